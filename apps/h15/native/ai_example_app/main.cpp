@@ -27,6 +27,7 @@
 #include "tracker_stage.hpp"
 #include "persist_stage.hpp"
 #include "aggregator_stage.hpp"
+#include "graph_builder.hpp"
 
 // Frontend Params
 #define FRONTEND_STAGE "frontend_stage"
@@ -95,6 +96,9 @@ enum class ArgumentType {
     Config,
     SkipDrawing,
     PartialLandmarks,
+    WorkStealing,
+    PipelineConfig,
+    MetricsFile,
     Error
 };
 
@@ -112,7 +116,10 @@ cxxopts::Options build_arg_parser()
   ("l, print-latency", "Print Latency", cxxopts::value<bool>()->default_value("false"))
   ("c, config-file-path", "Frontend Configuration Path", cxxopts::value<std::string>()->default_value(FRONTEND_CONFIG_FILE))
   ("s, skip-drawing", "Skip drawing", cxxopts::value<bool>()->default_value("false"))
-  ("p, partial-landmarks", "Draw only eyes for face landmarks", cxxopts::value<bool>()->default_value("false"));
+  ("p, partial-landmarks", "Draw only eyes for face landmarks", cxxopts::value<bool>()->default_value("false"))
+  ("w, work-stealing", "Run the stages on a shared work stealing thread pool instead of a thread per stage", cxxopts::value<bool>()->default_value("false"))
+  ("g, pipeline-config", "AI pipeline graph description (JSON) to build instead of the built in AI pipeline", cxxopts::value<std::string>()->default_value(""))
+  ("m, metrics-file", "File to write the stage latency and queue metrics (JSON) to every second", cxxopts::value<std::string>()->default_value(""));
   return options;
 }
 
@@ -148,6 +155,18 @@ std::vector<ArgumentType> handle_arguments(const cxxopts::ParseResult &result, c
         arguments.push_back(ArgumentType::PartialLandmarks);
     }
 
+    if (result.count("work-stealing")) {
+        arguments.push_back(ArgumentType::WorkStealing);
+    }
+
+    if (result.count("pipeline-config")) {
+        arguments.push_back(ArgumentType::PipelineConfig);
+    }
+
+    if (result.count("metrics-file")) {
+        arguments.push_back(ArgumentType::MetricsFile);
+    }
+
     // Handle unrecognized options
     for (const auto &unrecognized : result.unmatched()) {
         std::cerr << "Error: Unrecognized option or argument: " << unrecognized << std::endl;
@@ -174,7 +193,10 @@ struct AppResources
     bool print_latency;
     bool skip_drawing;
     bool partial_landmarks;
+    bool work_stealing;
     std::string frontend_config;
+    std::string pipeline_config;
+    std::string metrics_file;
 
     void clear()
     {
@@ -186,7 +208,10 @@ struct AppResources
         print_latency = false;
         skip_drawing = false;
         partial_landmarks = false;
+        work_stealing = false;
         frontend_config = "";
+        pipeline_config = "";
+        metrics_file = "";
     }
 
     ~AppResources()
@@ -383,6 +408,8 @@ void create_ai_pipeline(std::shared_ptr<AppResources> app_resources)
                                                                                      false, app_resources->print_fps);
     std::shared_ptr<PersistStage> tracker_stage = std::make_shared<PersistStage>(TRACKER_STAGE, 5, 1, false, app_resources->print_fps);
     std::shared_ptr<OverlayStage> overlay_stage = std::make_shared<OverlayStage>(OVERLAY_STAGE, app_resources->skip_drawing, app_resources->partial_landmarks, LANDMARKS_RANGE_MIN, LANDMARKS_RANGE_MAX, 1, false, app_resources->print_fps);
+    // The overlay feeds the encoder of the displayed stream, run it ahead of the AI stages when on the work stealing executor
+    overlay_stage->set_latency_critical(true);
     
     // Add stages to pipeline
     app_resources->pipeline->add_stage(tilling_stage);
@@ -409,6 +436,44 @@ void create_ai_pipeline(std::shared_ptr<AppResources> app_resources)
     tracker_stage->add_subscriber(overlay_stage);
     overlay_stage->add_subscriber(app_resources->encoders[AI_VISION_SINK]);
 }
+/**
+ * @brief Create the application's processing pipeline from a JSON graph description.
+ *
+ * Same as create_ai_pipeline, but the stages, their parameters and their connections are read from the
+ * file given with --pipeline-config (see configs/ai_pipeline.json), so they can be tuned without recompiling.
+ * The frontend streams are the inputs of the graph, and the encoder of the vision stream is its output.
+ *
+ * @param app_resources Shared pointer to the application's resources, which includes the pipeline object.
+ * @return AppStatus Status of loading and building the graph.
+ */
+AppStatus create_ai_pipeline_from_config(std::shared_ptr<AppResources> app_resources)
+{
+    PipelineGraphBuilder builder;
+    builder.add_external_stage(AI_VISION_SINK, app_resources->encoders[AI_VISION_SINK]);
+
+    // The drawing flags of the command line apply on top of the description
+    bool skip_drawing = app_resources->skip_drawing;
+    bool partial_landmarks = app_resources->partial_landmarks;
+    builder.register_stage_type(
+        "overlay",
+        [skip_drawing, partial_landmarks](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+        {
+            return std::make_shared<OverlayStage>(config.name,
+                                                  skip_drawing || PipelineGraphBuilder::get_bool(json, "skip_drawing", false),
+                                                  partial_landmarks || PipelineGraphBuilder::get_bool(json, "partial_landmarks", false),
+                                                  PipelineGraphBuilder::get_uint(json, "landmarks_range_min", 0),
+                                                  PipelineGraphBuilder::get_uint(json, "landmarks_range_max", 0),
+                                                  config.queue_size, config.leaky, print_fps);
+        });
+
+    AppStatus status = builder.load_file(app_resources->pipeline_config);
+    if (status != AppStatus::SUCCESS)
+    {
+        return status;
+    }
+    return builder.build(app_resources->pipeline, app_resources->print_fps);
+}
+
 /**
  * @brief Main function to initialize and run the application.
  *
@@ -467,6 +532,15 @@ int main(int argc, char *argv[])
             case ArgumentType::PartialLandmarks:
                 app_resources->partial_landmarks = true;
                 break;
+            case ArgumentType::WorkStealing:
+                app_resources->work_stealing = true;
+                break;
+            case ArgumentType::PipelineConfig:
+                app_resources->pipeline_config = result["pipeline-config"].as<std::string>();
+                break;
+            case ArgumentType::MetricsFile:
+                app_resources->metrics_file = result["metrics-file"].as<std::string>();
+                break;
             case ArgumentType::Error:
                 return 1;
             }
@@ -479,14 +553,27 @@ int main(int argc, char *argv[])
         configure_frontend_and_encoders(app_resources);
 
         // Create pipeline and stages
-        create_ai_pipeline(app_resources);
+        if (app_resources->pipeline_config.empty())
+        {
+            create_ai_pipeline(app_resources);
+        }
+        else if (create_ai_pipeline_from_config(app_resources) != AppStatus::SUCCESS)
+        {
+            return 1;
+        }
 
         // Subscribe stages to frontend
         subscribe_to_frontend(app_resources);
 
         // Start pipeline
         std::cout << "Starting." << std::endl;
-        app_resources->pipeline->start_pipeline();
+        app_resources->pipeline->start_pipeline(app_resources->work_stealing ? PipelineExecutionMode::WORK_STEALING
+                                                                             : PipelineExecutionMode::THREAD_PER_STAGE);
+        if (!app_resources->metrics_file.empty() || app_resources->print_latency)
+        {
+            // Latency percentiles of every stage and queue occupancy, to a file or to stdout
+            app_resources->pipeline->start_metrics_dump(std::chrono::seconds(1), app_resources->metrics_file);
+        }
 
         std::cout << "Using frontend config: " << app_resources->frontend_config << std::endl;
         std::cout << "Started playing for " << timeout << " seconds." << std::endl;
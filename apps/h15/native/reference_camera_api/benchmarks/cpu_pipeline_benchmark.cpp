@@ -0,0 +1,197 @@
+/**
+ * Runs a pipeline graph description (e.g. the ai_example_app configs/ai_pipeline.json) on the CPU backend,
+ * without the Hailo hardware, to profile the pipeline infra on any machine.
+ *
+ * The inputs of the graph are fed by a CpuFrontendStage, crop stages use the CPU crop and resize, inference
+ * stages replay recorded output tensors (<recordings-dir>/<stage name>.rec, recorded on the device with
+ * HailortAsyncStage::record_outputs) after their "latency_us", and the outputs of the graph are counted.
+ * Postprocess stages can be replaced by pass-through stages to measure the infra alone, without recordings.
+ * Prints the frames received by every output, the batches of the inference stages and the metrics snapshot of the pipeline.
+ */
+
+// General includes
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <cxxopts/cxxopts.hpp>
+
+// Infra includes
+#include "cpu_backend.hpp"
+#include "graph_builder.hpp"
+#include "pipeline.hpp"
+
+class PassThroughStage : public ConnectedStage
+{
+public:
+    PassThroughStage(std::string name, size_t queue_size, bool leaky) : ConnectedStage(name, queue_size, leaky, false) {}
+
+    AppStatus process(BufferPtr data) override
+    {
+        data->add_time_stamp(m_stage_id);
+        set_duration(data);
+        send_to_subscribers(data);
+        return AppStatus::SUCCESS;
+    }
+};
+
+static bool file_exists(const std::string &path)
+{
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+// Parses "sink0=3840x2160,sink2=1920x1080"
+static bool parse_inputs(const std::string &inputs, std::map<std::string, std::pair<int, int>> &sizes)
+{
+    std::stringstream stream(inputs);
+    std::string input;
+    while (std::getline(stream, input, ','))
+    {
+        size_t equal = input.find('='), x = input.find('x', equal);
+        if (equal == std::string::npos || x == std::string::npos)
+        {
+            std::cerr << "Invalid input '" << input << "', expected name=WIDTHxHEIGHT" << std::endl;
+            return false;
+        }
+        sizes[input.substr(0, equal)] = {std::stoi(input.substr(equal + 1, x - equal - 1)), std::stoi(input.substr(x + 1))};
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options("CPU pipeline benchmark");
+    options.add_options()
+    ("h,help", "Show this help")
+    ("g,pipeline-config", "Pipeline graph description (JSON)", cxxopts::value<std::string>())
+    ("inputs", "Inputs of the graph and their frame sizes", cxxopts::value<std::string>()->default_value("sink0=3840x2160,sink2=1920x1080"))
+    ("outputs", "Outputs of the graph (stages of the application)", cxxopts::value<std::string>()->default_value("sink0"))
+    ("fps", "Frame rate of the inputs", cxxopts::value<double>()->default_value("30"))
+    ("input-pool-size", "Frames of every input that can be in the pipeline at once", cxxopts::value<size_t>()->default_value("10"))
+    ("t,timeout", "Time to run in seconds", cxxopts::value<int>()->default_value("10"))
+    ("recordings-dir", "Directory of the recorded output tensors of the inference stages", cxxopts::value<std::string>()->default_value(""))
+    ("inference-latency", "Latency of inference stages without \"latency_us\" in micro seconds", cxxopts::value<int>()->default_value("10000"))
+    ("skip-postprocess", "Replace the postprocess stages by pass-through stages")
+    ("w,work-stealing", "Run the stages on a shared work stealing thread pool");
+    auto args = options.parse(argc, argv);
+    if (args.count("help") || !args.count("pipeline-config"))
+    {
+        std::cout << options.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    std::map<std::string, std::pair<int, int>> input_sizes;
+    if (!parse_inputs(args["inputs"].as<std::string>(), input_sizes))
+    {
+        return 1;
+    }
+    std::string recordings_dir = args["recordings-dir"].as<std::string>();
+    std::chrono::microseconds default_latency(args["inference-latency"].as<int>());
+
+    PipelinePtr pipeline = std::make_shared<Pipeline>();
+    PipelineGraphBuilder builder;
+
+    // Outputs count the frames they receive
+    std::map<std::string, std::shared_ptr<std::atomic<uint64_t>>> received;
+    std::stringstream outputs(args["outputs"].as<std::string>());
+    std::string output;
+    while (std::getline(outputs, output, ','))
+    {
+        auto counter = std::make_shared<std::atomic<uint64_t>>(0);
+        received[output] = counter;
+        CallbackStagePtr sink = std::make_shared<CallbackStage>(output, 5, true);
+        sink->set_callback([counter](BufferPtr data)
+                           { (*counter)++; });
+        builder.add_external_stage(output, sink);
+        pipeline->add_stage(sink, StageType::SINK);
+    }
+
+    builder.register_stage_type(
+        "hailort",
+        [recordings_dir, default_latency](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+        {
+            std::string recording = recordings_dir.empty() ? "" : recordings_dir + "/" + config.name + ".rec";
+            if (!recording.empty() && !file_exists(recording))
+            {
+                std::cout << "No recording for " << config.name << ", replaying without tensors" << std::endl;
+                recording = "";
+            }
+            std::chrono::microseconds latency = (config.latency_us > 0) ? std::chrono::microseconds((int64_t)config.latency_us) : default_latency;
+            ReplayInferenceStagePtr stage = std::make_shared<ReplayInferenceStage>(config.name, recording, latency, config.in_flight_limit,
+                                                                                   config.queue_size, print_fps, PipelineGraphBuilder::get_uint(json, "batch_size", 1));
+            stage->set_batching(PipelineGraphBuilder::get_batch_timeout(json), PipelineGraphBuilder::get_bool(json, "adaptive_batching", false),
+                                PipelineGraphBuilder::get_uint(json, "min_batch", 1));
+            return stage;
+        },
+        [](GraphStageConfig &config, const rapidjson::Value &json)
+        {
+            config.owns_pool = true;
+            config.pool_size = PipelineGraphBuilder::get_uint(json, "pool_size");
+            config.in_flight_limit = PipelineGraphBuilder::get_uint(json, "jobs_limit", 1);
+        });
+    if (args.count("skip-postprocess"))
+    {
+        builder.register_stage_type(
+            "postprocess",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<PassThroughStage>(config.name, config.queue_size, config.leaky);
+            });
+    }
+
+    if (builder.load_file(args["pipeline-config"].as<std::string>()) != AppStatus::SUCCESS ||
+        builder.build(pipeline) != AppStatus::SUCCESS)
+    {
+        return 1;
+    }
+
+    // Crop stages crop and resize on the CPU
+    for (auto &stage : builder.get_stages())
+    {
+        std::shared_ptr<DspBaseCropStage> crop_stage = std::dynamic_pointer_cast<DspBaseCropStage>(stage.second);
+        if (crop_stage != nullptr)
+            crop_stage->set_backend(std::make_shared<CpuCropResizeBackend>());
+    }
+
+    CpuFrontendStagePtr frontend = std::make_shared<CpuFrontendStage>("cpu_frontend", args["fps"].as<double>());
+    for (auto &input : input_sizes)
+    {
+        frontend->add_stream(input.first, input.second.first, input.second.second, args["input-pool-size"].as<size_t>());
+    }
+    for (auto &connection : builder.get_input_connections())
+    {
+        if (!input_sizes.count(connection.first))
+        {
+            std::cerr << "No frame size for input " << connection.first << ", set it with --inputs" << std::endl;
+            return 1;
+        }
+        frontend->subscribe_to_stream(connection.first, builder.get_stages().at(connection.second));
+    }
+    pipeline->add_stage(frontend, StageType::SOURCE);
+
+    pipeline->start_pipeline(args.count("work-stealing") ? PipelineExecutionMode::WORK_STEALING : PipelineExecutionMode::THREAD_PER_STAGE);
+    std::this_thread::sleep_for(std::chrono::seconds(args["timeout"].as<int>()));
+    pipeline->stop_pipeline();
+
+    double seconds = args["timeout"].as<int>();
+    for (auto &counter : received)
+    {
+        std::cout << counter.first << ": " << *counter.second << " frames (" << *counter.second / seconds << " fps)" << std::endl;
+    }
+    for (auto &input : input_sizes)
+    {
+        std::cout << input.first << ": " << frontend->get_dropped_frames(input.first) << " frames dropped at the input" << std::endl;
+    }
+    for (auto &stage : builder.get_stages())
+    {
+        ReplayInferenceStagePtr inference_stage = std::dynamic_pointer_cast<ReplayInferenceStage>(stage.second);
+        if (inference_stage == nullptr)
+            continue;
+        InferBatcher::Stats stats = inference_stage->get_batch_stats();
+        std::cout << stage.first << ": " << stats.batches << " batches, " << (stats.batches ? double(stats.buffers) / stats.batches : 0)
+                  << " buffers per batch, " << stats.deadline_batches << " on the deadline, batch size " << stats.batch_size << std::endl;
+    }
+    std::cout << pipeline->get_metrics_snapshot().to_json() << std::endl;
+    return 0;
+}
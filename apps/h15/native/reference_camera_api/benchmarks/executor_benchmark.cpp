@@ -0,0 +1,190 @@
+/**
+ * Compares the thread per stage and the work stealing execution modes of the pipeline infra with stub stages.
+ *
+ * Several independent chains of stages (one per stream) are fed from the main thread, every stage spins for
+ * a fixed time on each buffer and pushes it on, and a callback stage at the end of every chain records the
+ * latency from the source. No Hailo hardware is used, the buffers carry no frame, so it builds and runs
+ * without the media library SDK (e.g. on a host).
+ * Reports throughput, mean and max latency, CPU time and context switches of every mode, and optionally the
+ * metrics snapshot of the pipeline (per stage latency percentiles and queue occupancy).
+ */
+
+// General includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <sys/resource.h>
+#include <cxxopts/cxxopts.hpp>
+
+// Infra includes
+#include "pipeline.hpp"
+
+#define SOURCE_NAME "source"
+
+class BusyStage : public ConnectedStage
+{
+private:
+    std::chrono::microseconds m_work_time;
+
+public:
+    BusyStage(std::string name, std::chrono::microseconds work_time, size_t queue_size) :
+        ConnectedStage(name, queue_size, false, false), m_work_time(work_time) {}
+
+    AppStatus process(BufferPtr data) override
+    {
+        auto busy_until = std::chrono::steady_clock::now() + m_work_time;
+        while (std::chrono::steady_clock::now() < busy_until)
+        {
+        }
+        data->add_time_stamp(m_stage_id);
+        set_duration(data);
+        send_to_subscribers(data);
+        return AppStatus::SUCCESS;
+    }
+};
+
+struct BenchmarkResult
+{
+    double total_ms;
+    double mean_latency_us;
+    double max_latency_us;
+    double cpu_ms;
+    long context_switches;
+};
+
+static double cpu_time_ms(const struct rusage &usage)
+{
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+BenchmarkResult run_benchmark(PipelineExecutionMode mode, size_t num_streams, size_t num_stages, size_t num_buffers,
+                              std::chrono::microseconds work_time, size_t queue_size, size_t num_workers, bool print_metrics)
+{
+    PipelinePtr pipeline = std::make_shared<Pipeline>();
+    std::vector<ConnectedStagePtr> first_stages;
+
+    std::mutex done_mutex;
+    std::condition_variable done_cv;
+    size_t received = 0;
+    double total_latency_us = 0, max_latency_us = 0;
+
+    for (size_t stream = 0; stream < num_streams; stream++)
+    {
+        ConnectedStagePtr previous;
+        for (size_t i = 0; i < num_stages; i++)
+        {
+            std::string name = "stream" + std::to_string(stream) + "_stage" + std::to_string(i);
+            ConnectedStagePtr stage = std::make_shared<BusyStage>(name, work_time, queue_size);
+            if (previous == nullptr)
+            {
+                stage->add_queue(SOURCE_NAME);
+                first_stages.push_back(stage);
+            }
+            else
+            {
+                previous->add_subscriber(stage);
+            }
+            pipeline->add_stage(stage);
+            previous = stage;
+        }
+
+        CallbackStagePtr sink = std::make_shared<CallbackStage>("stream" + std::to_string(stream) + "_sink", queue_size);
+        sink->set_callback([&](BufferPtr data)
+                           {
+                               double latency_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - data->get_time_stamp(0)).count();
+                               std::lock_guard<std::mutex> lock(done_mutex);
+                               total_latency_us += latency_us;
+                               max_latency_us = std::max(max_latency_us, latency_us);
+                               received++;
+                               done_cv.notify_all(); });
+        previous->add_subscriber(sink);
+        pipeline->add_stage(sink, StageType::SINK);
+    }
+
+    struct rusage usage_start, usage_end;
+    getrusage(RUSAGE_SELF, &usage_start);
+    auto start = std::chrono::steady_clock::now();
+    pipeline->start_pipeline(mode, num_workers);
+
+    for (size_t i = 0; i < num_buffers; i++)
+    {
+        for (auto &stage : first_stages)
+        {
+            stage->push(std::make_shared<Buffer>(nullptr), SOURCE_NAME);
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(done_mutex);
+        done_cv.wait(lock, [&]
+                     { return received == num_buffers * num_streams; });
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    getrusage(RUSAGE_SELF, &usage_end);
+    pipeline->stop_pipeline();
+    if (print_metrics)
+    {
+        std::cout << pipeline->get_metrics_snapshot().to_json() << std::endl;
+    }
+
+    BenchmarkResult result;
+    result.total_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    result.mean_latency_us = total_latency_us / received;
+    result.max_latency_us = max_latency_us;
+    result.cpu_ms = cpu_time_ms(usage_end) - cpu_time_ms(usage_start);
+    result.context_switches = (usage_end.ru_nvcsw + usage_end.ru_nivcsw) - (usage_start.ru_nvcsw + usage_start.ru_nivcsw);
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options("Pipeline executor benchmark");
+    options.add_options()
+    ("h,help", "Show this help")
+    ("streams", "Number of parallel chains of stages", cxxopts::value<size_t>()->default_value("4"))
+    ("stages", "Number of stages in every chain", cxxopts::value<size_t>()->default_value("8"))
+    ("buffers", "Number of buffers pushed to every chain", cxxopts::value<size_t>()->default_value("2000"))
+    ("work-time", "Processing time of every stage per buffer in micro seconds", cxxopts::value<int>()->default_value("50"))
+    ("queue-size", "Size of the stage queues", cxxopts::value<size_t>()->default_value("5"))
+    ("workers", "Number of executor workers, 0 uses one per core", cxxopts::value<size_t>()->default_value("0"))
+    ("metrics", "Print the metrics snapshot of the pipeline after every mode");
+    auto args = options.parse(argc, argv);
+    if (args.count("help"))
+    {
+        std::cout << options.help() << std::endl;
+        return 0;
+    }
+
+    size_t num_streams = args["streams"].as<size_t>();
+    size_t num_stages = args["stages"].as<size_t>();
+    size_t num_buffers = args["buffers"].as<size_t>();
+    std::chrono::microseconds work_time(args["work-time"].as<int>());
+    size_t queue_size = args["queue-size"].as<size_t>();
+    size_t num_workers = args["workers"].as<size_t>();
+    bool print_metrics = args.count("metrics") > 0;
+
+    std::cout << num_streams << " streams x " << num_stages << " stages, " << num_buffers << " buffers per stream, "
+              << work_time.count() << " us per stage" << std::endl;
+    std::cout << std::left << std::setw(20) << "mode" << std::setw(12) << "fps" << std::setw(20) << "mean latency [us]"
+              << std::setw(20) << "max latency [us]" << std::setw(12) << "cpu [ms]" << "context switches" << std::endl;
+
+    std::vector<std::pair<std::string, PipelineExecutionMode>> modes = {
+        {"thread per stage", PipelineExecutionMode::THREAD_PER_STAGE},
+        {"work stealing", PipelineExecutionMode::WORK_STEALING}};
+    for (auto &mode : modes)
+    {
+        BenchmarkResult result = run_benchmark(mode.second, num_streams, num_stages, num_buffers, work_time, queue_size, num_workers, print_metrics);
+        std::cout << std::left << std::setw(20) << mode.first
+                  << std::setw(12) << std::fixed << std::setprecision(0) << (num_buffers * num_streams) / (result.total_ms / 1000.0)
+                  << std::setw(20) << result.mean_latency_us
+                  << std::setw(20) << result.max_latency_us
+                  << std::setw(12) << result.cpu_ms
+                  << result.context_switches << std::endl;
+    }
+    return 0;
+}
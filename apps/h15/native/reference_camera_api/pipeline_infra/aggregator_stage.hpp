@@ -48,6 +48,12 @@ public:
 
     void add_queue(std::string name) override {}
 
+    // The loop waits for the sub frames of every main frame, keep a dedicated thread on an executor.
+    bool runs_as_task() override
+    {
+        return false;
+    }
+
     HailoBBox create_flattened_bbox(const HailoBBox &bbox, const HailoBBox &parent_bbox)
     {
         float xmin = parent_bbox.xmin() + bbox.xmin() * parent_bbox.width();
@@ -189,7 +195,7 @@ public:
                 // If no subframes are requested, send the main buffer as is
                 if (num_subframes == 0)
                 {
-                    main_buffer->add_time_stamp(m_stage_name);
+                    main_buffer->add_time_stamp(m_stage_id);
                     set_duration(main_buffer);
                     send_to_subscribers(main_buffer);
                     continue;
@@ -226,7 +232,7 @@ public:
                     }
                 } else {
                     // if not blocking and not enough subframes, then continue
-                    main_buffer->add_time_stamp(m_stage_name);
+                    main_buffer->add_time_stamp(m_stage_id);
                     set_duration(main_buffer);
                     send_to_subscribers(main_buffer);
                     continue;
@@ -259,7 +265,7 @@ public:
                 nms(main_buffer->get_roi(), m_iou_threshold);
             }
 
-            main_buffer->add_time_stamp(m_stage_name);
+            main_buffer->add_time_stamp(m_stage_id);
             // pass the main_buffer to the subscribers
             set_duration(main_buffer);
             send_to_subscribers(main_buffer);
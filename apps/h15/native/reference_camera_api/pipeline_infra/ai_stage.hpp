@@ -16,35 +16,66 @@
 // Tappas includes
 #include "hailo_objects.hpp"
 
-// Media library includes
-#include "media_library/media_library_types.hpp"
-
 // Infra includes
+#include "batcher.hpp"
 #include "buffer.hpp"
+#include "media_library_buffer.hpp"
 #include "queue.hpp"
 #include "stage.hpp"
+#include "tensor_recording.hpp"
 
 /**
  * @brief Class representing an asynchronous HailoRT stage in a connected stage pipeline.
  * 
  * This class is responsible for managing the HailoRT inference model, setting up
  * buffer pools, and executing asynchronous inference jobs.
+ *
+ * Input buffers are accumulated into batches of up to batch_size buffers (see InferBatcher), and every batch is
+ * bound and submitted to HailoRT as one job. The batch is submitted when it is full, or when its first buffer
+ * has waited the batch timeout. With adaptive batching the batch size follows the depth of the input queue.
  */
 class HailortAsyncStage : public ConnectedStage
 {
 private:
+    /**
+     * @brief An output tensor of the network, in the order of the outputs of the infer model.
+     */
+    struct OutputTensor
+    {
+        std::string name;
+        size_t frame_size;
+        hailo_vstream_info_t vstream_info;
+        BufferPoolPtr pool;
+    };
+
+    /**
+     * @brief The buffers of a submitted batch, shared with its completion callback.
+     */
+    struct InferBatch
+    {
+        std::vector<BufferPtr> inputs;
+        std::vector<std::vector<BufferPtr>> outputs; ///< Output tensor buffers of every input, in the order of m_outputs.
+        std::chrono::steady_clock::time_point begin;
+    };
+    using InferBatchPtr = std::shared_ptr<InferBatch>;
+
     // pool members
     int m_output_pool_size;  ///< Size of the output buffer pool.
-    std::unordered_map<std::string, MediaLibraryBufferPoolPtr> m_tensor_buffer_pools; ///< Buffer pools for each output tensor.
+    std::vector<OutputTensor> m_outputs; ///< Output tensors with their buffer pools.
     
     // hailort members
     std::unique_ptr<hailort::VDevice> m_vdevice;    ///< HailoRT virtual device.
     std::shared_ptr<hailort::InferModel> m_infer_model; ///< HailoRT inference model.
     hailort::ConfiguredInferModel m_configured_infer_model; ///< Configured HailoRT inference model.
-    hailort::ConfiguredInferModel::Bindings m_bindings; ///< Bindings for connecting buffers to the inference model.
-    std::unordered_map<std::string, hailo_vstream_info_t> m_vstream_infos; ///< Information about each virtual stream.
+    std::vector<hailort::ConfiguredInferModel::Bindings> m_bindings; ///< Bindings for every buffer of a batch.
     std::shared_ptr<hailort::AsyncInferJob> m_last_infer_job; ///< Pointer to the last asynchronous inference job.
 
+    // batching members
+    InferBatcherPtr m_batcher; ///< Accumulates the input buffers into batches.
+    std::chrono::microseconds m_batch_timeout = INFER_BATCH_DEFAULT_TIMEOUT; ///< Longest wait of a buffer for its batch.
+    bool m_adaptive_batching = false; ///< Whether the batch size follows the input queue depth.
+    size_t m_min_batch = 1; ///< Smallest batch size of adaptive batching.
+
     // network members
     std::string m_hef_path; ///< Path to the Hailo Execution File (HEF).
     std::string m_group_id; ///< Group ID for the HailoRT device.
@@ -59,6 +90,11 @@ private:
     std::condition_variable m_available_buffers_cv;
     std::mutex m_buff_pool_mutex;
     StagePoolMode m_pool_mode; //< Pool mode for the buffer pool used in this stage
+
+    // recording members
+    std::string m_recording_path; ///< File the output tensors are recorded to, empty if not recording.
+    size_t m_recording_max_frames = 0; ///< Number of frames to record.
+    TensorRecordingPtr m_recording; ///< Recorded output tensors, saved on deinit.
     
     
 public:
@@ -70,7 +106,8 @@ public:
      * @param queue_size Size of the processing queue.
      * @param output_pool_size Size of the output buffer pool.
      * @param group_id Group ID for the HailoRT device.
-     * @param batch_size Batch size for inference.
+     * @param batch_size Batch size for inference, the largest batch submitted at once.
+     * @param job_limit Limit on the number of buffers in inference at once.
      * @param scheduler_threshold Threshold for the scheduler.
      * @param scheduler_timeout Timeout for the scheduler.
      * @param print_fps Whether to print frames per second information.
@@ -85,6 +122,41 @@ public:
         m_active_jobs = 0;
     }
 
+    /**
+     * @brief Batching settings, call before the stage is started. Batches are up to batch_size buffers.
+     * 
+     * @param timeout Longest wait of a buffer for its batch to fill.
+     * @param adaptive Follow the depth of the input queue with the batch size, between min_batch and batch_size.
+     * @param min_batch Smallest batch size of adaptive batching.
+     */
+    void set_batching(std::chrono::microseconds timeout, bool adaptive = false, size_t min_batch = 1)
+    {
+        m_batch_timeout = timeout;
+        m_adaptive_batching = adaptive;
+        m_min_batch = min_batch;
+    }
+
+    /**
+     * @brief Batches submitted so far and the current batch size.
+     */
+    InferBatcher::Stats get_batch_stats()
+    {
+        return (m_batcher != nullptr) ? m_batcher->get_stats() : InferBatcher::Stats();
+    }
+
+    /**
+     * @brief Record the output tensors of the first frames, to replay them without the hardware (see ReplayInferenceStage).
+     *        Call before the stage is started, the recording is saved when the stage stops.
+     * 
+     * @param path File to save the recording to.
+     * @param max_frames Number of frames to record.
+     */
+    void record_outputs(std::string path, size_t max_frames)
+    {
+        m_recording_path = path;
+        m_recording_max_frames = max_frames;
+    }
+
     /**
      * @brief Initialize the HailoRT stage.
      * 
@@ -123,36 +195,59 @@ public:
         m_configured_infer_model.set_scheduler_threshold(m_scheduler_threshold);
         m_configured_infer_model.set_scheduler_timeout(std::chrono::milliseconds(m_scheduler_timeout));
         
-        // Create bindings through which to connect buffers for inference
-        auto bindings = m_configured_infer_model.create_bindings();
-        if (!bindings) {
-            std::cerr << "Failed to create infer bindings, Hailort status = " << bindings.status() << std::endl;
+        // Create bindings through which to connect buffers for inference, one for every buffer of a batch
+        size_t max_batch = std::min<size_t>(std::max(m_batch_size, 1), std::max<size_t>(m_jobs_limit, 1));
+        m_bindings.clear();
+        for (size_t i = 0; i < max_batch; i++) {
+            auto bindings = m_configured_infer_model.create_bindings();
+            if (!bindings) {
+                std::cerr << "Failed to create infer bindings, Hailort status = " << bindings.status() << std::endl;
+                return AppStatus::HAILORT_ERROR;
+            }
+            m_bindings.emplace_back(bindings.release());
+        }
+
+        // Gather the vstream info for each output tensor
+        auto vstream_infos = m_infer_model->hef().get_output_vstream_infos();
+        if (!vstream_infos) {
+            std::cerr << "Failed to get vstream info, Hailort status = " << vstream_infos.status() << std::endl;
             return AppStatus::HAILORT_ERROR;
         }
-        m_bindings = bindings.release();
 
         // Prepare a buffer pool for each output tensor
+        m_outputs.clear();
         for (auto &output : m_infer_model->outputs()) {
-            size_t tensor_size = output.get_frame_size();
+            OutputTensor tensor;
+            tensor.name = output.name();
+            tensor.frame_size = output.get_frame_size();
+            for (const auto &vstream_info : vstream_infos.value()) {
+                if (tensor.name == vstream_info.name)
+                    tensor.vstream_info = vstream_info;
+            }
             std::string tensor_name = m_stage_name + "/" + output.name();
-            m_tensor_buffer_pools[output.name()] = std::make_shared<MediaLibraryBufferPool>(tensor_size, 1, HAILO_FORMAT_GRAY8,
-                                                                                             m_output_pool_size, HAILO_MEMORY_TYPE_DMABUF, tensor_size, tensor_name);
-            if (m_tensor_buffer_pools[output.name()]->init() != MEDIA_LIBRARY_SUCCESS)
+            MediaLibraryBufferPoolPtr pool = std::make_shared<MediaLibraryBufferPool>(tensor.frame_size, 1, HAILO_FORMAT_GRAY8,
+                                                                                      m_output_pool_size, HAILO_MEMORY_TYPE_DMABUF, tensor.frame_size, tensor_name);
+            if (pool->init() != MEDIA_LIBRARY_SUCCESS)
             {
                 return AppStatus::BUFFER_ALLOCATION_ERROR;
             }
+            tensor.pool = std::make_shared<MediaLibraryFramePool>(pool);
+            m_outputs.push_back(tensor);
         }
 
-        // Gather the vstream info for each output tensor
-        auto vstream_infos = m_infer_model->hef().get_output_vstream_infos();
-        if (!vstream_infos) {
-            std::cerr << "Failed to get vstream info, Hailort status = " << vstream_infos.status() << std::endl;
-            return AppStatus::HAILORT_ERROR;
-        }
-        for (const auto &vstream_info : vstream_infos.value()) {
-            m_vstream_infos[vstream_info.name] = vstream_info;
+        if (!m_recording_path.empty())
+        {
+            m_recording = std::make_shared<TensorRecording>();
+            for (auto &output : m_outputs) {
+                m_recording->add_tensor(output.vstream_info, output.frame_size);
+            }
         }
 
+        m_batcher = std::make_shared<InferBatcher>([this](std::vector<BufferPtr> &batch) { submit_batch(batch); },
+                                                   [this]() -> size_t { return m_queues.empty() ? 0 : m_queues[0]->size(); },
+                                                   max_batch, m_batch_timeout, m_adaptive_batching, m_min_batch);
+        m_batcher->start();
+
         return AppStatus::SUCCESS;
     }
 
@@ -163,6 +258,10 @@ public:
      */
     AppStatus deinit() override
     {
+        if (m_batcher != nullptr) {
+            m_dropped_buffers += m_batcher->stop();
+        }
+
         // Wait for last infer to finish
         if (m_last_infer_job) {
             auto status = m_last_infer_job->wait(std::chrono::milliseconds(10000));
@@ -176,17 +275,29 @@ public:
             queue->flush();
         }
 
+        if (m_recording != nullptr)
+        {
+            std::cout << m_stage_name << " saving " << m_recording->num_frames() << " recorded frames to " << m_recording_path << std::endl;
+            m_recording->save(m_recording_path);
+            m_recording = nullptr;
+        }
+
         return AppStatus::SUCCESS;
     }
 
     /**
      * @brief Set pixel buffer for the inference input.
      * 
+     * @param bindings Bindings of the buffer.
      * @param buffer Buffer containing the pixel data.
      * @return AppStatus Status of setting the pixel buffer.
      */
-    AppStatus set_pix_buf(const HailoMediaLibraryBufferPtr buffer)
+    AppStatus set_pix_buf(hailort::ConfiguredInferModel::Bindings &bindings, const HailoMediaLibraryBufferPtr buffer)
     {
+        if (buffer == nullptr) {
+            std::cerr << m_stage_name << " requires media library buffers" << std::endl;
+            return AppStatus::INVALID_ARGUMENT;
+        }
         int y_plane_fd = buffer->get_plane_fd(0);
         uint32_t y_plane_size = buffer->get_plane_size(0);
 
@@ -204,7 +315,7 @@ public:
         pix_buffer.planes[1].plane_size = uv_plane_size;
         pix_buffer.planes[1].fd = uv_plane_fd;
 
-        auto status = m_bindings.input()->set_pix_buffer(pix_buffer);
+        auto status = bindings.input()->set_pix_buffer(pix_buffer);
         if (HAILO_SUCCESS != status) {
             std::cerr << "Failed to set infer input buffer, Hailort status = " << status << std::endl;
             return AppStatus::HAILORT_ERROR;
@@ -216,39 +327,36 @@ public:
      /**
      * @brief Acquire and set tensor buffers for the inference output.
      * 
-     * @param tensor_buffers Map of tensor buffers to be acquired and set.
+     * @param bindings Bindings of the buffer.
+     * @param tensor_buffers Acquired tensor buffers, in the order of the outputs. Left empty when the frame is dropped (leaky pool).
      * @return AppStatus Status of acquiring and setting the tensor buffers.
      */
-    AppStatus acquire_and_set_tensor_buffers(std::unordered_map<std::string, BufferPtr> &tensor_buffers)
+    AppStatus acquire_and_set_tensor_buffers(hailort::ConfiguredInferModel::Bindings &bindings, std::vector<BufferPtr> &tensor_buffers)
     {
         // Acquire a buffer for each output tensor
-        for (auto &output : m_infer_model->outputs()) {
+        tensor_buffers.reserve(m_outputs.size());
+        for (auto &output : m_outputs) {
             // Acquire a buffer for this tensor output from the corresponding buffer pool
-            HailoMediaLibraryBufferPtr tensor_buffer = std::make_shared<hailo_media_library_buffer>();
-            BufferPtr tensor_buffer_ptr = std::make_shared<Buffer>(tensor_buffer);
-            if (m_tensor_buffer_pools[output.name()]->acquire_buffer(tensor_buffer) != MEDIA_LIBRARY_SUCCESS)
+            BufferPtr tensor_buffer = output.pool->acquire_buffer();
+            if (tensor_buffer == nullptr)
             {
                 if (m_pool_mode == StagePoolMode::FAIL_ON_EMPTY_POOL) {
                     return AppStatus::BUFFER_ALLOCATION_ERROR;
                 } else if (m_pool_mode == StagePoolMode::BLOCKING) {
                     std::unique_lock<std::mutex> lock(m_buff_pool_mutex);
-                    m_available_buffers_cv.wait(lock, [this, output, tensor_buffer] { return m_tensor_buffer_pools[output.name()]->acquire_buffer(tensor_buffer) == MEDIA_LIBRARY_SUCCESS; });
+                    m_available_buffers_cv.wait(lock, [&output, &tensor_buffer] { return (tensor_buffer = output.pool->acquire_buffer()) != nullptr; });
                 } else {
-                    for (auto& buffer : tensor_buffers) {
-                        buffer.second.reset();
-                    }
+                    tensor_buffers.clear();
                     return AppStatus::SUCCESS;
                 }
             }
 
-            // Set entry in map
-            tensor_buffers[output.name()] = tensor_buffer_ptr;
+            tensor_buffers.push_back(tensor_buffer);
 
             // Set the HailoRT bindings for the acquired buffer
-            size_t tensor_size = output.get_frame_size();
-            auto status = m_bindings.output(output.name())->set_buffer(hailort::MemoryView(tensor_buffer->get_plane_ptr(0), tensor_size));
+            auto status = bindings.output(output.name)->set_buffer(hailort::MemoryView(tensor_buffer->get_frame()->get_plane_ptr(0), output.frame_size));
             if (HAILO_SUCCESS != status) {
-                std::cerr << m_stage_name << " failed to set infer output buffer "<< output.name() << ", Hailort status = " << status << std::endl;
+                std::cerr << m_stage_name << " failed to set infer output buffer "<< output.name << ", Hailort status = " << status << std::endl;
                 return AppStatus::HAILORT_ERROR;
             }
         }
@@ -256,103 +364,183 @@ public:
     }
 
     /**
-     * @brief Perform inference on the input buffer by triggering an async infer job.
-     * This job calls the given callback on completion.
+     * @brief Send the buffers of a completed batch to the next stages, with their output tensors.
      * 
-     * @param input_buffer Buffer containing the input data.
-     * @param tensor_buffers Map of tensor buffers for the inference output.
-     * @return AppStatus Status of the inference.
-     */    
-    AppStatus infer(BufferPtr input_buffer, const std::unordered_map<std::string, BufferPtr> &tensor_buffers)
+     * @param batch The completed batch.
+     * @param status Status of the inference.
+     */
+    void complete_batch(InferBatch &batch, hailo_status status)
     {
-        // wait for infer model to be ready
-        auto status = m_configured_infer_model.wait_for_async_ready(std::chrono::milliseconds(1000));
-        if (HAILO_SUCCESS != status) {
-            std::cerr << "Failed to wait for async ready, Hailort status = " << status << std::endl;
-            return AppStatus::HAILORT_ERROR;
+        // active jobs finished
+        {
+            std::unique_lock<std::mutex> lock(m_active_jobs_mutex);
+            m_active_jobs -= batch.inputs.size();
         }
+        m_active_jobs_cv.notify_all();
 
-        // Run the async infer api, when inference is done it will call the given callback
-        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
-        auto job = m_configured_infer_model.run_async(m_bindings, [tensor_buffers, input_buffer, begin, this](const hailort::AsyncInferCompletionInfo& completion_info) {
-            // active job finished
-            --this->m_active_jobs;
-            m_active_jobs_cv.notify_one();
-            
-            // check infer status
-            if (completion_info.status != HAILO_SUCCESS) {
-                std::cerr << "Failed to run async infer, Hailort status = " << completion_info.status << std::endl;
-                return AppStatus::HAILORT_ERROR;
-            }
+        // check infer status
+        if (status != HAILO_SUCCESS) {
+            m_dropped_buffers += batch.inputs.size();
+            std::cerr << m_stage_name << " failed to run async infer, dropped " << batch.inputs.size() << " buffers, Hailort status = " << status << std::endl;
+            return;
+        }
+
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        if (m_print_fps)
+        {
+            std::cout << "Inference time (" << m_stage_name << ") = " << std::chrono::duration_cast<std::chrono::microseconds>(end - batch.begin).count()
+                      << "[microseconds] batch of " << batch.inputs.size() << std::endl;
+        }
+
+        for (size_t frame = 0; frame < batch.inputs.size(); frame++) {
+            BufferPtr &input_buffer = batch.inputs[frame];
+            std::vector<BufferPtr> &tensor_buffers = batch.outputs[frame];
 
             // Add metadata for each output tensor buffer
-            for (auto &output : m_infer_model->outputs()) {
-                BufferPtr tensor_buffer = tensor_buffers.at(output.name());
-                TensorMetadataPtr tensor_metadata = std::make_shared<TensorMetadata>(tensor_buffer, output.name());
+            for (size_t i = 0; i < m_outputs.size(); i++) {
+                TensorMetadataPtr tensor_metadata = std::make_shared<TensorMetadata>(tensor_buffers[i], m_outputs[i].name);
                 input_buffer->add_metadata(tensor_metadata);
 
                 // Add the vstream info and data pointer to the HailoRoi for later use (postprocessing)
-                input_buffer->get_roi()->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(tensor_buffer->get_buffer()->get_plane_ptr(0)), 
-                                                                                  m_vstream_infos[output.name()]));
+                HailoTensorPtr tensor = std::make_shared<HailoTensor>(tensor_buffers[i]->get_frame()->get_plane_ptr(0), m_outputs[i].vstream_info);
+                // The tensor buffer owns the data, so postprocess results can reference it without a copy
+                tensor->set_owner(tensor_buffers[i]);
+                input_buffer->get_roi()->add_tensor(tensor);
             }
 
-            std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-            if (m_print_fps)
+            if (m_recording != nullptr && m_recording->num_frames() < m_recording_max_frames)
             {
-                std::cout << "Inference time (" << m_stage_name << ") = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "[microseconds]" << std::endl;
+                std::vector<const uint8_t *> tensor_data;
+                for (auto &tensor_buffer : tensor_buffers) {
+                    tensor_data.push_back(tensor_buffer->get_frame()->get_plane_ptr(0));
+                }
+                m_recording->add_frame(tensor_data);
             }
-            
+
             // Send the input buffer to the next stage
-            input_buffer->add_time_stamp(m_stage_name);
+            input_buffer->add_time_stamp(m_stage_id);
             set_duration(input_buffer);
             send_to_subscribers(input_buffer);
+        }
+    }
 
+    /**
+     * @brief Bind a batch of input buffers and submit it as one async infer job.
+     * The job calls complete_batch on completion. Buffers without output buffers (leaky pool) are dropped
+     * and counted, on failure none of the buffers are submitted.
+     * 
+     * @param buffers Buffers of the batch, up to the batch size.
+     * @return AppStatus Status of the inference.
+     */
+    AppStatus infer(std::vector<BufferPtr> &buffers)
+    {
+        // wait for room for the batch
+        {
+            std::unique_lock<std::mutex> lock(m_active_jobs_mutex);
+            m_active_jobs_cv.wait(lock, [this, &buffers] { return m_active_jobs + buffers.size() <= m_jobs_limit || m_active_jobs == 0; });
+        }
+
+        InferBatchPtr batch = std::make_shared<InferBatch>();
+        size_t skipped = 0;
+        batch->inputs.reserve(buffers.size());
+        batch->outputs.reserve(buffers.size());
+        for (auto &buffer : buffers) {
+            hailort::ConfiguredInferModel::Bindings &bindings = m_bindings[batch->inputs.size()];
+            if (set_pix_buf(bindings, get_media_library_buffer(buffer)) != AppStatus::SUCCESS)
+            {
+                return AppStatus::HAILORT_ERROR;
+            }
+            std::vector<BufferPtr> tensor_buffers;
+            AppStatus status = acquire_and_set_tensor_buffers(bindings, tensor_buffers);
+            if (status != AppStatus::SUCCESS)
+            {
+                return AppStatus::HAILORT_ERROR;
+            }
+            if (tensor_buffers.empty())
+            {
+                // No output buffers for this frame in a leaky pool, drop it
+                skipped++;
+                continue;
+            }
+            batch->inputs.push_back(buffer);
+            batch->outputs.push_back(std::move(tensor_buffers));
+        }
+        size_t batch_size = batch->inputs.size();
+        if (batch_size == 0)
+        {
+            m_dropped_buffers += skipped;
             return AppStatus::SUCCESS;
+        }
+
+        // wait for infer model to be ready
+        auto status = m_configured_infer_model.wait_for_async_ready(std::chrono::milliseconds(1000), batch_size);
+        if (HAILO_SUCCESS != status) {
+            std::cerr << "Failed to wait for async ready, Hailort status = " << status << std::endl;
+            return AppStatus::HAILORT_ERROR;
+        }
+
+        // Run the async infer api on the bindings of the batch, when inference is done it will call the given callback
+        std::vector<hailort::ConfiguredInferModel::Bindings> partial_bindings;
+        if (batch_size < m_bindings.size()) {
+            partial_bindings.assign(m_bindings.begin(), m_bindings.begin() + batch_size);
+        }
+        batch->begin = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(m_active_jobs_mutex);
+            m_active_jobs += batch_size;
+        }
+        auto job = m_configured_infer_model.run_async((batch_size < m_bindings.size()) ? partial_bindings : m_bindings,
+                                                      [batch, this](const hailort::AsyncInferCompletionInfo& completion_info) {
+            complete_batch(*batch, completion_info.status);
         });
-        ++m_active_jobs;
 
         if (!job) {
             std::cerr << "Failed to start async infer job, status = " << job.status() << std::endl;
+            {
+                std::unique_lock<std::mutex> lock(m_active_jobs_mutex);
+                m_active_jobs -= batch_size;
+            }
+            m_active_jobs_cv.notify_all();
             return AppStatus::HAILORT_ERROR;
         }
 
         // detach the job to run in it's own thread on the side
         job->detach();
         m_last_infer_job = std::make_shared<hailort::AsyncInferJob>(job.release());
+        m_dropped_buffers += skipped;
 
         return AppStatus::SUCCESS;
     }
 
     /**
-     * @brief Process the data in the buffer.
+     * @brief Submit a batch of the batcher.
      * 
-     * @param data Buffer containing the data to be processed.
-     * @return AppStatus Status of the processing.
+     * @param buffers Buffers of the batch.
      */
-    AppStatus process(BufferPtr data)
+    void submit_batch(std::vector<BufferPtr> &buffers)
     {
-        std::unique_lock<std::mutex> lock(m_active_jobs_mutex);
-        m_active_jobs_cv.wait(lock, [this] { return m_active_jobs < m_jobs_limit; });
-
-        // Set the input buffer
-        if (set_pix_buf(data->get_buffer()) != AppStatus::SUCCESS)
+        if (infer(buffers) != AppStatus::SUCCESS)
         {
-            return AppStatus::HAILORT_ERROR;
+            m_dropped_buffers += buffers.size();
+            std::cerr << m_stage_name << " failed to infer a batch, dropped " << buffers.size() << " buffers" << std::endl;
         }
+    }
 
-        // Acquire and set tensor buffers
-        std::unordered_map<std::string, BufferPtr> tensor_buffers;
-        if (acquire_and_set_tensor_buffers(tensor_buffers) != AppStatus::SUCCESS)
-        {
-            return AppStatus::HAILORT_ERROR;
-        }
+    // Submitting a batch waits for room on the device, keep a dedicated thread on an executor.
+    bool runs_as_task() override
+    {
+        return false;
+    }
 
-        // Run the inference
-        if (infer(data, tensor_buffers) != AppStatus::SUCCESS)
-        {
-            return AppStatus::HAILORT_ERROR;
-        }
-        
+    /**
+     * @brief Process the data in the buffer, the buffer is inferred with the next batch.
+     * 
+     * @param data Buffer containing the data to be processed.
+     * @return AppStatus Status of the processing.
+     */
+    AppStatus process(BufferPtr data)
+    {
+        m_batcher->add(data);
         return AppStatus::SUCCESS;
     }
 };
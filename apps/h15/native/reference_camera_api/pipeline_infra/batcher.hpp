@@ -0,0 +1,261 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define INFER_BATCH_DEFAULT_TIMEOUT (std::chrono::microseconds(2000))
+
+/**
+ * @brief Picks the batch size of an inference stage from the depth of its input queue.
+ *
+ * The batch doubles while the queue holds another full batch (the accelerator is behind), and shrinks by a
+ * quarter when a batch had to leave on its deadline with nothing queued behind it (the input is too slow to
+ * fill it, and waiting only adds latency).
+ */
+class AdaptiveBatchController
+{
+private:
+    size_t m_min_batch;
+    size_t m_max_batch;
+    size_t m_batch;
+
+public:
+    AdaptiveBatchController(size_t min_batch, size_t max_batch)
+        : m_min_batch(std::max<size_t>(min_batch, 1)), m_max_batch(std::max(max_batch, m_min_batch)), m_batch(m_min_batch) {}
+
+    size_t batch_size()
+    {
+        return m_batch;
+    }
+
+    /**
+     * @brief Update the batch size after a batch was submitted.
+     * @param queue_depth Buffers waiting in the input queue.
+     * @param on_deadline Whether the batch was submitted on its deadline, before it was full.
+     */
+    void update(size_t queue_depth, bool on_deadline)
+    {
+        if (queue_depth >= m_batch)
+        {
+            m_batch = std::min(m_batch * 2, m_max_batch);
+        }
+        else if (on_deadline && queue_depth == 0)
+        {
+            m_batch = std::max(m_batch - std::max<size_t>(m_batch / 4, 1), m_min_batch);
+        }
+    }
+};
+
+/**
+ * @brief Accumulates the buffers of an inference stage into batches, submitted when the batch is full or when its
+ *        oldest buffer has waited the batch timeout.
+ *
+ * Batches are submitted in order, one at a time, on the thread that filled the batch or on the deadline thread
+ * of the batcher. With a max batch of 1 every buffer is submitted right away on the calling thread.
+ *
+ * @tparam T The type of the batched items (a BufferPtr in the inference stages, see InferBatcher).
+ */
+template <typename T>
+class Batcher
+{
+public:
+    // Submits a batch, may block until the accelerator has room for it.
+    using SubmitFunction = std::function<void(std::vector<T> &batch)>;
+    // Buffers waiting in the input queue of the stage.
+    using QueueDepthFunction = std::function<size_t()>;
+
+    struct Stats
+    {
+        uint64_t batches = 0;
+        uint64_t buffers = 0;
+        uint64_t deadline_batches = 0; // Submitted on their deadline before they were full
+        size_t batch_size = 0;         // Current target batch size
+    };
+
+private:
+    SubmitFunction m_submit;
+    QueueDepthFunction m_queue_depth;
+    size_t m_max_batch;
+    std::chrono::microseconds m_timeout;
+    bool m_adaptive;
+    AdaptiveBatchController m_controller;
+
+    std::vector<T> m_pending;
+    std::chrono::steady_clock::time_point m_deadline;
+    Stats m_stats;
+    bool m_running = false;
+    std::mutex m_mutex;        // Pending buffers, controller and stats
+    std::mutex m_submit_mutex; // Taken before m_mutex, keeps the batches in order
+    std::condition_variable m_cv;
+    std::thread m_deadline_thread;
+
+    size_t target_batch()
+    {
+        return m_adaptive ? m_controller.batch_size() : m_max_batch;
+    }
+
+    // Takes the pending batch if it is full (or expired, or any when force), returns whether it did.
+    bool take_batch(std::vector<T> &batch, bool force)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        bool full = m_pending.size() >= target_batch();
+        bool expired = !m_pending.empty() && std::chrono::steady_clock::now() >= m_deadline;
+        if (m_pending.empty() || !(full || expired || force))
+        {
+            return false;
+        }
+        if (m_pending.size() <= m_max_batch)
+        {
+            batch.swap(m_pending);
+            m_pending.reserve(m_max_batch);
+        }
+        else
+        {
+            batch.assign(m_pending.begin(), m_pending.begin() + m_max_batch);
+            m_pending.erase(m_pending.begin(), m_pending.begin() + m_max_batch);
+        }
+
+        size_t queue_depth = m_queue_depth ? m_queue_depth() : 0;
+        m_controller.update(queue_depth, !full);
+        m_stats.batches++;
+        m_stats.buffers += batch.size();
+        if (!full)
+            m_stats.deadline_batches++;
+        return true;
+    }
+
+    void flush(bool force)
+    {
+        std::unique_lock<std::mutex> submit_lock(m_submit_mutex);
+        std::vector<T> batch;
+        if (take_batch(batch, force))
+        {
+            m_submit(batch);
+        }
+    }
+
+    void deadline_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (m_running)
+        {
+            if (m_pending.empty())
+            {
+                m_cv.wait(lock, [this] { return !m_pending.empty() || !m_running; });
+                continue;
+            }
+            if (m_cv.wait_until(lock, m_deadline, [this] { return !m_running; }))
+            {
+                break;
+            }
+            lock.unlock();
+            flush(false);
+            lock.lock();
+        }
+    }
+
+public:
+    /**
+     * @param submit Submits a batch.
+     * @param queue_depth Depth of the input queue of the stage, drives the adaptive batch size.
+     * @param max_batch Largest batch.
+     * @param timeout Longest wait of a buffer for its batch to fill.
+     * @param adaptive Adapt the batch size to the queue depth between min_batch and max_batch.
+     * @param min_batch Smallest batch size of the adaptive mode.
+     */
+    Batcher(SubmitFunction submit, QueueDepthFunction queue_depth, size_t max_batch, std::chrono::microseconds timeout,
+                 bool adaptive = false, size_t min_batch = 1)
+        : m_submit(submit), m_queue_depth(queue_depth), m_max_batch(std::max<size_t>(max_batch, 1)), m_timeout(timeout),
+          m_adaptive(adaptive), m_controller(min_batch, m_max_batch)
+    {
+        m_pending.reserve(m_max_batch);
+    }
+
+    ~Batcher()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_running)
+            return;
+        m_running = true;
+        if (m_max_batch > 1)
+            m_deadline_thread = std::thread(&Batcher::deadline_loop, this);
+    }
+
+    /**
+     * @brief Stop the deadline thread, pending buffers are dropped. They are not submitted, as the accelerator and
+     *        the next stages may already be stopping.
+     * @return The number of dropped buffers, for the dropped counter of the stage.
+     */
+    size_t stop()
+    {
+        size_t dropped;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_running = false;
+            dropped = m_pending.size();
+            m_pending.clear();
+        }
+        m_cv.notify_all();
+        if (m_deadline_thread.joinable())
+        {
+            m_deadline_thread.join();
+        }
+        return dropped;
+    }
+
+    /**
+     * @brief Add a buffer to the pending batch, and submit the batch if it is full.
+     */
+    void add(T buffer)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_pending.empty())
+            {
+                m_deadline = std::chrono::steady_clock::now() + m_timeout;
+            }
+            m_pending.push_back(buffer);
+            if (m_pending.size() < target_batch())
+            {
+                lock.unlock();
+                m_cv.notify_one();
+                return;
+            }
+        }
+        flush(false);
+    }
+
+    /**
+     * @brief Submit the pending buffers now, e.g. at the end of a stream.
+     */
+    void flush()
+    {
+        flush(true);
+    }
+
+    Stats get_stats()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        Stats stats = m_stats;
+        stats.batch_size = target_batch();
+        return stats;
+    }
+};
+
+class Buffer;
+
+// Batches the buffers of the inference stages (HailortAsyncStage, ReplayInferenceStage)
+using InferBatcher = Batcher<std::shared_ptr<Buffer>>;
+using InferBatcherPtr = std::shared_ptr<InferBatcher>;
@@ -1,15 +1,23 @@
 #pragma once
 
 // general includes
+#include <array>
+#include <iostream>
+#include <memory>
 #include <thread>
 #include <vector>
 
+#ifdef HAILO15_TARGET
 // medialibrary includes
 #include "hailo/media_library/buffer_pool.hpp"
+#endif
 
 // tappas includes
 #include "hailo_objects.hpp"
 
+// Infra includes
+#include "metrics.hpp"
+
 class Buffer;
 using BufferPtr = std::shared_ptr<Buffer>;
 
@@ -19,6 +27,7 @@ enum class MetadataType
     TENSOR,
     EXPECTED_CROPS,
     SIZE,
+    CROP_INDEX,
 };
 
 class Metadata 
@@ -53,6 +62,28 @@ public:
 };
 using CroppingMetadataPtr = std::shared_ptr<CroppingMetadata>;
 
+// Position of a crop among the crops of its frame, lets later stages group the crops of a frame
+class CropIndexMetadata : public Metadata
+{
+private:
+    size_t m_index;
+    size_t m_num_crops;
+public:
+    CropIndexMetadata(size_t index, size_t num_crops) : Metadata(MetadataType::CROP_INDEX), m_index(index), m_num_crops(num_crops)
+    {}
+
+    size_t get_index()
+    {
+        return m_index;
+    }
+
+    size_t get_num_crops()
+    {
+        return m_num_crops;
+    }
+};
+using CropIndexMetadataPtr = std::shared_ptr<CropIndexMetadata>;
+
 class BufferMetadata : public Metadata
 {
 private:
@@ -104,50 +135,113 @@ public:
 };
 using TensorMetadataPtr = std::shared_ptr<TensorMetadata>;
 
-class TimeStamp
+struct TimeStamp
 {
-private:
-    std::chrono::steady_clock::time_point m_time;
-    std::string m_stage_name;
+    StageId stage_id;
+    std::chrono::steady_clock::time_point time;
+};
 
+// Buffers keep the timestamps inline, the timestamps of a buffer that passes more stages are dropped and counted
+#define MAX_BUFFER_TIME_STAMPS (16)
+
+/**
+ * @brief Image or tensor memory carried by a Buffer. Implemented by the media library buffers
+ *        (MediaLibraryFrame, media_library_buffer.hpp) and by the CpuFrames of the CPU backend, so only the
+ *        stages that use the hardware depend on the media library.
+ */
+class FrameData
+{
 public:
-    TimeStamp(std::string stage_name)
+    virtual ~FrameData() = default;
+
+    virtual int get_width() const = 0;
+
+    virtual int get_height() const = 0;
+
+    virtual uint8_t *get_plane_ptr(int plane) const = 0;
+
+    virtual int get_plane_stride(int plane) const = 0;
+
+    /**
+     * @brief Synchronize the plane for CPU access (DMA memory), before and after the access.
+     * @return false on failure.
+     */
+    virtual bool sync_start(int plane)
     {
-        m_time = std::chrono::steady_clock::now();
-        m_stage_name = stage_name;
+        return true;
     }
 
-    std::chrono::steady_clock::time_point get_time_point() const {
-        return m_time;
+    virtual bool sync_end(int plane)
+    {
+        return true;
     }
+};
+using FrameDataPtr = std::shared_ptr<FrameData>;
+
+/**
+ * @brief NV12 frame in host memory, carried by buffers of the CPU backend (see cpu_backend.hpp)
+ *        instead of a media library buffer.
+ */
+struct CpuFrame : public FrameData
+{
+    int width;
+    int height;
+    std::vector<uint8_t> data; // Y plane followed by the interleaved UV plane, no padding
+
+    CpuFrame(int width, int height) : width(width), height(height), data(width * height * 3 / 2) {}
 
-    std::string get_stage_name() const {
-        return m_stage_name;
+    uint8_t *y_plane()
+    {
+        return data.data();
+    }
+
+    uint8_t *uv_plane()
+    {
+        return data.data() + width * height;
+    }
+
+    int get_width() const override
+    {
+        return width;
     }
-};
-using TimeStampPtr = std::shared_ptr<TimeStamp>;
 
+    int get_height() const override
+    {
+        return height;
+    }
+
+    uint8_t *get_plane_ptr(int plane) const override
+    {
+        return const_cast<uint8_t *>(data.data()) + ((plane == 0) ? 0 : width * height);
+    }
 
+    int get_plane_stride(int plane) const override
+    {
+        return width;
+    }
+};
+using CpuFramePtr = std::shared_ptr<CpuFrame>;
 
 class Buffer {
 private:
-    HailoMediaLibraryBufferPtr m_buffer;
+    FrameDataPtr m_frame;
     HailoROIPtr m_roi;
     std::vector<MetadataPtr> m_metadata;
-    std::vector<TimeStampPtr> m_timestamps;
+    std::array<TimeStamp, MAX_BUFFER_TIME_STAMPS> m_timestamps;
+    size_t m_num_timestamps = 0;
+    size_t m_dropped_timestamps = 0;
 
 public:
-    Buffer(HailoMediaLibraryBufferPtr buffer)
-        : m_buffer(buffer) 
+    Buffer(FrameDataPtr frame)
+        : m_frame(frame) 
     {
         m_roi = std::make_shared<HailoROI>(HailoROI(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f)));
-        TimeStampPtr time_stamp =  std::make_shared<TimeStamp>("Source");
-        m_timestamps.push_back(time_stamp);
+        add_time_stamp(StageIds::SOURCE);
     }
 
 
-    Buffer(HailoMediaLibraryBufferPtr buffer, HailoROIPtr roi)
-        : m_buffer(buffer) 
+    Buffer(FrameDataPtr frame, HailoROIPtr roi)
+        : m_frame(frame) 
     {
         if (roi) {
             m_roi = roi;
@@ -156,41 +250,80 @@ public:
         }
     }
 
-    HailoMediaLibraryBufferPtr get_buffer() const {
-        return m_buffer;
+#ifdef HAILO15_TARGET
+    // Media library buffers are wrapped in a MediaLibraryFrame, these overloads are kept for code written before
+    // FrameData and are defined in media_library_buffer.hpp.
+    [[deprecated("Use Buffer(std::make_shared<MediaLibraryFrame>(buffer))")]]
+    Buffer(HailoMediaLibraryBufferPtr buffer);
+
+    [[deprecated("Use Buffer(std::make_shared<MediaLibraryFrame>(buffer), roi)")]]
+    Buffer(HailoMediaLibraryBufferPtr buffer, HailoROIPtr roi);
+
+    // nullptr if the buffer carries other memory (e.g. a CpuFrame).
+    [[deprecated("Use get_media_library_buffer(buffer)")]]
+    HailoMediaLibraryBufferPtr get_buffer() const;
+#endif
+
+    FrameDataPtr get_frame() const {
+        return m_frame;
+    }
+
+    // Set for buffers of the CPU backend, which have no media library buffer.
+    CpuFramePtr get_cpu_frame() const {
+        return std::dynamic_pointer_cast<CpuFrame>(m_frame);
     }
 
     HailoROIPtr get_roi() const {
         return m_roi;
     }
 
+    void add_time_stamp(StageId stage_id) {
+        if (m_num_timestamps == m_timestamps.size()) {
+            m_dropped_timestamps++;
+            return;
+        }
+        m_timestamps[m_num_timestamps++] = {stage_id, std::chrono::steady_clock::now()};
+    }
+
     void add_time_stamp(const std::string &stage) {
-        TimeStampPtr time_stamp =  std::make_shared<TimeStamp>(stage);
-        m_timestamps.push_back(time_stamp);
+        add_time_stamp(StageIds::get(stage));
     }
 
     size_t get_num_stages() const {
-            return m_timestamps.size();
+            return m_num_timestamps;
+    }
+
+    // Timestamps that did not fit, the last recorded timestamp is not the one of the last stage then.
+    size_t get_dropped_time_stamps() const {
+        return m_dropped_timestamps;
     }
 
     std::chrono::steady_clock::time_point get_time_stamp( int index) const {
-        return  m_timestamps[index]->get_time_point();
+        return  m_timestamps[index].time;
+    }
+
+    StageId get_time_stamp_stage(int index) const {
+        return m_timestamps[index].stage_id;
     }
 
     void print_latency_measurements() const {
-         size_t last_index = (m_timestamps.size() - 1);
-          for (size_t i = 0; i < m_timestamps.size(); ++i){
-            std::cout  << m_timestamps[i]->get_stage_name()<< " ";
+         if (m_num_timestamps == 0)
+            return;
+         size_t last_index = (m_num_timestamps - 1);
+          for (size_t i = 0; i < m_num_timestamps; ++i){
+            std::cout  << StageIds::name(m_timestamps[i].stage_id)<< " ";
           }
     
           std::cout << std::endl;
           for (size_t i = 0; i < last_index; ++i) {
-            auto stage_name = m_timestamps[i+1]->get_stage_name();
-            std::chrono::steady_clock::time_point end  = m_timestamps[i+1]->get_time_point();
-            std::chrono::steady_clock::time_point start  = m_timestamps[i]->get_time_point();
+            auto stage_name = StageIds::name(m_timestamps[i+1].stage_id);
+            std::chrono::steady_clock::time_point end  = m_timestamps[i+1].time;
+            std::chrono::steady_clock::time_point start  = m_timestamps[i].time;
             
             std::cout  << stage_name <<" took: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "[milli] ";
           }
+          if (m_dropped_timestamps > 0)
+            std::cout << "(" << m_dropped_timestamps << " more stages not timed)";
           std::cout  <<  std::endl;
     }
         
@@ -218,3 +351,28 @@ public:
     }
 
 };
+
+/**
+ * @brief Fixed size pool of buffers, implemented over the media library buffer pools (MediaLibraryFramePool,
+ *        media_library_buffer.hpp) and the CPU backend (CpuBufferPool, cpu_backend.hpp).
+ */
+class BufferPool
+{
+public:
+    virtual ~BufferPool() = default;
+
+    virtual size_t get_available_buffers_count() = 0;
+
+    /**
+     * @brief Acquire a buffer, its frame goes back to the pool once the buffer is released.
+     * @param roi ROI of the buffer, a full frame ROI if nullptr.
+     * @return nullptr if the pool is empty.
+     */
+    virtual BufferPtr acquire_buffer(HailoROIPtr roi = nullptr) = 0;
+};
+using BufferPoolPtr = std::shared_ptr<BufferPool>;
+
+#ifdef HAILO15_TARGET
+// Defines the deprecated media library overloads of Buffer
+#include "media_library_buffer.hpp"
+#endif
@@ -0,0 +1,445 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+
+// Infra includes
+#include "batcher.hpp"
+#include "buffer.hpp"
+#include "crop_backend.hpp"
+#include "stage.hpp"
+#include "tensor_recording.hpp"
+
+/**
+ * CPU backend: stand-ins for the parts of the pipeline that need the Hailo hardware (DSP, DMA buffer pools,
+ * frontend and HailoRT), so pipelines run and can be profiled on any machine.
+ *
+ * Buffers carry a CpuFrame instead of a media library buffer. CpuCropResizeBackend replaces the DSP in the crop
+ * stages (DspBaseCropStage::set_backend), CpuFrontendStage produces frames in place of the frontend and
+ * ReplayInferenceStage returns the recorded output tensors of a network (HailortAsyncStage::record_outputs)
+ * after a configurable latency. All the other stages (postprocess, aggregator, tracker, overlay...) run as is.
+ */
+
+/**
+ * @brief Fixed size pool of CpuFrames, released frames go back to the pool.
+ */
+class CpuBufferPool : public BufferPool, public std::enable_shared_from_this<CpuBufferPool>
+{
+private:
+    int m_width;
+    int m_height;
+    std::vector<std::unique_ptr<CpuFrame>> m_free_frames;
+    std::mutex m_mutex;
+
+    void release(CpuFrame *frame)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_free_frames.emplace_back(frame);
+    }
+
+public:
+    CpuBufferPool(int width, int height, size_t pool_size) : m_width(width), m_height(height)
+    {
+        for (size_t i = 0; i < pool_size; i++)
+        {
+            m_free_frames.push_back(std::make_unique<CpuFrame>(width, height));
+        }
+    }
+
+    int width()
+    {
+        return m_width;
+    }
+
+    int height()
+    {
+        return m_height;
+    }
+
+    size_t get_available_buffers_count() override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_free_frames.size();
+    }
+
+    BufferPtr acquire_buffer(HailoROIPtr roi = nullptr) override
+    {
+        CpuFramePtr frame = acquire_frame();
+        if (frame == nullptr)
+        {
+            return nullptr;
+        }
+        return std::make_shared<Buffer>(frame, roi);
+    }
+
+    /**
+     * @brief Acquire a frame, nullptr if the pool is empty.
+     */
+    CpuFramePtr acquire_frame()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_free_frames.empty())
+        {
+            return nullptr;
+        }
+        CpuFrame *frame = m_free_frames.back().release();
+        m_free_frames.pop_back();
+        std::weak_ptr<CpuBufferPool> weak_pool = shared_from_this();
+        return CpuFramePtr(frame, [weak_pool](CpuFrame *released)
+                           {
+            std::shared_ptr<CpuBufferPool> pool = weak_pool.lock();
+            if (pool)
+                pool->release(released);
+            else
+                delete released; });
+    }
+
+    // Fill every free frame, e.g. with a test pattern for a source.
+    void fill(std::function<void(CpuFrame &frame)> fill_function)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (auto &frame : m_free_frames)
+        {
+            fill_function(*frame);
+        }
+    }
+};
+using CpuBufferPoolPtr = std::shared_ptr<CpuBufferPool>;
+
+/**
+ * @brief Crop and resize with OpenCV (bilinear, as the DSP) into frames of a CpuBufferPool.
+ */
+class CpuCropResizeBackend : public CropResizeBackend
+{
+private:
+    CpuBufferPoolPtr m_buffer_pool;
+
+public:
+    AppStatus init(int output_width, int output_height, int pool_size, std::string pool_name) override
+    {
+        m_buffer_pool = std::make_shared<CpuBufferPool>(output_width, output_height, pool_size);
+        return AppStatus::SUCCESS;
+    }
+
+    size_t get_available_buffers_count() override
+    {
+        return m_buffer_pool->get_available_buffers_count();
+    }
+
+    BufferPtr acquire_buffer(HailoROIPtr roi) override
+    {
+        return m_buffer_pool->acquire_buffer(roi);
+    }
+
+    AppStatus multi_crop_resize(BufferPtr input, std::vector<CropRect> &crops, std::vector<BufferPtr> &outputs) override
+    {
+        CpuFramePtr src = input->get_cpu_frame();
+        if (src == nullptr)
+        {
+            std::cerr << "CPU crop and resize requires buffers of the CPU backend" << std::endl;
+            return AppStatus::INVALID_ARGUMENT;
+        }
+        cv::Mat src_y(src->height, src->width, CV_8UC1, src->y_plane());
+        cv::Mat src_uv(src->height / 2, src->width / 2, CV_8UC2, src->uv_plane());
+        for (size_t i = 0; i < outputs.size(); i++)
+        {
+            CpuFramePtr dst = outputs[i]->get_cpu_frame();
+            CropRect &crop = crops[i];
+            int x = std::min<int>(crop.start_x, src->width - 2);
+            int y = std::min<int>(crop.start_y, src->height - 2);
+            int width = std::max<int>(std::min<int>(crop.end_x, src->width) - x, 2);
+            int height = std::max<int>(std::min<int>(crop.end_y, src->height) - y, 2);
+
+            cv::Mat dst_y(dst->height, dst->width, CV_8UC1, dst->y_plane());
+            cv::Mat dst_uv(dst->height / 2, dst->width / 2, CV_8UC2, dst->uv_plane());
+            cv::resize(src_y(cv::Rect(x, y, width, height)), dst_y, dst_y.size(), 0, 0, cv::INTER_LINEAR);
+            cv::resize(src_uv(cv::Rect(x / 2, y / 2, width / 2, height / 2)), dst_uv, dst_uv.size(), 0, 0, cv::INTER_LINEAR);
+        }
+        return AppStatus::SUCCESS;
+    }
+};
+
+/**
+ * @brief Produces frames of a fixed test pattern at a fixed rate, in place of the frontend.
+ *        Subscription is by stream id, as with the FrontendStage. A frame is dropped when the pool of its stream is empty.
+ */
+class CpuFrontendStage : public ConnectedStage
+{
+private:
+    struct Stream
+    {
+        CpuBufferPoolPtr pool;
+        std::vector<ConnectedStagePtr> subscribers;
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    std::map<std::string, Stream> m_streams;
+    double m_fps;
+
+public:
+    CpuFrontendStage(std::string name, double fps, bool print_fps=false) :
+        ConnectedStage(name, 1, false, print_fps), m_fps(fps) {}
+
+    /**
+     * @brief Add an output stream.
+     * @param pool_size Frames of the stream that can be in the pipeline at once.
+     */
+    void add_stream(std::string stream_id, int width, int height, size_t pool_size)
+    {
+        Stream &stream = m_streams[stream_id];
+        stream.pool = std::make_shared<CpuBufferPool>(width, height, pool_size);
+        stream.pool->fill([](CpuFrame &frame)
+                          {
+            for (int row = 0; row < frame.height; row++)
+                std::fill_n(frame.y_plane() + row * frame.width, frame.width, uint8_t(row * 255 / frame.height));
+            std::fill_n(frame.uv_plane(), frame.width * frame.height / 2, uint8_t(128)); });
+    }
+
+    void subscribe_to_stream(std::string stream_id, ConnectedStagePtr subscriber)
+    {
+        m_streams[stream_id].subscribers.push_back(subscriber);
+        subscriber->add_queue(stream_id);
+    }
+
+    uint64_t get_dropped_frames(std::string stream_id)
+    {
+        return m_streams[stream_id].dropped;
+    }
+
+    // Frames are produced at a fixed rate on the stage thread.
+    bool runs_as_task() override
+    {
+        return false;
+    }
+
+    void loop() override
+    {
+        init();
+        auto frame_time = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / m_fps));
+        auto next_frame = std::chrono::steady_clock::now();
+        while (!m_end_of_stream)
+        {
+            for (auto &stream : m_streams)
+            {
+                CpuFramePtr frame = stream.second.pool->acquire_frame();
+                if (frame == nullptr)
+                {
+                    stream.second.dropped++;
+                    continue;
+                }
+                BufferPtr buffer = std::make_shared<Buffer>(frame, nullptr);
+                buffer->add_time_stamp(StageIds::SOURCE);
+                for (auto &subscriber : stream.second.subscribers)
+                {
+                    subscriber->push(buffer, stream.first);
+                }
+            }
+
+            if (m_print_fps)
+            {
+                m_counter++;
+                print_fps();
+            }
+            next_frame += frame_time;
+            std::this_thread::sleep_until(next_frame);
+        }
+        deinit();
+    }
+};
+using CpuFrontendStagePtr = std::shared_ptr<CpuFrontendStage>;
+
+/**
+ * @brief Stand-in for HailortAsyncStage: adds the recorded output tensors of the next frame of a recording to
+ *        the ROI of every buffer, and sends it on after the given latency. Up to jobs_limit buffers are in flight,
+ *        as on the device. Without a recording, buffers are sent on without tensors.
+ *
+ * Buffers are batched as in HailortAsyncStage (see set_batching), a batch completes as a whole after the latency.
+ */
+class ReplayInferenceStage : public ConnectedStage
+{
+private:
+    struct Job
+    {
+        std::chrono::steady_clock::time_point done;
+        std::vector<BufferPtr> buffers;
+        std::vector<size_t> frames; // Recorded frame of every buffer
+    };
+
+    std::string m_recording_path;
+    TensorRecordingPtr m_recording;
+    std::chrono::microseconds m_latency;
+    size_t m_jobs_limit;
+    size_t m_batch_size;
+    std::chrono::microseconds m_batch_timeout = INFER_BATCH_DEFAULT_TIMEOUT;
+    bool m_adaptive_batching = false;
+    size_t m_min_batch = 1;
+    InferBatcherPtr m_batcher;
+    size_t m_next_frame = 0;
+    size_t m_in_flight = 0; // Buffers of the jobs
+
+    std::deque<Job> m_jobs;
+    std::mutex m_jobs_mutex;
+    std::condition_variable m_jobs_cv;  // New jobs, or stopping
+    std::condition_variable m_space_cv; // A job completed
+    std::thread m_completion_thread;
+    bool m_running = false;
+
+    void complete(Job &job)
+    {
+        for (size_t index = 0; index < job.buffers.size(); index++)
+        {
+            BufferPtr &buffer = job.buffers[index];
+            if (m_recording != nullptr && m_recording->num_frames() > 0)
+            {
+                auto &tensors = m_recording->tensors();
+                for (size_t i = 0; i < tensors.size(); i++)
+                {
+                    buffer->get_roi()->add_tensor(std::make_shared<HailoTensor>(m_recording->get_frame(i, job.frames[index]), tensors[i].info));
+                }
+            }
+            buffer->add_time_stamp(m_stage_id);
+            set_duration(buffer);
+            send_to_subscribers(buffer);
+        }
+    }
+
+    void submit_batch(std::vector<BufferPtr> &batch)
+    {
+        std::unique_lock<std::mutex> lock(m_jobs_mutex);
+        m_space_cv.wait(lock, [this, &batch] { return m_in_flight + batch.size() <= m_jobs_limit || m_in_flight == 0 || !m_running; });
+        if (!m_running)
+        {
+            return;
+        }
+        size_t num_frames = (m_recording != nullptr) ? m_recording->num_frames() : 0;
+        Job job = {std::chrono::steady_clock::now() + m_latency, std::move(batch), {}};
+        for (size_t i = 0; i < job.buffers.size(); i++)
+        {
+            job.frames.push_back((num_frames > 0) ? m_next_frame++ % num_frames : 0);
+        }
+        m_in_flight += job.buffers.size();
+        m_jobs.push_back(std::move(job));
+        lock.unlock();
+        m_jobs_cv.notify_one();
+    }
+
+    void completion_loop()
+    {
+        std::unique_lock<std::mutex> lock(m_jobs_mutex);
+        while (m_running)
+        {
+            m_jobs_cv.wait(lock, [this] { return !m_jobs.empty() || !m_running; });
+            if (!m_running)
+            {
+                break;
+            }
+            // Jobs have the same latency, so they complete in order
+            if (m_jobs_cv.wait_until(lock, m_jobs.front().done, [this] { return !m_running; }))
+            {
+                break;
+            }
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_in_flight -= job.buffers.size();
+            lock.unlock();
+            m_space_cv.notify_all();
+            complete(job);
+            lock.lock();
+        }
+    }
+
+public:
+    /**
+     * @param recording_path Recording of HailortAsyncStage::record_outputs, empty for no tensors.
+     * @param latency Time from a buffer entering the stage to its output.
+     * @param jobs_limit Buffers in flight at once.
+     * @param batch_size Largest batch.
+     */
+    ReplayInferenceStage(std::string name, std::string recording_path, std::chrono::microseconds latency, size_t jobs_limit,
+                         size_t queue_size, bool print_fps=false, size_t batch_size=1) :
+        ConnectedStage(name, queue_size, false, print_fps), m_recording_path(recording_path), m_latency(latency),
+        m_jobs_limit(std::max<size_t>(jobs_limit, 1)), m_batch_size(std::min(std::max<size_t>(batch_size, 1), m_jobs_limit)) {}
+
+    /**
+     * @brief Batching settings, as HailortAsyncStage::set_batching. Call before the stage is started.
+     */
+    void set_batching(std::chrono::microseconds timeout, bool adaptive = false, size_t min_batch = 1)
+    {
+        m_batch_timeout = timeout;
+        m_adaptive_batching = adaptive;
+        m_min_batch = min_batch;
+    }
+
+    InferBatcher::Stats get_batch_stats()
+    {
+        return (m_batcher != nullptr) ? m_batcher->get_stats() : InferBatcher::Stats();
+    }
+
+    AppStatus init() override
+    {
+        if (!m_recording_path.empty())
+        {
+            m_recording = std::make_shared<TensorRecording>();
+            if (!m_recording->load(m_recording_path))
+            {
+                return AppStatus::CONFIGURATION_ERROR;
+            }
+        }
+        m_running = true;
+        m_completion_thread = std::thread(&ReplayInferenceStage::completion_loop, this);
+        m_batcher = std::make_shared<InferBatcher>([this](std::vector<BufferPtr> &batch) { submit_batch(batch); },
+                                                   [this]() -> size_t { return m_queues.empty() ? 0 : m_queues[0]->size(); },
+                                                   m_batch_size, m_batch_timeout, m_adaptive_batching, m_min_batch);
+        m_batcher->start();
+        return AppStatus::SUCCESS;
+    }
+
+    AppStatus deinit() override
+    {
+        if (m_batcher != nullptr)
+        {
+            m_dropped_buffers += m_batcher->stop();
+        }
+        {
+            std::unique_lock<std::mutex> lock(m_jobs_mutex);
+            m_running = false;
+            m_jobs.clear();
+        }
+        m_jobs_cv.notify_all();
+        m_space_cv.notify_all();
+        if (m_completion_thread.joinable())
+        {
+            m_completion_thread.join();
+        }
+        for (auto &queue : m_queues)
+        {
+            queue->flush();
+        }
+        return AppStatus::SUCCESS;
+    }
+
+    // Submitting a batch waits for a free job, as on the device, keep a dedicated thread on an executor.
+    bool runs_as_task() override
+    {
+        return false;
+    }
+
+    AppStatus process(BufferPtr data) override
+    {
+        m_batcher->add(data);
+        return AppStatus::SUCCESS;
+    }
+};
+using ReplayInferenceStagePtr = std::shared_ptr<ReplayInferenceStage>;
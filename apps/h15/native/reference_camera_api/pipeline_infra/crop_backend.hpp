@@ -0,0 +1,51 @@
+#pragma once
+
+// General includes
+#include <memory>
+#include <string>
+#include <vector>
+
+// Infra includes
+#include "buffer.hpp"
+#include "stage.hpp"
+
+/**
+ * @brief Crop of a multi crop and resize, in pixels of the input frame (the DSP takes even coordinates only).
+ */
+struct CropRect
+{
+    size_t start_x;
+    size_t start_y;
+    size_t end_x;
+    size_t end_y;
+};
+
+/**
+ * @brief Output buffer pool and multi crop and resize used by the crop stages.
+ *        DspCropResizeBackend (dsp_backend.hpp) runs on the DSP, CpuCropResizeBackend (cpu_backend.hpp) without the hardware.
+ */
+class CropResizeBackend
+{
+public:
+    virtual ~CropResizeBackend() = default;
+
+    /**
+     * @brief Allocate the output buffer pool.
+     */
+    virtual AppStatus init(int output_width, int output_height, int pool_size, std::string pool_name) = 0;
+
+    virtual size_t get_available_buffers_count() = 0;
+
+    /**
+     * @brief Acquire an output buffer from the pool.
+     * @param roi ROI of the output buffer.
+     * @return nullptr if the pool is empty.
+     */
+    virtual BufferPtr acquire_buffer(HailoROIPtr roi) = 0;
+
+    /**
+     * @brief Crop and resize the input buffer, crop i into outputs[i].
+     */
+    virtual AppStatus multi_crop_resize(BufferPtr input, std::vector<CropRect> &crops, std::vector<BufferPtr> &outputs) = 0;
+};
+using CropResizeBackendPtr = std::shared_ptr<CropResizeBackend>;
@@ -0,0 +1,335 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Infra includes
+#include "buffer.hpp"
+#include "crop_backend.hpp"
+#include "metrics.hpp"
+
+#define CROP_POOL_POLL_INTERVAL (std::chrono::milliseconds(5))
+#define CROP_DEFAULT_RESERVATION_TIMEOUT (std::chrono::milliseconds(100))
+
+class CropBufferPool;
+using CropBufferPoolPtr = std::shared_ptr<CropBufferPool>;
+
+/**
+ * @brief Output buffer pool of a crop backend with reservations, shared by one or more consumers (crop stages
+ *        with the same output size).
+ *
+ * A multi crop job reserves all its buffers at once, so it never holds part of the pool while it waits for the
+ * rest. Every consumer may hold up to its quota of buffers (reserved, or acquired and not yet released
+ * downstream), so a burst of crops of one consumer can't take the buffers of the others. The last
+ * priority_reserve buffers can only be taken by priority consumers, and no other consumer reserves while a
+ * priority consumer waits. Released buffers wake the waiting reservations.
+ */
+class CropBufferPool : public std::enable_shared_from_this<CropBufferPool>
+{
+private:
+    struct Consumer
+    {
+        std::string name;
+        size_t quota;
+        bool priority;
+        size_t in_use = 0;
+        uint64_t reservations = 0;
+        uint64_t granted = 0;
+        uint64_t partial = 0;
+        uint64_t dropped_frames = 0;
+        uint64_t dropped_crops = 0;
+        LatencyHistogram wait;
+    };
+
+    std::string m_name;
+    int m_width;
+    int m_height;
+    size_t m_size;
+    size_t m_priority_reserve;
+    CropResizeBackendPtr m_backend;
+    bool m_initialized = false;
+    size_t m_in_use = 0;  // Reserved or acquired and not released
+    size_t m_pending = 0; // Reserved and not acquired yet
+    size_t m_priority_waiters = 0;
+    std::map<std::string, std::unique_ptr<Consumer>> m_consumers;
+    std::mutex m_mutex;
+    std::condition_variable m_released_cv;
+
+    // Buffers the consumer can reserve now, up to count. Called with the lock held.
+    size_t available_for(Consumer &consumer, size_t count)
+    {
+        // Buffers released by the pipeline may return to the backend pool a bit after their release here
+        size_t backend_free = m_backend->get_available_buffers_count();
+        size_t free = std::min(m_size - m_in_use, (backend_free > m_pending) ? backend_free - m_pending : 0);
+        if (!consumer.priority)
+        {
+            if (m_priority_waiters > 0)
+                return 0;
+            free = (free > m_priority_reserve) ? free - m_priority_reserve : 0;
+        }
+        size_t quota_left = (consumer.quota > consumer.in_use) ? consumer.quota - consumer.in_use : 0;
+        return std::min({count, free, quota_left});
+    }
+
+    void release(Consumer *consumer, size_t count, bool pending)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_in_use -= count;
+            consumer->in_use -= count;
+            if (pending)
+                m_pending -= count;
+        }
+        m_released_cv.notify_all();
+    }
+
+public:
+    /**
+     * @brief Buffers reserved by a consumer, acquired one by one. Buffers that were not acquired go back to the
+     *        pool when the reservation is destroyed.
+     */
+    class Reservation
+    {
+    private:
+        friend class CropBufferPool;
+        CropBufferPoolPtr m_pool;
+        Consumer *m_consumer = nullptr;
+        size_t m_count = 0;
+        size_t m_acquired = 0;
+
+    public:
+        ~Reservation()
+        {
+            if (m_pool != nullptr && m_acquired < m_count)
+                m_pool->release(m_consumer, m_count - m_acquired, true);
+        }
+
+        size_t size()
+        {
+            return m_count;
+        }
+
+        /**
+         * @brief Acquire one of the reserved buffers, it goes back to the reservations of the pool once released.
+         * @param roi ROI of the output buffer.
+         * @return nullptr if all the reserved buffers were acquired, or the backend pool is empty.
+         */
+        BufferPtr acquire_buffer(HailoROIPtr roi)
+        {
+            if (m_acquired >= m_count)
+                return nullptr;
+            m_acquired++;
+            BufferPtr buffer = m_pool->m_backend->acquire_buffer(roi);
+            if (buffer == nullptr)
+            {
+                m_pool->release(m_consumer, 1, true);
+                std::unique_lock<std::mutex> lock(m_pool->m_mutex);
+                m_consumer->dropped_crops++;
+                return nullptr;
+            }
+            {
+                std::unique_lock<std::mutex> lock(m_pool->m_mutex);
+                m_pool->m_pending--;
+            }
+            // The returned buffer holds the backend buffer, its release returns the reservation to the pool
+            std::weak_ptr<CropBufferPool> weak_pool = m_pool;
+            Consumer *consumer = m_consumer;
+            Buffer *raw_buffer = buffer.get();
+            return BufferPtr(raw_buffer, [buffer, weak_pool, consumer](Buffer *) mutable
+                             {
+                buffer.reset();
+                CropBufferPoolPtr pool = weak_pool.lock();
+                if (pool)
+                    pool->release(consumer, 1, false); });
+        }
+    };
+    using ReservationPtr = std::unique_ptr<Reservation>;
+
+    /**
+     * @brief Constructor.
+     * @param name Name of the pool.
+     * @param width Width of the buffers.
+     * @param height Height of the buffers.
+     * @param size Number of buffers.
+     * @param priority_reserve Buffers that only priority consumers can take.
+     */
+    CropBufferPool(std::string name, int width, int height, size_t size, size_t priority_reserve = 0)
+        : m_name(name), m_width(width), m_height(height), m_size(size), m_priority_reserve(std::min(priority_reserve, size)) {}
+
+    std::string name()
+    {
+        return m_name;
+    }
+
+    int width()
+    {
+        return m_width;
+    }
+
+    int height()
+    {
+        return m_height;
+    }
+
+    /**
+     * @brief Sets the backend of the buffers, ignored once the pool is initialized.
+     */
+    void set_backend(CropResizeBackendPtr backend)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_initialized)
+            m_backend = backend;
+    }
+
+    CropResizeBackendPtr get_backend()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_backend;
+    }
+
+    /**
+     * @brief Initializes the backend and allocates its buffers, once for all the consumers.
+     */
+    AppStatus init()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_initialized)
+            return AppStatus::SUCCESS;
+        if (m_backend == nullptr)
+        {
+            std::cerr << "Pool " << m_name << " has no crop backend" << std::endl;
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+        AppStatus status = m_backend->init(m_width, m_height, m_size, m_name);
+        m_initialized = (status == AppStatus::SUCCESS);
+        return status;
+    }
+
+    /**
+     * @brief Register a consumer, or update its quota and priority.
+     * @param name Name of the consumer.
+     * @param quota Buffers the consumer may hold at once, 0 for the whole pool.
+     * @param priority Whether the consumer may take the priority reserve.
+     */
+    void add_consumer(std::string name, size_t quota = 0, bool priority = false)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::unique_ptr<Consumer> &consumer = m_consumers[name];
+        if (consumer == nullptr)
+        {
+            consumer = std::make_unique<Consumer>();
+            consumer->name = name;
+        }
+        consumer->quota = (quota == 0) ? m_size : std::min(quota, m_size);
+        consumer->priority = priority;
+    }
+
+    /**
+     * @brief Reserve buffers for a multi crop job, all at once.
+     * @param consumer_name Registered consumer.
+     * @param count Buffers requested.
+     * @param min_count Smallest reservation to take, count for all or nothing.
+     * @param timeout Time to wait for min_count buffers, 0 to not wait.
+     * @return The reservation, empty if min_count buffers were not available in time (the frame is dropped).
+     */
+    ReservationPtr reserve(const std::string &consumer_name, size_t count, size_t min_count, std::chrono::milliseconds timeout)
+    {
+        ReservationPtr reservation = std::make_unique<Reservation>();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto consumer_it = m_consumers.find(consumer_name);
+        if (consumer_it == m_consumers.end() || !m_initialized || count == 0)
+        {
+            if (count > 0)
+                std::cerr << "Pool " << m_name << " has no consumer " << consumer_name << " or is not initialized" << std::endl;
+            return reservation;
+        }
+        Consumer &consumer = *consumer_it->second;
+        consumer.reservations++;
+        min_count = std::min(std::max<size_t>(min_count, 1), count);
+
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point deadline = begin + timeout;
+        size_t granted = available_for(consumer, count);
+        if (granted < min_count && timeout.count() > 0)
+        {
+            if (consumer.priority)
+                m_priority_waiters++;
+            while ((granted = available_for(consumer, count)) < min_count)
+            {
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if (now >= deadline)
+                    break;
+                // Wake up on releases, and poll for the buffers that return to the backend pool later
+                m_released_cv.wait_until(lock, std::min(deadline, now + CROP_POOL_POLL_INTERVAL));
+            }
+            if (consumer.priority && --m_priority_waiters == 0)
+                m_released_cv.notify_all();
+        }
+        consumer.wait.record(std::chrono::steady_clock::now() - begin);
+
+        if (granted < min_count)
+        {
+            consumer.dropped_frames++;
+            consumer.dropped_crops += count;
+            return reservation;
+        }
+        if (granted < count)
+        {
+            consumer.partial++;
+            consumer.dropped_crops += count - granted;
+        }
+        consumer.granted += granted;
+        consumer.in_use += granted;
+        m_in_use += granted;
+        m_pending += granted;
+        reservation->m_pool = shared_from_this();
+        reservation->m_consumer = &consumer;
+        reservation->m_count = granted;
+        return reservation;
+    }
+
+    PoolSnapshot get_stats(const std::string &consumer_name)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        PoolSnapshot stats;
+        stats.name = m_name;
+        stats.capacity = m_size;
+        stats.available = m_size - m_in_use;
+        auto consumer_it = m_consumers.find(consumer_name);
+        if (consumer_it == m_consumers.end())
+            return stats;
+        Consumer &consumer = *consumer_it->second;
+        stats.in_use = consumer.in_use;
+        stats.quota = consumer.quota;
+        stats.priority = consumer.priority;
+        stats.reservations = consumer.reservations;
+        stats.granted = consumer.granted;
+        stats.partial = consumer.partial;
+        stats.dropped_frames = consumer.dropped_frames;
+        stats.dropped_crops = consumer.dropped_crops;
+        stats.wait = consumer.wait.snapshot();
+        return stats;
+    }
+
+    void reset_stats(const std::string &consumer_name)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto consumer_it = m_consumers.find(consumer_name);
+        if (consumer_it == m_consumers.end())
+            return;
+        Consumer &consumer = *consumer_it->second;
+        consumer.reservations = 0;
+        consumer.granted = 0;
+        consumer.partial = 0;
+        consumer.dropped_frames = 0;
+        consumer.dropped_crops = 0;
+        consumer.wait.reset();
+    }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+// General includes
+#include <iostream>
+#include <string>
+#include <vector>
+
+// medialibrary includes
+#include "media_library/dsp_utils.hpp"
+
+// Infra includes
+#include "crop_backend.hpp"
+#include "media_library_buffer.hpp"
+
+/**
+ * @brief Multi crop and resize on the DSP, into a DMA buffer pool of the media library.
+ */
+class DspCropResizeBackend : public CropResizeBackend
+{
+private:
+    BufferPoolPtr m_buffer_pool;
+
+public:
+    AppStatus init(int output_width, int output_height, int pool_size, std::string pool_name) override
+    {
+        auto bytes_per_line = dsp_utils::get_dsp_desired_stride_from_width(output_width);
+        MediaLibraryBufferPoolPtr pool = std::make_shared<MediaLibraryBufferPool>(output_width, output_height, HAILO_FORMAT_NV12,
+                                                                                  pool_size, HAILO_MEMORY_TYPE_DMABUF, bytes_per_line, pool_name);
+        if (pool->init() != MEDIA_LIBRARY_SUCCESS)
+        {
+            return AppStatus::DSP_OPERATION_ERROR;
+        }
+        m_buffer_pool = std::make_shared<MediaLibraryFramePool>(pool);
+        return AppStatus::SUCCESS;
+    }
+
+    size_t get_available_buffers_count() override
+    {
+        return m_buffer_pool->get_available_buffers_count();
+    }
+
+    BufferPtr acquire_buffer(HailoROIPtr roi) override
+    {
+        return m_buffer_pool->acquire_buffer(roi);
+    }
+
+    AppStatus multi_crop_resize(BufferPtr input, std::vector<CropRect> &crops, std::vector<BufferPtr> &outputs) override
+    {
+        HailoMediaLibraryBufferPtr input_buffer = get_media_library_buffer(input);
+        if (input_buffer == nullptr)
+        {
+            std::cerr << "DSP crop and resize requires media library buffers" << std::endl;
+            return AppStatus::INVALID_ARGUMENT;
+        }
+
+        std::vector<dsp_crop_api_t> dsp_crops;
+        std::vector<dsp_crop_resize_params_t> crops_params;
+        std::vector<hailo_dsp_buffer_data_t> output_dsp_buffers;
+        dsp_crops.reserve(outputs.size());
+        crops_params.reserve(outputs.size());
+        output_dsp_buffers.reserve(outputs.size());
+        for (std::size_t i = 0; i < outputs.size(); ++i)
+        {
+            dsp_crops.push_back({
+                .start_x = crops[i].start_x,
+                .start_y = crops[i].start_y,
+                .end_x = crops[i].end_x,
+                .end_y = crops[i].end_y,
+            });
+            output_dsp_buffers.emplace_back(std::move(get_media_library_buffer(outputs[i])->buffer_data->As<hailo_dsp_buffer_data_t>()));
+            dsp_crop_resize_params_t crop_resize_params = {
+                .crop = &dsp_crops[i],
+            };
+            crop_resize_params.dst[0] = &output_dsp_buffers[i].properties;
+            crops_params.emplace_back(std::move(crop_resize_params));
+        }
+
+        hailo_dsp_buffer_data_t in_buffer_data = input_buffer->buffer_data->As<hailo_dsp_buffer_data_t>();
+        dsp_multi_crop_resize_params_t multi_crop_resize_params = {
+            .src = &in_buffer_data.properties,
+            .crop_resize_params = crops_params.data(),
+            .crop_resize_params_count = outputs.size(),
+            .interpolation = INTERPOLATION_TYPE_BILINEAR,
+        };
+
+        dsp_status status = dsp_utils::perform_dsp_multi_resize(&multi_crop_resize_params);
+        if (status != DSP_SUCCESS)
+        {
+            std::cerr << "Failed to perform dsp multi resize" << std::endl;
+            return AppStatus::DSP_OPERATION_ERROR;
+        }
+        return AppStatus::SUCCESS;
+    }
+};
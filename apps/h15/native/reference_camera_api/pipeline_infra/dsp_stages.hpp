@@ -2,10 +2,18 @@
 
 #include "stage.hpp"
 #include "buffer.hpp"
-#include "media_library/dsp_utils.hpp"
+#include "crop_backend.hpp"
+#include "crop_buffer_pool.hpp"
 #include "hailo_common.hpp"
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
 
+#ifdef HAILO15_TARGET
+#include "dsp_backend.hpp"
+#endif
 
 #define DETECTOR_WIDTH 1920
 #define DETECTOR_HEIGHT 1080
@@ -19,7 +27,11 @@
 class DspBaseCropStage : public ConnectedStage
 {
 protected:
-    MediaLibraryBufferPoolPtr m_buffer_pool; /**< Buffer pool for managing media library buffers */
+    CropResizeBackendPtr m_backend; /**< Output buffer pool and crop and resize, the DSP unless set */
+    CropBufferPoolPtr m_pool; /**< Reservations of the output buffers, may be shared with other crop stages */
+    size_t m_pool_quota = 0; /**< Output buffers the stage may hold at once, 0 for the whole pool */
+    bool m_pool_priority = false; /**< Whether the stage may take the priority reserve of the pool */
+    std::chrono::milliseconds m_reservation_timeout = CROP_DEFAULT_RESERVATION_TIMEOUT; /**< Blocking mode wait for buffers */
     int m_output_pool_size; /**< Size of the output buffer pool */
     int m_input_width;  /**< Width of the input data */
     int m_input_height; /**< Height of the input data */
@@ -28,8 +40,6 @@ protected:
 
     std::string m_main_subscriber; /**< Name of the main subscriber */
     std::string m_sub_subscriber; /**< Name of the sub-subscriber */
-    std::condition_variable m_available_buffers_cv;
-    std::mutex m_buff_pool_mutex;
 
     StagePoolMode m_pool_mode; //< Pool mode for the buffer pool used in this stage
 public:
@@ -56,15 +66,115 @@ public:
                                           m_output_width(output_width), m_output_hight(output_height),
                                           m_main_subscriber(main_sub_name), m_sub_subscriber(sub_sub_name), m_pool_mode(pool_mode) {}
 
+    /**
+     * @brief Sets the backend, the DSP by default when built with the media library. Call before the stage is started.
+     * @param backend Output buffer pool and crop and resize implementation.
+     */
+    void set_backend(CropResizeBackendPtr backend)
+    {
+        m_backend = backend;
+    }
+
+    /**
+     * @brief Reserve the output buffers from a pool shared with other crop stages instead of a pool of the stage,
+     *        call before the stage is started.
+     * @param pool Pool with the output size of the stage.
+     * @param quota Output buffers the stage may hold at once, 0 for the whole pool.
+     * @param priority Whether the stage may take the priority reserve of the pool.
+     */
+    void set_buffer_pool(CropBufferPoolPtr pool, size_t quota = 0, bool priority = false)
+    {
+        m_pool = pool;
+        m_pool_quota = quota;
+        m_pool_priority = priority;
+    }
+
+    /**
+     * @brief Sets the quota and priority of the stage in its own pool, call before the stage is started.
+     */
+    void set_pool_quota(size_t quota, bool priority = false)
+    {
+        m_pool_quota = quota;
+        m_pool_priority = priority;
+    }
+
+    /**
+     * @brief How long a blocking stage waits for output buffers before it drops the crops of a frame.
+     */
+    void set_reservation_timeout(std::chrono::milliseconds timeout)
+    {
+        m_reservation_timeout = timeout;
+    }
+
+    /**
+     * @brief Initializes the backend and its output buffer pool, and registers the stage as a consumer of the pool.
+     * @param pool_name Name of the output buffer pool.
+     * @return Status of the operation.
+     */
+    AppStatus init_backend(std::string pool_name)
+    {
+        if (m_pool == nullptr)
+        {
+            m_pool = std::make_shared<CropBufferPool>(pool_name, m_output_width, m_output_hight, m_output_pool_size);
+        }
+        else if (m_pool->width() != m_output_width || m_pool->height() != m_output_hight)
+        {
+            std::cerr << m_stage_name << " output size " << m_output_width << "x" << m_output_hight << " doesn't match the pool "
+                      << m_pool->name() << " (" << m_pool->width() << "x" << m_pool->height() << ")" << std::endl;
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+#ifdef HAILO15_TARGET
+        if (m_backend == nullptr)
+        {
+            m_backend = std::make_shared<DspCropResizeBackend>();
+        }
+#endif
+        if (m_backend != nullptr)
+        {
+            m_pool->set_backend(m_backend);
+        }
+        AppStatus status = m_pool->init();
+        if (status != AppStatus::SUCCESS)
+        {
+            return status;
+        }
+        m_backend = m_pool->get_backend();
+        m_pool->add_consumer(m_stage_name, m_pool_quota, m_pool_priority);
+        return AppStatus::SUCCESS;
+    }
+
+    StageSnapshot get_metrics() override
+    {
+        StageSnapshot snapshot = ConnectedStage::get_metrics();
+        if (m_pool != nullptr)
+        {
+            snapshot.pools.push_back(m_pool->get_stats(m_stage_name));
+        }
+        return snapshot;
+    }
+
+    void reset_metrics() override
+    {
+        ConnectedStage::reset_metrics();
+        if (m_pool != nullptr)
+        {
+            m_pool->reset_stats(m_stage_name);
+        }
+    }
+
+    /**
+     * @brief Whether a frame can be processed with part of its crops when the pool is short of buffers.
+     */
+    virtual bool allow_partial_crops() { return true; }
     
     /**
      * @brief Prepares cropping dimensions for a single bounding box.
      * @param bbox Bounding box for cropping.
      * @param crop_resize_dims Vector to store crop resize dimensions.
      */
-    virtual void prepare_single_crop_dim(HailoBBox bbox, std::vector<dsp_crop_api_t> &crop_resize_dims)
+    virtual void prepare_single_crop_dim(HailoBBox bbox, std::vector<CropRect> &crop_resize_dims)
     {
-        dsp_crop_api_t crop_resize_dim = {
+        CropRect crop_resize_dim = {
             .start_x = (size_t)std::clamp((bbox.xmin() * m_input_width), (float)0.0, ((float)m_input_width) - (float)1.0), 
             .start_y = (size_t)std::clamp((bbox.ymin() * m_input_height), (float)0.0, ((float)m_input_height) - (float)1.0),
             .end_x = (size_t)std::clamp(((bbox.xmin() * m_input_width) + (bbox.width() * m_input_width)), (float)1.0, (float)m_input_width),
@@ -92,7 +202,7 @@ public:
      * @param input_buffer Input buffer.
      * @param crop_resize_dims Vector to store crop dimensions.
      */
-    virtual void prepare_crops(BufferPtr input_buffer, std::vector<dsp_crop_api_t> &crop_resize_dims) = 0;
+    virtual void prepare_crops(BufferPtr input_buffer, std::vector<CropRect> &crop_resize_dims) = 0;
     
     /**
      * @brief Gets the bounding box for a specific crop.
@@ -127,86 +237,70 @@ public:
      */
     AppStatus process(BufferPtr data) override
     {
-        dsp_status status;
         std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-        std::vector<dsp_crop_resize_params_t> crops_params;
-        std::vector<dsp_crop_api_t> crop_resize_dims;
-        std::vector<HailoMediaLibraryBufferPtr> cropped_buffers;
-        std::vector<hailo_dsp_buffer_data_t> output_dsp_buffers;
+        std::vector<CropRect> crop_resize_dims;
+        std::vector<BufferPtr> cropped_buffers;
         prepare_crops(data, crop_resize_dims);
 
-        std::size_t num_crops_allowed = std::min(crop_resize_dims.size(), (std::size_t)m_buffer_pool->get_available_buffers_count());
-
-        crops_params.reserve(num_crops_allowed);
-        output_dsp_buffers.reserve(num_crops_allowed);
-
-        for (std::size_t i = 0; i < num_crops_allowed; ++i)
+        // Reserve the buffers of all the crops at once. Blocking stages wait a bounded time, except on the
+        // executor workers, which are shared by all the stages and must not block.
+        std::size_t min_crops = allow_partial_crops() ? 1 : crop_resize_dims.size();
+        std::chrono::milliseconds timeout(0);
+        if (m_pool_mode == StagePoolMode::BLOCKING && !StageExecutor::on_worker_thread())
         {
-            auto &dims = crop_resize_dims[i];
+            timeout = m_reservation_timeout;
+        }
+        CropBufferPool::ReservationPtr reservation = m_pool->reserve(m_stage_name, crop_resize_dims.size(), min_crops, timeout);
 
-            HailoMediaLibraryBufferPtr cropped_buffer = std::make_shared<hailo_media_library_buffer>();
-            if (m_buffer_pool->acquire_buffer(cropped_buffer) != MEDIA_LIBRARY_SUCCESS)
+        cropped_buffers.reserve(reservation->size());
+        for (std::size_t i = 0; i < reservation->size(); ++i)
+        {
+            BufferPtr cropped_buffer = reservation->acquire_buffer(get_crop_roi(i));
+            if (cropped_buffer == nullptr)
             {
-                if (m_pool_mode == StagePoolMode::FAIL_ON_EMPTY_POOL) {
-                    for (auto& buffer : cropped_buffers) {
-                        buffer.reset();
-                    }
-                    return AppStatus::BUFFER_ALLOCATION_ERROR;
-                } else if (m_pool_mode == StagePoolMode::BLOCKING) {
-                    std::unique_lock<std::mutex> lock(m_buff_pool_mutex);
-                    m_available_buffers_cv.wait(lock, [this, cropped_buffer] { return m_buffer_pool->acquire_buffer(cropped_buffer) == MEDIA_LIBRARY_SUCCESS; });
-                } else {
-                    /* Leaky */
-                    for (auto& buffer : cropped_buffers) {
-                        buffer.reset();
-                    }
-                    return AppStatus::SUCCESS;
-                }
+                break;
             }
-
-            output_dsp_buffers.emplace_back(std::move(cropped_buffer->buffer_data->As<hailo_dsp_buffer_data_t>()));
-            dsp_crop_resize_params_t crop_resize_params = {
-                .crop = &dims,
-            };
-
-            crop_resize_params.dst[0] = &output_dsp_buffers[i].properties;
-            crops_params.emplace_back(std::move(crop_resize_params));
             cropped_buffers.emplace_back(cropped_buffer);
         }
+        if (cropped_buffers.size() < min_crops && !crop_resize_dims.empty())
+        {
+            cropped_buffers.clear();
+            if (m_pool_mode == StagePoolMode::FAIL_ON_EMPTY_POOL)
+            {
+                post_crop(data);
+                return AppStatus::BUFFER_ALLOCATION_ERROR;
+            }
+            // Leaky, or blocking past the timeout: drop the crops, the frame still goes to the main subscriber
+        }
 
-        HailoMediaLibraryBufferPtr input_buffer = data->get_buffer();
-        hailo_dsp_buffer_data_t in_buffer_data = input_buffer->buffer_data->As<hailo_dsp_buffer_data_t>();
-        dsp_multi_crop_resize_params_t multi_crop_resize_params = {
-            .src = &in_buffer_data.properties,
-            .crop_resize_params = crops_params.data(),
-            .crop_resize_params_count = num_crops_allowed,
-            .interpolation = INTERPOLATION_TYPE_BILINEAR,
-        };
-
-        status = dsp_utils::perform_dsp_multi_resize(&multi_crop_resize_params);
-        if (status != DSP_SUCCESS) 
+        if (!cropped_buffers.empty())
         {
-            std::cerr << "Failed to perform dsp multi resize" << std::endl;
-            return AppStatus::DSP_OPERATION_ERROR;
+            crop_resize_dims.resize(cropped_buffers.size());
+            AppStatus status = m_backend->multi_crop_resize(data, crop_resize_dims, cropped_buffers);
+            if (status != AppStatus::SUCCESS)
+            {
+                post_crop(data);
+                return status;
+            }
         }
 
         CroppingMetadataPtr cropping_meta = std::make_shared<CroppingMetadata>(cropped_buffers.size());
         data->add_metadata(cropping_meta);
         
-        data->add_time_stamp(m_stage_name);
+        data->add_time_stamp(m_stage_id);
         set_duration(data);
         send_to_specific_subsciber(m_main_subscriber, data);
 
         for (std::size_t i = 0; i < cropped_buffers.size(); ++i)
         {
-            HailoROIPtr roi = get_crop_roi(i);
-            BufferPtr cropped_buffer_ptr = std::make_shared<Buffer>(cropped_buffers[i], roi);
+            BufferPtr cropped_buffer_ptr = cropped_buffers[i];
 
             // Set the ROI of the cropped buffer to the scale of the parent ROI
             // Note, this will make overlay incorrect if the bboxes are not flattened
             cropped_buffer_ptr->get_roi()->set_scaling_bbox(get_crop_bbox(i));
-            cropped_buffer_ptr->add_time_stamp(m_stage_name+"_"+ std::to_string(i));
+            cropped_buffer_ptr->add_metadata(std::make_shared<CropIndexMetadata>(i, cropped_buffers.size()));
+            cropped_buffer_ptr->add_time_stamp(m_stage_id);
 
             send_to_specific_subsciber(m_sub_subscriber, cropped_buffer_ptr);
         }
@@ -218,7 +312,7 @@ public:
         if (m_print_fps)
         {
             std::cout << m_stage_name << " crop and resize time = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() 
-                      << "[microseconds]" << "Number of crops: " << crop_resize_dims.size() << std::endl;
+                      << "[microseconds]" << "Number of crops: " << cropped_buffers.size() << std::endl;
         }
 
         return AppStatus::SUCCESS;
@@ -263,13 +357,10 @@ public:
      */
     AppStatus init() override
     {
-        auto bytes_per_line = dsp_utils::get_dsp_desired_stride_from_width(m_output_width);
-        m_buffer_pool = std::make_shared<MediaLibraryBufferPool>(m_output_width, m_output_hight, HAILO_FORMAT_NV12,
-                                                                 m_output_pool_size, HAILO_MEMORY_TYPE_DMABUF, bytes_per_line, "tilling_buffer_pool");
-           
-        if (m_buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
+        AppStatus status = init_backend("tilling_buffer_pool");
+        if (status != AppStatus::SUCCESS)
         {
-            return AppStatus::DSP_OPERATION_ERROR;
+            return status;
         }
         
         /* Create the HailoTileROI objects and the buffer pools we will have pool per tile */
@@ -283,12 +374,17 @@ public:
         return AppStatus::SUCCESS;
     }
 
+    /**
+     * @brief The detection of a frame needs all its tiles.
+     */
+    bool allow_partial_crops() override { return false; }
+
     /**
      * @brief Prepares crop dimensions based on tiles.
      * @param input_buffer Input buffer.
      * @param crop_resize_dims Vector to store crop dimensions.
      */
-    void prepare_crops(BufferPtr input_buffer, std::vector<dsp_crop_api_t> &crop_resize_dims) override
+    void prepare_crops(BufferPtr input_buffer, std::vector<CropRect> &crop_resize_dims) override
     {
         for (auto &tile : m_fhd_tiles)
         {
@@ -354,13 +450,10 @@ public:
      */
     AppStatus init() override
     {
-        auto bytes_per_line = dsp_utils::get_dsp_desired_stride_from_width(m_output_width);
-        m_buffer_pool = std::make_shared<MediaLibraryBufferPool>(m_output_width, m_output_hight, HAILO_FORMAT_NV12,
-                                                                 m_output_pool_size, HAILO_MEMORY_TYPE_DMABUF, bytes_per_line, "detection_buffer_pool");
-           
-        if (m_buffer_pool->init() != MEDIA_LIBRARY_SUCCESS)
+        AppStatus status = init_backend("detection_buffer_pool");
+        if (status != AppStatus::SUCCESS)
         {
-            return AppStatus::DSP_OPERATION_ERROR;
+            return status;
         }
 
         return AppStatus::SUCCESS;
@@ -371,7 +464,7 @@ public:
      * @param input_buffer Input buffer.
      * @param crop_resize_dims Vector to store crop dimensions.
      */
-    void prepare_crops(BufferPtr input_buffer, std::vector<dsp_crop_api_t> &crop_resize_dims) override
+    void prepare_crops(BufferPtr input_buffer, std::vector<CropRect> &crop_resize_dims) override
     {
         HailoROIPtr roi = input_buffer->get_roi();
         
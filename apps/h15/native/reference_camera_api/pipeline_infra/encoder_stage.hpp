@@ -12,6 +12,7 @@
 // Infra includes
 #include "stage.hpp"
 #include "buffer.hpp"
+#include "media_library_buffer.hpp"
 
 class EncoderStage : public ConnectedStage
 {
@@ -44,7 +45,7 @@ public:
             {
                 // Keep in mind, this does not pass Buffer metadata from encoder input to the next stage
                 // It is generally assumed that this is near the end of pipeline.
-                BufferPtr wrapped_buffer = std::make_shared<Buffer>(buffer);
+                BufferPtr wrapped_buffer = std::make_shared<Buffer>(std::make_shared<MediaLibraryFrame>(buffer));
                 SizeMetadataPtr size_meta = std::make_shared<SizeMetadata>(this->m_stage_name, size);
                 wrapped_buffer->add_metadata(size_meta);
                 this->send_to_subscribers(wrapped_buffer);
@@ -80,6 +81,12 @@ public:
         return create(config_string);
     }
 
+    // Encoding waits for the encoder hardware, keep a dedicated thread on an executor.
+    bool runs_as_task() override
+    {
+        return false;
+    }
+
     AppStatus process(BufferPtr data)
     {
         if (m_encoder == nullptr)
@@ -87,7 +94,13 @@ public:
             std::cerr << "Encoder " << m_stage_name << " not initialized" << std::endl;
             return AppStatus::UNINITIALIZED;
         }
-        m_encoder->add_buffer(data->get_buffer());
+        HailoMediaLibraryBufferPtr buffer = get_media_library_buffer(data);
+        if (buffer == nullptr)
+        {
+            std::cerr << "Encoder " << m_stage_name << " requires media library buffers" << std::endl;
+            return AppStatus::INVALID_ARGUMENT;
+        }
+        m_encoder->add_buffer(buffer);
         return AppStatus::SUCCESS;
     }
 };
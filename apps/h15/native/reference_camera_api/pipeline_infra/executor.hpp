@@ -0,0 +1,400 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * @brief A unit of work that can be run by the StageExecutor.
+ *
+ * run_once() is never called concurrently for the same task, and is only called while ready() is true.
+ * ready() may be called from any thread, also while run_once() runs.
+ * run_once() should not block, the worker threads are shared by all the tasks.
+ */
+class ScheduledTask
+{
+public:
+    virtual ~ScheduledTask() = default;
+
+    // Whether run_once() has work to do and room to push its output.
+    virtual bool ready() = 0;
+
+    virtual void run_once() = 0;
+};
+
+/**
+ * @brief Runs tasks on a fixed pool of worker threads, instead of a thread per task.
+ *
+ * Every worker has its own deque of scheduled tasks. A task scheduled from a worker goes to the front of
+ * that worker's deque and is run next, so a buffer tends to be processed by the next stage on the same core.
+ * Idle workers steal from the back of the other workers' deques. Latency critical tasks are kept in a shared
+ * deque that all the workers check first.
+ *
+ * Tasks are not polled: a task is scheduled when notify() is called for it (a buffer was pushed to its queue,
+ * or a queue it pushes to has room again) and it is ready(). After running up to run_budget times it goes back
+ * to the end of the line if it is still ready.
+ */
+class StageExecutor
+{
+public:
+    using TaskId = size_t;
+
+    struct Stats
+    {
+        uint64_t runs = 0;
+        uint64_t steals = 0;
+    };
+
+private:
+    struct TaskEntry
+    {
+        ScheduledTask *task;
+        std::string name;
+        bool latency_critical;
+        std::atomic<bool> scheduled{false};
+        std::atomic<bool> removed{false};
+        // Threads calling into the task without holding it scheduled (notify, and a worker after clearing scheduled)
+        std::atomic<size_t> users{0};
+    };
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<TaskEntry *> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<TaskEntry>> m_tasks; // Never erased while the executor lives
+    std::unordered_map<std::string, TaskId> m_task_ids;
+    std::shared_mutex m_tasks_mutex;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::deque<TaskEntry *> m_priority_tasks;
+    std::mutex m_priority_mutex;
+
+    std::atomic<size_t> m_pending{0};
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_sleep_cv;
+    std::mutex m_idle_mutex;
+    std::condition_variable m_idle_cv;
+
+    std::atomic<bool> m_running{false};
+    std::atomic<size_t> m_next_worker{0};
+    size_t m_run_budget;
+    std::atomic<uint64_t> m_runs{0};
+    std::atomic<uint64_t> m_steals{0};
+
+    struct WorkerIdentity
+    {
+        StageExecutor *executor = nullptr;
+        size_t index = 0;
+    };
+
+    static WorkerIdentity &current_worker()
+    {
+        thread_local WorkerIdentity identity;
+        return identity;
+    }
+
+    // Returns false if the task was removed, the task may not be called then.
+    bool acquire(TaskEntry *entry)
+    {
+        entry->users++;
+        if (entry->removed)
+        {
+            release(entry);
+            return false;
+        }
+        return true;
+    }
+
+    void release(TaskEntry *entry)
+    {
+        if (--entry->users == 0 && entry->removed)
+        {
+            std::lock_guard<std::mutex> lock(m_idle_mutex);
+            m_idle_cv.notify_all();
+        }
+    }
+
+    TaskEntry *get_entry(TaskId id)
+    {
+        std::shared_lock<std::shared_mutex> lock(m_tasks_mutex);
+        return (id < m_tasks.size()) ? m_tasks[id].get() : nullptr;
+    }
+
+    // A task rescheduled after using its run budget goes to the back of the line.
+    void enqueue(TaskEntry *entry, bool requeue)
+    {
+        WorkerIdentity &identity = current_worker();
+        size_t worker = (identity.executor == this) ? identity.index : m_workers.size();
+        if (entry->latency_critical)
+        {
+            std::lock_guard<std::mutex> lock(m_priority_mutex);
+            m_priority_tasks.push_back(entry);
+        }
+        else if (worker < m_workers.size())
+        {
+            std::lock_guard<std::mutex> lock(m_workers[worker]->mutex);
+            if (requeue)
+                m_workers[worker]->tasks.push_back(entry);
+            else
+                m_workers[worker]->tasks.push_front(entry);
+        }
+        else
+        {
+            Worker &target = *m_workers[m_next_worker++ % m_workers.size()];
+            std::lock_guard<std::mutex> lock(target.mutex);
+            target.tasks.push_back(entry);
+        }
+        m_pending++;
+        {
+            // Taking the lock orders this with a worker that is about to sleep
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        }
+        m_sleep_cv.notify_one();
+    }
+
+    void schedule(TaskEntry *entry, bool requeue = false)
+    {
+        if (entry->removed || !m_running)
+            return;
+        if (!entry->scheduled.exchange(true))
+            enqueue(entry, requeue);
+    }
+
+    TaskEntry *take(size_t index)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_priority_mutex);
+            if (!m_priority_tasks.empty())
+            {
+                TaskEntry *entry = m_priority_tasks.front();
+                m_priority_tasks.pop_front();
+                return entry;
+            }
+        }
+        {
+            Worker &own = *m_workers[index];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                TaskEntry *entry = own.tasks.front();
+                own.tasks.pop_front();
+                return entry;
+            }
+        }
+        for (size_t i = 1; i < m_workers.size(); i++)
+        {
+            Worker &victim = *m_workers[(index + i) % m_workers.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                TaskEntry *entry = victim.tasks.back();
+                victim.tasks.pop_back();
+                m_steals++;
+                return entry;
+            }
+        }
+        return nullptr;
+    }
+
+    void run(TaskEntry *entry)
+    {
+        for (size_t i = 0; i < m_run_budget && !entry->removed && entry->task->ready(); i++)
+        {
+            entry->task->run_once();
+            m_runs++;
+        }
+
+        // Keep holding the task while it is checked, remove_task waits until it is released
+        if (!acquire(entry))
+        {
+            entry->scheduled = false;
+            std::lock_guard<std::mutex> lock(m_idle_mutex);
+            m_idle_cv.notify_all();
+            return;
+        }
+        entry->scheduled = false;
+        // A notify() that arrived while running was ignored, check again
+        if (entry->task->ready())
+        {
+            schedule(entry, true);
+        }
+        release(entry);
+    }
+
+    void notify(TaskEntry *entry)
+    {
+        if (entry == nullptr || entry->scheduled || !acquire(entry))
+            return;
+        if (entry->task->ready())
+            schedule(entry);
+        release(entry);
+    }
+
+    void worker_loop(size_t index)
+    {
+        current_worker() = {this, index};
+        while (m_running)
+        {
+            TaskEntry *entry = take(index);
+            if (entry == nullptr)
+            {
+                std::unique_lock<std::mutex> lock(m_sleep_mutex);
+                m_sleep_cv.wait(lock, [this]
+                                { return m_pending > 0 || !m_running; });
+                continue;
+            }
+            m_pending--;
+            run(entry);
+        }
+    }
+
+public:
+    StageExecutor(size_t run_budget = 4) : m_run_budget(std::max<size_t>(run_budget, 1)) {}
+
+    ~StageExecutor()
+    {
+        stop();
+    }
+
+    /**
+     * @brief Start the worker threads.
+     *
+     * @param num_workers Number of worker threads, 0 uses one per core.
+     * @param pin_workers Pin every worker to its own core.
+     */
+    void start(size_t num_workers = 0, bool pin_workers = true)
+    {
+        size_t num_cores = std::max(std::thread::hardware_concurrency(), 1u);
+        if (num_workers == 0)
+            num_workers = num_cores;
+
+        for (size_t i = 0; i < num_workers; i++)
+            m_workers.emplace_back(std::make_unique<Worker>());
+        m_running = true;
+        for (size_t i = 0; i < num_workers; i++)
+        {
+            m_workers[i]->thread = std::thread(&StageExecutor::worker_loop, this, i);
+            if (pin_workers)
+            {
+                cpu_set_t cpuset;
+                CPU_ZERO(&cpuset);
+                CPU_SET(i % num_cores, &cpuset);
+                pthread_setaffinity_np(m_workers[i]->thread.native_handle(), sizeof(cpu_set_t), &cpuset);
+            }
+        }
+
+        // Tasks that became ready before the workers were started
+        std::shared_lock<std::shared_mutex> lock(m_tasks_mutex);
+        for (auto &entry : m_tasks)
+            notify(entry.get());
+    }
+
+    void stop()
+    {
+        if (!m_running.exchange(false))
+            return;
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+        }
+        m_sleep_cv.notify_all();
+        for (auto &worker : m_workers)
+            worker->thread.join();
+
+        std::lock_guard<std::mutex> lock(m_idle_mutex);
+        m_idle_cv.notify_all();
+    }
+
+    /**
+     * @brief Register a task, it is not run until it is notified.
+     *
+     * @param name Name used to notify the task by name (the name of its stage).
+     * @param latency_critical Run this task before all the other scheduled tasks.
+     */
+    TaskId add_task(ScheduledTask *task, std::string name, bool latency_critical = false)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_tasks_mutex);
+        auto entry = std::make_unique<TaskEntry>();
+        entry->task = task;
+        entry->name = name;
+        entry->latency_critical = latency_critical;
+        m_tasks.emplace_back(std::move(entry));
+        m_task_ids[name] = m_tasks.size() - 1;
+        return m_tasks.size() - 1;
+    }
+
+    /**
+     * @brief Unregister a task, waits until no thread runs or checks it anymore.
+     */
+    void remove_task(TaskId id)
+    {
+        TaskEntry *entry = get_entry(id);
+        if (entry == nullptr)
+            return;
+        entry->removed = true;
+        {
+            std::unique_lock<std::mutex> lock(m_idle_mutex);
+            m_idle_cv.wait(lock, [this, entry]
+                           { return (!entry->scheduled || !m_running) && entry->users == 0; });
+        }
+        std::unique_lock<std::shared_mutex> lock(m_tasks_mutex);
+        auto it = m_task_ids.find(entry->name);
+        if (it != m_task_ids.end() && it->second == id)
+            m_task_ids.erase(it);
+    }
+
+    /**
+     * @brief Schedule a task if it is ready and not already scheduled.
+     */
+    void notify(TaskId id)
+    {
+        notify(get_entry(id));
+    }
+
+    void notify(const std::string &name)
+    {
+        TaskEntry *entry = nullptr;
+        {
+            std::shared_lock<std::shared_mutex> lock(m_tasks_mutex);
+            auto it = m_task_ids.find(name);
+            if (it != m_task_ids.end())
+                entry = m_tasks[it->second].get();
+        }
+        notify(entry);
+    }
+
+    /**
+     * @brief Whether the calling thread is a worker of an executor, the workers are shared and must not block.
+     */
+    static bool on_worker_thread()
+    {
+        return current_worker().executor != nullptr;
+    }
+
+    size_t num_workers()
+    {
+        return m_workers.size();
+    }
+
+    Stats get_stats()
+    {
+        Stats stats;
+        stats.runs = m_runs;
+        stats.steals = m_steals;
+        return stats;
+    }
+};
+using StageExecutorPtr = std::shared_ptr<StageExecutor>;
@@ -16,6 +16,7 @@
 #include "media_library/media_library_types.hpp"
 #include "stage.hpp"
 #include "buffer.hpp"
+#include "media_library_buffer.hpp"
 
 class FrontendStage : public ConnectedStage
 {
@@ -78,7 +79,7 @@ public:
             std::cout << "subscribing to frontend for '" << s.id << "'" << std::endl;
             fe_callbacks[s.id] = [s, this](HailoMediaLibraryBufferPtr buffer, size_t size)
             {
-                BufferPtr wrapped_buffer = std::make_shared<Buffer>(buffer);
+                BufferPtr wrapped_buffer = std::make_shared<Buffer>(std::make_shared<MediaLibraryFrame>(buffer));
                 for (auto &subscriber : m_stream_subscribers[s.id])
                 {
                     subscriber->push(wrapped_buffer, s.id);
@@ -89,6 +90,12 @@ public:
         return AppStatus::SUCCESS;
     }
 
+    // Buffers are pushed from the frontend callbacks, the thread only waits for the end of stream.
+    bool runs_as_task() override
+    {
+        return false;
+    }
+
     virtual AppStatus stop() override
     {
         set_end_of_stream(true);
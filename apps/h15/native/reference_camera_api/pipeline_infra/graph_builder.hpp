@@ -0,0 +1,559 @@
+#pragma once
+
+// General includes
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// rapidjson includes
+#include "rapidjson/document.h"
+#include "rapidjson/error/en.h"
+#include "rapidjson/filereadstream.h"
+
+// Infra includes
+#include "aggregator_stage.hpp"
+#include "batcher.hpp"
+#include "dsp_stages.hpp"
+#include "graph_config.hpp"
+#include "overlay_stage.hpp"
+#include "persist_stage.hpp"
+#include "pipeline.hpp"
+#include "postprocess_stage.hpp"
+#include "tracker_stage.hpp"
+
+#ifdef HAILO15_TARGET
+#include "ai_stage.hpp"
+#endif
+
+/**
+ * @brief Builds the stages of a pipeline and their connections from a JSON description.
+ *
+ * The description lists the stages with their parameters, the external inputs that feed the graph
+ * (e.g. frontend streams, subscribed by the application) and the connections in subscription order:
+ *
+ *      {
+ *          "target_fps": 30,
+ *          "auto_size": false,
+ *          "inputs": ["sink2"],
+ *          "stages": [
+ *              {"name": "detection", "type": "hailort", "hef_path": "...", "queue_size": 5, "pool_size": 50, ...},
+ *              {"name": "detection_post", "type": "postprocess", "so_path": "...", "function_name": "...", ...}
+ *          ],
+ *          "connections": [
+ *              {"from": "sink2", "to": "detection"},
+ *              {"from": "detection", "to": "detection_post"},
+ *              {"from": "detection_post", "to": "sink0"}
+ *          ]
+ *      }
+ *
+ * Connections to stages created by the application (e.g. encoders) need them to be added with
+ * add_external_stage() before loading. The graph is validated before any stage is created. When auto_size is
+ * set, queue and pool sizes are derived from target_fps and the stage latencies ("latency_us" of every stage,
+ * or set_stage_latency() from a previous measurement) instead of the sizes in the description.
+ *
+ * Without the media library (HAILO15_TARGET undefined) the "hailort" type is not registered and crop stages
+ * need a backend (see DspBaseCropStage::set_backend), e.g. to run on the CPU backend (cpu_backend.hpp).
+ *
+ * Common stage fields: name, type, queue_size, leaky, latency_critical, items_per_frame, latency_us, stage_type
+ * ("general", "source" or "sink"). Every type reads its own constructor parameters, and new types can be added
+ * with register_stage_type().
+ *
+ * Inference stages batch up to batch_size buffers, and read the batching settings batch_timeout_us,
+ * adaptive_batching and min_batch (see HailortAsyncStage::set_batching).
+ *
+ * Crop stages also read the reservation settings of their output pool (see CropBufferPool): pool_quota,
+ * pool_priority and reservation_timeout_ms. Crop stages with the same "shared_pool" name and output size share
+ * one pool, of the largest pool_size of them, with the largest "priority_reserve" of them.
+ */
+class PipelineGraphBuilder
+{
+public:
+    using StageFactory = std::function<ConnectedStagePtr(const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps)>;
+
+    // Fills the type specific parts of the stage config (pool, required inputs and outputs) from the JSON.
+    using StageDescriber = std::function<void(GraphStageConfig &config, const rapidjson::Value &json)>;
+
+private:
+    struct RegisteredType
+    {
+        StageFactory factory;
+        StageDescriber describer;
+    };
+
+    rapidjson::Document m_document;
+    PipelineGraph m_graph;
+    std::map<std::string, RegisteredType> m_types;
+    std::map<std::string, const rapidjson::Value *> m_stage_json;
+    std::map<std::string, ConnectedStagePtr> m_external_stages;
+    std::map<std::string, ConnectedStagePtr> m_built_stages;
+    std::map<std::string, double> m_measured_latencies;
+    std::vector<std::pair<std::string, std::string>> m_connections;
+    double m_target_fps = 0;
+    bool m_auto_size = false;
+    bool m_loaded = false;
+
+public:
+    static std::string get_string(const rapidjson::Value &json, const char *key, std::string default_value = "")
+    {
+        return (json.HasMember(key) && json[key].IsString()) ? json[key].GetString() : default_value;
+    }
+
+    static size_t get_uint(const rapidjson::Value &json, const char *key, size_t default_value = 0)
+    {
+        return (json.HasMember(key) && json[key].IsUint()) ? json[key].GetUint() : default_value;
+    }
+
+    static int get_int(const rapidjson::Value &json, const char *key, int default_value = 0)
+    {
+        return (json.HasMember(key) && json[key].IsInt()) ? json[key].GetInt() : default_value;
+    }
+
+    static double get_double(const rapidjson::Value &json, const char *key, double default_value = 0)
+    {
+        return (json.HasMember(key) && json[key].IsNumber()) ? json[key].GetDouble() : default_value;
+    }
+
+    static bool get_bool(const rapidjson::Value &json, const char *key, bool default_value = false)
+    {
+        return (json.HasMember(key) && json[key].IsBool()) ? json[key].GetBool() : default_value;
+    }
+
+    static StagePoolMode get_pool_mode(const rapidjson::Value &json)
+    {
+        std::string mode = get_string(json, "pool_mode", "fail_on_empty");
+        if (mode == "blocking")
+            return StagePoolMode::BLOCKING;
+        if (mode == "leaky")
+            return StagePoolMode::LEAKY;
+        return StagePoolMode::FAIL_ON_EMPTY_POOL;
+    }
+
+    // Batching of the inference stages, "batch_timeout_us"
+    static std::chrono::microseconds get_batch_timeout(const rapidjson::Value &json)
+    {
+        return std::chrono::microseconds(get_uint(json, "batch_timeout_us", INFER_BATCH_DEFAULT_TIMEOUT.count()));
+    }
+
+    PipelineGraphBuilder()
+    {
+        register_crop_stages();
+
+#ifdef HAILO15_TARGET
+        register_stage_type(
+            "hailort",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                std::shared_ptr<HailortAsyncStage> stage = std::make_shared<HailortAsyncStage>(config.name, get_string(json, "hef_path"), config.queue_size, config.pool_size,
+                                                                                               get_string(json, "group_id", "device0"), get_int(json, "batch_size", 1),
+                                                                                               config.in_flight_limit, get_int(json, "scheduler_threshold", 4),
+                                                                                               std::chrono::milliseconds(get_int(json, "scheduler_timeout_ms", 100)),
+                                                                                               print_fps, get_pool_mode(json));
+                stage->set_batching(get_batch_timeout(json), get_bool(json, "adaptive_batching", false), get_uint(json, "min_batch", 1));
+                return stage;
+            },
+            [](GraphStageConfig &config, const rapidjson::Value &json)
+            {
+                config.owns_pool = true;
+                config.pool_size = get_uint(json, "pool_size");
+                config.in_flight_limit = get_uint(json, "jobs_limit", 1);
+            });
+#endif
+
+        register_stage_type(
+            "postprocess",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<PostprocessStage>(config.name, get_string(json, "so_path"), get_string(json, "function_name", DEFAULT_FUNC_NAME),
+                                                          get_string(json, "config_path"), config.queue_size, config.leaky, print_fps);
+            });
+
+        register_stage_type(
+            "aggregator",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<AggregatorStage>(config.name, get_bool(json, "blocking", false),
+                                                         config.required_inputs[0], config.queue_size,
+                                                         config.required_inputs[1], config.sub_queue_size,
+                                                         get_int(json, "static_sub_frames", -1),
+                                                         get_bool(json, "multi_scale", false), get_double(json, "iou_threshold", 0.3),
+                                                         get_double(json, "border_threshold", 0.1), config.leaky, print_fps);
+            },
+            [](GraphStageConfig &config, const rapidjson::Value &json)
+            {
+                config.aggregator = true;
+                config.required_inputs = {get_string(json, "main_input"), get_string(json, "sub_input")};
+                config.sub_queue_size = get_uint(json, "sub_queue_size", config.queue_size);
+            });
+
+        register_stage_type(
+            "tracker",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<TrackerStage>(config.name, config.queue_size, config.leaky, get_int(json, "classification_id", -1), print_fps);
+            });
+
+        register_stage_type(
+            "persist",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<PersistStage>(config.name, get_uint(json, "expiration", 5), config.queue_size, config.leaky, print_fps);
+            });
+
+        register_stage_type(
+            "overlay",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<OverlayStage>(config.name, get_bool(json, "skip_drawing", false), get_bool(json, "partial_landmarks", false),
+                                                      get_uint(json, "landmarks_range_min", 0), get_uint(json, "landmarks_range_max", 0),
+                                                      config.queue_size, config.leaky, print_fps);
+            });
+    }
+
+    /**
+     * @brief Add (or replace) a stage type.
+     *
+     * @param factory Creates the stage from its config (sizes may be auto sized) and its JSON object.
+     * @param describer Optional, fills the type specific parts of the config used for validation and sizing.
+     */
+    void register_stage_type(std::string type, StageFactory factory, StageDescriber describer = nullptr)
+    {
+        m_types[type] = {factory, describer};
+    }
+
+    /**
+     * @brief Add a stage created by the application that stages of the graph can connect to, e.g. an encoder.
+     *        It is not added to the pipeline by build().
+     */
+    void add_external_stage(std::string name, ConnectedStagePtr stage)
+    {
+        m_external_stages[name] = stage;
+    }
+
+    /**
+     * @brief Set the measured latency of a stage, overrides the latency in the description.
+     */
+    void set_stage_latency(std::string name, std::chrono::microseconds latency)
+    {
+        m_measured_latencies[name] = latency.count();
+    }
+
+    /**
+     * @brief Override the auto sizing settings of the description, call after loading.
+     */
+    void set_auto_size(bool auto_size, double target_fps)
+    {
+        m_auto_size = auto_size;
+        m_target_fps = target_fps;
+    }
+
+    AppStatus load_file(std::string path)
+    {
+        std::FILE *fp = fopen(path.c_str(), "r");
+        if (fp == nullptr)
+        {
+            std::cerr << "Failed to open pipeline graph file " << path << std::endl;
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+        char buffer[4096];
+        rapidjson::FileReadStream stream(fp, buffer, sizeof(buffer));
+        m_document.ParseStream(stream);
+        fclose(fp);
+        return load_document();
+    }
+
+    AppStatus load_string(std::string json)
+    {
+        m_document.Parse(json.c_str());
+        return load_document();
+    }
+
+    /**
+     * @brief The config of a stage after loading (and auto sizing), nullptr if there is no such stage.
+     */
+    const GraphStageConfig *get_stage_config(std::string name)
+    {
+        return m_graph.get_stage(name);
+    }
+
+    /**
+     * @brief The stages created by build(), by name.
+     */
+    const std::map<std::string, ConnectedStagePtr> &get_stages()
+    {
+        return m_built_stages;
+    }
+
+    /**
+     * @brief The connections from the inputs of the graph (input, stage), for the application to subscribe.
+     */
+    std::vector<std::pair<std::string, std::string>> get_input_connections()
+    {
+        std::vector<std::pair<std::string, std::string>> input_connections;
+        for (auto &connection : m_connections)
+        {
+            if (m_graph.is_input(connection.first))
+                input_connections.push_back(connection);
+        }
+        return input_connections;
+    }
+
+    /**
+     * @brief Validate the graph, auto size it if requested, create the stages, add them to the pipeline and
+     *        connect them. Nothing is added to the pipeline if the graph is not valid.
+     */
+    AppStatus build(PipelinePtr pipeline, bool print_fps = false)
+    {
+        if (!m_loaded)
+        {
+            std::cerr << "Pipeline graph not loaded" << std::endl;
+            return AppStatus::UNINITIALIZED;
+        }
+
+        for (auto &latency : m_measured_latencies)
+        {
+            GraphStageConfig *config = m_graph.get_stage(latency.first);
+            if (config != nullptr)
+                config->latency_us = latency.second;
+        }
+
+        std::vector<std::string> errors, warnings;
+        if (m_auto_size)
+        {
+            if (m_target_fps <= 0)
+            {
+                std::cerr << "Pipeline graph auto sizing requires a positive target fps" << std::endl;
+                return AppStatus::CONFIGURATION_ERROR;
+            }
+            m_graph.auto_size(m_target_fps, warnings);
+        }
+        bool valid = m_graph.validate(errors, warnings, m_target_fps);
+        for (auto &warning : warnings)
+        {
+            std::cout << "Pipeline graph warning: " << warning << std::endl;
+        }
+        if (!valid)
+        {
+            for (auto &error : errors)
+            {
+                std::cerr << "Pipeline graph error: " << error << std::endl;
+            }
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+
+        std::map<std::string, ConnectedStagePtr> stages;
+        for (auto &config : m_graph.stages())
+        {
+            const rapidjson::Value &json = *m_stage_json[config.name];
+            ConnectedStagePtr stage = m_types[config.type].factory(config, json, print_fps);
+            if (stage == nullptr)
+            {
+                std::cerr << "Failed to create stage " << config.name << std::endl;
+                return AppStatus::CONFIGURATION_ERROR;
+            }
+            stage->set_latency_critical(config.latency_critical);
+            stages[config.name] = stage;
+        }
+        AppStatus status = configure_crop_pools(stages);
+        if (status != AppStatus::SUCCESS)
+        {
+            return status;
+        }
+
+        for (auto &config : m_graph.stages())
+        {
+            std::string stage_type = get_string(*m_stage_json[config.name], "stage_type", "general");
+            StageType type = (stage_type == "source") ? StageType::SOURCE : (stage_type == "sink") ? StageType::SINK : StageType::GENERAL;
+            pipeline->add_stage(stages[config.name], type);
+        }
+
+        for (auto &connection : m_connections)
+        {
+            if (m_graph.is_input(connection.first))
+            {
+                // Fed by the application
+                continue;
+            }
+            ConnectedStagePtr subscriber = stages.count(connection.second) ? stages[connection.second] : m_external_stages[connection.second];
+            stages[connection.first]->add_subscriber(subscriber);
+        }
+        m_built_stages = stages;
+        return AppStatus::SUCCESS;
+    }
+
+private:
+    // Pool settings of the crop stages, and the pools shared by several of them ("shared_pool").
+    AppStatus configure_crop_pools(std::map<std::string, ConnectedStagePtr> &stages)
+    {
+        std::map<std::string, CropBufferPoolPtr> shared_pools;
+        for (auto &config : m_graph.stages())
+        {
+            std::shared_ptr<DspBaseCropStage> crop_stage = std::dynamic_pointer_cast<DspBaseCropStage>(stages[config.name]);
+            if (crop_stage == nullptr)
+                continue;
+            const rapidjson::Value &json = *m_stage_json[config.name];
+            size_t quota = get_uint(json, "pool_quota");
+            bool priority = get_bool(json, "pool_priority", false);
+            if (json.HasMember("reservation_timeout_ms"))
+                crop_stage->set_reservation_timeout(std::chrono::milliseconds(get_uint(json, "reservation_timeout_ms")));
+
+            std::string pool_name = get_string(json, "shared_pool");
+            if (pool_name.empty())
+            {
+                crop_stage->set_pool_quota(quota, priority);
+                continue;
+            }
+            // The shared pool takes the size of the largest pool of its stages
+            CropBufferPoolPtr &pool = shared_pools[pool_name];
+            int width = get_int(json, "output_width"), height = get_int(json, "output_height");
+            if (pool == nullptr)
+            {
+                size_t size = 0, priority_reserve = 0;
+                for (auto &other : m_graph.stages())
+                {
+                    if (get_string(*m_stage_json[other.name], "shared_pool") == pool_name)
+                    {
+                        size = std::max(size, other.pool_size);
+                        priority_reserve = std::max(priority_reserve, get_uint(*m_stage_json[other.name], "priority_reserve"));
+                    }
+                }
+                pool = std::make_shared<CropBufferPool>(pool_name, width, height, size, priority_reserve);
+            }
+            else if (pool->width() != width || pool->height() != height)
+            {
+                std::cerr << "Stage " << config.name << " output size doesn't match the shared pool " << pool_name << std::endl;
+                return AppStatus::CONFIGURATION_ERROR;
+            }
+            crop_stage->set_buffer_pool(pool, quota, priority);
+        }
+        return AppStatus::SUCCESS;
+    }
+
+    void register_crop_stages()
+    {
+        StageDescriber crop_describer = [](GraphStageConfig &config, const rapidjson::Value &json)
+        {
+            config.owns_pool = true;
+            config.pool_size = get_uint(json, "pool_size");
+            std::string main_output = get_string(json, "main_output");
+            std::string sub_output = get_string(json, "sub_output");
+            config.required_subscribers = {main_output, sub_output};
+            // Only the crops are taken from the pool, the main output gets the input buffer
+            config.pool_subscribers = {sub_output};
+        };
+
+        register_stage_type(
+            "tilling_crop",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                std::vector<HailoBBox> tiles;
+                if (json.HasMember("tiles") && json["tiles"].IsArray())
+                {
+                    for (auto &tile : json["tiles"].GetArray())
+                    {
+                        if (!tile.IsArray() || tile.Size() != 4)
+                        {
+                            std::cerr << "Stage " << config.name << " tiles must be [xmin, ymin, width, height]" << std::endl;
+                            return nullptr;
+                        }
+                        tiles.emplace_back(tile[0].GetFloat(), tile[1].GetFloat(), tile[2].GetFloat(), tile[3].GetFloat());
+                    }
+                }
+                return std::make_shared<TillingCropStage>(config.name, config.pool_size, get_int(json, "input_width"), get_int(json, "input_height"),
+                                                          get_int(json, "output_width"), get_int(json, "output_height"),
+                                                          get_string(json, "main_output"), get_string(json, "sub_output"), tiles,
+                                                          config.queue_size, config.leaky, print_fps, get_pool_mode(json));
+            },
+            crop_describer);
+
+        register_stage_type(
+            "bbox_crop",
+            [](const GraphStageConfig &config, const rapidjson::Value &json, bool print_fps) -> ConnectedStagePtr
+            {
+                return std::make_shared<BBoxCropStage>(config.name, config.pool_size, get_int(json, "input_width"), get_int(json, "input_height"),
+                                                       get_int(json, "output_width"), get_int(json, "output_height"),
+                                                       get_string(json, "main_output"), get_string(json, "sub_output"), get_string(json, "label"),
+                                                       config.queue_size, config.leaky, print_fps, get_pool_mode(json));
+            },
+            crop_describer);
+    }
+
+    AppStatus load_document()
+    {
+        if (m_document.HasParseError())
+        {
+            std::cerr << "Pipeline graph JSON error (offset " << m_document.GetErrorOffset() << "): "
+                      << rapidjson::GetParseError_En(m_document.GetParseError()) << std::endl;
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+        if (!m_document.IsObject() || !m_document.HasMember("stages") || !m_document["stages"].IsArray() ||
+            !m_document.HasMember("connections") || !m_document["connections"].IsArray())
+        {
+            std::cerr << "Pipeline graph must have \"stages\" and \"connections\" arrays" << std::endl;
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+
+        m_graph = PipelineGraph();
+        m_stage_json.clear();
+        m_connections.clear();
+        m_target_fps = get_double(m_document, "target_fps", 0);
+        m_auto_size = get_bool(m_document, "auto_size", false);
+
+        std::vector<std::string> errors;
+        if (m_document.HasMember("inputs") && m_document["inputs"].IsArray())
+        {
+            for (auto &input : m_document["inputs"].GetArray())
+            {
+                if (input.IsString())
+                    m_graph.add_input(input.GetString());
+            }
+        }
+        for (auto &external : m_external_stages)
+        {
+            m_graph.add_output(external.first);
+        }
+
+        for (auto &json : m_document["stages"].GetArray())
+        {
+            GraphStageConfig config;
+            config.name = get_string(json, "name");
+            config.type = get_string(json, "type");
+            if (!m_types.count(config.type))
+            {
+                errors.push_back("Stage '" + config.name + "' has unknown type '" + config.type + "'");
+                continue;
+            }
+            config.queue_size = get_uint(json, "queue_size", config.queue_size);
+            config.leaky = get_bool(json, "leaky", false);
+            config.latency_critical = get_bool(json, "latency_critical", false);
+            config.items_per_frame = get_uint(json, "items_per_frame", 1);
+            config.latency_us = get_double(json, "latency_us", 0);
+            if (m_types[config.type].describer)
+                m_types[config.type].describer(config, json);
+            if (m_graph.add_stage(config, errors))
+                m_stage_json[config.name] = &json;
+        }
+
+        for (auto &connection : m_document["connections"].GetArray())
+        {
+            std::string from = get_string(connection, "from");
+            std::string to = get_string(connection, "to");
+            if (m_graph.connect(from, to, errors))
+                m_connections.emplace_back(from, to);
+        }
+
+        if (!errors.empty())
+        {
+            for (auto &error : errors)
+            {
+                std::cerr << "Pipeline graph error: " << error << std::endl;
+            }
+            return AppStatus::CONFIGURATION_ERROR;
+        }
+        m_loaded = true;
+        return AppStatus::SUCCESS;
+    }
+};
+using PipelineGraphBuilderPtr = std::shared_ptr<PipelineGraphBuilder>;
@@ -0,0 +1,342 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Description of a stage in a pipeline graph, the parts that the graph validation and sizing use.
+ */
+struct GraphStageConfig
+{
+    std::string name;
+    std::string type;
+    size_t queue_size = 5;
+    size_t sub_queue_size = 0;  // Size of the sub input queue, aggregators only
+    size_t pool_size = 0;       // Size of the output buffer pool
+    size_t in_flight_limit = 1; // Buffers the stage works on at once (the jobs limit of an async inference stage)
+    size_t items_per_frame = 1; // Buffers the stage receives on its main input per frame (e.g. crops per frame)
+    double latency_us = 0;      // Measured processing time of a buffer, 0 if unknown
+    bool leaky = false;
+    bool latency_critical = false;
+    bool owns_pool = false;     // Allocates its output buffers from its own pool
+    bool aggregator = false;    // Merges the buffers of its sub input into its main input, releasing them
+
+    std::vector<std::string> required_inputs;      // If set, the inputs must be exactly these (main first)
+    std::vector<std::string> required_subscribers; // Must be subscribers of the stage
+    std::vector<std::string> pool_subscribers;     // Subscribers that receive buffers of the pool, empty for all
+
+    // Filled by PipelineGraph::connect, in subscription order
+    std::vector<std::string> inputs;
+    std::vector<std::string> subscribers;
+};
+
+/**
+ * @brief A pipeline graph: stages, the external inputs that feed it (e.g. frontend streams) and the external
+ *        outputs it feeds (e.g. encoders), and the connections between them.
+ *
+ * Validates the graph before any stage is created, and sizes queues and pools from a target frame rate and
+ * the measured stage latencies. Sizing follows Little's law: a stage that receives items_per_frame buffers per
+ * frame at the target fps and spends latency_us on each, holds rate * latency buffers at a time. Its queue holds
+ * the burst of a frame on top of that, and an output pool covers every queue and stage its buffers pass through
+ * until they are released (by an aggregator, or at the end of the graph).
+ */
+class PipelineGraph
+{
+private:
+    std::vector<GraphStageConfig> m_stages;
+    std::map<std::string, size_t> m_index;
+    std::set<std::string> m_inputs;
+    std::set<std::string> m_outputs;
+
+    GraphStageConfig *find(const std::string &name)
+    {
+        auto it = m_index.find(name);
+        return (it == m_index.end()) ? nullptr : &m_stages[it->second];
+    }
+
+    static bool contains(const std::vector<std::string> &names, const std::string &name)
+    {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+
+    // Buffers a stage works on at once at the target rate.
+    static size_t in_service(const GraphStageConfig &stage, double target_fps)
+    {
+        if (stage.latency_us <= 0 || target_fps <= 0)
+            return 1;
+        double busy = target_fps * stage.items_per_frame * stage.latency_us / 1000000.0;
+        return std::min(std::max<size_t>(std::ceil(busy), 1), std::max<size_t>(stage.in_flight_limit, 1));
+    }
+
+    // Size of the queue of a stage that buffers from the given input wait in.
+    static size_t input_queue_size(const GraphStageConfig &stage, const std::string &input)
+    {
+        if (stage.aggregator && stage.required_inputs.size() > 1 && stage.required_inputs[1] == input)
+            return stage.sub_queue_size;
+        return stage.queue_size;
+    }
+
+    // Buffers that can be held downstream of a stage, from the queue of target on (reached from input).
+    size_t held_downstream(const std::string &input, const std::string &target, double target_fps, std::set<std::string> &visited)
+    {
+        GraphStageConfig *stage = find(target);
+        if (stage == nullptr || visited.count(target))
+            return 0;
+        visited.insert(target);
+        size_t held = input_queue_size(*stage, input) + in_service(*stage, target_fps);
+        if (stage->aggregator)
+            return held;
+        for (auto &subscriber : stage->subscribers)
+            held += held_downstream(target, subscriber, target_fps, visited);
+        return held;
+    }
+
+public:
+    bool add_stage(const GraphStageConfig &config, std::vector<std::string> &errors)
+    {
+        if (config.name.empty())
+        {
+            errors.push_back("A stage of type '" + config.type + "' has no name");
+            return false;
+        }
+        if (m_index.count(config.name) || m_inputs.count(config.name) || m_outputs.count(config.name))
+        {
+            errors.push_back("Stage name '" + config.name + "' is used more than once");
+            return false;
+        }
+        m_index[config.name] = m_stages.size();
+        m_stages.push_back(config);
+        m_stages.back().inputs.clear();
+        m_stages.back().subscribers.clear();
+        return true;
+    }
+
+    // An input fed from outside the graph, e.g. a frontend stream.
+    void add_input(const std::string &name)
+    {
+        m_inputs.insert(name);
+    }
+
+    // A stage outside the graph that stages of the graph push to, e.g. an encoder.
+    void add_output(const std::string &name)
+    {
+        m_outputs.insert(name);
+    }
+
+    bool is_input(const std::string &name) const
+    {
+        return m_inputs.count(name) > 0;
+    }
+
+    bool is_output(const std::string &name) const
+    {
+        return m_outputs.count(name) > 0;
+    }
+
+    bool connect(const std::string &from, const std::string &to, std::vector<std::string> &errors)
+    {
+        GraphStageConfig *producer = find(from);
+        GraphStageConfig *consumer = find(to);
+        if (producer == nullptr && !is_input(from))
+        {
+            errors.push_back("Connection from unknown stage or input '" + from + "'");
+            return false;
+        }
+        if (consumer == nullptr && !is_output(to))
+        {
+            errors.push_back("Connection to unknown stage or output '" + to + "'");
+            return false;
+        }
+        if (producer != nullptr && contains(producer->subscribers, to))
+        {
+            errors.push_back("Stage '" + from + "' is connected to '" + to + "' more than once");
+            return false;
+        }
+        if (producer != nullptr)
+            producer->subscribers.push_back(to);
+        if (consumer != nullptr)
+            consumer->inputs.push_back(from);
+        return true;
+    }
+
+    std::vector<GraphStageConfig> &stages()
+    {
+        return m_stages;
+    }
+
+    GraphStageConfig *get_stage(const std::string &name)
+    {
+        return find(name);
+    }
+
+    /**
+     * @brief Order the stages so that every stage comes after its producers.
+     *
+     * @return false if the graph has a cycle, the stages on it are not in order.
+     */
+    bool topological_order(std::vector<std::string> &order)
+    {
+        std::map<std::string, size_t> pending_inputs;
+        std::vector<std::string> ready;
+        for (auto &stage : m_stages)
+        {
+            size_t internal_inputs = 0;
+            for (auto &input : stage.inputs)
+                internal_inputs += (find(input) != nullptr);
+            pending_inputs[stage.name] = internal_inputs;
+            if (internal_inputs == 0)
+                ready.push_back(stage.name);
+        }
+        while (!ready.empty())
+        {
+            std::string name = ready.back();
+            ready.pop_back();
+            order.push_back(name);
+            for (auto &subscriber : find(name)->subscribers)
+            {
+                if (find(subscriber) != nullptr && --pending_inputs[subscriber] == 0)
+                    ready.push_back(subscriber);
+            }
+        }
+        return order.size() == m_stages.size();
+    }
+
+    /**
+     * @brief Buffers of the output pool of a stage that can be in use at once, with the current queue sizes.
+     */
+    size_t required_pool_size(const std::string &name, double target_fps)
+    {
+        GraphStageConfig *stage = find(name);
+        if (stage == nullptr)
+            return 0;
+        size_t required = in_service(*stage, target_fps);
+        std::set<std::string> visited;
+        for (auto &subscriber : stage->subscribers)
+        {
+            if (stage->pool_subscribers.empty() || contains(stage->pool_subscribers, subscriber))
+                required += held_downstream(name, subscriber, target_fps, visited);
+        }
+        return required;
+    }
+
+    /**
+     * @brief Check that the graph can run.
+     *
+     * Errors: unknown or duplicated connections, cycles, stages that are never fed, stages that would leave
+     * inputs unread (only aggregators read more than one input), missing required inputs and subscribers,
+     * and zero sized queues. Warnings: pools smaller than the buffers that can be in flight downstream.
+     *
+     * @return true if there are no errors.
+     */
+    bool validate(std::vector<std::string> &errors, std::vector<std::string> &warnings, double target_fps = 0)
+    {
+        size_t initial_errors = errors.size();
+        for (auto &stage : m_stages)
+        {
+            if (stage.inputs.empty())
+            {
+                errors.push_back("Stage '" + stage.name + "' has no input");
+            }
+            if (stage.aggregator)
+            {
+                for (auto &input : stage.required_inputs)
+                {
+                    if (!contains(stage.inputs, input))
+                        errors.push_back("Aggregator '" + stage.name + "' input '" + input + "' is not connected");
+                }
+                for (auto &input : stage.inputs)
+                {
+                    if (!contains(stage.required_inputs, input))
+                        errors.push_back("Aggregator '" + stage.name + "' has no queue for input '" + input + "'");
+                }
+                if (stage.sub_queue_size == 0)
+                    errors.push_back("Aggregator '" + stage.name + "' sub queue size must be positive");
+            }
+            else if (stage.inputs.size() > 1)
+            {
+                errors.push_back("Stage '" + stage.name + "' has " + std::to_string(stage.inputs.size()) +
+                                 " inputs, only its first input would be read (use an aggregator to merge streams)");
+            }
+            for (auto &subscriber : stage.required_subscribers)
+            {
+                if (!subscriber.empty() && !contains(stage.subscribers, subscriber))
+                    errors.push_back("Stage '" + stage.name + "' output '" + subscriber + "' is not connected");
+            }
+            if (stage.queue_size == 0)
+                errors.push_back("Stage '" + stage.name + "' queue size must be positive");
+            if (stage.owns_pool && stage.pool_size == 0)
+                errors.push_back("Stage '" + stage.name + "' pool size must be positive");
+        }
+
+        std::vector<std::string> order;
+        if (!topological_order(order))
+        {
+            std::string cycle;
+            for (auto &stage : m_stages)
+            {
+                if (!contains(order, stage.name))
+                    cycle += (cycle.empty() ? "" : ", ") + stage.name;
+            }
+            errors.push_back("The graph has a cycle through: " + cycle);
+        }
+
+        if (errors.size() > initial_errors)
+            return false;
+
+        for (auto &stage : m_stages)
+        {
+            if (!stage.owns_pool)
+                continue;
+            if (stage.pool_size < stage.in_flight_limit)
+            {
+                warnings.push_back("Stage '" + stage.name + "' pool size " + std::to_string(stage.pool_size) +
+                                   " is smaller than its in flight limit " + std::to_string(stage.in_flight_limit));
+            }
+            size_t required = required_pool_size(stage.name, target_fps);
+            if (stage.pool_size < required)
+            {
+                warnings.push_back("Stage '" + stage.name + "' pool size " + std::to_string(stage.pool_size) +
+                                   " is smaller than the " + std::to_string(required) +
+                                   " buffers that can be in flight downstream, the stage may wait for buffers");
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Size the queues and pools for a target frame rate from the stage latencies.
+     *        Stages without a measured latency are assumed to handle one buffer at a time.
+     *
+     * @param warnings Stages that cannot keep up with the target rate are reported.
+     */
+    void auto_size(double target_fps, std::vector<std::string> &warnings, size_t min_queue_size = 2)
+    {
+        for (auto &stage : m_stages)
+        {
+            double busy = target_fps * stage.items_per_frame * stage.latency_us / 1000000.0;
+            if (busy > std::max<size_t>(stage.in_flight_limit, 1))
+            {
+                warnings.push_back("Stage '" + stage.name + "' cannot keep up with " + std::to_string(target_fps) +
+                                   " fps, it needs " + std::to_string(busy) + " buffers in flight");
+            }
+            stage.queue_size = std::max(min_queue_size, stage.items_per_frame + in_service(stage, target_fps));
+            if (stage.aggregator && stage.required_inputs.size() > 1)
+            {
+                GraphStageConfig *sub_producer = find(stage.required_inputs[1]);
+                size_t sub_items = (sub_producer != nullptr) ? sub_producer->items_per_frame + in_service(*sub_producer, target_fps) : 1;
+                stage.sub_queue_size = std::max(min_queue_size, sub_items);
+            }
+        }
+        // Pools depend on the queue sizes downstream
+        for (auto &stage : m_stages)
+        {
+            if (stage.owns_pool)
+                stage.pool_size = std::max(required_pool_size(stage.name, target_fps), stage.in_flight_limit);
+        }
+    }
+};
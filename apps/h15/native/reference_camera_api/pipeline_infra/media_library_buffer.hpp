@@ -0,0 +1,111 @@
+#pragma once
+
+// general includes
+#include <memory>
+
+// medialibrary includes
+#include "hailo/media_library/buffer_pool.hpp"
+
+// Infra includes
+#include "buffer.hpp"
+
+/**
+ * @brief Media library buffer (DMA memory) carried by a Buffer, the output of the frontend, the DSP and the
+ *        encoder. Only the stages that use the hardware include this header.
+ */
+class MediaLibraryFrame : public FrameData
+{
+private:
+    HailoMediaLibraryBufferPtr m_buffer;
+
+public:
+    MediaLibraryFrame(HailoMediaLibraryBufferPtr buffer) : m_buffer(buffer) {}
+
+    HailoMediaLibraryBufferPtr get_buffer() const
+    {
+        return m_buffer;
+    }
+
+    int get_width() const override
+    {
+        return m_buffer->buffer_data->width;
+    }
+
+    int get_height() const override
+    {
+        return m_buffer->buffer_data->height;
+    }
+
+    uint8_t *get_plane_ptr(int plane) const override
+    {
+        return static_cast<uint8_t *>(m_buffer->get_plane_ptr(plane));
+    }
+
+    int get_plane_stride(int plane) const override
+    {
+        return m_buffer->get_plane_stride(plane);
+    }
+
+    bool sync_start(int plane) override
+    {
+        return DmaMemoryAllocator::get_instance().dmabuf_sync_start(m_buffer->get_plane_ptr(plane)) == MEDIA_LIBRARY_SUCCESS;
+    }
+
+    bool sync_end(int plane) override
+    {
+        return DmaMemoryAllocator::get_instance().dmabuf_sync_end(m_buffer->get_plane_ptr(plane)) == MEDIA_LIBRARY_SUCCESS;
+    }
+};
+using MediaLibraryFramePtr = std::shared_ptr<MediaLibraryFrame>;
+
+/**
+ * @brief The media library buffer of a buffer, nullptr if it carries other memory (e.g. a CpuFrame).
+ */
+static inline HailoMediaLibraryBufferPtr get_media_library_buffer(const BufferPtr &buffer)
+{
+    MediaLibraryFramePtr frame = std::dynamic_pointer_cast<MediaLibraryFrame>(buffer->get_frame());
+    return (frame != nullptr) ? frame->get_buffer() : nullptr;
+}
+
+inline Buffer::Buffer(HailoMediaLibraryBufferPtr buffer)
+    : Buffer(std::make_shared<MediaLibraryFrame>(buffer))
+{
+}
+
+inline Buffer::Buffer(HailoMediaLibraryBufferPtr buffer, HailoROIPtr roi)
+    : Buffer(std::make_shared<MediaLibraryFrame>(buffer), roi)
+{
+}
+
+inline HailoMediaLibraryBufferPtr Buffer::get_buffer() const
+{
+    MediaLibraryFramePtr frame = std::dynamic_pointer_cast<MediaLibraryFrame>(m_frame);
+    return (frame != nullptr) ? frame->get_buffer() : nullptr;
+}
+
+/**
+ * @brief BufferPool over an initialized media library buffer pool.
+ */
+class MediaLibraryFramePool : public BufferPool
+{
+private:
+    MediaLibraryBufferPoolPtr m_pool;
+
+public:
+    MediaLibraryFramePool(MediaLibraryBufferPoolPtr pool) : m_pool(pool) {}
+
+    size_t get_available_buffers_count() override
+    {
+        return m_pool->get_available_buffers_count();
+    }
+
+    BufferPtr acquire_buffer(HailoROIPtr roi = nullptr) override
+    {
+        HailoMediaLibraryBufferPtr buffer = std::make_shared<hailo_media_library_buffer>();
+        if (m_pool->acquire_buffer(buffer) != MEDIA_LIBRARY_SUCCESS)
+        {
+            return nullptr;
+        }
+        return std::make_shared<Buffer>(std::make_shared<MediaLibraryFrame>(buffer), roi);
+    }
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+// General includes
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Tappas includes
+#include "latency_buckets.hpp"
+
+using StageId = uint16_t;
+
+/**
+ * @brief Maps stage names to small ids, so buffers can record per stage timestamps without strings.
+ *        Ids are process wide and never reused, the same name always gets the same id.
+ */
+class StageIds
+{
+private:
+    std::shared_mutex m_mutex;
+    std::unordered_map<std::string, StageId> m_ids;
+    std::vector<std::string> m_names;
+
+    StageIds()
+    {
+        get_or_add("Source");
+    }
+
+    StageId get_or_add(const std::string &name)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto it = m_ids.find(name);
+            if (it != m_ids.end())
+                return it->second;
+        }
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_ids.find(name);
+        if (it != m_ids.end())
+            return it->second;
+        StageId id = static_cast<StageId>(m_names.size());
+        m_ids[name] = id;
+        m_names.push_back(name);
+        return id;
+    }
+
+    static StageIds &instance()
+    {
+        static StageIds stage_ids;
+        return stage_ids;
+    }
+
+public:
+    static constexpr StageId SOURCE = 0;
+
+    static StageId get(const std::string &name)
+    {
+        return instance().get_or_add(name);
+    }
+
+    static std::string name(StageId id)
+    {
+        StageIds &ids = instance();
+        std::shared_lock<std::shared_mutex> lock(ids.m_mutex);
+        return (id < ids.m_names.size()) ? ids.m_names[id] : "";
+    }
+};
+
+struct LatencySnapshot
+{
+    uint64_t count = 0;
+    double mean_us = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+};
+
+/**
+ * @brief Lock free histogram of latencies in micro seconds.
+ *
+ * Uses the bucket layout and percentile math of the latency histogram tracer (latency_buckets.hpp), so
+ * percentiles are within ~3% of the recorded values. record() is a few relaxed atomic increments, safe to call
+ * from any thread.
+ */
+class LatencyHistogram
+{
+private:
+    std::array<std::atomic<uint64_t>, LATENCY_HISTOGRAM_BUCKETS> m_buckets;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_sum;
+    std::atomic<uint64_t> m_max;
+
+public:
+    LatencyHistogram()
+    {
+        reset();
+    }
+
+    void record(uint64_t latency_us)
+    {
+        m_buckets[latency_bucket_index(latency_us)].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(latency_us, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (latency_us > max && !m_max.compare_exchange_weak(max, latency_us, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    void record(std::chrono::steady_clock::duration latency)
+    {
+        record(std::chrono::duration_cast<std::chrono::microseconds>(std::max(latency, std::chrono::steady_clock::duration::zero())).count());
+    }
+
+    /**
+     * @brief Not synchronized with concurrent record() calls, a few records may be lost.
+     */
+    void reset()
+    {
+        for (auto &bucket : m_buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        m_count = 0;
+        m_sum = 0;
+        m_max = 0;
+    }
+
+    LatencySnapshot snapshot() const
+    {
+        LatencySnapshot snapshot;
+        std::array<uint64_t, LATENCY_HISTOGRAM_BUCKETS> counts;
+        uint64_t total = 0;
+        for (size_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+        {
+            counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+        if (total == 0)
+            return snapshot;
+
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        uint64_t p50, p90, p99;
+        latency_bucket_percentiles(counts.data(), total, max, &p50, &p90, &p99);
+        snapshot.count = total;
+        snapshot.mean_us = double(m_sum.load(std::memory_order_relaxed)) / m_count.load(std::memory_order_relaxed);
+        snapshot.max_us = max;
+        snapshot.p50_us = p50;
+        snapshot.p99_us = p99;
+        return snapshot;
+    }
+};
+
+struct QueueSnapshot
+{
+    std::string name;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t max_level = 0;
+    uint64_t pushed = 0;
+    uint64_t dropped = 0;
+    uint64_t blocked = 0; // Pushes that waited for space
+};
+
+struct PoolSnapshot
+{
+    std::string name;         // Name of the buffer pool
+    size_t capacity = 0;
+    size_t available = 0;
+    size_t in_use = 0;        // Reserved or held by the consumer
+    size_t quota = 0;
+    bool priority = false;
+    uint64_t reservations = 0;
+    uint64_t granted = 0;     // Buffers reserved
+    uint64_t partial = 0;     // Reservations that got less buffers than requested
+    uint64_t dropped_frames = 0;
+    uint64_t dropped_crops = 0;
+    LatencySnapshot wait;     // Time to reserve
+};
+
+struct StageSnapshot
+{
+    std::string name;
+    LatencySnapshot latency;        // From the previous timestamp of the buffer (includes the wait in the queue)
+    LatencySnapshot source_latency; // From the first timestamp of the buffer
+    uint64_t untimed = 0;           // Buffers out of timestamps (see MAX_BUFFER_TIME_STAMPS), not in the latencies
+    uint64_t dropped = 0;           // Buffers the stage dropped itself (e.g. no output buffers, failed inference)
+    std::vector<QueueSnapshot> queues;
+    std::vector<PoolSnapshot> pools; // Output buffer pools the stage reserves from
+};
+
+/**
+ * @brief Metrics of all the stages of a pipeline at one point in time.
+ */
+struct PipelineSnapshot
+{
+    std::chrono::system_clock::time_point time;
+    std::vector<StageSnapshot> stages;
+
+    static void latency_to_json(std::ostringstream &json, const LatencySnapshot &latency)
+    {
+        json << "{\"count\": " << latency.count << ", \"mean\": " << latency.mean_us << ", \"p50\": " << latency.p50_us
+             << ", \"p99\": " << latency.p99_us << ", \"max\": " << latency.max_us << "}";
+    }
+
+    std::string to_json() const
+    {
+        std::ostringstream json;
+        json << "{\"timestamp_ms\": " << std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count()
+             << ", \"stages\": [";
+        for (size_t i = 0; i < stages.size(); i++)
+        {
+            const StageSnapshot &stage = stages[i];
+            json << (i ? ", " : "") << "{\"name\": \"" << stage.name << "\", \"latency_us\": ";
+            latency_to_json(json, stage.latency);
+            json << ", \"source_latency_us\": ";
+            latency_to_json(json, stage.source_latency);
+            json << ", \"untimed\": " << stage.untimed;
+            json << ", \"dropped\": " << stage.dropped;
+            json << ", \"queues\": [";
+            for (size_t j = 0; j < stage.queues.size(); j++)
+            {
+                const QueueSnapshot &queue = stage.queues[j];
+                json << (j ? ", " : "") << "{\"name\": \"" << queue.name << "\", \"size\": " << queue.size
+                     << ", \"capacity\": " << queue.capacity << ", \"max_level\": " << queue.max_level
+                     << ", \"pushed\": " << queue.pushed << ", \"dropped\": " << queue.dropped
+                     << ", \"blocked\": " << queue.blocked << "}";
+            }
+            json << "]";
+            if (!stage.pools.empty())
+            {
+                json << ", \"pools\": [";
+                for (size_t j = 0; j < stage.pools.size(); j++)
+                {
+                    const PoolSnapshot &pool = stage.pools[j];
+                    json << (j ? ", " : "") << "{\"name\": \"" << pool.name << "\", \"capacity\": " << pool.capacity
+                         << ", \"available\": " << pool.available << ", \"in_use\": " << pool.in_use
+                         << ", \"quota\": " << pool.quota << ", \"priority\": " << (pool.priority ? "true" : "false")
+                         << ", \"reservations\": " << pool.reservations << ", \"granted\": " << pool.granted
+                         << ", \"partial\": " << pool.partial << ", \"dropped_frames\": " << pool.dropped_frames
+                         << ", \"dropped_crops\": " << pool.dropped_crops << ", \"wait_us\": ";
+                    latency_to_json(json, pool.wait);
+                    json << "}";
+                }
+                json << "]";
+            }
+            json << "}";
+        }
+        json << "]}";
+        return json.str();
+    }
+};
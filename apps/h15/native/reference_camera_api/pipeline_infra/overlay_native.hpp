@@ -246,8 +246,7 @@ static overlay_status_t draw_id(HailoMat &mat, HailoUniqueIDPtr &hailo_id, Hailo
  * @param data_ptr mask data pointer
  * @param cv_type type of cv data, example: CV_32F
  */
-template <typename T>
-void calc_destination_roi_and_resize_mask(cv::Mat &destinationROI, cv::Mat &image_planes, HailoROIPtr roi, HailoMaskPtr mask, cv::Mat &resized_mask_data, T data_ptr, int cv_type)
+inline void calc_destination_roi_and_resize_mask(cv::Mat &destinationROI, cv::Mat &image_planes, HailoROIPtr roi, HailoMaskPtr mask, cv::Mat &resized_mask_data, const void *data_ptr, int cv_type)
 {
     if (mask->get_height() == 0 || mask->get_width() == 0) {
         return;
@@ -265,7 +264,7 @@ void calc_destination_roi_and_resize_mask(cv::Mat &destinationROI, cv::Mat &imag
     roi_width = std::clamp(roi_width, 0, image_planes.cols - roi_xmin);
     roi_height = std::clamp(roi_height, 0, image_planes.rows - roi_ymin);
 
-    cv::Mat mat_data = cv::Mat(mask->get_height(), mask->get_width(), cv_type, (uint8_t *)data_ptr.data());
+    cv::Mat mat_data = cv::Mat(mask->get_height(), mask->get_width(), cv_type, const_cast<void *>(data_ptr));
     cv::resize(mat_data, resized_mask_data, cv::Size(roi_width, roi_height), 0, 0, cv::INTER_LINEAR);
 
     cv::Rect roi_rect(cv::Point(roi_xmin, roi_ymin), cv::Size(roi_width, roi_height));
@@ -284,7 +283,6 @@ static overlay_status_t draw_depth_mask(cv::Mat &image_planes, HailoDepthMaskPtr
 {
     cv::Mat resized_mask_data;
     cv::Mat destinationROI;
-    calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->get_data(), CV_32F);
 
     float min = DEPTH_MIN_DISTANCE;
     float max = DEPTH_MAX_DISTANCE;
@@ -294,14 +292,34 @@ static overlay_status_t draw_depth_mask(cv::Mat &image_planes, HailoDepthMaskPtr
     cv::Point min_loc;
     cv::Point max_loc;
 
-    cv::minMaxLoc(resized_mask_data, &min_val, &max_val, &min_loc, &max_loc);
+    if (mask->is_quantized())
+    {
+        // Resize the quantized depths, and dequantize and normalize only the resized ROI in a single pass
+        calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->quantized_data(), mask->is_uint16() ? CV_16UC1 : CV_8UC1);
+        cv::minMaxLoc(resized_mask_data, &min_val, &max_val, &min_loc, &max_loc);
+        min_val = (min_val - mask->qp_zp()) * mask->qp_scale();
+        max_val = (max_val - mask->qp_zp()) * mask->qp_scale();
+
+        if (max < max_val)
+            max = max_val;
+        if (min > min_val)
+            min = min_val;
+
+        cv::Mat quantized_mask_data = resized_mask_data;
+        quantized_mask_data.convertTo(resized_mask_data, CV_32F, mask->qp_scale() / (max - min), (-mask->qp_zp() * mask->qp_scale() - min) / (max - min));
+    }
+    else
+    {
+        calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->get_data().data(), CV_32F);
+        cv::minMaxLoc(resized_mask_data, &min_val, &max_val, &min_loc, &max_loc);
 
-    if (max < max_val)
-        max = max_val;
-    if (min > min_val)
-        min = min_val;
+        if (max < max_val)
+            max = max_val;
+        if (min > min_val)
+            min = min_val;
 
-    resized_mask_data = (resized_mask_data - min) / (max - min);
+        resized_mask_data = (resized_mask_data - min) / (max - min);
+    }
 
     if (mask_overlay_n_threads > 0)
         cv::setNumThreads(mask_overlay_n_threads);
@@ -326,7 +344,7 @@ draw_class_mask(cv::Mat &image_planes, HailoClassMaskPtr mask, HailoROIPtr roi,
 {
     cv::Mat resized_mask_data;
     cv::Mat destinationROI;
-    calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->get_data(), CV_8UC1);
+    calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->data(), CV_8UC1);
 
     if (mask_overlay_n_threads > 0)
         cv::setNumThreads(mask_overlay_n_threads);
@@ -350,7 +368,7 @@ static overlay_status_t draw_conf_class_mask(cv::Mat &image_planes, HailoConfCla
 {
     cv::Mat resized_mask_data;
     cv::Mat destinationROI;
-    calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->get_data(), CV_32F);
+    calc_destination_roi_and_resize_mask(destinationROI, image_planes, roi, mask, resized_mask_data, mask->get_data().data(), CV_32F);
 
     cv::Scalar mask_color = indexToColor(mask->get_class_id());
 
@@ -71,6 +71,27 @@ public:
         return AppStatus::SUCCESS;
     }
 
+    /**
+     * @brief Draw the results of the buffer ROI on the mat.
+     * @param mat The mat of the buffer.
+     * @param data The data buffer.
+     */
+    void draw(HailoMat &mat, BufferPtr data)
+    {
+        // Blur faces if face-blur is activated.
+        if (m_hailooverlay_info.face_blur)
+        {
+            face_blur(mat, data->get_roi());
+        }
+        // Draw all results of the given roi on mat.
+        overlay_status_t ret = draw_all(mat, data->get_roi(), m_hailooverlay_info.landmark_point_radius, m_hailooverlay_info.show_confidence, m_hailooverlay_info.local_gallery, m_hailooverlay_info.mask_overlay_n_threads,
+                                        m_partial_landmarks, m_min_landmark, m_max_landmark);
+        if (ret != OVERLAY_STATUS_OK)
+        {
+            std::cerr << " Overlay failure draw_all failed, status = " << ret << std::endl;
+        }
+    }
+
     /**
      * @brief Process the given data buffer and apply overlay.
      * @param data The data buffer to process.
@@ -82,50 +103,29 @@ public:
 
         if (m_skip)
         {
-            data->add_time_stamp(m_stage_name);
+            data->add_time_stamp(m_stage_id);
             set_duration(data);
             send_to_subscribers(data);
             return AppStatus::SUCCESS;
         }
 
-        std::shared_ptr<HailoMat> hmat = std::make_shared<HailoNV12Mat>((uint8_t*)data->get_buffer()->get_plane_ptr(0),
-                                              data->get_buffer()->buffer_data->height,
-                                              data->get_buffer()->buffer_data->width,
-                                              data->get_buffer()->get_plane_stride(0),
-                                              data->get_buffer()->get_plane_stride(1),
-                                              m_hailooverlay_info.line_thickness,
-                                              m_hailooverlay_info.font_thickness,
-                                              (uint8_t*)data->get_buffer()->get_plane_ptr(0),
-                                              (uint8_t*)data->get_buffer()->get_plane_ptr(1));
-        if (hmat)
-        {
-            if (DmaMemoryAllocator::get_instance().dmabuf_sync_start(data->get_buffer()->get_plane_ptr(0)) != MEDIA_LIBRARY_SUCCESS)
-                    return AppStatus::DMA_ERROR;
-            if (DmaMemoryAllocator::get_instance().dmabuf_sync_start(data->get_buffer()->get_plane_ptr(1)) != MEDIA_LIBRARY_SUCCESS)
-                    return AppStatus::DMA_ERROR;
-            // Blur faces if face-blur is activated.
-            if (m_hailooverlay_info.face_blur)
-            {
-                face_blur(*hmat.get(), data->get_roi());
-            }
-            // Draw all results of the given roi on mat.
-            overlay_status_t ret = draw_all(*hmat.get(), data->get_roi(), m_hailooverlay_info.landmark_point_radius, m_hailooverlay_info.show_confidence, m_hailooverlay_info.local_gallery, m_hailooverlay_info.mask_overlay_n_threads,
-                                            m_partial_landmarks, m_min_landmark, m_max_landmark);
-            if (ret != OVERLAY_STATUS_OK)
-            {
-                std::cerr << " Overlay failure draw_all failed, status = " << ret << std::endl;
-            }
-            if (DmaMemoryAllocator::get_instance().dmabuf_sync_end(data->get_buffer()->get_plane_ptr(0)) != MEDIA_LIBRARY_SUCCESS)
-                    return AppStatus::DMA_ERROR;
-            if (DmaMemoryAllocator::get_instance().dmabuf_sync_end(data->get_buffer()->get_plane_ptr(1)) != MEDIA_LIBRARY_SUCCESS)
-                    return AppStatus::DMA_ERROR;
-        }
+        // Media library buffers are DMA memory, synchronized around the CPU access, CpuFrames need no synchronization
+        FrameDataPtr frame = data->get_frame();
+        HailoNV12Mat mat(frame->get_plane_ptr(0), frame->get_height(), frame->get_width(),
+                         frame->get_plane_stride(0), frame->get_plane_stride(1),
+                         m_hailooverlay_info.line_thickness, m_hailooverlay_info.font_thickness,
+                         frame->get_plane_ptr(0), frame->get_plane_ptr(1));
+        if (!frame->sync_start(0) || !frame->sync_start(1))
+            return AppStatus::DMA_ERROR;
+        draw(mat, data);
+        if (!frame->sync_end(0) || !frame->sync_end(1))
+            return AppStatus::DMA_ERROR;
         std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
         if (m_print_fps)
         {
             std::cout << "Overlay time = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "[microseconds]" << std::endl;
         }
-        data->add_time_stamp(m_stage_name);
+        data->add_time_stamp(m_stage_id);
         set_duration(data);
         send_to_subscribers(data);
 
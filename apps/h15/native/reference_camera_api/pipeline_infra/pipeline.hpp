@@ -1,6 +1,9 @@
 #pragma once
 
 // general includes
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
 #include <queue>
 #include <thread>
 #include <vector>
@@ -15,6 +18,17 @@ enum class StageType
     SINK
 };
 
+/* PipelineExecutionMode: how the stages are run
+Thread per stage - every stage runs its loop on its own thread.
+Work stealing - stages are scheduled as tasks on a fixed pool of worker threads (see StageExecutor),
+                stages with a custom loop keep their own thread.
+*/
+enum class PipelineExecutionMode
+{
+    THREAD_PER_STAGE = 0,
+    WORK_STEALING
+};
+
 class Pipeline
 {
 private:
@@ -22,6 +36,44 @@ private:
     std::vector<StagePtr> m_gen_stages;  // For general type stages
     std::vector<StagePtr> m_src_stages;  // For source type stages
     std::vector<StagePtr> m_sink_stages; // For sink type stages
+    StageExecutorPtr m_executor;         // Set in work stealing mode
+
+    // Periodic metrics dump
+    std::thread m_metrics_thread;
+    std::mutex m_metrics_mutex;
+    std::condition_variable m_metrics_cv;
+    bool m_metrics_running = false;
+
+    void dump_metrics(const std::string &path)
+    {
+        std::string json = get_metrics_snapshot().to_json();
+        if (path.empty())
+        {
+            std::cout << json << std::endl;
+            return;
+        }
+        // Write and rename, so readers never see a partial snapshot
+        std::string tmp_path = path + ".tmp";
+        {
+            std::ofstream file(tmp_path, std::ios::trunc);
+            if (!file.is_open())
+            {
+                std::cerr << "Failed to open metrics file " << tmp_path << std::endl;
+                return;
+            }
+            file << json << std::endl;
+        }
+        std::rename(tmp_path.c_str(), path.c_str());
+    }
+
+    AppStatus start_stage(StagePtr stage)
+    {
+        if (m_executor != nullptr)
+        {
+            return stage->start_on_executor(m_executor);
+        }
+        return stage->start();
+    }
 
 public:
 
@@ -41,24 +93,38 @@ public:
         m_stages.push_back(stage);
     }
 
-    void start_pipeline()
+    /**
+     * @brief Start all the stages.
+     *
+     * @param mode Run every stage on its own thread, or on a shared work stealing executor.
+     * @param num_workers Number of executor worker threads, 0 uses one per core. Work stealing mode only.
+     * @param pin_workers Pin every executor worker to its own core. Work stealing mode only.
+     */
+    void start_pipeline(PipelineExecutionMode mode=PipelineExecutionMode::THREAD_PER_STAGE,
+                        size_t num_workers=0, bool pin_workers=true)
     {
+        if (mode == PipelineExecutionMode::WORK_STEALING)
+        {
+            m_executor = std::make_shared<StageExecutor>();
+            m_executor->start(num_workers, pin_workers);
+        }
+
         // Start the sink stages
         for (auto &stage : m_sink_stages)
         {
-            stage->start();
+            start_stage(stage);
         }
 
         // Start the general stages
         for (auto &stage : m_gen_stages)
         {
-            stage->start();
+            start_stage(stage);
         }
 
         // Start the source stages
         for (auto &stage : m_src_stages)
         {
-            stage->start();
+            start_stage(stage);
         }
     }
 
@@ -81,6 +147,69 @@ public:
         {
             stage->stop();
         }
+
+        if (m_executor != nullptr)
+        {
+            m_executor->stop();
+            m_executor = nullptr;
+        }
+
+        stop_metrics_dump();
+    }
+
+    /**
+     * @brief Latency percentiles and queue occupancy of every stage, since the start or the last reset_metrics.
+     */
+    PipelineSnapshot get_metrics_snapshot()
+    {
+        PipelineSnapshot snapshot;
+        snapshot.time = std::chrono::system_clock::now();
+        for (auto &stage : m_stages)
+        {
+            snapshot.stages.push_back(stage->get_metrics());
+        }
+        return snapshot;
+    }
+
+    void reset_metrics()
+    {
+        for (auto &stage : m_stages)
+        {
+            stage->reset_metrics();
+        }
+    }
+
+    /**
+     * @brief Dump a metrics snapshot as JSON every interval, until stop_metrics_dump or stop_pipeline.
+     *
+     * @param path File to overwrite with the latest snapshot, stdout if empty.
+     */
+    void start_metrics_dump(std::chrono::milliseconds interval, std::string path="")
+    {
+        stop_metrics_dump();
+        m_metrics_running = true;
+        m_metrics_thread = std::thread([this, interval, path]()
+                                       {
+            std::unique_lock<std::mutex> lock(m_metrics_mutex);
+            while (!m_metrics_cv.wait_for(lock, interval, [this] { return !m_metrics_running; }))
+            {
+                lock.unlock();
+                dump_metrics(path);
+                lock.lock();
+            } });
+    }
+
+    void stop_metrics_dump()
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_metrics_mutex);
+            m_metrics_running = false;
+        }
+        m_metrics_cv.notify_all();
+        if (m_metrics_thread.joinable())
+        {
+            m_metrics_thread.join();
+        }
     }
 
     StagePtr get_stage_by_name(std::string stage_name)
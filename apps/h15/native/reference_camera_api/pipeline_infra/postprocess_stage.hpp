@@ -16,9 +16,6 @@
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
-// Media library includes
-#include "media_library/media_library_types.hpp"
-
 // Infra includes
 #include "buffer.hpp"
 #include "queue.hpp"
@@ -28,12 +25,15 @@
 #define DEFAULT_FUNC_NAME "filter"
 #define INIT_FUNC_NAME "init"
 #define FREE_FUNC_NAME "free_resources"
+#define BATCH_FUNC_SUFFIX "_batch"
 
 /**
  * @brief Class representing a post-processing stage in the connected stage pipeline.
  * 
  * This class is responsible for loading a shared object library, initializing it, and
  * applying post-processing functions to the data.
+ * If the library exports "<function name>_batch", the crops of a frame (see CropIndexMetadata) are held
+ * until all of them arrived and are post-processed in one call.
  */
 class PostprocessStage : public ConnectedStage
 {
@@ -50,6 +50,9 @@ private:
     // Function handlers
     void (*m_handler)(HailoROIPtr, void *);             ///< Function pointer to the post-processing function with parameters.
     void (*m_handler_no_config)(HailoROIPtr);           ///< Function pointer to the post-processing function without parameters.
+    void (*m_batch_handler)(std::vector<HailoROIPtr> &, void *) = nullptr;     ///< Batched post-processing function with parameters, if any.
+    void (*m_batch_handler_no_config)(std::vector<HailoROIPtr> &) = nullptr;   ///< Batched post-processing function without parameters, if any.
+    std::vector<BufferPtr> m_pending_crops;             ///< Crops of the current frame waiting for the rest of the frame's crops.
     std::chrono::steady_clock::time_point m_last_time;  ///< Timestamp of the last processed frame.
 
 public:
@@ -110,6 +113,14 @@ public:
             return AppStatus::CONFIGURATION_ERROR;
         }
 
+        // The batched function is optional, crops are post-processed one by one without it
+        std::string batch_function_name = m_function_name + BATCH_FUNC_SUFFIX;
+        if (m_params != nullptr)
+            m_batch_handler = (void (*)(std::vector<HailoROIPtr> &, void *))dlsym(m_loaded_lib, batch_function_name.c_str());
+        else
+            m_batch_handler_no_config = (void (*)(std::vector<HailoROIPtr> &))dlsym(m_loaded_lib, batch_function_name.c_str());
+        dlerror();
+
         m_last_time = std::chrono::steady_clock::now();
 
         return AppStatus::SUCCESS;
@@ -138,10 +149,43 @@ public:
         {
             queue->flush();
         }
+        m_pending_crops.clear();
     
         return AppStatus::SUCCESS;
     }
 
+    /**
+     * @brief Post-process the pending crops in one call of the batched function and push them.
+     */
+    void process_batch()
+    {
+        if (m_pending_crops.empty())
+            return;
+
+        std::vector<HailoROIPtr> rois;
+        rois.reserve(m_pending_crops.size());
+        for (auto &crop : m_pending_crops)
+        {
+            rois.push_back(crop->get_roi());
+        }
+        if (m_params != nullptr)
+        {
+            m_batch_handler(rois, m_params);
+        }
+        else
+        {
+            m_batch_handler_no_config(rois);
+        }
+
+        for (auto &crop : m_pending_crops)
+        {
+            crop->add_time_stamp(m_stage_id);
+            set_duration(crop);
+            send_to_subscribers(crop);
+        }
+        m_pending_crops.clear();
+    }
+
     /**
      * @brief Process the data in the buffer using the loaded library
      * 
@@ -150,6 +194,26 @@ public:
      */
     AppStatus process(BufferPtr data)
     {    
+        if (m_batch_handler != nullptr || m_batch_handler_no_config != nullptr)
+        {
+            std::vector<MetadataPtr> metadata = data->get_metadata_of_type(MetadataType::CROP_INDEX);
+            CropIndexMetadataPtr crop_index = metadata.empty() ? nullptr : std::dynamic_pointer_cast<CropIndexMetadata>(metadata[0]);
+            // A frame that is not a crop, or the first crop of a new frame, ends the pending group
+            if (crop_index == nullptr || crop_index->get_index() == 0)
+            {
+                process_batch();
+            }
+            if (crop_index != nullptr)
+            {
+                m_pending_crops.push_back(data);
+                if (m_pending_crops.size() >= crop_index->get_num_crops())
+                {
+                    process_batch();
+                }
+                return AppStatus::SUCCESS;
+            }
+        }
+
         // Get the roi from the buffer
         HailoROIPtr hailo_roi = data->get_roi();
 
@@ -171,7 +235,7 @@ public:
             m_last_time = end;
         }
         
-	data->add_time_stamp(m_stage_name);
+	data->add_time_stamp(m_stage_id);
         set_duration(data);
 
 	// Push the buffer to the next stage
@@ -1,13 +1,16 @@
 #pragma once
 
 // General includes
+#include <algorithm>
 #include <queue>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
+#include <functional>
 
 // Infra includes
 #include "buffer.hpp"
+#include "metrics.hpp"
 
 class Queue
 {
@@ -20,7 +23,41 @@ private:
     bool m_flushing;
     std::unique_ptr<std::condition_variable> m_condvar;
     std::shared_ptr<std::mutex> m_mutex;
-    uint64_t m_drop_count = 0, m_push_count = 0;
+    uint64_t m_drop_count = 0, m_push_count = 0, m_blocked_count = 0;
+    size_t m_max_level = 0;
+    std::function<void()> m_on_push;
+    std::function<void()> m_on_space;
+
+    // Runs the callbacks outside of the queue lock, they may take the locks of other queues.
+    void notify_callbacks(std::unique_lock<std::mutex> &lock, bool pushed, bool made_space)
+    {
+        std::function<void()> on_push = pushed ? m_on_push : nullptr;
+        std::function<void()> on_space = made_space ? m_on_space : nullptr;
+        lock.unlock();
+        if (on_push)
+            on_push();
+        if (on_space)
+            on_space();
+    }
+
+    void push_unlocked(std::unique_lock<std::mutex> &lock, BufferPtr buffer)
+    {
+        // if leaky, pop the front for a full queue
+        if (m_leaky && m_queue.size() >= m_max_buffers)
+        {
+            m_queue.pop();
+            m_drop_count++;
+        }
+        m_queue.push(buffer);
+        m_push_count++;
+        m_max_level = std::max(m_max_level, m_queue.size());
+        if (m_print_level)
+        {
+            std::cout << "Queue: " << m_name << " level: " << m_queue.size() << std::endl;
+        }
+        m_condvar->notify_one();
+        notify_callbacks(lock, true, false);
+    }
 
 public:
     Queue(std::string name, size_t max_buffers, bool leaky=false, bool print_level=false)
@@ -49,31 +86,80 @@ public:
         return m_queue.size();
     }
 
+    // Whether a push would block, a leaky queue is never full.
+    bool full()
+    {
+        std::unique_lock<std::mutex> lock(*(m_mutex));
+        return !m_leaky && m_queue.size() >= m_max_buffers;
+    }
+
+    /**
+     * @brief Set callbacks for a stage executor: on_push is called after a buffer is pushed,
+     *        on_space after a pop from a full queue.
+     */
+    void set_callbacks(std::function<void()> on_push, std::function<void()> on_space)
+    {
+        std::unique_lock<std::mutex> lock(*(m_mutex));
+        m_on_push = on_push;
+        m_on_space = on_space;
+    }
+
+    /**
+     * @brief Occupancy and counters since the queue was created (or the last reset_stats).
+     */
+    QueueSnapshot get_stats()
+    {
+        std::unique_lock<std::mutex> lock(*(m_mutex));
+        QueueSnapshot stats;
+        stats.name = m_name;
+        stats.size = m_queue.size();
+        stats.capacity = m_max_buffers;
+        stats.max_level = m_max_level;
+        stats.pushed = m_push_count;
+        stats.dropped = m_drop_count;
+        stats.blocked = m_blocked_count;
+        return stats;
+    }
+
+    void reset_stats()
+    {
+        std::unique_lock<std::mutex> lock(*(m_mutex));
+        m_push_count = 0;
+        m_drop_count = 0;
+        m_blocked_count = 0;
+        m_max_level = m_queue.size();
+    }
+
     void push(BufferPtr buffer)
     {
         std::unique_lock<std::mutex> lock(*(m_mutex));
         if (!m_leaky)
         {
             // if not leaky, then wait until there is space in the queue
-            m_condvar->wait(lock, [this]
-                            { return m_queue.size() < m_max_buffers; });
-        } 
-        else 
-        {
-            // if leaky, pop the front for a full queue
-            if(m_queue.size() >= m_max_buffers)
+            if (m_queue.size() >= m_max_buffers)
             {
-                m_queue.pop();
-                m_drop_count++;
+                m_blocked_count++;
             }
+            m_condvar->wait(lock, [this]
+                            { return m_queue.size() < m_max_buffers; });
         }
-        m_queue.push(buffer);
-        m_push_count++;
-        if (m_print_level)
+        push_unlocked(lock, buffer);
+    }
+
+    /**
+     * @brief Non blocking push, used by the executor workers, which are shared by all the stages and must not block.
+     * @return false if the queue is not leaky and full, the buffer was not pushed then.
+     */
+    bool try_push(BufferPtr buffer)
+    {
+        std::unique_lock<std::mutex> lock(*(m_mutex));
+        if (!m_leaky && m_queue.size() >= m_max_buffers)
         {
-            std::cout << "Queue: " << m_name << " level: " << m_queue.size() << std::endl;
+            m_blocked_count++;
+            return false;
         }
-        m_condvar->notify_one();
+        push_unlocked(lock, buffer);
+        return true;
     }
 
     BufferPtr pop()
@@ -87,9 +173,27 @@ public:
             // if we reachied here, then the queue is empty and we are flushing
             return nullptr;
         }
+        bool was_full = m_queue.size() >= m_max_buffers;
+        BufferPtr buffer = m_queue.front();
+        m_queue.pop();
+        m_condvar->notify_one();
+        notify_callbacks(lock, false, was_full);
+        return buffer;
+    }
+
+    // Non blocking pop, returns nullptr if the queue is empty.
+    BufferPtr try_pop()
+    {
+        std::unique_lock<std::mutex> lock(*(m_mutex));
+        if (m_queue.empty())
+        {
+            return nullptr;
+        }
+        bool was_full = m_queue.size() >= m_max_buffers;
         BufferPtr buffer = m_queue.front();
         m_queue.pop();
         m_condvar->notify_one();
+        notify_callbacks(lock, false, was_full);
         return buffer;
     }
 
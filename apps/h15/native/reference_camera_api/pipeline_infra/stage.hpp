@@ -1,6 +1,8 @@
 #pragma once
 
 // General includes
+#include <atomic>
+#include <deque>
 #include <queue>
 #include <mutex>
 #include <thread>
@@ -15,11 +17,10 @@
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
-// Media library includes
-#include "media_library/media_library_types.hpp"
-
 // Infra includes
 #include "buffer.hpp"
+#include "executor.hpp"
+#include "metrics.hpp"
 #include "queue.hpp"
 
 enum class AppStatus
@@ -51,8 +52,9 @@ enum class StagePoolMode
 class Stage
 {
 protected:
-    bool m_end_of_stream = false;
+    std::atomic<bool> m_end_of_stream{false};
     std::string m_stage_name;
+    StageId m_stage_id;
     std::thread m_thread;
 
     // FPS Related memebers
@@ -63,8 +65,14 @@ protected:
     
     int m_counter = 0;
 
+    // Latency metrics, recorded by set_duration
+    LatencyHistogram m_latency_histogram;
+    LatencyHistogram m_source_latency_histogram;
+    std::atomic<uint64_t> m_untimed_buffers{0};
+    std::atomic<uint64_t> m_dropped_buffers{0};
+
 public:
-    Stage(std::string name, bool print_fps) : m_stage_name(name), m_print_fps(print_fps) {}
+    Stage(std::string name, bool print_fps) : m_stage_name(name), m_stage_id(StageIds::get(name)), m_print_fps(print_fps) {}
 
     virtual ~Stage() = default;
 
@@ -73,6 +81,11 @@ public:
         return m_stage_name;
     }
 
+    StageId get_id()
+    {
+        return m_stage_id;
+    }
+
     virtual AppStatus start()
     {
         m_end_of_stream = false;
@@ -87,6 +100,15 @@ public:
         return AppStatus::SUCCESS;
     }
 
+    /**
+     * @brief Start the stage on a shared executor instead of its own thread.
+     *        Stages that cannot run as executor tasks keep their own thread.
+     */
+    virtual AppStatus start_on_executor(StageExecutorPtr executor)
+    {
+        return start();
+    }
+
     virtual AppStatus init()
     {
         return AppStatus::SUCCESS;
@@ -124,15 +146,42 @@ public:
 
     void set_duration(BufferPtr buff)
     {
+       // The buffer ran out of timestamps before this stage, its last timestamp is of an earlier stage
+       if (buff->get_dropped_time_stamps() > 0)
+       {
+        m_untimed_buffers++;
+        return;
+       }
        if(buff->get_num_stages() >= 2)
        {
         std::chrono::steady_clock::time_point ts_start = buff->get_time_stamp(buff->get_num_stages()-2);
         std::chrono::steady_clock::time_point ts_end = buff->get_time_stamp(buff->get_num_stages()-1);
         m_duration = std::chrono::duration_cast<std::chrono::microseconds>(ts_end - ts_start);
+        m_latency_histogram.record(ts_end - ts_start);
+        m_source_latency_histogram.record(ts_end - buff->get_time_stamp(0));
        }
         
     }
 
+    virtual StageSnapshot get_metrics()
+    {
+        StageSnapshot snapshot;
+        snapshot.name = m_stage_name;
+        snapshot.latency = m_latency_histogram.snapshot();
+        snapshot.source_latency = m_source_latency_histogram.snapshot();
+        snapshot.untimed = m_untimed_buffers;
+        snapshot.dropped = m_dropped_buffers;
+        return snapshot;
+    }
+
+    virtual void reset_metrics()
+    {
+        m_latency_histogram.reset();
+        m_source_latency_histogram.reset();
+        m_untimed_buffers = 0;
+        m_dropped_buffers = 0;
+    }
+
     void print_fps()
     {
         std::chrono::steady_clock::time_point current_time = std::chrono::steady_clock::now();
@@ -149,7 +198,7 @@ using StagePtr = std::shared_ptr<Stage>;
 
 class ConnectedStage;
 using ConnectedStagePtr = std::shared_ptr<ConnectedStage>;
-class ConnectedStage : public Stage
+class ConnectedStage : public Stage, public ScheduledTask
 {
 protected:
     size_t m_queue_size;
@@ -157,6 +206,48 @@ protected:
     std::vector<QueuePtr> m_queues;
     std::vector<ConnectedStagePtr> m_subscribers;
 
+    // Executor mode
+    StageExecutorPtr m_executor;
+    StageExecutor::TaskId m_task_id = 0;
+    bool m_latency_critical = false;
+    size_t m_next_queue = 0; // Input queues are served in turn
+    // Outputs that did not fit in the queue of their subscriber, pushed before the next input is processed.
+    // At most the outputs of one process() call, as the stage is not ready while its subscribers are full.
+    std::deque<std::pair<QueuePtr, BufferPtr>> m_pending_outputs;
+    std::mutex m_pending_outputs_mutex;
+
+    // Push to a subscriber, without blocking on the executor workers.
+    void push_to_subscriber(ConnectedStagePtr subscriber, BufferPtr data)
+    {
+        QueuePtr queue = StageExecutor::on_worker_thread() ? subscriber->get_queue(m_stage_name) : nullptr;
+        if (queue == nullptr)
+        {
+            subscriber->push(data, m_stage_name);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_pending_outputs_mutex);
+        if (!m_pending_outputs.empty() || !queue->try_push(data))
+        {
+            m_pending_outputs.emplace_back(queue, data);
+        }
+    }
+
+    // Returns false if some of the pending outputs still don't fit.
+    bool push_pending_outputs()
+    {
+        std::lock_guard<std::mutex> lock(m_pending_outputs_mutex);
+        while (!m_pending_outputs.empty())
+        {
+            if (!m_pending_outputs.front().first->try_push(m_pending_outputs.front().second))
+            {
+                return false;
+            }
+            m_pending_outputs.pop_front();
+        }
+        return true;
+    }
+
 public:
     ConnectedStage(std::string name, size_t queue_size, bool leaky=false, bool print_fps=false) :
         Stage(name, print_fps), m_queue_size(queue_size), m_leaky(leaky)
@@ -198,11 +289,190 @@ public:
         }
     }
 
+    QueuePtr get_queue(std::string name)
+    {
+        for (auto &queue : m_queues)
+        {
+            if (queue->name() == name)
+            {
+                return queue;
+            }
+        }
+        return nullptr;
+    }
+
+    StageSnapshot get_metrics() override
+    {
+        StageSnapshot snapshot = Stage::get_metrics();
+        for (auto &queue : m_queues)
+        {
+            snapshot.queues.push_back(queue->get_stats());
+        }
+        return snapshot;
+    }
+
+    void reset_metrics() override
+    {
+        Stage::reset_metrics();
+        for (auto &queue : m_queues)
+        {
+            queue->reset_stats();
+        }
+    }
+
+    /**
+     * @brief Whether the stage can run as an executor task, processing one buffer at a time from any of its queues.
+     *        Stages with a custom loop, or whose process() waits on hardware or I/O, override this to keep their own thread.
+     */
+    virtual bool runs_as_task()
+    {
+        return true;
+    }
+
+    /**
+     * @brief Latency critical stages are run by the executor before all the other stages.
+     */
+    void set_latency_critical(bool latency_critical)
+    {
+        m_latency_critical = latency_critical;
+    }
+
+    AppStatus start_on_executor(StageExecutorPtr executor) override
+    {
+        m_end_of_stream = false;
+        m_executor = executor;
+        StageExecutor *executor_ptr = executor.get();
+        if (!runs_as_task())
+        {
+            // Popping from a full queue lets the executor know its producer may run again
+            for (auto &queue : m_queues)
+            {
+                std::string producer = queue->name();
+                queue->set_callbacks(nullptr, [executor_ptr, producer]()
+                                     { executor_ptr->notify(producer); });
+            }
+            return start();
+        }
+
+        init();
+        m_task_id = executor->add_task(this, m_stage_name, m_latency_critical);
+        StageExecutor::TaskId task_id = m_task_id;
+        for (auto &queue : m_queues)
+        {
+            std::string producer = queue->name();
+            queue->set_callbacks([executor_ptr, task_id]()
+                                 { executor_ptr->notify(task_id); },
+                                 [executor_ptr, producer]()
+                                 { executor_ptr->notify(producer); });
+        }
+        executor->notify(m_task_id);
+        return AppStatus::SUCCESS;
+    }
+
+    AppStatus stop() override
+    {
+        if (m_executor == nullptr)
+        {
+            return Stage::stop();
+        }
+
+        AppStatus status = AppStatus::SUCCESS;
+        if (runs_as_task())
+        {
+            set_end_of_stream(true);
+            m_executor->remove_task(m_task_id);
+            deinit();
+            std::lock_guard<std::mutex> lock(m_pending_outputs_mutex);
+            m_pending_outputs.clear();
+        }
+        else
+        {
+            status = Stage::stop();
+        }
+        for (auto &queue : m_queues)
+        {
+            queue->set_callbacks(nullptr, nullptr);
+        }
+        m_executor = nullptr;
+        return status;
+    }
+
+    bool ready() override
+    {
+        if (m_end_of_stream)
+        {
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_pending_outputs_mutex);
+            if (!m_pending_outputs.empty())
+            {
+                return !m_pending_outputs.front().first->full();
+            }
+        }
+        bool has_input = false;
+        for (auto &queue : m_queues)
+        {
+            if (queue->size() > 0)
+            {
+                has_input = true;
+                break;
+            }
+        }
+        if (!has_input)
+        {
+            return false;
+        }
+        // Back-pressure, wait for room in the queues of the subscribers
+        for (auto &subscriber : m_subscribers)
+        {
+            QueuePtr queue = subscriber->get_queue(m_stage_name);
+            if (queue != nullptr && queue->full())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void run_once() override
+    {
+        if (!push_pending_outputs())
+        {
+            return;
+        }
+
+        BufferPtr data = nullptr;
+        for (size_t i = 0; i < m_queues.size() && data == nullptr; i++)
+        {
+            data = m_queues[m_next_queue]->try_pop();
+            m_next_queue = (m_next_queue + 1) % m_queues.size();
+        }
+        if (data == nullptr)
+        {
+            return;
+        }
+
+        if (m_print_fps && !m_first_fps_measured)
+        {
+            m_last_time = std::chrono::steady_clock::now();
+            m_first_fps_measured = true;
+        }
+
+        process(data);
+
+        if (m_print_fps)
+        {
+            m_counter++;
+            print_fps();
+        }
+    }
+
     void send_to_subscribers(BufferPtr data)
     {
         for (auto &subscriber : m_subscribers)
         {
-            subscriber->push(data, m_stage_name);
+            push_to_subscriber(subscriber, data);
         }
     }
 
@@ -212,7 +482,7 @@ public:
         {
             if (stage_name == subscriber->get_name())
             {
-                subscriber->push(data, m_stage_name);
+                push_to_subscriber(subscriber, data);
             }
         } 
     }
@@ -263,7 +533,7 @@ public:
             m_callback(data);
         
         
-        data->add_time_stamp(m_stage_name);
+        data->add_time_stamp(m_stage_id);
         set_duration(data);
 
         return AppStatus::SUCCESS;
@@ -0,0 +1,148 @@
+#pragma once
+
+// General includes
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// HailoRT includes
+#include "hailo/hailort.h"
+
+#define TENSOR_RECORDING_MAGIC (0x43455248) // "HREC"
+#define TENSOR_RECORDING_VERSION (1)
+
+/**
+ * @brief Output tensors of a network for a sequence of frames, recorded on the device by HailortAsyncStage and
+ *        replayed by ReplayInferenceStage (cpu_backend.hpp) without the hardware.
+ *
+ * File layout: magic, version, number of tensors and frames (uint32 each), then for every tensor its
+ * hailo_vstream_info_t and frame size, then the tensors of every frame, frame after frame.
+ */
+class TensorRecording
+{
+public:
+    struct Tensor
+    {
+        hailo_vstream_info_t info;
+        size_t frame_size;
+        std::vector<uint8_t> frames; // frame_size bytes per frame
+    };
+
+private:
+    std::vector<Tensor> m_tensors;
+    size_t m_num_frames = 0;
+    std::mutex m_mutex;
+
+public:
+    void add_tensor(const hailo_vstream_info_t &info, size_t frame_size)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_tensors.push_back({info, frame_size, {}});
+    }
+
+    /**
+     * @brief Append a frame, data holds a pointer for every tensor in the order they were added.
+     */
+    void add_frame(const std::vector<const uint8_t *> &data)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < m_tensors.size(); i++)
+        {
+            m_tensors[i].frames.insert(m_tensors[i].frames.end(), data[i], data[i] + m_tensors[i].frame_size);
+        }
+        m_num_frames++;
+    }
+
+    size_t num_frames()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_num_frames;
+    }
+
+    // Not synchronized with add_frame, for replaying a loaded recording.
+    std::vector<Tensor> &tensors()
+    {
+        return m_tensors;
+    }
+
+    uint8_t *get_frame(size_t tensor_index, size_t frame_index)
+    {
+        Tensor &tensor = m_tensors[tensor_index];
+        return tensor.frames.data() + frame_index * tensor.frame_size;
+    }
+
+    bool save(const std::string &path)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to open tensor recording " << path << std::endl;
+            return false;
+        }
+        uint32_t header[] = {TENSOR_RECORDING_MAGIC, TENSOR_RECORDING_VERSION, (uint32_t)m_tensors.size(), (uint32_t)m_num_frames};
+        file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        for (auto &tensor : m_tensors)
+        {
+            uint32_t frame_size = tensor.frame_size;
+            file.write(reinterpret_cast<const char *>(&tensor.info), sizeof(tensor.info));
+            file.write(reinterpret_cast<const char *>(&frame_size), sizeof(frame_size));
+        }
+        for (size_t frame = 0; frame < m_num_frames; frame++)
+        {
+            for (auto &tensor : m_tensors)
+            {
+                file.write(reinterpret_cast<const char *>(tensor.frames.data() + frame * tensor.frame_size), tensor.frame_size);
+            }
+        }
+        return file.good();
+    }
+
+    bool load(const std::string &path)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            std::cerr << "Failed to open tensor recording " << path << std::endl;
+            return false;
+        }
+        uint32_t header[4] = {0};
+        file.read(reinterpret_cast<char *>(header), sizeof(header));
+        if (!file || header[0] != TENSOR_RECORDING_MAGIC || header[1] != TENSOR_RECORDING_VERSION)
+        {
+            std::cerr << "Invalid tensor recording " << path << std::endl;
+            return false;
+        }
+        m_tensors.resize(header[2]);
+        m_num_frames = header[3];
+        for (auto &tensor : m_tensors)
+        {
+            uint32_t frame_size = 0;
+            file.read(reinterpret_cast<char *>(&tensor.info), sizeof(tensor.info));
+            file.read(reinterpret_cast<char *>(&frame_size), sizeof(frame_size));
+            tensor.frame_size = frame_size;
+            tensor.frames.resize(frame_size * m_num_frames);
+        }
+        for (size_t frame = 0; frame < m_num_frames; frame++)
+        {
+            for (auto &tensor : m_tensors)
+            {
+                file.read(reinterpret_cast<char *>(tensor.frames.data() + frame * tensor.frame_size), tensor.frame_size);
+            }
+        }
+        if (!file)
+        {
+            std::cerr << "Tensor recording " << path << " is truncated" << std::endl;
+            m_tensors.clear();
+            m_num_frames = 0;
+            return false;
+        }
+        return true;
+    }
+};
+using TensorRecordingPtr = std::shared_ptr<TensorRecording>;
@@ -64,7 +64,7 @@ public:
         {
             std::cout << "Tracker time = " << std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count() << "[microseconds]" << std::endl;
         }
-        data->add_time_stamp(m_stage_name);
+        data->add_time_stamp(m_stage_id);
         set_duration(data);
         send_to_subscribers(data);
 
@@ -12,6 +12,7 @@
 // Infra includes
 #include "stage.hpp"
 #include "buffer.hpp"
+#include "media_library_buffer.hpp"
 #include "udp_module.hpp"
 
 class UdpStage : public ConnectedStage
@@ -74,6 +75,12 @@ public:
         return create(host, port, type);
     }
 
+    // Sending waits on the socket, keep a dedicated thread on an executor.
+    bool runs_as_task() override
+    {
+        return false;
+    }
+
     AppStatus process(BufferPtr data)
     {
         if (m_udp == nullptr)
@@ -90,7 +97,13 @@ public:
         }
         SizeMetadataPtr size_metadata = std::dynamic_pointer_cast<SizeMetadata>(metadata[0]);
         size_t size = size_metadata->get_size();
-        m_udp->add_buffer(data->get_buffer(), size);
+        HailoMediaLibraryBufferPtr buffer = get_media_library_buffer(data);
+        if (buffer == nullptr)
+        {
+            std::cerr << "Udp " << m_stage_name << " requires media library buffers" << std::endl;
+            return AppStatus::INVALID_ARGUMENT;
+        }
+        m_udp->add_buffer(buffer, size);
 
         return AppStatus::SUCCESS;
     }
@@ -1,15 +1,26 @@
 #include "pipeline_infra/aggregator_stage.hpp"
 #include "pipeline_infra/ai_stage.hpp"
+#include "pipeline_infra/batcher.hpp"
 #include "pipeline_infra/buffer.hpp"
+#include "pipeline_infra/cpu_backend.hpp"
+#include "pipeline_infra/crop_backend.hpp"
+#include "pipeline_infra/crop_buffer_pool.hpp"
+#include "pipeline_infra/dsp_backend.hpp"
 #include "pipeline_infra/dsp_stages.hpp"
 #include "pipeline_infra/encoder_stage.hpp"
+#include "pipeline_infra/executor.hpp"
 #include "pipeline_infra/frontend_stage.hpp"
+#include "pipeline_infra/graph_builder.hpp"
+#include "pipeline_infra/graph_config.hpp"
+#include "pipeline_infra/media_library_buffer.hpp"
+#include "pipeline_infra/metrics.hpp"
 #include "pipeline_infra/overlay_stage.hpp"
 #include "pipeline_infra/persist_stage.hpp"
 #include "pipeline_infra/pipeline.hpp"
 #include "pipeline_infra/postprocess_stage.hpp"
 #include "pipeline_infra/queue.hpp"
 #include "pipeline_infra/stage.hpp"
+#include "pipeline_infra/tensor_recording.hpp"
 #include "pipeline_infra/tracker_stage.hpp"
 #include "pipeline_infra/udp_module.hpp"
 #include "pipeline_infra/udp_stage.hpp"
@@ -54,12 +54,15 @@ namespace hailo_common
         return detection;
     }
 
-    inline void add_detections(HailoROIPtr roi, std::vector<HailoDetection> detections)
+    inline void add_detections(HailoROIPtr roi, const std::vector<HailoDetection> &detections)
     {
-        for (auto det : detections)
+        std::vector<HailoObjectPtr> objects;
+        objects.reserve(detections.size());
+        for (const HailoDetection &det : detections)
         {
-            add_object(roi, std::make_shared<HailoDetection>(det));
+            objects.emplace_back(std::make_shared<HailoDetection>(det));
         }
+        roi->add_objects(objects);
     }
 
     inline void add_detection_pointers(HailoROIPtr roi, std::vector<HailoDetectionPtr> detections)
@@ -182,6 +182,17 @@ public:
      * @return hailo_object_t - The type of the object.
      */
     virtual hailo_object_t get_type() = 0;
+
+    /**
+     * @brief Clone this object.
+     *
+     * @return std::shared_ptr<HailoObject> - A copy of this object, or nullptr for objects that can't be cloned.
+     *         Such objects are shared between a main object and its clones, so they should be treated as read only.
+     */
+    virtual std::shared_ptr<HailoObject> clone()
+    {
+        return nullptr;
+    }
 };
 
 using HailoObjectPtr = std::shared_ptr<HailoObject>;
@@ -193,17 +204,76 @@ using HailoObjectPtr = std::shared_ptr<HailoObject>;
 class HailoMainObject : public HailoObject, public std::enable_shared_from_this<HailoMainObject>
 {
 protected:
-    std::vector<HailoObjectPtr> m_sub_objects;
+    // The list of sub objects may be shared with copies and clones of this object, it is copied before it is modified.
+    std::shared_ptr<std::vector<HailoObjectPtr>> m_sub_objects;
     std::map<std::string, HailoTensorPtr> m_tensors;
+    // Set on a clone and on its source while they share their sub objects. The first access to the sub objects
+    // through either of them replaces the shared ones with clones of its own.
+    bool m_shared_sub_objects;
+
+    /**
+     * @brief Turn a fresh copy of another main object into a copy on write clone of it, in O(1).
+     *        Called with the mutex of the source object locked. The clone gets its own mutex and tensors,
+     *        and shares the list of sub objects with the source. The sub objects are copied level by level,
+     *        by whichever of the two first accesses them (see unshare_sub_objects()).
+     *
+     * @param other The main object this object was copied from.
+     */
+    void init_clone(HailoMainObject &other)
+    {
+        mutex = std::make_shared<std::mutex>();
+        m_tensors = other.m_tensors;
+        m_sub_objects = other.m_sub_objects;
+        m_shared_sub_objects = true;
+        other.m_shared_sub_objects = true;
+    }
+
+    /**
+     * @brief Replace the sub objects shared with a clone (or with the source of this clone) with clones of them,
+     *        must be called with the mutex locked. Cloning a sub main object is O(1) as well, so only the path
+     *        to the objects that are accessed is copied. Sub objects that can't be cloned (masks, user meta) stay shared.
+     *        Objects taken from a main object before it was cloned are not part of its tree anymore once it is
+     *        accessed again, take them again after cloning to modify them.
+     */
+    void unshare_sub_objects()
+    {
+        if (!m_shared_sub_objects)
+            return;
+        m_shared_sub_objects = false;
+        if (m_sub_objects->empty())
+            return;
+
+        auto sub_objects = std::make_shared<std::vector<HailoObjectPtr>>();
+        sub_objects->reserve(m_sub_objects->size());
+        for (auto &obj : *m_sub_objects)
+        {
+            HailoObjectPtr obj_clone = obj->clone();
+            sub_objects->emplace_back(obj_clone ? obj_clone : obj);
+        }
+        m_sub_objects = std::move(sub_objects);
+    }
+
+    /**
+     * @brief Make the list of sub objects private to this object before modifying it, must be called with the mutex locked.
+     */
+    void detach_sub_objects()
+    {
+        unshare_sub_objects();
+        if (m_sub_objects.use_count() > 1)
+        {
+            m_sub_objects = std::make_shared<std::vector<HailoObjectPtr>>(*m_sub_objects);
+        }
+    }
 
 public:
-    HailoMainObject()
+    HailoMainObject() : m_sub_objects(std::make_shared<std::vector<HailoObjectPtr>>()), m_shared_sub_objects(false)
     {
         mutex = std::make_shared<std::mutex>();
     };
     virtual ~HailoMainObject() = default;
-    HailoMainObject(HailoMainObject &&other) noexcept : HailoObject(other), m_sub_objects(std::move(other.m_sub_objects)){};
-    HailoMainObject(const HailoMainObject &other) : HailoObject(other), m_sub_objects(other.m_sub_objects){};
+    // The moved from object keeps sharing the list of sub objects, so it stays valid
+    HailoMainObject(HailoMainObject &&other) noexcept : HailoObject(other), m_sub_objects(other.m_sub_objects), m_shared_sub_objects(other.m_shared_sub_objects){};
+    HailoMainObject(const HailoMainObject &other) : HailoObject(other), m_sub_objects(other.m_sub_objects), m_shared_sub_objects(other.m_shared_sub_objects){};
     HailoMainObject &operator=(const HailoMainObject &other) = default;
     HailoMainObject &operator=(HailoMainObject &&other) noexcept = default;
 
@@ -215,7 +285,20 @@ public:
     void add_object(HailoObjectPtr obj)
     {
         std::lock_guard<std::mutex> lock(*mutex);
-        m_sub_objects.emplace_back(obj);
+        detach_sub_objects();
+        m_sub_objects->emplace_back(obj);
+    };
+
+    /**
+     * @brief Add objects to the main object, under a single lock.
+     *
+     * @param objects Objects to add.
+     */
+    void add_objects(const std::vector<HailoObjectPtr> &objects)
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        detach_sub_objects();
+        m_sub_objects->insert(m_sub_objects->end(), objects.begin(), objects.end());
     };
 
     /**
@@ -238,7 +321,8 @@ public:
     void remove_object(HailoObjectPtr obj)
     {
         std::lock_guard<std::mutex> lock(*mutex);
-        m_sub_objects.erase(std::remove(m_sub_objects.begin(), m_sub_objects.end(), obj), m_sub_objects.end());
+        detach_sub_objects();
+        m_sub_objects->erase(std::remove(m_sub_objects->begin(), m_sub_objects->end(), obj), m_sub_objects->end());
     };
 
     /**
@@ -250,7 +334,8 @@ public:
     void remove_object(uint index)
     {
         std::lock_guard<std::mutex> lock(*mutex);
-        m_sub_objects.erase(m_sub_objects.begin() + index);
+        detach_sub_objects();
+        m_sub_objects->erase(m_sub_objects->begin() + index);
     };
 
     /**
@@ -327,7 +412,8 @@ public:
     std::vector<HailoObjectPtr> get_objects()
     {
         std::lock_guard<std::mutex> lock(*mutex);
-        return m_sub_objects;
+        unshare_sub_objects();
+        return *m_sub_objects;
     }
 
     /**
@@ -339,8 +425,9 @@ public:
     std::vector<HailoObjectPtr> get_objects_typed(hailo_object_t type)
     {
         std::lock_guard<std::mutex> lock(*mutex);
+        unshare_sub_objects();
         std::vector<HailoObjectPtr> filtered_subobjects;
-        for (auto &obj : m_sub_objects)
+        for (auto &obj : *m_sub_objects)
         {
             if (obj->get_type() == type)
             {
@@ -392,6 +479,19 @@ public:
         return HAILO_ROI;
     }
 
+    /**
+     * @brief Clone this ROI in O(1), sub objects are copied on the first access to them in the clone or in this ROI.
+     *
+     * @return std::shared_ptr<HailoObject> - The cloned ROI.
+     */
+    virtual std::shared_ptr<HailoObject> clone()
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        auto roi = std::make_shared<HailoROI>(*this);
+        roi->init_clone(*this);
+        return roi;
+    }
+
     /**
      * @brief Add an object to the main object.
      *
@@ -408,6 +508,27 @@ public:
         HailoMainObject::add_object(obj);
     };
 
+    /**
+     * @brief Add objects to the main object, under a single lock.
+     *
+     * @param objects Objects to add.
+     */
+    void add_objects(const std::vector<HailoObjectPtr> &objects)
+    {
+        HailoBBox bbox = this->get_bbox();
+        std::string stream_id = this->get_stream_id();
+        for (const HailoObjectPtr &obj : objects)
+        {
+            std::shared_ptr<HailoROI> possible_roi = std::dynamic_pointer_cast<HailoROI>(obj);
+            if (nullptr != possible_roi)
+            {
+                possible_roi->set_scaling_bbox(bbox);
+                possible_roi->set_stream_id(stream_id);
+            }
+        }
+        HailoMainObject::add_objects(objects);
+    };
+
     /**
      * @brief Add an object to the main object.
      *        Ignore possible scaling of rois
@@ -533,7 +654,8 @@ public:
         if (this != &other)
         {
             m_bbox = std::move(other.m_bbox);
-            m_sub_objects = std::move(other.m_sub_objects);
+            m_sub_objects = other.m_sub_objects;
+            m_shared_sub_objects = other.m_shared_sub_objects;
             m_index = other.m_index;
             m_overlap_x_axis = other.m_overlap_x_axis;
             m_overlap_y_axis = other.m_overlap_y_axis;
@@ -549,6 +671,7 @@ public:
         {
             m_bbox = other.m_bbox;
             m_sub_objects = other.m_sub_objects;
+            m_shared_sub_objects = other.m_shared_sub_objects;
             m_index = other.m_index;
             m_overlap_x_axis = other.m_overlap_x_axis;
             m_overlap_y_axis = other.m_overlap_y_axis;
@@ -563,6 +686,14 @@ public:
         return HAILO_TILE;
     }
 
+    virtual std::shared_ptr<HailoObject> clone()
+    {
+        std::lock_guard<std::mutex> lock(*mutex);
+        auto tile = std::make_shared<HailoTileROI>(*this);
+        tile->init_clone(*this);
+        return tile;
+    }
+
     float get_overlap_x_axis() { return m_overlap_x_axis; }
     float get_overlap_y_axis() { return m_overlap_y_axis; }
     uint get_index() { return m_index; }
@@ -654,10 +785,12 @@ public:
         return HAILO_DETECTION;
     }
 
-    std::shared_ptr<HailoObject> clone()
+    virtual std::shared_ptr<HailoObject> clone()
     {
         std::lock_guard<std::mutex> lock(*mutex);
-        return std::make_shared<HailoDetection>(*this);
+        auto detection = std::make_shared<HailoDetection>(*this);
+        detection->init_clone(*this);
+        return detection;
     }
 
     // Getters of DetectionObject.
@@ -990,17 +1123,73 @@ class HailoDepthMask : public HailoMask
 {
 protected:
     std::vector<float> m_data;
+    std::shared_ptr<const void> m_quantized_data; // Quantized depths referenced in place (e.g. in the output tensor), nullptr if m_data owns the depths
+    bool m_is_uint16;
+    float m_qp_scale;
+    float m_qp_zp;
+    std::shared_ptr<std::mutex> m_data_mutex;     // Guards the dequantization of m_quantized_data into m_data
 
 public:
-    HailoDepthMask(std::vector<float> &&data_vec, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_data(std::move(data_vec)){};
+    HailoDepthMask(std::vector<float> &&data_vec, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_data(std::move(data_vec)),
+                                                                                                        m_is_uint16(false), m_qp_scale(1.0f), m_qp_zp(0.0f), m_data_mutex(std::make_shared<std::mutex>()){};
+    /**
+     * @brief Construct a depth mask that references quantized depths without copying them,
+     *        depth = (value - qp_zp) * qp_scale, dequantized only when get_data() is called.
+     *
+     * @param quantized_data Reference counted pointer to mask_width * mask_height uint8 or uint16 values.
+     * @param is_uint16 Whether the values are uint16.
+     * @param qp_scale Quantization scale.
+     * @param qp_zp Quantization zero point.
+     */
+    HailoDepthMask(std::shared_ptr<const void> quantized_data, bool is_uint16, float qp_scale, float qp_zp, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency),
+                                                                                                                                                                 m_quantized_data(std::move(quantized_data)), m_is_uint16(is_uint16), m_qp_scale(qp_scale), m_qp_zp(qp_zp),
+                                                                                                                                                                 m_data_mutex(std::make_shared<std::mutex>()){};
 
     virtual hailo_object_t get_type()
     {
         return HAILO_DEPTH_MASK;
     }
 
+    bool is_quantized()
+    {
+        return m_quantized_data != nullptr;
+    }
+    const void *quantized_data()
+    {
+        return m_quantized_data.get();
+    }
+    bool is_uint16()
+    {
+        return m_is_uint16;
+    }
+    float qp_scale()
+    {
+        return m_qp_scale;
+    }
+    float qp_zp()
+    {
+        return m_qp_zp;
+    }
+
+    /**
+     * @brief Get the depths in meters, dequantized on the first call for a quantized mask.
+     */
     const std::vector<float> &get_data()
     {
+        if (m_quantized_data)
+        {
+            std::lock_guard<std::mutex> lock(*m_data_mutex);
+            if (m_data.empty())
+            {
+                size_t size = size_t(m_mask_width) * m_mask_height;
+                m_data.resize(size);
+                for (size_t i = 0; i < size; i++)
+                {
+                    float value = m_is_uint16 ? static_cast<const uint16_t *>(m_quantized_data.get())[i] : static_cast<const uint8_t *>(m_quantized_data.get())[i];
+                    m_data[i] = (value - m_qp_zp) * m_qp_scale;
+                }
+            }
+        }
         return m_data;
     }
     virtual ~HailoDepthMask() = default;
@@ -1011,17 +1200,42 @@ class HailoClassMask : public HailoMask
 {
 protected:
     std::vector<uint8_t> m_data;
+    std::shared_ptr<const uint8_t> m_shared_data; // Class ids referenced in place (e.g. in the output tensor), nullptr if m_data owns the ids
+    std::shared_ptr<std::mutex> m_data_mutex;     // Guards the copy of m_shared_data into m_data
 
 public:
-    HailoClassMask(std::vector<uint8_t> &&data_vec, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_data(std::move(data_vec)){};
+    HailoClassMask(std::vector<uint8_t> &&data_vec, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_data(std::move(data_vec)), m_data_mutex(std::make_shared<std::mutex>()){};
+    /**
+     * @brief Construct a class mask that references the class ids without copying them.
+     *
+     * @param data Reference counted pointer to mask_width * mask_height class ids.
+     */
+    HailoClassMask(std::shared_ptr<const uint8_t> data, int mask_width, int mask_height, float transparency) : HailoMask(mask_width, mask_height, transparency), m_shared_data(std::move(data)), m_data_mutex(std::make_shared<std::mutex>()){};
 
     virtual hailo_object_t get_type()
     {
         return HAILO_CLASS_MASK;
     }
 
+    /**
+     * @brief Get the class ids in place, without copying a referenced mask.
+     */
+    const uint8_t *data()
+    {
+        return m_shared_data ? m_shared_data.get() : m_data.data();
+    }
+
+    /**
+     * @brief Get the class ids, copied on the first call for a referenced mask.
+     */
     const std::vector<uint8_t> &get_data()
     {
+        if (m_shared_data)
+        {
+            std::lock_guard<std::mutex> lock(*m_data_mutex);
+            if (m_data.empty())
+                m_data.assign(m_shared_data.get(), m_shared_data.get() + size_t(m_mask_width) * m_mask_height);
+        }
         return m_data;
     }
     virtual ~HailoClassMask() = default;
@@ -19,6 +19,7 @@ private:
     uint8_t *m_data;                     // Pointer to the data of the tensor.
     hailo_vstream_info_t m_vstream_info; // Pointer to vstream info.
     std::string m_name;                  // Name of output tensor.
+    std::shared_ptr<void> m_owner;       // Keeps the memory of the data alive, if set.
 public:
     /**
      * @brief Construct a new Hailo Tensor object
@@ -47,6 +48,26 @@ public:
     {
         return m_data;
     }
+    /**
+     * @brief Sets the owner of the data: the memory stays valid while the owner is referenced.
+     *
+     * @param owner Reference counted handle of the memory (e.g. a mapped output buffer).
+     */
+    void set_owner(std::shared_ptr<void> owner)
+    {
+        m_owner = std::move(owner);
+    }
+    /**
+     * @brief Gets a reference counted pointer to the data, that keeps the memory alive after the tensor is removed.
+     *
+     * @return std::shared_ptr<const uint8_t> the data, nullptr if the tensor has no owner.
+     */
+    std::shared_ptr<const uint8_t> shared_data()
+    {
+        if (!m_owner)
+            return nullptr;
+        return std::shared_ptr<const uint8_t>(m_owner, m_data);
+    }
     const uint32_t width() { return m_vstream_info.shape.width; }
     const uint32_t height() { return m_vstream_info.shape.height; }
     const uint32_t features() { return m_vstream_info.shape.features; }
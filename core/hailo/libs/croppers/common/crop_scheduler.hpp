@@ -0,0 +1,227 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+
+/**
+ * Tracker aware crop scheduling, shared by the croppers.
+ *
+ * Given the detections of a frame with their tracking ids, the scheduler picks which ones are sent to the
+ * next network: a track is cropped again only after the refresh interval of its class, and never more than
+ * max_crops_per_frame crops are sent in one frame, so the cost of the cascade is bounded whatever the number
+ * of objects. Tracks that miss the budget get more urgent every frame, so all of them are eventually served.
+ * The tracker ids and frames of every stream are their own, so the croppers keep one scheduler per stream
+ * (StreamCropSchedulers).
+ */
+
+class CropSchedulerParams
+{
+public:
+    uint default_refresh_frames;                    // Frames between two crops of the same track
+    std::map<std::string, uint> refresh_frames;     // Per label refresh interval, overrides the default
+    uint warmup_frames;                             // A new track is not cropped during its first sightings
+    size_t max_crops_per_frame;                     // Crop budget of a frame, 0 for no limit
+    float min_quality;                              // Candidates below this quality are never cropped
+    uint evict_frames;                              // Tracks not seen for this many frames are forgotten
+    CropSchedulerParams() : default_refresh_frames(1), warmup_frames(0), max_crops_per_frame(0),
+                            min_quality(std::numeric_limits<float>::lowest()), evict_frames(120) {}
+};
+
+/**
+ * @brief A detection that may be cropped.
+ */
+struct CropCandidate
+{
+    HailoROIPtr roi;  // The roi to crop
+    int tracking_id;  // -1 for an untracked detection, which is due on every frame
+    std::string label;
+    float quality;    // Higher is better, breaks ties between equally urgent tracks
+};
+
+/**
+ * @brief Returns the tracking id of a detection, or -1 if it is not tracked.
+ */
+inline int crop_tracking_id(HailoDetectionPtr detection)
+{
+    std::vector<HailoUniqueIDPtr> ids = hailo_common::get_hailo_track_id(detection);
+    return ids.empty() ? -1 : ids[0]->get_id();
+}
+
+class CropScheduler
+{
+private:
+    struct TrackState
+    {
+        uint64_t last_seen;
+        uint64_t last_crop;
+        uint sightings;
+        uint crops;
+        bool cropped;
+    };
+
+    CropSchedulerParams m_params;
+    std::map<int, TrackState> m_tracks;
+    std::mutex m_mutex;
+    uint64_t m_frame;
+
+    uint refresh_frames(const std::string &label) const
+    {
+        auto refresh = m_params.refresh_frames.find(label);
+        return std::max(1u, refresh == m_params.refresh_frames.end() ? m_params.default_refresh_frames : refresh->second);
+    }
+
+    void evict_stale_tracks()
+    {
+        for (auto it = m_tracks.begin(); it != m_tracks.end();)
+        {
+            if (m_frame - it->second.last_seen > m_params.evict_frames)
+                it = m_tracks.erase(it);
+            else
+                ++it;
+        }
+    }
+
+public:
+    CropScheduler(const CropSchedulerParams &params = CropSchedulerParams()) : m_params(params), m_frame(0) {}
+
+    /**
+     * @brief Chooses the candidates of a frame to crop. Call once per frame.
+     *
+     * @param candidates All the detections of the frame that could be cropped, including the ones that are not due,
+     *                   so their tracks are kept alive.
+     * @return std::vector<HailoROIPtr> The rois to crop, in the order of the candidates.
+     */
+    std::vector<HailoROIPtr> schedule(const std::vector<CropCandidate> &candidates)
+    {
+        struct Due
+        {
+            size_t index;
+            bool first;       // Never cropped (or untracked)
+            float staleness;  // Frames since the last crop, in refresh intervals
+            float quality;
+            uint crops;       // Times the track was cropped
+        };
+        std::vector<Due> due;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frame++;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            const CropCandidate &candidate = candidates[i];
+            if (candidate.tracking_id < 0)
+            {
+                if (candidate.quality >= m_params.min_quality)
+                    due.push_back({i, true, 0.0f, candidate.quality, 0});
+                continue;
+            }
+
+            auto inserted = m_tracks.emplace(candidate.tracking_id, TrackState{m_frame, 0, 0, 0, false});
+            TrackState &track = inserted.first->second;
+            if (track.last_seen != m_frame || inserted.second)
+                track.sightings++;
+            track.last_seen = m_frame;
+            if (track.sightings <= m_params.warmup_frames || candidate.quality < m_params.min_quality)
+                continue;
+
+            uint refresh = refresh_frames(candidate.label);
+            uint64_t since_crop = m_frame - track.last_crop;
+            if (!track.cropped || since_crop >= refresh)
+                due.push_back({i, !track.cropped, (float)since_crop / refresh, candidate.quality, track.crops});
+        }
+
+        // Most urgent first: new tracks, then the most overdue, then the best quality, then the least cropped
+        size_t budget = m_params.max_crops_per_frame == 0 ? due.size() : std::min(due.size(), m_params.max_crops_per_frame);
+        auto more_urgent = [](const Due &a, const Due &b)
+        {
+            if (a.first != b.first)
+                return a.first;
+            if (a.staleness != b.staleness)
+                return a.staleness > b.staleness;
+            if (a.quality != b.quality)
+                return a.quality > b.quality;
+            if (a.crops != b.crops)
+                return a.crops < b.crops;
+            return a.index < b.index;
+        };
+        std::partial_sort(due.begin(), due.begin() + budget, due.end(), more_urgent);
+        due.resize(budget);
+        std::sort(due.begin(), due.end(), [](const Due &a, const Due &b) { return a.index < b.index; });
+
+        std::vector<HailoROIPtr> crop_rois;
+        crop_rois.reserve(due.size());
+        for (const Due &chosen : due)
+        {
+            const CropCandidate &candidate = candidates[chosen.index];
+            if (candidate.tracking_id >= 0)
+            {
+                TrackState &track = m_tracks[candidate.tracking_id];
+                track.cropped = true;
+                track.crops++;
+                track.last_crop = m_frame;
+            }
+            crop_rois.emplace_back(candidate.roi);
+        }
+
+        evict_stale_tracks();
+        return crop_rois;
+    }
+
+    size_t num_tracks()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_tracks.size();
+    }
+};
+
+/**
+ * @brief One CropScheduler per stream, created with the same params on the first frame of the stream.
+ *        Safe to share between streaming threads.
+ */
+class StreamCropSchedulers
+{
+private:
+    CropSchedulerParams m_params;
+    std::map<std::string, CropScheduler> m_schedulers;
+    std::mutex m_mutex;
+
+public:
+    StreamCropSchedulers(const CropSchedulerParams &params = CropSchedulerParams()) : m_params(params) {}
+
+    /**
+     * @brief The scheduler of a stream (HailoROI::get_stream_id()).
+     */
+    CropScheduler &get(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto scheduler = m_schedulers.find(stream_id);
+        if (scheduler == m_schedulers.end())
+            scheduler = m_schedulers.emplace(std::piecewise_construct, std::forward_as_tuple(stream_id), std::forward_as_tuple(m_params)).first;
+        return scheduler->second;
+    }
+
+    /**
+     * @brief Chooses the candidates of a frame of a stream to crop, see CropScheduler::schedule().
+     */
+    std::vector<HailoROIPtr> schedule(const std::string &stream_id, const std::vector<CropCandidate> &candidates)
+    {
+        return get(stream_id).schedule(candidates);
+    }
+
+    size_t num_streams()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_schedulers.size();
+    }
+};
@@ -0,0 +1,393 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "hailo_objects.hpp"
+#include "hailomat.hpp"
+
+/**
+ * Sharpness (quality) scoring of crops, shared by the croppers.
+ *
+ * The score is the variance of the Laplacian of the luma of the crop, resampled to a fixed grid.
+ * Everything runs in integers on the luma as it is in the frame: the Y plane of NV12, the Y bytes of YUY2,
+ * and a fixed point BT.601 gray for RGB(A), so no colour conversion or crop copy is made.
+ * A QualityCache keeps the score of every tracked object of a stream until its box changes meaningfully.
+ */
+
+#define QUALITY_WEIGHT_BITS (8) // Fixed point resampling weights, each axis sums to 1 << QUALITY_WEIGHT_BITS
+
+//-------------------------------
+// LUMA VIEW
+//-------------------------------
+
+/**
+ * @brief The luma of a frame in place: the value of pixel (x, y) is data[y * row_stride + x * pixel_stride],
+ *        or the gray of the R,G,B bytes there when rgb is set.
+ */
+struct LumaView
+{
+    const uint8_t *data;
+    int width;
+    int height;
+    int row_stride;
+    int pixel_stride;
+    bool rgb;
+};
+
+/**
+ * @brief The luma of a HailoMat, without conversion.
+ *
+ * @param hailo_mat The frame.
+ * @return LumaView A view of its luma, full resolution.
+ */
+inline LumaView luma_view(std::shared_ptr<HailoMat> hailo_mat)
+{
+    const cv::Mat &mat = hailo_mat->get_matrices()[0];
+    switch (hailo_mat->get_type())
+    {
+    case HAILO_MAT_NV12:
+        // The first matrix is the Y plane
+        return {mat.data, mat.cols, mat.rows, (int)mat.step, 1, false};
+    case HAILO_MAT_YUY2:
+        // Every 4 bytes are Y0 U Y1 V, two pixels
+        return {mat.data, mat.cols * 2, mat.rows, (int)mat.step, 2, false};
+    default:
+        return {mat.data, mat.cols, mat.rows, (int)mat.step, (int)mat.elemSize(), true};
+    }
+}
+
+//-------------------------------
+// LAPLACIAN VARIANCE
+//-------------------------------
+
+/**
+ * @brief How a crop is resampled to the grid, matching the cv::resize interpolation the scores were tuned with.
+ */
+typedef enum
+{
+    QUALITY_INTER_AREA,   // Shrinking averages the covered pixels, enlarging interpolates linearly (like INTER_AREA)
+    QUALITY_INTER_LINEAR, // Interpolates linearly between the two nearest pixels either way (like INTER_LINEAR)
+} quality_interpolation_t;
+
+/**
+ * @brief How a crop is scored.
+ */
+struct QualityConfig
+{
+    int grid_width;  // The crop is resampled to grid_width x grid_height before the Laplacian (at least 2x2)
+    int grid_height;
+    bool blur;       // 3x3 gaussian blur of the grid before the Laplacian
+    bool normalize;  // Score the grid as if stretched to a maximum of 255
+    quality_interpolation_t interpolation;
+};
+
+/**
+ * @brief Fixed point resampling taps of one axis: output i is the sum of weights[offset[i] + k] * input[first[i] + k].
+ */
+struct QualityTaps
+{
+    std::vector<int> first;
+    std::vector<int> count;
+    std::vector<int> offset;
+    std::vector<int32_t> weights;
+
+    void build(int src, int dst, quality_interpolation_t interpolation)
+    {
+        first.assign(dst, 0);
+        count.assign(dst, 0);
+        offset.assign(dst, 0);
+        weights.clear();
+        const int32_t one = 1 << QUALITY_WEIGHT_BITS;
+        const float scale = (float)src / dst;
+        std::vector<float> coverage;
+        for (int i = 0; i < dst; i++)
+        {
+            coverage.clear();
+            if (src >= dst && interpolation == QUALITY_INTER_AREA)
+            {
+                float begin = i * scale, end = std::min((i + 1) * scale, (float)src);
+                first[i] = std::min((int)begin, src - 1);
+                for (int s = first[i]; s < src && s < end; s++)
+                    coverage.push_back((std::min(s + 1.0f, end) - std::max((float)s, begin)) / scale);
+            }
+            else
+            {
+                float position = CLAMP((i + 0.5f) * scale - 0.5f, 0.0f, (float)(src - 1));
+                first[i] = std::min((int)position, src - 1);
+                float fraction = position - first[i];
+                coverage.push_back(1.0f - fraction);
+                if (first[i] + 1 < src)
+                    coverage.push_back(fraction);
+            }
+
+            // Quantize the weights, the rounding error goes to the largest one so they sum to exactly one
+            offset[i] = weights.size();
+            count[i] = coverage.size();
+            int32_t sum = 0;
+            size_t largest = 0;
+            for (size_t k = 0; k < coverage.size(); k++)
+            {
+                int32_t weight = std::lround(coverage[k] * one);
+                weights.push_back(weight);
+                sum += weight;
+                if (weight > weights[offset[i] + largest])
+                    largest = k;
+            }
+            weights[offset[i] + largest] += one - sum;
+        }
+    }
+};
+
+template <bool RGB>
+inline int32_t luma_at(const uint8_t *pixel)
+{
+    if (RGB)
+        return (77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] + 128) >> 8;
+    return pixel[0];
+}
+
+// The horizontal pass: every row of the crop resampled to the grid width, in 1 << QUALITY_WEIGHT_BITS fixed point
+template <bool RGB>
+inline void resample_rows(const LumaView &view, int x, int y, int height, const QualityTaps &taps, int grid_width,
+                          std::vector<int32_t> &rows)
+{
+    rows.resize((size_t)height * grid_width);
+    for (int r = 0; r < height; r++)
+    {
+        const uint8_t *row = view.data + (size_t)(y + r) * view.row_stride + (size_t)x * view.pixel_stride;
+        int32_t *out = rows.data() + (size_t)r * grid_width;
+        for (int i = 0; i < grid_width; i++)
+        {
+            const uint8_t *pixel = row + (size_t)taps.first[i] * view.pixel_stride;
+            const int32_t *weights = taps.weights.data() + taps.offset[i];
+            int32_t sum = 0;
+            for (int k = 0; k < taps.count[i]; k++, pixel += view.pixel_stride)
+                sum += weights[k] * luma_at<RGB>(pixel);
+            out[i] = sum;
+        }
+    }
+}
+
+// Reflected index (like BORDER_REFLECT_101) of a neighbour one step outside [0, size)
+inline int reflect_101(int i, int size)
+{
+    return i < 0 ? 1 : (i >= size ? size - 2 : i);
+}
+
+/**
+ * @brief Scores the sharpness of a crop: the variance of the Laplacian of its luma, resampled to the config grid.
+ *        The scratch buffers are kept per thread, so repeated calls don't allocate.
+ *
+ * @param view The luma of the frame.
+ * @param x Left of the crop, in pixels.
+ * @param y Top of the crop, in pixels.
+ * @param width Width of the crop, in pixels.
+ * @param height Height of the crop, in pixels.
+ * @param config The grid and filters.
+ * @return float The variance of the Laplacian, 0 for an empty crop.
+ */
+inline float laplacian_variance(const LumaView &view, int x, int y, int width, int height, const QualityConfig &config)
+{
+    thread_local QualityTaps x_taps, y_taps;
+    thread_local std::vector<int32_t> rows, grid, blurred;
+
+    x = CLAMP(x, 0, view.width);
+    y = CLAMP(y, 0, view.height);
+    width = std::min(width, view.width - x);
+    height = std::min(height, view.height - y);
+    if (width <= 0 || height <= 0)
+        return 0.0f;
+    const int grid_width = config.grid_width, grid_height = config.grid_height;
+
+    // Resample the crop to the grid, horizontally then vertically, rounding back to 8 bits
+    x_taps.build(width, grid_width, config.interpolation);
+    y_taps.build(height, grid_height, config.interpolation);
+    if (view.rgb)
+        resample_rows<true>(view, x, y, height, x_taps, grid_width, rows);
+    else
+        resample_rows<false>(view, x, y, height, x_taps, grid_width, rows);
+    grid.assign((size_t)grid_width * grid_height, 0);
+    const int shift = 2 * QUALITY_WEIGHT_BITS;
+    for (int j = 0; j < grid_height; j++)
+    {
+        int32_t *out = grid.data() + (size_t)j * grid_width;
+        for (int k = 0; k < y_taps.count[j]; k++)
+        {
+            const int32_t weight = y_taps.weights[y_taps.offset[j] + k];
+            const int32_t *in = rows.data() + (size_t)(y_taps.first[j] + k) * grid_width;
+            for (int i = 0; i < grid_width; i++)
+                out[i] += weight * in[i];
+        }
+        for (int i = 0; i < grid_width; i++)
+            out[i] = (out[i] + (1 << (shift - 1))) >> shift;
+    }
+
+    // 3x3 gaussian blur, {1, 2, 1} / 4 in each direction
+    if (config.blur)
+    {
+        blurred.resize(grid.size());
+        for (int j = 0; j < grid_height; j++)
+        {
+            const int32_t *up = grid.data() + (size_t)reflect_101(j - 1, grid_height) * grid_width;
+            const int32_t *center = grid.data() + (size_t)j * grid_width;
+            const int32_t *down = grid.data() + (size_t)reflect_101(j + 1, grid_height) * grid_width;
+            int32_t *out = blurred.data() + (size_t)j * grid_width;
+            for (int i = 0; i < grid_width; i++)
+            {
+                int left = reflect_101(i - 1, grid_width), right = reflect_101(i + 1, grid_width);
+                int32_t sum = (up[left] + 2 * up[i] + up[right]) +
+                              2 * (center[left] + 2 * center[i] + center[right]) +
+                              (down[left] + 2 * down[i] + down[right]);
+                out[i] = (sum + 8) >> 4;
+            }
+        }
+        grid.swap(blurred);
+    }
+
+    // Laplacian (4-neighbour kernel), with a running sum and sum of squares for the variance
+    int64_t sum = 0, sum_of_squares = 0;
+    int32_t max_value = 0;
+    for (int j = 0; j < grid_height; j++)
+    {
+        const int32_t *up = grid.data() + (size_t)reflect_101(j - 1, grid_height) * grid_width;
+        const int32_t *center = grid.data() + (size_t)j * grid_width;
+        const int32_t *down = grid.data() + (size_t)reflect_101(j + 1, grid_height) * grid_width;
+        for (int i = 0; i < grid_width; i++)
+        {
+            int32_t laplacian = up[i] + down[i] + center[reflect_101(i - 1, grid_width)] +
+                                center[reflect_101(i + 1, grid_width)] - 4 * center[i];
+            sum += laplacian;
+            sum_of_squares += (int64_t)laplacian * laplacian;
+            max_value = std::max(max_value, center[i]);
+        }
+    }
+    const double n = (double)grid_width * grid_height;
+    double variance = (sum_of_squares - (double)sum * sum / n) / n;
+
+    // The Laplacian is linear, stretching the grid to a maximum of 255 scales the variance by the square
+    if (config.normalize)
+    {
+        if (max_value == 0)
+            return 0.0f;
+        double stretch = 255.0 / max_value;
+        variance *= stretch * stretch;
+    }
+    return (float)variance;
+}
+
+//-------------------------------
+// PER TRACK CACHE
+//-------------------------------
+
+/**
+ * @brief Quality scores per stream and tracking id. A score is reused while the box of the track stays about the same
+ *        (IoU of at least min_iou with the scored box) and is younger than refresh_frames.
+ *        Tracks not seen for evict_frames frames of their stream are dropped. Every stream counts its own frames,
+ *        since the tracker ids of different streams overlap. Safe to share between streaming threads.
+ */
+class QualityCache
+{
+private:
+    struct Entry
+    {
+        float xmin, ymin, xmax, ymax; // The scored box
+        float quality;
+        uint64_t scored_frame;
+        uint64_t seen_frame;
+    };
+    struct Stream
+    {
+        uint64_t frame = 0;
+        std::map<int, Entry> entries;
+    };
+    std::map<std::string, Stream> m_streams;
+    std::mutex m_mutex;
+    float m_min_iou;
+    uint64_t m_refresh_frames;
+    uint64_t m_evict_frames;
+
+    static float iou(const Entry &entry, const HailoBBox &bbox)
+    {
+        float inter_width = std::min(entry.xmax, bbox.xmax()) - std::max(entry.xmin, bbox.xmin());
+        float inter_height = std::min(entry.ymax, bbox.ymax()) - std::max(entry.ymin, bbox.ymin());
+        if (inter_width <= 0.0f || inter_height <= 0.0f)
+            return 0.0f;
+        float intersection = inter_width * inter_height;
+        float entry_area = (entry.xmax - entry.xmin) * (entry.ymax - entry.ymin);
+        float union_area = entry_area + bbox.width() * bbox.height() - intersection;
+        return union_area > 0.0f ? intersection / union_area : 0.0f;
+    }
+
+public:
+    QualityCache(float min_iou = 0.9f, uint64_t refresh_frames = 30, uint64_t evict_frames = 60)
+        : m_min_iou(min_iou), m_refresh_frames(refresh_frames), m_evict_frames(evict_frames){};
+
+    /**
+     * @brief Starts a new frame of a stream, and drops the tracks of the stream that were not seen for too long.
+     *
+     * @param stream_id The stream of the frame (HailoROI::get_stream_id()).
+     */
+    void new_frame(const std::string &stream_id)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stream &stream = m_streams[stream_id];
+        stream.frame++;
+        for (auto it = stream.entries.begin(); it != stream.entries.end();)
+        {
+            if (stream.frame - it->second.seen_frame > m_evict_frames)
+                it = stream.entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    /**
+     * @brief The quality of a track, scored again with compute() only if its box moved or the score is old.
+     *
+     * @param stream_id The stream of the track.
+     * @param tracking_id The id of the track.
+     * @param bbox The box to score, normalized to the frame.
+     * @param compute Scores the box, float().
+     * @return float The quality.
+     */
+    template <typename ComputeFunc>
+    float get(const std::string &stream_id, int tracking_id, const HailoBBox &bbox, ComputeFunc compute)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Stream &stream = m_streams[stream_id];
+            auto entry = stream.entries.find(tracking_id);
+            if (entry != stream.entries.end())
+            {
+                entry->second.seen_frame = stream.frame;
+                if (stream.frame - entry->second.scored_frame < m_refresh_frames && iou(entry->second, bbox) >= m_min_iou)
+                    return entry->second.quality;
+            }
+        }
+
+        // Score outside of the lock, other streams only wait for the map
+        float quality = compute();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Stream &stream = m_streams[stream_id];
+        stream.entries[tracking_id] = {bbox.xmin(), bbox.ymin(), bbox.xmax(), bbox.ymax(), quality, stream.frame, stream.frame};
+        return quality;
+    }
+
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t size = 0;
+        for (auto &stream : m_streams)
+            size += stream.second.entries.size();
+        return size;
+    }
+};
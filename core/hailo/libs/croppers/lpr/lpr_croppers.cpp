@@ -3,16 +3,23 @@
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
 #include "lpr_croppers.hpp"
+#include "common/quality_estimation.hpp"
 #include <iostream>
 
 #define VEHICLE_LABEL "car"
 #define LICENSE_PLATE_LABEL "license_plate"
 #define OCR_LABEL "ocr"
 
+// Plates are scored on a 200x40 grid, area resampled, blurred and stretched to the full luma range
+static const QualityConfig PLATE_QUALITY_CONFIG = {200, 40, true, true, QUALITY_INTER_AREA};
+// Plate scores per stream and vehicle tracking id, for vehicles with a single plate
+static QualityCache plate_quality_cache;
+
 /**
  * @brief Returns the calculate the variance of edges.
+ *        Computed on the luma of the image in place (see common/quality_estimation.hpp).
  *
- * @param image  -  cv::Mat
+ * @param image  -  std::shared_ptr<HailoMat>
  *        The original image.
  *
  * @param roi  -  HailoBBox
@@ -27,79 +34,22 @@
 float quality_estimation(std::shared_ptr<HailoMat> hailo_mat, const HailoBBox &roi, const float crop_ratio = 0.1)
 {
     // Crop the center of the roi from the image, avoid cropping out of bounds
-    float roi_width = roi.width();
-    float roi_height = roi.height();
-    float roi_xmin = roi.xmin();
-    float roi_ymin = roi.ymin();
-    float roi_xmax = roi.xmax();
-    float roi_ymax = roi.ymax();
-    float x_offset = roi_width * crop_ratio;
-    float y_offset = roi_height * crop_ratio;
-    float cropped_xmin = CLAMP(roi_xmin + x_offset, 0, 1);
-    float cropped_ymin = CLAMP(roi_ymin + y_offset, 0, 1);
-    float cropped_xmax = CLAMP(roi_xmax - x_offset, cropped_xmin, 1);
-    float cropped_ymax = CLAMP(roi_ymax - y_offset, cropped_ymin, 1);
-    float cropped_width_n = cropped_xmax - cropped_xmin;
-    float cropped_height_n = cropped_ymax - cropped_ymin;
-    int cropped_width = int(cropped_width_n * hailo_mat->native_width());
-    int cropped_height = int(cropped_height_n * hailo_mat->native_height());
+    float x_offset = roi.width() * crop_ratio;
+    float y_offset = roi.height() * crop_ratio;
+    float cropped_xmin = CLAMP(roi.xmin() + x_offset, 0, 1);
+    float cropped_ymin = CLAMP(roi.ymin() + y_offset, 0, 1);
+    float cropped_xmax = CLAMP(roi.xmax() - x_offset, cropped_xmin, 1);
+    float cropped_ymax = CLAMP(roi.ymax() - y_offset, cropped_ymin, 1);
+    LumaView luma = luma_view(hailo_mat);
+    int cropped_width = int((cropped_xmax - cropped_xmin) * luma.width);
+    int cropped_height = int((cropped_ymax - cropped_ymin) * luma.height);
 
     // If the cropepd image is too small then quality is zero
     if (cropped_width <= CROP_WIDTH_LIMIT || cropped_height <= CROP_HEIGHT_LIMIT)
         return -1.0;
 
-    // If it is not too small then we can make the crop
-    HailoROIPtr crop_roi = std::make_shared<HailoROI>(HailoBBox(cropped_xmin, cropped_ymin, cropped_width_n, cropped_height_n));
-    std::vector<cv::Mat> cropped_image_vec = hailo_mat->crop(crop_roi);
-
-    // Convert image to BGR
-    cv::Mat bgr_image;
-    switch (hailo_mat->get_type())
-    {
-    case HAILO_MAT_YUY2:
-    {
-        cv::Mat cropped_image = cropped_image_vec[0];
-        cv::Mat yuy2_image = cv::Mat(cropped_image.rows, cropped_image.cols * 2, CV_8UC2, (char *)cropped_image.data, cropped_image.step);
-        cv::cvtColor(yuy2_image, bgr_image, cv::COLOR_YUV2BGR_YUY2);
-        break;
-    }
-    case HAILO_MAT_NV12:
-    {
-        cv::Mat full_mat = cv::Mat(cropped_image_vec[0].rows + cropped_image_vec[1].rows, cropped_image_vec[0].cols, CV_8UC1);
-        memcpy(full_mat.data, cropped_image_vec[0].data, cropped_image_vec[0].rows * cropped_image_vec[0].cols);
-        memcpy(full_mat.data + cropped_image_vec[0].rows * cropped_image_vec[0].cols, cropped_image_vec[1].data, cropped_image_vec[1].rows * cropped_image_vec[1].cols);
-        cv::cvtColor(full_mat, bgr_image, cv::COLOR_YUV2BGR_NV12);
-
-        break;
-    }
-    default:
-        bgr_image = cropped_image_vec[0];
-        break;
-    }
-
-    // Resize the frame
-    cv::Mat resized_image;
-    cv::resize(bgr_image, resized_image, cv::Size(200, 40), 0, 0, cv::INTER_AREA);
-
-    // Gaussian Blur
-    cv::Mat gaussian_image;
-    cv::GaussianBlur(resized_image, gaussian_image, cv::Size(3, 3), 0);
-
-    // Convert to grayscale
-    cv::Mat gray_image;
-    cv::Mat gray_image_normalized;
-    cv::cvtColor(gaussian_image, gray_image, cv::COLOR_BGR2GRAY);
-    cv::normalize(gray_image, gray_image_normalized, 255, 0, cv::NORM_INF);
-
-    // Compute the Laplacian of the gray image
-    cv::Mat laplacian_image;
-    cv::Laplacian(gray_image_normalized, laplacian_image, CV_64F);
-
-    // Calculate the variance of edges
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(laplacian_image, mean, stddev, cv::Mat());
-    float variance = stddev.val[0] * stddev.val[0];
-    return variance;
+    return laplacian_variance(luma, int(cropped_xmin * luma.width), int(cropped_ymin * luma.height),
+                              cropped_width, cropped_height, PLATE_QUALITY_CONFIG);
 }
 
 /**
@@ -120,14 +70,20 @@ std::vector<HailoROIPtr> license_plate_quality_estimation(std::shared_ptr<HailoM
 {
     std::vector<HailoROIPtr> crop_rois;
     float variance;
+    plate_quality_cache.new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> vehicle_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &vehicle : vehicle_ptrs)
     {
         if (VEHICLE_LABEL != vehicle->get_label())
             continue;
+        std::vector<HailoUniqueIDPtr> vehicle_ids = hailo_common::get_hailo_track_id(vehicle);
         // For each detection, check the inner detections
         std::vector<HailoDetectionPtr> license_plate_ptrs = hailo_common::get_hailo_detections(vehicle);
+        // The cache keeps one score per vehicle, the plates of a vehicle with several of them are always scored
+        bool cache_plate = !vehicle_ids.empty() &&
+                           std::count_if(license_plate_ptrs.begin(), license_plate_ptrs.end(), [](HailoDetectionPtr &plate)
+                                         { return LICENSE_PLATE_LABEL == plate->get_label(); }) == 1;
         for (HailoDetectionPtr &license_plate : license_plate_ptrs)
         {
             if (LICENSE_PLATE_LABEL != license_plate->get_label())
@@ -135,7 +91,12 @@ std::vector<HailoROIPtr> license_plate_quality_estimation(std::shared_ptr<HailoM
             HailoBBox license_plate_box = hailo_common::create_flattened_bbox(license_plate->get_bbox(), license_plate->get_scaling_bbox());
 
             // Get the variance of the image, only add ROIs that are above threshold.
-            variance = quality_estimation(image, license_plate_box, CROP_RATIO);
+            // A tracked vehicle reuses the score of its plate until the plate moves.
+            if (!cache_plate)
+                variance = quality_estimation(image, license_plate_box, CROP_RATIO);
+            else
+                variance = plate_quality_cache.get(roi->get_stream_id(), vehicle_ids[0]->get_id(), license_plate_box,
+                                                   [&]() { return quality_estimation(image, license_plate_box, CROP_RATIO); });
 
             if (variance >= QUALITY_THRESHOLD)
             {
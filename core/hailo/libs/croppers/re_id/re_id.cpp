@@ -5,6 +5,8 @@
 #include <vector>
 #include <iostream>
 #include "re_id.hpp"
+#include "common/quality_estimation.hpp"
+#include "common/crop_scheduler.hpp"
 
 #define PERSON_LABEL "person"
 #define MIN_RATIO (1.7f)
@@ -15,13 +17,33 @@
 #define MAX_X (0.95f)
 #define TRACK_DELAY (5)
 #define MIN_QUALITY (400)
-#define RE_ID_NETWORK_SIZE (cv::Size(128, 256))
-std::map<int, int> track_counter;
+#define RE_ID_MAX_CROPS_PER_FRAME (8)
+
+// Persons are scored on the grid of the network input, without blur or stretching, resampled linearly
+static const QualityConfig PERSON_QUALITY_CONFIG = {128, 256, false, false, QUALITY_INTER_LINEAR};
+// Person scores per stream and tracking id
+static QualityCache person_quality_cache;
+
+/**
+ * @brief The params of the re-id crop schedulers: a track waits TRACK_DELAY frames after it first shows up,
+ *        then is cropped on every frame its quality is good enough, within the crop budget.
+ */
+CropSchedulerParams re_id_scheduler_params()
+{
+    CropSchedulerParams params;
+    params.warmup_frames = TRACK_DELAY + 1;
+    params.min_quality = MIN_QUALITY;
+    params.max_crops_per_frame = RE_ID_MAX_CROPS_PER_FRAME;
+    return params;
+}
+// A scheduler per stream
+static StreamCropSchedulers person_schedulers(re_id_scheduler_params());
 
 /**
  * @brief Returns the quaility estimation of the person's crop.
+ *        Computed on the luma of the image in place (see common/quality_estimation.hpp).
  *
- * @param image  -  cv::Mat
+ * @param image  -  std::shared_ptr<HailoMat>
  *        The original image.
  *
  * @param roi  -  HailoBBox
@@ -30,57 +52,17 @@ std::map<int, int> track_counter;
  * @return float
  *         The quality estimation of the person.
  */
-float quality_estimation(const cv::Mat &image, const HailoBBox &roi)
+float quality_estimation(std::shared_ptr<HailoMat> image, const HailoBBox &roi)
 {
-    // Crop the center of the roi from the image, avoid cropping out of bounds
-    int cropped_xmin = CLAMP((image.cols * roi.xmin()), 0, image.cols);
-    int cropped_ymin = CLAMP((image.rows * roi.ymin()), 0, image.rows);
-    int cropped_xmax = CLAMP((image.cols * roi.xmax()), cropped_xmin, image.cols);
-    int cropped_ymax = CLAMP((image.rows * roi.ymax()), cropped_ymin, image.rows);
-    int cropped_width = cropped_xmax - cropped_xmin;
-    int cropped_height = cropped_ymax - cropped_ymin;
-
-    // If it is not too small then we can make the crop
-    cv::Rect center_crop(cropped_xmin, cropped_ymin, cropped_width, cropped_height);
-    cv::Mat cropped_image = image(center_crop);
+    // Crop the roi from the image, avoid cropping out of bounds
+    LumaView luma = luma_view(image);
+    int cropped_xmin = CLAMP((luma.width * roi.xmin()), 0, luma.width);
+    int cropped_ymin = CLAMP((luma.height * roi.ymin()), 0, luma.height);
+    int cropped_xmax = CLAMP((luma.width * roi.xmax()), cropped_xmin, luma.width);
+    int cropped_ymax = CLAMP((luma.height * roi.ymax()), cropped_ymin, luma.height);
 
-    // Resize the frame
-    cv::Mat resized_image;
-    cv::resize(cropped_image, resized_image, RE_ID_NETWORK_SIZE, 0, 0, cv::INTER_LINEAR);
-
-    // Convert to grayscale
-    cv::Mat gray_image;
-    cv::cvtColor(resized_image, gray_image, cv::COLOR_RGB2GRAY);
-
-    // Compute the Laplacian of the gray image
-    cv::Mat laplacian_image;
-    cv::Laplacian(gray_image, laplacian_image, CV_64F);
-
-    // Calculate the quality of person
-    cv::Scalar mean, stddev;
-    cv::meanStdDev(laplacian_image, mean, stddev, cv::Mat());
-    float quality = stddev.val[0] * stddev.val[0];
-
-    // Release resources
-    resized_image.release();
-    cropped_image.release();
-    gray_image.release();
-    laplacian_image.release();
-
-    return quality;
-}
-
-HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
-{
-    for (auto obj : detection->get_objects_typed(HAILO_UNIQUE_ID))
-    {
-        HailoUniqueIDPtr id = std::dynamic_pointer_cast<HailoUniqueID>(obj);
-        if (id->get_mode() == TRACKING_ID)
-        {
-            return id;
-        }
-    }
-    return nullptr;
+    return laplacian_variance(luma, cropped_xmin, cropped_ymin, cropped_xmax - cropped_xmin, cropped_ymax - cropped_ymin,
+                              PERSON_QUALITY_CONFIG);
 }
 
 /**
@@ -92,7 +74,8 @@ HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
  */
 std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIPtr roi)
 {
-    std::vector<HailoROIPtr> crop_rois;
+    std::vector<CropCandidate> candidates;
+    person_quality_cache.new_frame(roi->get_stream_id());
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
@@ -103,30 +86,23 @@ std::vector<HailoROIPtr> create_crops(std::shared_ptr<HailoMat> image, HailoROIP
             // Remove previous matrices
             roi->remove_objects_typed(HAILO_MATRIX);
 
-            int tracking_id = get_tracking_id(detection)->get_id();
-
-            auto counter = track_counter.find(tracking_id);
-            if (counter == track_counter.end())
-            {
-                track_counter[tracking_id] = 0;
-            }
-            else if (counter->second < TRACK_DELAY)
+            // Every person is passed to the scheduler to keep its track, persons out of the frame limits never qualify
+            int tracking_id = crop_tracking_id(detection);
+            auto bbox = detection->get_bbox();
+            float quality = std::numeric_limits<float>::lowest();
+            float ratio = (bbox.height() * image->height()) / (bbox.width() * image->width());
+            if (ratio > MIN_RATIO && ratio < MAX_RATIO &&
+                bbox.height() > MIN_HEIGHT && bbox.height() < MAX_HEIGHT &&
+                bbox.xmin() > MIN_X && bbox.xmax() < MAX_X)
             {
-                track_counter[tracking_id] += 1;
-            }
-            else
-            {
-                auto bbox = detection->get_bbox();
-                float quality = quality_estimation(image->get_matrices()[0], bbox);
-                float ratio = (bbox.height() * image->height()) / (bbox.width() * image->width());
-                if (ratio > MIN_RATIO && ratio < MAX_RATIO &&
-                    bbox.height() > MIN_HEIGHT && bbox.height() < MAX_HEIGHT &&
-                    bbox.xmin() > MIN_X && bbox.xmax() < MAX_X && quality > MIN_QUALITY)
-                {
-                    crop_rois.emplace_back(detection);
-                }
+                // The score is reused until the person moves
+                if (tracking_id < 0)
+                    quality = quality_estimation(image, bbox);
+                else
+                    quality = person_quality_cache.get(roi->get_stream_id(), tracking_id, bbox, [&]() { return quality_estimation(image, bbox); });
             }
+            candidates.push_back({detection, tracking_id, detection->get_label(), quality});
         }
     }
-    return crop_rois;
-}
+    return person_schedulers.schedule(roi->get_stream_id(), candidates);
+}
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <vector>
 #include <cmath>
 #include "vms_croppers.hpp"
+#include "common/crop_scheduler.hpp"
 
 #define PERSON_LABEL "person"
 #define FACE_LABEL "face"
@@ -12,27 +13,24 @@
 #define FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR (0.10f)
 #define TRACK_UPDATE 60
 
-std::map<int, int> track_counter;
+#define VMS_MAX_CROPS_PER_FRAME 8
 
 /**
-* @brief Get the tracking Hailo Unique Id object from a Hailo Detection.
-* 
-* @param detection HailoDetectionPtr
-* @return HailoUniqueIdPtr pointer to the Hailo Unique Id object
+* @brief The params of a scheduler that crops every track once per TRACK_UPDATE frames,
+*        at most VMS_MAX_CROPS_PER_FRAME crops per frame.
 */
-HailoUniqueIDPtr get_tracking_id(HailoDetectionPtr detection)
+CropSchedulerParams track_update_params()
 {
-    for (auto obj : detection->get_objects_typed(HAILO_UNIQUE_ID))
-    {
-        HailoUniqueIDPtr id = std::dynamic_pointer_cast<HailoUniqueID>(obj);
-        if (id->get_mode() == TRACKING_ID)
-        {
-            return id;
-        }
-    }
-    return nullptr;
+    CropSchedulerParams params;
+    params.default_refresh_frames = TRACK_UPDATE;
+    params.max_crops_per_frame = VMS_MAX_CROPS_PER_FRAME;
+    return params;
 }
 
+// Persons and faces have their own tracks, on every stream
+static StreamCropSchedulers person_schedulers(track_update_params());
+static StreamCropSchedulers face_schedulers(track_update_params());
+
 /**
 * @brief Returns a boolean box is invalid cause it has nan value.
 * 
@@ -45,43 +43,23 @@ bool box_contains_nan(HailoBBox box)
 }
 
 /**
-* @brief Returns a boolean indicating if traker update is required for a given detection.
-*       It is determined by the number of frames since the last update.
-*       How many frames to wait for an update are defined in TRACK_UPDATE.
+* @brief Returns the detections to crop among the candidates.
+*        With use_track_update every track is updated once per TRACK_UPDATE frames, within the crop budget.
 * 
-* @param detection HailoDetectionPtr
+* @param scheduler CropScheduler of the stream of the candidates
+* @param candidates the detections that could be cropped
 * @param use_track_update boolean can override the default behaviour, false will always require an update
-* @return boolean indicating if traker update is required.
+* @return std::vector<HailoROIPtr> the detections to crop.
 */
-bool track_update(HailoDetectionPtr detection, bool use_track_update)
+std::vector<HailoROIPtr> track_update(CropScheduler &scheduler, const std::vector<CropCandidate> &candidates, bool use_track_update)
 {
-    auto tracking_obj = get_tracking_id(detection);
-    if (tracking_obj && use_track_update)
-    {
-        int tracking_id = tracking_obj->get_id();
-        auto counter = track_counter.find(tracking_id);
-        if (counter == track_counter.end())
-        {
-            // Emplace new element to the track_counter map. track update required.
-            track_counter.emplace(tracking_id, 0);
-            return true;
-        }
-        else if (counter->second >= TRACK_UPDATE)
-        {
-            // Counter passed the TRACK_UPDATE limit - set existing track to 0. track update required.
-            track_counter[tracking_id] = 0;
-            return true;
-        }
-        else if (counter->second < TRACK_UPDATE)
-        {
-            // Counter is still below TRACK_UPDATE_LIMIT - increasing the exising value. track update should be skipped. 
-            track_counter[tracking_id] += 1;
-        }
-
-        return false;
-    }
+    if (use_track_update)
+        return scheduler.schedule(candidates);
 
-    return true;
+    std::vector<HailoROIPtr> crop_rois;
+    for (const CropCandidate &candidate : candidates)
+        crop_rois.emplace_back(candidate.roi);
+    return crop_rois;
 }
 
 /**
@@ -93,19 +71,16 @@ bool track_update(HailoDetectionPtr detection, bool use_track_update)
  */
 std::vector<HailoROIPtr> person_crop(std::shared_ptr<HailoMat> image, HailoROIPtr roi, bool use_track_update=false)
 {
-    std::vector<HailoROIPtr> crop_rois;
+    std::vector<CropCandidate> candidates;
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
     {
         // Modify only detections with "person" label.
         if (std::string(PERSON_LABEL) == detection->get_label())
-        {
-            if (track_update(detection, use_track_update))
-                crop_rois.emplace_back(detection);
-        }
+            candidates.push_back({detection, crop_tracking_id(detection), detection->get_label(), detection->get_confidence()});
     }
-    return crop_rois;
+    return track_update(person_schedulers.get(roi->get_stream_id()), candidates, use_track_update);
 }
 
 /**
@@ -192,26 +167,28 @@ HailoDetectionPtr clone_detection_object(HailoDetectionPtr detection)
  */
 std::vector<HailoROIPtr> face_crop(std::shared_ptr<HailoMat> image, HailoROIPtr roi, bool use_track_update=false)
 {
-    std::vector<HailoROIPtr> crop_rois;
+    std::vector<CropCandidate> candidates;
     // Get all detections.
     std::vector<HailoDetectionPtr> detections_ptrs = hailo_common::get_hailo_detections(roi);
     for (HailoDetectionPtr &detection : detections_ptrs)
     {
         // Modify only detections with "face" label.
         if (std::string(FACE_LABEL) == detection->get_label() && !box_contains_nan(detection->get_bbox()))
-        {
-            if (track_update(detection, use_track_update))
-            {
-                // Modifies a rectengle according to a cropping algorithm only on faces
-                auto new_bbox = algorithm_face_crop(image->native_width(), image->native_height(), detection->get_bbox(), FACE_ATTRIBUTES_CROP_SCALE_FACTOR, FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR);
+            candidates.push_back({detection, crop_tracking_id(detection), detection->get_label(), detection->get_confidence()});
+    }
 
-                HailoDetectionPtr new_roi = clone_detection_object(detection);
-                hailo_common::fixate_landmarks_with_bbox(new_roi, new_bbox);
+    std::vector<HailoROIPtr> crop_rois;
+    for (HailoROIPtr &face : track_update(face_schedulers.get(roi->get_stream_id()), candidates, use_track_update))
+    {
+        HailoDetectionPtr detection = std::dynamic_pointer_cast<HailoDetection>(face);
+        // Modifies a rectengle according to a cropping algorithm only on faces
+        auto new_bbox = algorithm_face_crop(image->native_width(), image->native_height(), detection->get_bbox(), FACE_ATTRIBUTES_CROP_SCALE_FACTOR, FACE_ATTRIBUTES_CROP_HIGHT_OFFSET_FACTOR);
 
-                new_roi->set_bbox(new_bbox);
-                crop_rois.emplace_back(new_roi);
-            }
-        }
+        HailoDetectionPtr new_roi = clone_detection_object(detection);
+        hailo_common::fixate_landmarks_with_bbox(new_roi, new_bbox);
+
+        new_roi->set_bbox(new_bbox);
+        crop_rois.emplace_back(new_roi);
     }
     return crop_rois;
 }
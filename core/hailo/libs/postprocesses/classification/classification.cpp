@@ -2,14 +2,13 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <algorithm>
+#include <map>
 #include <vector>
 #include <iostream>
 #include "common/labels/imagenet.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "common/quantized.hpp"
 #include "classification.hpp"
-#include "xtensor/xadapt.hpp"
-#include "xtensor/xarray.hpp"
 
 #define RESNET_50_LAYER_NAME "resnet_v1_50/softmax1"
 #define MOBILENET_V1_LAYER_NAME "mobilenet_v1/softmax1"
@@ -18,7 +17,6 @@
 
 void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
 {
-    const int k = 1;
     std::string label = "";
 
     if (!roi->has_tensors())
@@ -29,14 +27,11 @@ void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
     // Extract the relevant output tensor.
     HailoTensorPtr scores = roi->get_tensor(layer_name);
 
-    // Convert the tensor to xarray.
-    xt::xarray<uint8_t> xscores = common::get_xtensor(scores);
-
-    // Find the topk scores.
-    xt::xarray<int> top_k_scores = common::top_k(xscores, k);
+    // Find the top score, in place on the quantized scores.
+    common::QuantizedArgmax top = common::tensor_argmax(scores);
 
     // Extrats the label of the top score.
-    int index = top_k_scores[0] - label_offset;
+    int index = top.index - label_offset;
     std::string labels = common::imagenet_labels[index];
 
     // If there are multiple synonyms for this class, take only the first.
@@ -45,7 +40,7 @@ void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
         label = labels.substr(0, comma_pos);
     else
         label = labels;
-    float confidence = scores->fix_scale(xscores(index));
+    float confidence = scores->fix_scale(top.value);
     // Update the tensor with the classification result.
     hailo_common::add_classification(roi,
                                      std::string("imagenet"),
@@ -54,6 +49,39 @@ void top1(HailoROIPtr roi, std::string layer_name, int label_offset)
                                      index);
 }
 
+/**
+ * @brief Top 1 of the crops of a frame. The scores are scanned in place (argmax keeps the first
+ *        of equal scores), and the label is parsed once per class instead of once per crop.
+ */
+void top1_batch(std::vector<HailoROIPtr> &rois, std::string layer_name, int label_offset)
+{
+    std::map<int, std::string> labels;
+    for (auto &roi : rois)
+    {
+        if (!roi->has_tensors())
+            continue;
+
+        HailoTensorPtr scores = roi->get_tensor(layer_name);
+        common::QuantizedArgmax top = common::tensor_argmax(scores);
+        int index = top.index - label_offset;
+
+        auto label = labels.find(index);
+        if (label == labels.end())
+        {
+            // If there are multiple synonyms for this class, take only the first.
+            std::string synonyms = common::imagenet_labels[index];
+            int comma_pos = synonyms.find(COMMA);
+            label = labels.emplace(index, (comma_pos > 0) ? synonyms.substr(0, comma_pos) : synonyms).first;
+        }
+        float confidence = scores->fix_scale(top.value);
+        hailo_common::add_classification(roi,
+                                         std::string("imagenet"),
+                                         label->second,
+                                         confidence,
+                                         index);
+    }
+}
+
 void filter(HailoROIPtr roi)
 {
     top1(roi, RESNET_50_LAYER_NAME, 0);
@@ -72,4 +100,24 @@ void mobilenet_v1(HailoROIPtr roi)
 void resnet_v1_18(HailoROIPtr roi)
 {
     top1(roi, RESNET_V1_18_LAYER_NAME, 0);
-}
\ No newline at end of file
+}
+
+void filter_batch(std::vector<HailoROIPtr> &rois)
+{
+    top1_batch(rois, RESNET_50_LAYER_NAME, 0);
+}
+
+void resnet_v1_50_batch(std::vector<HailoROIPtr> &rois)
+{
+    top1_batch(rois, RESNET_50_LAYER_NAME, 0);
+}
+
+void mobilenet_v1_batch(std::vector<HailoROIPtr> &rois)
+{
+    top1_batch(rois, MOBILENET_V1_LAYER_NAME, 1);
+}
+
+void resnet_v1_18_batch(std::vector<HailoROIPtr> &rois)
+{
+    top1_batch(rois, RESNET_V1_18_LAYER_NAME, 0);
+}
@@ -3,6 +3,7 @@
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
 #pragma once
+#include <vector>
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
@@ -11,4 +12,8 @@ void filter(HailoROIPtr roi);
 void resnet_v1_50(HailoROIPtr roi);
 void mobilenet_v1(HailoROIPtr roi);
 void resnet_v1_18(HailoROIPtr roi);
+void filter_batch(std::vector<HailoROIPtr> &rois);
+void resnet_v1_50_batch(std::vector<HailoROIPtr> &rois);
+void mobilenet_v1_batch(std::vector<HailoROIPtr> &rois);
+void resnet_v1_18_batch(std::vector<HailoROIPtr> &rois);
 __END_DECLS
\ No newline at end of file
@@ -4,12 +4,9 @@
 **/
 #include <vector>
 #include "common/labels/celeb_a.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "common/quantized.hpp"
 #include "face_attributes.hpp"
 #include "hailo_tracker.hpp"
-#include "xtensor/xadapt.hpp"
-#include "xtensor/xarray.hpp"
 
 #define RESNET_V1_18_FACE_OUTPUT_LAYER_NAME "face_attr_resnet_v1_18/fc3"
 #define RESNET_V1_18_FACE_NUMBER_OF_CLASSES 40
@@ -17,19 +14,14 @@
 
 std::string tracker_name="hailo_face_tracker";
 
-xt::xarray<float> get_face_attributes(HailoROIPtr roi, std::string output_layer_name)
+std::vector<int> get_face_attributes(HailoROIPtr roi, std::string output_layer_name)
 {
     // Extract the relevant output tensor.
     HailoTensorPtr outp_tensor = roi->get_tensor(output_layer_name);
 
-    // Convert the tensor to xarray
-    xt::xarray<float> output_dequantize = common::get_xtensor_float(outp_tensor);
-
-    // Reshape the output tensor to 40 classes view
-    output_dequantize = xt::reshape_view(output_dequantize, {1, RESNET_V1_18_FACE_NUMBER_OF_CLASSES, 2});
-
-    // Get the face attributes values by argmax
-    xt::xarray<float>  attr_predictions = xt::argmax(output_dequantize, -1);
+    // Get the face attributes values by argmax over the 2 scores of each of the 40 classes, on the quantized output
+    std::vector<int> attr_predictions;
+    common::tensor_argmax_rows(outp_tensor, outp_tensor->size() / RESNET_V1_18_FACE_NUMBER_OF_CLASSES, attr_predictions);
     return attr_predictions;
 }
 
@@ -88,7 +80,7 @@ void face_attributes_postprocess(HailoROIPtr roi, std::string output_layer_name)
         return;
     }
 
-    xt::xarray<float> attr_predictions = get_face_attributes(roi, output_layer_name);
+    std::vector<int> attr_predictions = get_face_attributes(roi, output_layer_name);
 
     std::string jde_tracker_name = tracker_name + "_" + roi->get_stream_id();
     std::vector<HailoUniqueIDPtr> unique_ids = hailo_common::get_hailo_unique_id(roi);
@@ -109,7 +101,7 @@ void face_attributes_postprocess(HailoROIPtr roi, std::string output_layer_name)
             continue;
 
         // Get the confidence
-        float confidence = (attr_predictions(0, i)*0.99f);
+        float confidence = (attr_predictions[i] * 0.99f);
         add_attribute_prediction_to_roi(roi, unique_ids, jde_tracker_name, label, confidence, i);
     }
 }
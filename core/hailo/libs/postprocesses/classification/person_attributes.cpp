@@ -3,30 +3,43 @@
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
 #include <vector>
+#include <cmath>
 #include "common/labels/peta.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "common/quantized.hpp"
 #include "hailo_tracker.hpp"
 #include "person_attributes.hpp"
-#include "xtensor/xadapt.hpp"
-#include "xtensor/xarray.hpp"
 
 #define RESNET_V1_18_PERSON_OUTPUT_LAYER_NAME "person_attr_resnet_v1_18/fc1"
 #define RESNET_V1_18_PERSON_THRESHOLD 0.7f
 
 std::string tracker_name = "hailo_person_tracker";
 
-xt::xarray<float> get_attr_predictions_from_tensor(HailoTensorPtr outp_tensor)
+/**
+ * @brief Thresholds the sigmoid of the attributes on the quantized output:
+ *        sigmoid(x) > threshold <=> x > log(threshold / (1 - threshold)), so no value is dequantized.
+ */
+template <typename T>
+std::vector<bool> get_attr_predictions(const T *data, int num_of_attributes, int64_t quantized_threshold)
 {
-    // Convert the tensor to xarray
-    xt::xarray<float> xscores = common::get_xtensor_float(outp_tensor);
-    auto attr_predictions = xt::view(xscores, 0, 0, xt::all());
-
-    // Calculate the face attributes values by sigmoid
-    common::sigmoid(attr_predictions.data(), attr_predictions.size());
+    std::vector<bool> attr_predictions(num_of_attributes);
+    for (int i = 0; i < num_of_attributes; i++)
+        attr_predictions[i] = data[i] >= quantized_threshold;
     return attr_predictions;
 }
 
+std::vector<bool> get_attr_predictions_from_tensor(HailoTensorPtr outp_tensor)
+{
+    auto quant_info = outp_tensor->vstream_info().quant_info;
+    float logit = std::log(RESNET_V1_18_PERSON_THRESHOLD / (1.0f - RESNET_V1_18_PERSON_THRESHOLD));
+    int64_t threshold = common::quantized_threshold(logit, quant_info.qp_scale, quant_info.qp_zp);
+
+    // The attributes are the features of the first pixel
+    int num_of_attributes = outp_tensor->features();
+    if (common::is_uint16(outp_tensor))
+        return get_attr_predictions(common::tensor_data<uint16_t>(outp_tensor), num_of_attributes, threshold);
+    return get_attr_predictions(outp_tensor->data(), num_of_attributes, threshold);
+}
+
 void person_attributes_postprocess(HailoROIPtr roi, std::string output_layer_name)
 {
     if (!roi->has_tensors())
@@ -48,18 +61,16 @@ void person_attributes_postprocess(HailoROIPtr roi, std::string output_layer_nam
                                                                       std::string("person_attributes"));
     }
 
-    uint num_of_attributes = attr_predictions.shape()[0];
+    uint num_of_attributes = attr_predictions.size();
     // Iterate over the attribute predictions
     for (uint i = 0; i < num_of_attributes; i++)
     {
-        // Get the confidence
-        float confidence = attr_predictions(i);
         // Get the label from the peta labels
         label = labels::peta_filtered[i];
 
         // Filter confidence values by threshold
         HailoClassificationPtr classification;
-        if (label != "" && confidence > RESNET_V1_18_PERSON_THRESHOLD)
+        if (label != "" && attr_predictions[i])
         {
             classification = std::make_shared<HailoClassification>(std::string("person_attributes"),
                                                                    i,
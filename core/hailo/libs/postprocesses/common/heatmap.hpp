@@ -0,0 +1,202 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Heatmap decoding on quantized HWC tensors, shared by the pose estimation postprocesses.
+ * Channels are read in place with a stride (no transpose or dequantized copy), and peaks are found with
+ * integer compares. Dequantizing is monotonic (qp_scale > 0), so the peaks of the quantized data are the
+ * peaks of the dequantized heatmap.
+ */
+namespace common
+{
+    struct HeatmapPeak
+    {
+        int index;     // y * width + x
+        int x;
+        int y;
+        int32_t value; // Quantized value, or blurred value for heatmap_blurred_argmax
+    };
+
+    //-------------------------------
+    // ARGMAX / TOP K
+    //-------------------------------
+
+    /**
+     * @brief Argmax of one channel of an HWC tensor, the first of equal values in row-major order.
+     *
+     * @param data The tensor data.
+     * @param width Width of the heatmap.
+     * @param height Height of the heatmap.
+     * @param channels Number of channels (features) of the tensor.
+     * @param channel The channel to search.
+     */
+    template <typename T>
+    HeatmapPeak heatmap_argmax(const T *data, int width, int height, int channels, int channel)
+    {
+        const int size = width * height;
+        const T *channel_data = data + channel;
+        int best = 0;
+        T best_value = channel_data[0];
+        for (int i = 1; i < size; i++)
+        {
+            T value = channel_data[i * channels];
+            if (value > best_value)
+            {
+                best_value = value;
+                best = i;
+            }
+        }
+        return {best, best % width, best / width, (int32_t)best_value};
+    }
+
+    /**
+     * @brief The k highest values of one channel of an HWC tensor, by partial selection.
+     *
+     * @param data The tensor data.
+     * @param width Width of the heatmap.
+     * @param height Height of the heatmap.
+     * @param channels Number of channels (features) of the tensor.
+     * @param channel The channel to search.
+     * @param k Number of peaks, at most width * height.
+     * @param peaks Filled with the peaks, highest first (lower index first on equal values).
+     */
+    template <typename T>
+    void heatmap_top_k(const T *data, int width, int height, int channels, int channel, int k, std::vector<HeatmapPeak> &peaks)
+    {
+        const int size = width * height;
+        k = std::min(k, size);
+        peaks.clear();
+        if (k <= 0)
+            return;
+
+        // A min-heap of the best k values so far: a candidate only costs a compare against its root
+        auto worse = [](const HeatmapPeak &a, const HeatmapPeak &b)
+        {
+            return (a.value > b.value) || (a.value == b.value && a.index < b.index);
+        };
+        const T *channel_data = data + channel;
+        peaks.reserve(k);
+        for (int i = 0; i < k; i++)
+        {
+            peaks.push_back({i, i % width, i / width, (int32_t)channel_data[i * channels]});
+        }
+        std::make_heap(peaks.begin(), peaks.end(), worse);
+        for (int i = k; i < size; i++)
+        {
+            int32_t value = channel_data[i * channels];
+            if (value <= peaks.front().value)
+                continue;
+            std::pop_heap(peaks.begin(), peaks.end(), worse);
+            peaks.back() = {i, i % width, i / width, value};
+            std::push_heap(peaks.begin(), peaks.end(), worse);
+        }
+        std::sort_heap(peaks.begin(), peaks.end(), worse);
+    }
+
+    //-------------------------------
+    // GAUSSIAN BLUR
+    //-------------------------------
+
+    // The 5 taps of a gaussian kernel with sigma 1.1, which is OpenCV's kernel for a size of 5 with sigma 0,
+    // in fixed point: {1, 4, 6, 4, 1} / 16 in each direction
+    static const int32_t HEATMAP_BLUR_TAPS[5] = {1, 4, 6, 4, 1};
+    static const int HEATMAP_BLUR_RADIUS = 2;
+    static const int HEATMAP_BLUR_SHIFT = 8; // The 2D kernel sums to 256
+
+    /**
+     * @brief Separable 5x5 gaussian blur of one channel of an HWC tensor (zero padded) in fixed point, and its argmax.
+     *
+     * The blur runs on (value - zero_point), so blurred / 256 * qp_scale is exactly the blur of the dequantized heatmap.
+     *
+     * @param data The tensor data.
+     * @param width Width of the heatmap.
+     * @param height Height of the heatmap.
+     * @param channels Number of channels (features) of the tensor.
+     * @param channel The channel to blur.
+     * @param zero_point Quantization zero point of the tensor.
+     * @param blurred Filled with the blurred heatmap, width * height values in fixed point (<< HEATMAP_BLUR_SHIFT).
+     * @return HeatmapPeak The argmax of the blurred heatmap, the first of equal values in row-major order.
+     */
+    template <typename T>
+    HeatmapPeak heatmap_blurred_argmax(const T *data, int width, int height, int channels, int channel, int32_t zero_point,
+                                       std::vector<int32_t> &blurred)
+    {
+        const int size = width * height;
+        std::vector<int32_t> horizontal(size);
+        blurred.assign(size, 0);
+
+        const T *channel_data = data + channel;
+        for (int y = 0; y < height; y++)
+        {
+            const T *row = channel_data + y * width * channels;
+            int32_t *out = horizontal.data() + y * width;
+            for (int x = 0; x < width; x++)
+            {
+                int32_t sum = 0;
+                int first = std::max(x - HEATMAP_BLUR_RADIUS, 0), last = std::min(x + HEATMAP_BLUR_RADIUS, width - 1);
+                for (int i = first; i <= last; i++)
+                {
+                    sum += HEATMAP_BLUR_TAPS[i - x + HEATMAP_BLUR_RADIUS] * ((int32_t)row[i * channels] - zero_point);
+                }
+                out[x] = sum;
+            }
+        }
+
+        HeatmapPeak peak = {0, 0, 0, 0};
+        bool found = false;
+        for (int y = 0; y < height; y++)
+        {
+            int first = std::max(y - HEATMAP_BLUR_RADIUS, 0), last = std::min(y + HEATMAP_BLUR_RADIUS, height - 1);
+            int32_t *out = blurred.data() + y * width;
+            for (int j = first; j <= last; j++)
+            {
+                const int32_t tap = HEATMAP_BLUR_TAPS[j - y + HEATMAP_BLUR_RADIUS];
+                const int32_t *in = horizontal.data() + j * width;
+                for (int x = 0; x < width; x++)
+                {
+                    out[x] += tap * in[x];
+                }
+            }
+            for (int x = 0; x < width; x++)
+            {
+                if (!found || out[x] > peak.value)
+                {
+                    peak = {y * width + x, x, y, out[x]};
+                    found = true;
+                }
+            }
+        }
+        return peak;
+    }
+
+    //-------------------------------
+    // SUB-PIXEL REFINEMENT
+    //-------------------------------
+
+    /**
+     * @brief Which neighbours of a peak are higher, to shift the peak a quarter pixel towards them.
+     *        The peak must not be on the border of the heatmap.
+     *
+     * @param heatmap One channel, width * height values in row-major order (e.g. the blurred heatmap), or a channel of
+     *                an HWC tensor with its number of channels as the stride.
+     * @param width Width of the heatmap.
+     * @param peak The peak to refine.
+     * @param right Whether the right neighbour is higher than the left one.
+     * @param down Whether the neighbour below is higher than the one above.
+     * @param stride Distance between two values of the heatmap.
+     */
+    template <typename T>
+    void heatmap_peak_direction(const T *heatmap, int width, const HeatmapPeak &peak, bool &right, bool &down, int stride = 1)
+    {
+        const T *center = heatmap + peak.index * stride;
+        right = center[stride] > center[-stride];
+        down = center[width * stride] > center[-width * stride];
+    }
+}
@@ -0,0 +1,293 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <utility>
+#include <vector>
+#include "hailo_objects.hpp"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/**
+ * Reductions on quantized tensors, shared by the classification, attributes and OCR postprocesses.
+ * They read the tensor memory in place (no xtensor copy or dequantized array): dequantizing is monotonic
+ * (qp_scale > 0), so the argmax / top k of the quantized values are the ones of the dequantized output,
+ * and a softmax only depends on the differences between values, so it is read from a table of exponents.
+ */
+namespace common
+{
+    //-------------------------------
+    // TENSOR ACCESS
+    //-------------------------------
+
+    inline bool is_uint16(HailoTensorPtr &tensor)
+    {
+        return tensor->vstream_info().format.type == HAILO_FORMAT_TYPE_UINT16;
+    }
+
+    template <typename T>
+    const T *tensor_data(HailoTensorPtr &tensor)
+    {
+        return reinterpret_cast<const T *>(tensor->data());
+    }
+
+    //-------------------------------
+    // MAX / ARGMAX / TOP K
+    //-------------------------------
+
+    template <typename T>
+    T quantized_max(const T *data, int size)
+    {
+        T max = data[0];
+        for (int i = 1; i < size; i++)
+            max = data[i] > max ? data[i] : max;
+        return max;
+    }
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    template <>
+    inline uint8_t quantized_max<uint8_t>(const uint8_t *data, int size)
+    {
+        int i = 0;
+        uint8_t max = 0;
+        if (size >= 16)
+        {
+            uint8x16_t max_vec = vld1q_u8(data);
+            for (i = 16; i + 16 <= size; i += 16)
+                max_vec = vmaxq_u8(max_vec, vld1q_u8(data + i));
+            max = vmaxvq_u8(max_vec);
+        }
+        for (; i < size; i++)
+            max = std::max(max, data[i]);
+        return max;
+    }
+
+    template <>
+    inline uint16_t quantized_max<uint16_t>(const uint16_t *data, int size)
+    {
+        int i = 0;
+        uint16_t max = 0;
+        if (size >= 8)
+        {
+            uint16x8_t max_vec = vld1q_u16(data);
+            for (i = 8; i + 8 <= size; i += 8)
+                max_vec = vmaxq_u16(max_vec, vld1q_u16(data + i));
+            max = vmaxvq_u16(max_vec);
+        }
+        for (; i < size; i++)
+            max = std::max(max, data[i]);
+        return max;
+    }
+#endif
+
+    /**
+     * @brief Index of the highest value, the first of equal values (as std::max_element and xt::argmax).
+     *        The max is found by a branchless (vectorized) pass, then its first occurrence.
+     */
+    template <typename T>
+    int quantized_argmax(const T *data, int size)
+    {
+        T max = quantized_max(data, size);
+        return int(std::find(data, data + size, max) - data);
+    }
+
+    /**
+     * @brief Argmax of every row of a row-major matrix, e.g. every attribute of a (attributes x classes) output.
+     *
+     * @param data The matrix data.
+     * @param rows Number of rows.
+     * @param cols Number of values in a row.
+     * @param indices Filled with the argmax of each row.
+     */
+    template <typename T>
+    void quantized_argmax_rows(const T *data, int rows, int cols, std::vector<int> &indices)
+    {
+        indices.resize(rows);
+        for (int row = 0; row < rows; row++)
+            indices[row] = quantized_argmax(data + row * cols, cols);
+    }
+
+    /**
+     * @brief Indices of the k highest values, by partial selection: a min-heap of the best k so far,
+     *        so most values only cost a compare against its root.
+     *
+     * @param data The values.
+     * @param size Number of values.
+     * @param k Number of indices, at most size.
+     * @param indices Filled with the indices, highest first (lower index first on equal values).
+     */
+    template <typename T>
+    void quantized_top_k(const T *data, int size, int k, std::vector<int> &indices)
+    {
+        k = std::min(k, size);
+        indices.clear();
+        if (k <= 0)
+            return;
+        if (k == 1)
+        {
+            indices.push_back(quantized_argmax(data, size));
+            return;
+        }
+
+        auto worse = [data](int a, int b)
+        {
+            return (data[a] > data[b]) || (data[a] == data[b] && a < b);
+        };
+        indices.reserve(k);
+        for (int i = 0; i < k; i++)
+            indices.push_back(i);
+        std::make_heap(indices.begin(), indices.end(), worse);
+        for (int i = k; i < size; i++)
+        {
+            if (data[i] <= data[indices.front()])
+                continue;
+            std::pop_heap(indices.begin(), indices.end(), worse);
+            indices.back() = i;
+            std::push_heap(indices.begin(), indices.end(), worse);
+        }
+        std::sort_heap(indices.begin(), indices.end(), worse);
+    }
+
+    struct QuantizedArgmax
+    {
+        int index;
+        uint32_t value; // Quantized value, dequantize with HailoTensor::fix_scale
+    };
+
+    /**
+     * @brief Argmax of a whole tensor, uint8 or uint16.
+     */
+    inline QuantizedArgmax tensor_argmax(HailoTensorPtr &tensor)
+    {
+        int size = tensor->size();
+        if (is_uint16(tensor))
+        {
+            const uint16_t *data = tensor_data<uint16_t>(tensor);
+            int index = quantized_argmax(data, size);
+            return {index, data[index]};
+        }
+        const uint8_t *data = tensor->data();
+        int index = quantized_argmax(data, size);
+        return {index, data[index]};
+    }
+
+    /**
+     * @brief Argmax of every group of cols values of a tensor, uint8 or uint16.
+     */
+    inline void tensor_argmax_rows(HailoTensorPtr &tensor, int cols, std::vector<int> &indices)
+    {
+        int rows = tensor->size() / cols;
+        if (is_uint16(tensor))
+            quantized_argmax_rows(tensor_data<uint16_t>(tensor), rows, cols, indices);
+        else
+            quantized_argmax_rows(tensor->data(), rows, cols, indices);
+    }
+
+    //-------------------------------
+    // THRESHOLDS
+    //-------------------------------
+
+    /**
+     * @brief The smallest quantized value that dequantizes above a threshold:
+     *        (q - qp_zp) * qp_scale > value  <=>  q >= quantized_threshold(value, qp_scale, qp_zp).
+     */
+    inline int64_t quantized_threshold(float value, float qp_scale, float qp_zp)
+    {
+        return (int64_t)std::floor(qp_zp + value / qp_scale) + 1;
+    }
+
+    //-------------------------------
+    // SOFTMAX
+    //-------------------------------
+
+    // Exponents below exp(-SOFTMAX_LUT_TAIL) are dropped from the softmax sums, each one changes them by less than 1e-9
+    static const float SOFTMAX_LUT_TAIL = 20.0f;
+
+    /**
+     * @brief Softmax of quantized values, with exp() read from a table.
+     *
+     * softmax(x)_i = exp(x_i - x_max) / sum_j exp(x_j - x_max), and x_max - x_j = (q_max - q_j) * qp_scale does not
+     * depend on the zero point, so the table holds exp(-d * qp_scale) for every integer distance d from the max.
+     * The values may also be sums of n quantized values (as a mean over n), with qp_scale / n as the scale.
+     */
+    class QuantizedSoftmax
+    {
+    private:
+        std::vector<float> m_exp;
+
+    public:
+        /**
+         * @param qp_scale Scale of the quantized values.
+         * @param max_distance The largest distance between two values (255 for uint8).
+         */
+        QuantizedSoftmax(float qp_scale, uint32_t max_distance)
+        {
+            uint32_t size = (uint32_t)std::min<double>(max_distance, std::ceil(SOFTMAX_LUT_TAIL / qp_scale)) + 1;
+            m_exp.resize(size);
+            for (uint32_t d = 0; d < size; d++)
+                m_exp[d] = std::exp(-(float)d * qp_scale);
+        }
+
+        /**
+         * @brief A table per scale and thread, built on first use.
+         */
+        static const QuantizedSoftmax &cached(float qp_scale, uint32_t max_distance)
+        {
+            thread_local std::map<std::pair<float, uint32_t>, QuantizedSoftmax> tables;
+            auto key = std::make_pair(qp_scale, max_distance);
+            auto table = tables.find(key);
+            if (table == tables.end())
+                table = tables.emplace(key, QuantizedSoftmax(qp_scale, max_distance)).first;
+            return table->second;
+        }
+
+        float exp(uint32_t distance) const
+        {
+            return distance < m_exp.size() ? m_exp[distance] : 0.0f;
+        }
+
+        /**
+         * @brief The sum of exp(x_j - x_max) over the values, the softmax denominator.
+         */
+        template <typename T>
+        float sum(const T *data, int size, T max) const
+        {
+            float sum = 0.0f;
+            for (int i = 0; i < size; i++)
+                sum += exp(max - data[i]);
+            return sum;
+        }
+
+        /**
+         * @brief The softmax probability of the highest value, with its index.
+         */
+        template <typename T>
+        float max_probability(const T *data, int size, int &index) const
+        {
+            index = quantized_argmax(data, size);
+            return 1.0f / sum(data, size, data[index]);
+        }
+
+        /**
+         * @brief The full softmax of the values.
+         */
+        template <typename T>
+        void softmax(const T *data, int size, float *probabilities) const
+        {
+            T max = quantized_max(data, size);
+            float inverse_sum = 1.0f / sum(data, size, max);
+            for (int i = 0; i < size; i++)
+                probabilities[i] = exp(max - data[i]) * inverse_sum;
+        }
+    };
+
+}
@@ -17,6 +17,18 @@ void fast_depth(HailoROIPtr roi)
     }
     HailoTensorPtr tensor_ptr = roi->get_tensor(output_layer_name);
 
+    // reference the quantized depths in the output buffer when it can be kept alive,
+    // consumers dequantize them only where they need them
+    std::shared_ptr<const uint8_t> shared_data = tensor_ptr->shared_data();
+    if (shared_data)
+    {
+        auto quant_info = tensor_ptr->vstream_info().quant_info;
+        bool is_uint16 = tensor_ptr->vstream_info().format.type == HAILO_FORMAT_TYPE_UINT16;
+        hailo_common::add_object(roi, std::make_shared<HailoDepthMask>(std::move(shared_data), is_uint16, quant_info.qp_scale, quant_info.qp_zp,
+                                                                       tensor_ptr->width(), tensor_ptr->height(), 1.0));
+        return;
+    }
+
     // get the output buffer in uint16 format, and parse it to xarray in the proper size
     xt::xarray<uint16_t> tensor_data = common::get_xtensor_uint16(tensor_ptr);
 
@@ -2,14 +2,18 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#pragma once
 #include <vector>
 #include <string>
 #include <iostream>
 #include <cstring>
+#include <functional>
+#include <type_traits>
 #include "hailo/hailort.h"
 #include "hailo_objects.hpp"
 #include "common/structures.hpp"
 #include "common/nms.hpp"
+#include "common/quantized.hpp"
 #include "common/labels/coco_ninety.hpp"
 #include "common/labels/coco_visdrone.hpp"
 
@@ -20,13 +24,14 @@ class HailoNMSDecode
 {
 private:
     HailoTensorPtr _nms_output_tensor;
-    std::map<uint8_t, std::string> labels_dict;
+    const std::map<uint8_t, std::string> &labels_dict;
     float _detection_thr;
     uint _max_boxes;
     bool _filter_by_score;
     const hailo_vstream_info_t _vstream_info;
+    int64_t _quantized_detection_thr;
 
-    common::hailo_bbox_float32_t dequantize_hailo_bbox(const auto *bbox_struct)
+    common::hailo_bbox_float32_t dequantize_hailo_bbox(const common::hailo_bbox_t *bbox_struct)
     {
         // Dequantization of common::hailo_bbox_t (uint16_t) to common::hailo_bbox_float32_t (float32_t)
         common::hailo_bbox_float32_t dequant_bbox = {
@@ -39,27 +44,84 @@ private:
         return dequant_bbox;
     }
 
-    void parse_bbox_to_detection_object(auto dequant_bbox, uint32_t class_index, std::vector<HailoDetection> &_objects)
+    const common::hailo_bbox_float32_t &dequantize_hailo_bbox(const common::hailo_bbox_float32_t *bbox_struct)
     {
-        float confidence = CLAMP(dequant_bbox.score, 0.0f, 1.0f);
-        // filter score by detection threshold if needed.
-        if (!_filter_by_score || dequant_bbox.score > _detection_thr)
-        {
-            float32_t w, h = 0.0f;
-            // parse width and height of the box
-            std::tie(w, h) = get_shape(&dequant_bbox);
-            // create new detection object and add it to the vector of detections
-            _objects.push_back(HailoDetection(HailoBBox(dequant_bbox.x_min, dequant_bbox.y_min, w, h), class_index, labels_dict[class_index], confidence));
-        }
+        // Already float32_t, read in place
+        return *bbox_struct;
+    }
+
+    bool passes_score_filter(const common::hailo_bbox_t *bbox_struct)
+    {
+        // Compared in the quantized domain, so the boxes that are filtered out are never dequantized
+        return !_filter_by_score || bbox_struct->score >= _quantized_detection_thr;
+    }
+
+    bool passes_score_filter(const common::hailo_bbox_float32_t *bbox_struct)
+    {
+        return !_filter_by_score || bbox_struct->score > _detection_thr;
     }
 
-    std::pair<float, float> get_shape(auto *bbox_struct)
+    const std::string &get_label(uint32_t class_index)
+    {
+        // The labels are referenced in the labels dict, a missing label is empty
+        static const std::string empty_label;
+        auto label = labels_dict.find(class_index);
+        return (label == labels_dict.end()) ? empty_label : label->second;
+    }
+
+    std::pair<float, float> get_shape(const common::hailo_bbox_float32_t *bbox_struct)
     {
         float32_t w = bbox_struct->x_max - bbox_struct->x_min;
         float32_t h = bbox_struct->y_max - bbox_struct->y_min;
         return std::pair<float, float>(w, h);
     }
 
+    /**
+     * @brief Reads the nms buffer in place, and calls create_detection(bbox, confidence, class_index, label)
+     *        for every box that passes the score filter. The classes that keep_class rejects are skipped.
+     */
+    template <typename T, typename BBoxType, typename CreateDetection>
+    void parse_nms_buffer(CreateDetection &&create_detection, const std::function<bool(uint32_t)> &keep_class = nullptr)
+    {
+        // An uint16 output holds float32 boxes
+        using BufferBBoxType = typename std::conditional<std::is_same<T, uint16_t>::value, common::hailo_bbox_float32_t, BBoxType>::type;
+
+        uint32_t max_bboxes_per_class = _vstream_info.nms_shape.max_bboxes_per_class;
+        uint32_t num_of_classes = _vstream_info.nms_shape.number_of_classes;
+        size_t buffer_offset = 0;
+        const uint8_t *buffer = _nms_output_tensor->data();
+        for (size_t class_id = 0; class_id < num_of_classes; class_id++)
+        {
+            float32_t bbox_count = 0;
+            memcpy(&bbox_count, buffer + buffer_offset, sizeof(bbox_count));
+            buffer_offset += sizeof(bbox_count);
+
+            if (bbox_count == 0) // No detections
+                continue;
+            if (bbox_count > max_bboxes_per_class)
+                throw std::runtime_error("Runtime error - Got more than the maximum bboxes per class in the nms buffer");
+
+            uint32_t class_index = class_id + 1;
+            const BufferBBoxType *bboxes = reinterpret_cast<const BufferBBoxType *>(buffer + buffer_offset);
+            buffer_offset += static_cast<uint32_t>(bbox_count) * sizeof(BufferBBoxType);
+            if (keep_class && !keep_class(class_index))
+                continue;
+            const std::string &label = get_label(class_index);
+            for (size_t bbox_index = 0; bbox_index < static_cast<uint32_t>(bbox_count); bbox_index++)
+            {
+                // filter score by detection threshold if needed.
+                if (!passes_score_filter(&bboxes[bbox_index]))
+                    continue;
+                const common::hailo_bbox_float32_t &dequant_bbox = dequantize_hailo_bbox(&bboxes[bbox_index]);
+                float32_t w, h = 0.0f;
+                // parse width and height of the box
+                std::tie(w, h) = get_shape(&dequant_bbox);
+                create_detection(HailoBBox(dequant_bbox.x_min, dequant_bbox.y_min, w, h),
+                                 CLAMP(dequant_bbox.score, 0.0f, 1.0f), class_index, label);
+            }
+        }
+    }
+
 public:
     HailoNMSDecode(HailoTensorPtr tensor, std::map<uint8_t, std::string> &labels_dict, float detection_thr = DEFAULT_THRESHOLD, uint max_boxes = DEFAULT_MAX_BOXES, bool filter_by_score = false)
         : _nms_output_tensor(tensor), labels_dict(labels_dict), _detection_thr(detection_thr), _max_boxes(max_boxes), _filter_by_score(filter_by_score), _vstream_info(tensor->vstream_info())
@@ -67,6 +129,10 @@ public:
         // making sure that the network's output is indeed an NMS type, by checking the order type value included in the metadata
         if ((HAILO_FORMAT_ORDER_HAILO_NMS != _vstream_info.format.order) && (HAILO_FORMAT_ORDER_HAILO_NMS_BY_CLASS != _vstream_info.format.order))
             throw std::invalid_argument("Output tensor " + _nms_output_tensor->name() + " is not an NMS type");
+        // The score threshold of quantized (uint16) boxes
+        _quantized_detection_thr = 0;
+        if (_vstream_info.quant_info.qp_scale > 0.0f)
+            _quantized_detection_thr = common::quantized_threshold(_detection_thr, _vstream_info.quant_info.qp_scale, _vstream_info.quant_info.qp_zp);
     };
 
     template <typename T, typename BBoxType>
@@ -109,38 +175,29 @@ public:
 
         std::vector<HailoDetection> _objects;
         _objects.reserve(_max_boxes);
-        uint32_t max_bboxes_per_class = _vstream_info.nms_shape.max_bboxes_per_class;
-        uint32_t num_of_classes = _vstream_info.nms_shape.number_of_classes;
-        size_t buffer_offset = 0;
-        uint8_t *buffer = _nms_output_tensor->data();
-        for (size_t class_id = 0; class_id < num_of_classes; class_id++)
-        {
-            float32_t bbox_count = 0;
-            memcpy(&bbox_count, buffer + buffer_offset, sizeof(bbox_count));
-            buffer_offset += sizeof(bbox_count);
-
-            if (bbox_count == 0) // No detections
-                continue;
-            if (bbox_count > max_bboxes_per_class)
-                throw std::runtime_error("Runtime error - Got more than the maximum bboxes per class in the nms buffer");
-
-            for (size_t bbox_index = 0; bbox_index < static_cast<uint32_t>(bbox_count); bbox_index++)
-            {
-                if (std::is_same<T, uint16_t>::value)
-                {
-                    // output type (T) is uint16, so we need to do dequantization before parsing
-                    hailo_bbox_float32_t *bbox = (hailo_bbox_float32_t *)(&buffer[buffer_offset]);
-                    parse_bbox_to_detection_object(*bbox, class_id + 1, _objects);
-                    buffer_offset += sizeof(hailo_bbox_float32_t);
-                }
-                else
-                {
-                    BBoxType *bbox_struct = (BBoxType *)(&buffer[buffer_offset]);
-                    parse_bbox_to_detection_object(*bbox_struct, class_id + 1, _objects);
-                    buffer_offset += sizeof(BBoxType);
-                }
-            }
-        }
+        parse_nms_buffer<T, BBoxType>([&_objects](const HailoBBox &bbox, float confidence, uint32_t class_index, const std::string &label)
+                                      { _objects.emplace_back(bbox, class_index, label, confidence); });
         return _objects;
     }
+
+    /**
+     * @brief Decodes the nms buffer (see decode()) straight into the detections of the roi:
+     *        each detection is allocated once and all of them are added under a single lock.
+     *
+     * @param roi The roi to add the detections to.
+     * @param keep_class Optional, the detections of a class are added only if keep_class(class_index) is true.
+     */
+    template <typename T, typename BBoxType>
+    void decode_to_roi(HailoROIPtr roi, const std::function<bool(uint32_t)> &keep_class = nullptr)
+    {
+        if (!_nms_output_tensor)
+            return;
+
+        std::vector<HailoObjectPtr> detections;
+        detections.reserve(_max_boxes);
+        parse_nms_buffer<T, BBoxType>([&detections](const HailoBBox &bbox, float confidence, uint32_t class_index, const std::string &label)
+                                      { detections.emplace_back(std::make_shared<HailoDetection>(bbox, class_index, label, confidence)); },
+                                      keep_class);
+        roi->add_objects(detections);
+    }
 };
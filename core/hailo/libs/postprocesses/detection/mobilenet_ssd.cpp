@@ -19,8 +19,7 @@ static void mobilenet_ssd_base(HailoROIPtr roi, const std::string output_layer,
     }
 
     auto post = HailoNMSDecode(roi->get_tensor(output_layer), labels_dict);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void mobilenet_ssd(HailoROIPtr roi)
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <regex>
 #include <fstream>
 #include <sstream>
@@ -114,8 +115,7 @@ void yolov5(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV5M_OUTPUT_LAYER), common::coco_eighty);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov5s_nv12(HailoROIPtr roi)
@@ -125,8 +125,7 @@ void yolov5s_nv12(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV5S_OUTPUT_LAYER), common::coco_eighty);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov8s(HailoROIPtr roi)
@@ -136,8 +135,7 @@ void yolov8s(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV8S_OUTPUT_LAYER), common::coco_eighty);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov8m(HailoROIPtr roi)
@@ -147,8 +145,7 @@ void yolov8m(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV8M_OUTPUT_LAYER), common::coco_eighty);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolox(HailoROIPtr roi)
@@ -158,8 +155,7 @@ void yolox(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor("yolox_nms_postprocess"), common::coco_eighty);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov5m_vehicles(HailoROIPtr roi)
@@ -169,8 +165,7 @@ void yolov5m_vehicles(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV5M_VEHICLES_OUTPUT_LAYER), yolo_vehicles_labels);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov5m_vehicles_nv12(HailoROIPtr roi)
@@ -180,8 +175,7 @@ void yolov5m_vehicles_nv12(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor("yolov5m_vehicles_nv12/yolov5_nms_postprocess"), yolo_vehicles_labels);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov5s_personface(HailoROIPtr roi)
@@ -191,8 +185,7 @@ void yolov5s_personface(HailoROIPtr roi)
         return;
     }
     auto post = HailoNMSDecode(roi->get_tensor("yolov5s_personface_nv12/yolov5_nms_postprocess"), common::yolo_personface);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    hailo_common::add_detections(roi, detections);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
 }
 
 void yolov5_no_persons(HailoROIPtr roi)
@@ -201,20 +194,17 @@ void yolov5_no_persons(HailoROIPtr roi)
     {
         return;
     }
-    auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV5M_OUTPUT_LAYER), common::coco_eighty);
-    auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-    for (auto it = detections.begin(); it != detections.end();)
+    // The class index of the persons, looked up once. Indexing the labels map per box would insert the missing classes
+    static const uint32_t person_class_index = []()
     {
-        if (it->get_label() == "person")
-        {
-            it = detections.erase(it);
-        }
-        else
-        {
-            ++it;
-        }
-    }
-    hailo_common::add_detections(roi, detections);
+        auto person = std::find_if(common::coco_eighty.begin(), common::coco_eighty.end(),
+                                   [](const std::pair<const uint8_t, std::string> &label) { return label.second == "person"; });
+        return person->first;
+    }();
+    auto post = HailoNMSDecode(roi->get_tensor(DEFAULT_YOLOV5M_OUTPUT_LAYER), common::coco_eighty);
+    // Skip the person class, without creating its detections
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi, [](uint32_t class_index)
+                                                                { return class_index != person_class_index; });
 }
 void filter(HailoROIPtr roi, void *params_void_ptr)
 {
@@ -230,8 +220,7 @@ void filter(HailoROIPtr roi, void *params_void_ptr)
         if (std::regex_search(tensor->name(), std::regex("nms_postprocess"))) 
         {
             auto post = HailoNMSDecode(tensor, params->labels, params->detection_threshold, params->max_boxes, params->filter_by_score);
-            auto detections = post.decode<float32_t, common::hailo_bbox_float32_t>();
-            hailo_common::add_detections(roi, detections);
+            post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
         }
     }
 }
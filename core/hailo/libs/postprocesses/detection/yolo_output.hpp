@@ -3,233 +3,390 @@
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
 #pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <string>
+#include <vector>
 #include "hailo_objects.hpp"
-#include <iostream>
+#include "common/quantized.hpp"
 
 /**
- * @brief Base class to represent OutputLayer of Yolo networks.
+ * Output layers of Yolo networks, decoded by compile time layouts.
  *
+ * A layout is a policy class: the number of anchors, the channels of the center, shape, objectness and classes
+ * of an anchor, and the box math of the network. The boxes of a layer are extracted by a template over the
+ * layout, the data type of the tensors, the output activation and the number of classes, so every element is
+ * a pointer read and the box math is inlined. A network selects its YoloDecoder once (at init), and the data
+ * type of the outputs picks one of the decoder's two instantiations per layer.
+ *
+ * The objectness is compared to the detection threshold in the quantized domain, so the anchors under
+ * the threshold (most of them) cost a single read.
+ */
+
+enum yolo_layout_t
+{
+    YOLO_LAYOUT_V3,
+    YOLO_LAYOUT_TINY_V4,
+    YOLO_LAYOUT_V4,
+    YOLO_LAYOUT_V5,
+    YOLO_LAYOUT_X,
+};
+
+/**
+ * @brief The tensors of one output scale of a Yolo network.
+ *        Fused layouts hold all the channels in one tensor, split layouts have a tensor per field.
  */
 class YoloOutputLayer
 {
 public:
-    static const uint NUM_ANCHORS = 3;
-    static const uint NUM_CENTERS = 2;
-    static const uint NUM_SCALES = 2;
-    static const uint NUM_CONF = 1;
-    static const uint CONF_CHANNEL_OFFSET = NUM_CENTERS + NUM_SCALES;
-    static const uint CLASS_CHANNEL_OFFSET = CONF_CHANNEL_OFFSET + NUM_CONF;
-    YoloOutputLayer(uint width,
-                    uint height,
-                    uint num_of_classes,
-                    std::vector<int> anchors,
-                    bool perform_sigmoid,
-                    int label_offset,
-                    bool is_uint16,
-                    HailoTensorPtr tensor = nullptr) : _width(width),
-                                                       _height(height),
-                                                       _num_classes(num_of_classes),
-                                                       _anchors(anchors),
-                                                       label_offset(label_offset),
-                                                       _perform_sigmoid(perform_sigmoid),
-                                                       _is_uint16(is_uint16),
-                                                       _tensor(tensor){};
-    virtual ~YoloOutputLayer() = default;
-
-    uint _width;
-    uint _height;
-    uint _num_classes;
-    std::vector<int> _anchors;
+    HailoTensorPtr center;
+    HailoTensorPtr shape;
+    HailoTensorPtr obj;
+    HailoTensorPtr cls;
+    std::vector<int> anchors;
+
+    // Fused: per anchor x, y, w, h, objectness, classes (yolov3, tiny yolov4, yolov5)
+    YoloOutputLayer(HailoTensorPtr tensor, std::vector<int> anchors) : center(tensor), shape(tensor), obj(tensor), cls(tensor), anchors(anchors){};
+    // Split: centers, scales, objectness and classes tensors (yolov4)
+    YoloOutputLayer(HailoTensorPtr center, HailoTensorPtr scale, HailoTensorPtr obj, HailoTensorPtr cls, std::vector<int> anchors) : center(center), shape(scale), obj(obj), cls(cls), anchors(anchors){};
+    // Split, anchor free: x, y, w, h in one tensor (yolox)
+    YoloOutputLayer(HailoTensorPtr bbox, HailoTensorPtr obj, HailoTensorPtr cls) : center(bbox), shape(bbox), obj(obj), cls(cls){};
+
+    uint width() { return cls->width(); }
+    uint height() { return cls->height(); }
+};
+
+/**
+ * @brief What the boxes of a frame are extracted with.
+ */
+struct YoloExtractParams
+{
+    float detection_threshold;
     int label_offset;
+    uint image_width;
+    uint image_height;
+    const std::map<uint8_t, std::string> *labels;
+};
 
-    /**
-     * @brief Get the class object
-     *
-     * @param row
-     * @param col
-     * @param anchor
-     * @return std::pair<uint, float> class id and class probability.
-     */
-    std::pair<uint, float> get_class(uint row, uint col, uint anchor);
-    /**
-     * @brief Get the confidence object
-     *
-     * @param row
-     * @param col
-     * @param anchor
-     * @return float
-     */
-    virtual float get_confidence(uint row, uint col, uint anchor);
-    /**
-     * @brief Get the center object
-     *
-     * @param row
-     * @param col
-     * @param anchor
-     * @return std::pair<float, float> pair of x,y of the center of this prediction.
-     */
-    virtual std::pair<float, float> get_center(uint row, uint col, uint anchor) = 0;
-    /**
-     * @brief Get the shape object
-     *
-     * @param row
-     * @param col
-     * @param anchor
-     * @param image_width
-     * @param image_height
-     * @return std::pair<float, float> pair of w,h of the shape of this prediction.
-     */
-    virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height) = 0;
+//-------------------------------
+// LAYOUTS
+//-------------------------------
 
-protected:
-    bool _perform_sigmoid;
-    bool _is_uint16;
-    HailoTensorPtr _tensor;
-    float sigmoid(float x);
-    /**
-     * @brief Get the class channel object
-     *
-     * @param anchor
-     * @param channel
-     * @return uint
-     */
-    virtual uint get_class_prob(uint row, uint col, uint anchor, uint class_id);
-    /**
-     * @brief Get the class conf object
-     *
-     * @param prob_max
-     * @return float
-     */
-    virtual float get_class_conf(uint prob_max) = 0;
-    static uint num_classes(uint channels)
+template <bool SIGMOID>
+inline float yolo_activation(float x)
+{
+    // returns the value of the sigmoid function f(x) = 1/(1 + e^-x)
+    return SIGMOID ? 1.0f / (1.0f + expf(-x)) : x;
+}
+
+// Channels of an anchor in a fused tensor
+struct YoloFusedChannels
+{
+    static const uint CENTER_OFFSET = 0;
+    static const uint SHAPE_OFFSET = 2;
+    static const uint OBJ_OFFSET = 4;
+    static const uint CLASS_OFFSET = 5;
+};
+
+// Channels of an anchor in split tensors
+struct YoloSplitChannels
+{
+    static const uint CENTER_OFFSET = 0;
+    static const uint SHAPE_OFFSET = 0;
+    static const uint OBJ_OFFSET = 0;
+    static const uint CLASS_OFFSET = 0;
+};
+
+struct Yolov3Layout : public YoloFusedChannels
+{
+    static const yolo_layout_t TYPE = YOLO_LAYOUT_V3;
+    static const uint NUM_ANCHORS = 3;
+    static const bool HAS_ACTIVATION = true;
+    template <bool SIGMOID>
+    static float center(float value, uint cell, uint grid_size)
     {
-        return (channels / NUM_ANCHORS) - CLASS_CHANNEL_OFFSET;
+        return (yolo_activation<true>(value) + cell) / grid_size;
+    }
+    static float shape(float value, float anchor, uint image_size, uint grid_size)
+    {
+        return expf(value) * anchor / image_size;
     }
 };
 
-class Yolov3OL : public YoloOutputLayer
+struct TinyYolov4Layout : public YoloFusedChannels
 {
-public:
-    Yolov3OL(HailoTensorPtr tensor,
-             std::vector<int> anchors,
-             bool perform_sigmoid,
-             int label_offset,
-             bool is_uint16) : YoloOutputLayer(tensor->width(),
-                                               tensor->height(),
-                                               num_classes(tensor->features()),
-                                               anchors,
-                                               perform_sigmoid,
-                                               label_offset,
-                                               is_uint16,
-                                               tensor){};
-
-    virtual std::pair<float, float> get_center(uint row, uint col, uint anchor);
-    virtual float get_class_conf(uint prob_max);
-    virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
+    static const yolo_layout_t TYPE = YOLO_LAYOUT_TINY_V4;
+    static const uint NUM_ANCHORS = 3;
+    static const bool HAS_ACTIVATION = true;
+    static constexpr float SCALE_XY = 1.05f;
+    template <bool SIGMOID>
+    static float center(float value, uint cell, uint grid_size)
+    {
+        return (yolo_activation<true>(value) * SCALE_XY - 0.5f * (SCALE_XY - 1) + cell) / grid_size;
+    }
+    static float shape(float value, float anchor, uint image_size, uint grid_size)
+    {
+        return expf(value) * anchor / image_size;
+    }
 };
 
-class TinyYolov4OL : public YoloOutputLayer
+struct Yolov4Layout : public YoloSplitChannels
 {
-public:
-    const float SCALE_XY = 1.05f;
-    TinyYolov4OL(HailoTensorPtr tensor,
-                 std::vector<int> anchors,
-                 bool perform_sigmoid,
-                 int label_offset,
-                 bool is_uint16) : YoloOutputLayer(tensor->width(),
-                                                   tensor->height(),
-                                                   num_classes(tensor->features()),
-                                                   anchors,
-                                                   perform_sigmoid,
-                                                   label_offset,
-                                                   is_uint16,
-                                                   tensor){};
-    virtual std::pair<float, float> get_center(uint row, uint col, uint anchor);
-    virtual float get_class_conf(uint prob_max);
-    virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
+    static const yolo_layout_t TYPE = YOLO_LAYOUT_V4;
+    static const uint NUM_ANCHORS = 3;
+    static const bool HAS_ACTIVATION = true;
+    static constexpr float SCALE_XY = 1.05f;
+    template <bool SIGMOID>
+    static float center(float value, uint cell, uint grid_size)
+    {
+        return (yolo_activation<SIGMOID>(value) * SCALE_XY - 0.5f * (SCALE_XY - 1) + cell) / grid_size;
+    }
+    static float shape(float value, float anchor, uint image_size, uint grid_size)
+    {
+        return expf(value) * anchor / image_size;
+    }
 };
 
-class Yolov4OL : public YoloOutputLayer
+struct Yolov5Layout : public YoloFusedChannels
 {
-public:
-    const float SCALE_XY = 1.05f;
-    Yolov4OL(HailoTensorPtr center,
-             HailoTensorPtr scale,
-             HailoTensorPtr obj,
-             HailoTensorPtr cls,
-             std::vector<int> anchors,
-             int label_offset,
-             bool perform_sigmoid,
-             bool is_uint16) : YoloOutputLayer(cls->width(),
-                                                     cls->height(),
-                                                     (uint)(cls->features() / NUM_ANCHORS),
-                                                     anchors,
-                                                     perform_sigmoid,
-                                                     label_offset,
-                                                     is_uint16),
-                                     _center(center),
-                                     _scale(scale),
-                                     _obj(obj),
-                                     _cls(cls){};
-    virtual std::pair<float, float> get_center(uint row, uint col, uint anchor);
-    virtual float get_confidence(uint row, uint col, uint anchor);
-    virtual uint get_class_prob(uint row, uint col, uint anchor, uint channel);
-    virtual float get_class_conf(uint prob_max);
-    virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
-
-protected:
-    HailoTensorPtr _center;
-    HailoTensorPtr _scale;
-    HailoTensorPtr _obj;
-    HailoTensorPtr _cls;
+    static const yolo_layout_t TYPE = YOLO_LAYOUT_V5;
+    static const uint NUM_ANCHORS = 3;
+    static const bool HAS_ACTIVATION = false; // The sigmoid is part of the network
+    template <bool SIGMOID>
+    static float center(float value, uint cell, uint grid_size)
+    {
+        return (value * 2.0f - 0.5f + cell) / grid_size;
+    }
+    static float shape(float value, float anchor, uint image_size, uint grid_size)
+    {
+        float scale = 2.0f * value;
+        return scale * scale * anchor / image_size;
+    }
 };
 
-class Yolov5OL : public YoloOutputLayer
+struct YoloXLayout : public YoloSplitChannels
 {
-public:
-    Yolov5OL(HailoTensorPtr tensor,
-             std::vector<int> anchors,
-             bool perform_sigmoid,
-             int label_offset,
-             bool is_uint16) : YoloOutputLayer(tensor->width(),
-                                               tensor->height(),
-                                               num_classes(tensor->features()),
-                                               anchors,
-                                               false,
-                                               label_offset,
-                                               is_uint16,
-                                               tensor){};
-    virtual float get_class_conf(uint prob_max);
-    virtual std::pair<float, float> get_center(uint row, uint col, uint anchor);
-    virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
+    static const yolo_layout_t TYPE = YOLO_LAYOUT_X;
+    static const uint NUM_ANCHORS = 1;
+    static const uint SHAPE_OFFSET = 2; // x, y, w, h share the bbox tensor
+    static const bool HAS_ACTIVATION = false;
+    template <bool SIGMOID>
+    static float center(float value, uint cell, uint grid_size)
+    {
+        return (value + cell) / grid_size;
+    }
+    static float shape(float value, float anchor, uint image_size, uint grid_size)
+    {
+        return expf(value) / grid_size;
+    }
+};
+
+//-------------------------------
+// EXTRACTION
+//-------------------------------
+
+/**
+ * @brief A field of a layer (center, shape, objectness or classes) in place in its tensor.
+ */
+template <typename T>
+struct YoloField
+{
+    const T *data;
+    uint pixel_stride;
+    uint anchor_stride;
+    float qp_scale;
+    float qp_zp;
+
+    YoloField(HailoTensorPtr &tensor, uint num_anchors, uint offset)
+        : data(common::tensor_data<T>(tensor) + offset),
+          pixel_stride(tensor->features()),
+          anchor_stride(tensor->features() / num_anchors),
+          qp_scale(tensor->vstream_info().quant_info.qp_scale),
+          qp_zp(tensor->vstream_info().quant_info.qp_zp){};
+
+    const T *at(uint pixel, uint anchor) const
+    {
+        return data + pixel * pixel_stride + anchor * anchor_stride;
+    }
+    float dequantize(T value) const
+    {
+        return (float(value) - qp_zp) * qp_scale;
+    }
 };
 
-class YoloXOL : public YoloOutputLayer
+/**
+ * @brief The smallest quantized value that activates to at least the threshold,
+ *        found by bisection as the dequantization and the activation are monotonic.
+ */
+template <typename T, bool SIGMOID>
+uint32_t yolo_quantized_threshold(const YoloField<T> &field, float threshold)
+{
+    uint32_t low = 0;
+    uint32_t high = uint32_t(std::numeric_limits<T>::max()) + 1;
+    while (low < high)
+    {
+        uint32_t middle = (low + high) / 2;
+        if (yolo_activation<SIGMOID>(field.dequantize(T(middle))) >= threshold)
+            high = middle;
+        else
+            low = middle + 1;
+    }
+    return low;
+}
+
+/**
+ * @brief Extracts the boxes of a layer above the detection threshold.
+ *
+ * @param layer The tensors of the layer.
+ * @param params The threshold, labels and input size.
+ * @param[out] objects The detections are added to it.
+ */
+template <typename T, typename Layout, bool SIGMOID, uint NUM_CLASSES>
+void yolo_extract_boxes(YoloOutputLayer &layer, const YoloExtractParams &params, std::vector<HailoDetection> &objects)
+{
+    const uint A = Layout::NUM_ANCHORS;
+    const YoloField<T> center(layer.center, A, Layout::CENTER_OFFSET);
+    const YoloField<T> shape(layer.shape, A, Layout::SHAPE_OFFSET);
+    const YoloField<T> obj(layer.obj, A, Layout::OBJ_OFFSET);
+    const YoloField<T> cls(layer.cls, A, Layout::CLASS_OFFSET);
+    const uint width = layer.width();
+    const uint height = layer.height();
+
+    // Class ids start at 1, class id c is channel c - 1
+    const uint num_classes = (NUM_CLASSES != 0) ? NUM_CLASSES : cls.anchor_stride - Layout::CLASS_OFFSET;
+    const uint first_class = std::max(params.label_offset, 1);
+    if (first_class > num_classes)
+        return;
+    const uint class_count = num_classes - first_class + 1;
+
+    float anchors[A * 2] = {};
+    std::copy_n(layer.anchors.begin(), std::min<size_t>(layer.anchors.size(), A * 2), anchors);
+
+    const uint32_t obj_threshold = yolo_quantized_threshold<T, SIGMOID>(obj, params.detection_threshold);
+    for (uint row = 0; row < height; ++row)
+    {
+        for (uint col = 0; col < width; ++col)
+        {
+            const uint pixel = row * width + col;
+            for (uint anchor = 0; anchor < A; ++anchor)
+            {
+                const T obj_value = *obj.at(pixel, anchor);
+                if (obj_value < obj_threshold)
+                    continue;
+                const T *classes = cls.at(pixel, anchor) + first_class - 1;
+                int index = common::quantized_argmax(classes, (first_class == 1 && NUM_CLASSES != 0) ? NUM_CLASSES : class_count);
+                const T prob_max = classes[index];
+                // No class above zero falls back to the first class
+                uint class_id = (prob_max > 0) ? first_class + index : 1;
+                // Final confidence: box confidence * class probability
+                float confidence = yolo_activation<SIGMOID>(obj.dequantize(obj_value)) *
+                                   yolo_activation<SIGMOID>(cls.dequantize(prob_max));
+                if (confidence <= params.detection_threshold)
+                    continue;
+
+                const T *center_values = center.at(pixel, anchor);
+                const T *shape_values = shape.at(pixel, anchor);
+                float x = Layout::template center<SIGMOID>(center.dequantize(center_values[0]), col, width);
+                float y = Layout::template center<SIGMOID>(center.dequantize(center_values[1]), row, height);
+                float w = Layout::shape(shape.dequantize(shape_values[0]), anchors[anchor * 2], params.image_width, width);
+                float h = Layout::shape(shape.dequantize(shape_values[1]), anchors[anchor * 2 + 1], params.image_height, height);
+                auto label = params.labels->find(class_id);
+                // Get the top left corner of the object.
+                objects.push_back(HailoDetection(HailoBBox(x - (w / 2.0f), y - (h / 2.0f), w, h), class_id,
+                                                 (label != params.labels->end()) ? label->second : "", confidence));
+            }
+        }
+    }
+}
+
+// The number of classes of the coco networks, extracted with a constant class count
+#define YOLO_COCO_CLASSES (80)
+
+template <typename T, typename Layout, bool SIGMOID>
+void yolo_extract_layer(YoloOutputLayer &layer, const YoloExtractParams &params, std::vector<HailoDetection> &objects)
+{
+    if (layer.cls->features() / Layout::NUM_ANCHORS - Layout::CLASS_OFFSET == YOLO_COCO_CLASSES)
+        yolo_extract_boxes<T, Layout, SIGMOID, YOLO_COCO_CLASSES>(layer, params, objects);
+    else
+        yolo_extract_boxes<T, Layout, SIGMOID, 0>(layer, params, objects);
+}
+
+//-------------------------------
+// DISPATCH
+//-------------------------------
+
+/**
+ * @brief The instantiations of a layout and output activation, for uint8 and uint16 outputs.
+ */
+class YoloDecoder
 {
 public:
-    static const uint NUM_ANCHORS = 1;
-    YoloXOL(HailoTensorPtr bbox,
-            HailoTensorPtr obj,
-            HailoTensorPtr cls,
-            int label_offset,
-            bool is_uint16) : YoloOutputLayer(cls->width(),
-                                                cls->height(),
-                                                (uint)(cls->features()),
-                                                {},
-                                                false,
-                                                label_offset,
-                                                is_uint16),
-                                _bbox(bbox),
-                                _obj(obj),
-                                _cls(cls){};
-    virtual float get_confidence(uint row, uint col, uint anchor);
-    virtual uint get_class_prob(uint row, uint col, uint anchor, uint channel);
-    virtual float get_class_conf(uint prob_max);
-    virtual std::pair<float, float> get_center(uint row, uint col, uint anchor);
-    virtual std::pair<float, float> get_shape(uint row, uint col, uint anchor, uint image_width, uint image_height);
-
-protected:
-    HailoTensorPtr _bbox;
-    HailoTensorPtr _obj;
-    HailoTensorPtr _cls;
-};
\ No newline at end of file
+    using ExtractFunc = void (*)(YoloOutputLayer &, const YoloExtractParams &, std::vector<HailoDetection> &);
+
+    yolo_layout_t layout;
+    bool sigmoid;
+    uint num_anchors;
+    uint class_offset;
+    ExtractFunc extract_uint8;
+    ExtractFunc extract_uint16;
+
+    YoloDecoder(yolo_layout_t layout, bool sigmoid, uint num_anchors, uint class_offset, ExtractFunc extract_uint8, ExtractFunc extract_uint16)
+        : layout(layout), sigmoid(sigmoid), num_anchors(num_anchors), class_offset(class_offset),
+          extract_uint8(extract_uint8), extract_uint16(extract_uint16){};
+
+    uint num_classes(YoloOutputLayer &layer) const
+    {
+        return layer.cls->features() / num_anchors - class_offset;
+    }
+
+    void extract_boxes(YoloOutputLayer &layer, const YoloExtractParams &params, std::vector<HailoDetection> &objects) const
+    {
+        if (common::is_uint16(layer.obj))
+            extract_uint16(layer, params, objects);
+        else
+            extract_uint8(layer, params, objects);
+    }
+
+    /**
+     * @brief The decoder of a layout. Layouts without an output activation ignore sigmoid.
+     */
+    static const YoloDecoder &select(yolo_layout_t layout, bool sigmoid);
+};
+
+template <typename Layout, bool SIGMOID>
+const YoloDecoder &yolo_decoder()
+{
+    static const YoloDecoder decoder(Layout::TYPE, SIGMOID, Layout::NUM_ANCHORS, Layout::CLASS_OFFSET,
+                                     &yolo_extract_layer<uint8_t, Layout, SIGMOID>,
+                                     &yolo_extract_layer<uint16_t, Layout, SIGMOID>);
+    return decoder;
+}
+
+template <typename Layout>
+const YoloDecoder &yolo_decoder(bool sigmoid)
+{
+    if (Layout::HAS_ACTIVATION && sigmoid)
+        return yolo_decoder<Layout, Layout::HAS_ACTIVATION>();
+    return yolo_decoder<Layout, false>();
+}
+
+inline const YoloDecoder &YoloDecoder::select(yolo_layout_t layout, bool sigmoid)
+{
+    switch (layout)
+    {
+    case YOLO_LAYOUT_V3:
+        return yolo_decoder<Yolov3Layout>(sigmoid);
+    case YOLO_LAYOUT_TINY_V4:
+        return yolo_decoder<TinyYolov4Layout>(sigmoid);
+    case YOLO_LAYOUT_V4:
+        return yolo_decoder<Yolov4Layout>(sigmoid);
+    case YOLO_LAYOUT_X:
+        return yolo_decoder<YoloXLayout>(sigmoid);
+    case YOLO_LAYOUT_V5:
+    default:
+        return yolo_decoder<Yolov5Layout>(sigmoid);
+    }
+}
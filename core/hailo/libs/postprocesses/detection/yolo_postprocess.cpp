@@ -7,6 +7,7 @@
 #include <vector>
 #include <algorithm>
 #include <sstream>
+#include <iostream>
 
 #include "yolo_postprocess.hpp"
 #include "common/nms.hpp"
@@ -29,30 +30,40 @@ namespace fs = std::experimental::filesystem;
 class YoloPost
 {
 protected:
-    std::vector<std::shared_ptr<YoloOutputLayer>> _layers;
+    std::vector<YoloOutputLayer> _layers;
+    const YoloDecoder &_decoder;
     uint _max_boxes;
     float _detection_thr;
     float _iou_thr;
+    int _label_offset;
     uint m_image_width;
     uint m_image_height;
-    std::map<uint8_t, std::string> m_dataset;
+    const std::map<uint8_t, std::string> &m_dataset;
+
+    /**
+     * @brief The decoder selected at init, or the one of this layout if the params are of another network.
+     */
+    static const YoloDecoder &get_decoder(YoloParams *params, yolo_layout_t layout)
+    {
+        if (params->decoder != nullptr && params->decoder->layout == layout)
+            return *params->decoder;
+        return YoloDecoder::select(layout, params->output_activation == "sigmoid");
+    }
 
 public:
     virtual ~YoloPost() = default;
-    YoloPost(std::map<uint8_t, std::string> dataset,
-             float detection_threshold,
-             float iou_threshold,
-             uint max_boxes)
-        : _max_boxes(max_boxes), _detection_thr(detection_threshold),
-          _iou_thr(iou_threshold), m_dataset(dataset){};
+    YoloPost(YoloParams *params, yolo_layout_t layout)
+        : _decoder(get_decoder(params, layout)), _max_boxes(params->max_boxes), _detection_thr(params->detection_threshold),
+          _iou_thr(params->iou_threshold), _label_offset(params->label_offset), m_dataset(params->labels){};
 
     std::vector<HailoDetection> decode()
     {
         std::vector<HailoDetection> objects;
         objects.reserve(_max_boxes);
-        for (auto layer : _layers)
+        YoloExtractParams extract_params = {_detection_thr, _label_offset, m_image_width, m_image_height, &m_dataset};
+        for (auto &layer : _layers)
         {
-            extract_boxes(layer, objects);
+            _decoder.extract_boxes(layer, extract_params, objects);
         }
         common::nms(objects, _iou_thr);
         if (objects.size() > _max_boxes)
@@ -67,61 +78,18 @@ public:
 
     uint get_num_classes()
     {
-        return _layers[0]->_num_classes;
+        return _decoder.num_classes(_layers[0]);
     }
-
-    /**
-     * @brief Extract the boxes of generic yolo output layer.
-     *
-     * @param[in] image_size Network's input image width/height.
-     * @param[in] thr Postprocess threshold.
-     * @param[out] objects Reference to vector of detections.
-     */
-    void extract_boxes(std::shared_ptr<YoloOutputLayer> layer,
-                       std::vector<HailoDetection> &objects);
 };
 
-void YoloPost::extract_boxes(std::shared_ptr<YoloOutputLayer> layer,
-                             std::vector<HailoDetection> &objects)
-{
-    uint class_id = 0;
-    float x, y, h, w, confidence, class_confidence = 0.0f;
-    float xmin, ymin = 0.0f;
-    for (uint row = 0; row < layer->_height; ++row)
-    {
-        for (uint col = 0; col < layer->_width; ++col)
-        {
-            for (uint anchor = 0; anchor < layer->NUM_ANCHORS; ++anchor)
-            {
-                confidence = layer->get_confidence(row, col, anchor);
-                if (confidence < _detection_thr)
-                    continue;
-                std::tie(class_id, class_confidence) = layer->get_class(row, col, anchor);
-                // Final confidence: box confidence * class probability
-                confidence = confidence * class_confidence;
-                if (confidence > _detection_thr)
-                {
-                    std::tie(x, y) = layer->get_center(row, col, anchor);
-                    std::tie(w, h) = layer->get_shape(row, col, anchor, m_image_width, m_image_height);
-                    // Get the top left corner of the object.
-                    xmin = (x - (w / 2.0f));
-                    ymin = (y - (h / 2.0f));
-                    objects.push_back(HailoDetection(HailoBBox(xmin, ymin, w, h), class_id, m_dataset[class_id], confidence));
-                }
-            }
-        }
-    }
-}
-
 class Yolov5 : public YoloPost
 {
 public:
     Yolov5(HailoROIPtr roi, YoloParams *params)
-        : YoloPost(params->labels, params->detection_threshold, params->iou_threshold, params->max_boxes), _tensors(roi->get_tensors())
+        : YoloPost(params, YOLO_LAYOUT_V5), _tensors(roi->get_tensors())
     {
         if (_tensors.size() > 0)
         {
-            bool sigmoid = (params->output_activation == "sigmoid");
             sort(_tensors.begin(), _tensors.end(),
                  [](const HailoTensorPtr &a, const HailoTensorPtr &b)
                  { return a->size() < b->size(); });
@@ -131,8 +99,7 @@ public:
             _layers.reserve(_tensors.size());
             for (std::size_t i = 0; i < _tensors.size(); i++)
             {
-                hailo_format_type_t format = _tensors[i]->vstream_info().format.type;
-                _layers.push_back(std::make_shared<Yolov5OL>(_tensors[i], params->anchors_vec[i], sigmoid, params->label_offset, format == HAILO_FORMAT_TYPE_UINT16));
+                _layers.emplace_back(_tensors[i], params->anchors_vec[i]);
             }
 
             params->check_params_logic(get_num_classes());
@@ -149,11 +116,10 @@ class Yolov3 : public YoloPost
 {
 public:
     Yolov3(HailoROIPtr roi, YoloParams *params)
-        : YoloPost(params->labels, params->detection_threshold, params->iou_threshold, params->max_boxes), _tensors(roi->get_tensors())
+        : YoloPost(params, YOLO_LAYOUT_V3), _tensors(roi->get_tensors())
     {
         if (_tensors.size() > 0)
         {
-            bool sigmoid = (params->output_activation == "sigmoid");
             sort(_tensors.begin(), _tensors.end(),
                  [](const HailoTensorPtr &a, const HailoTensorPtr &b)
                  { return a->size() < b->size(); });
@@ -163,8 +129,7 @@ public:
 
             for (std::size_t i = 0; i < _tensors.size(); i++)
             {
-                hailo_format_type_t format = _tensors[i]->vstream_info().format.type;
-                _layers.push_back(std::make_shared<Yolov3OL>(_tensors[i], params->anchors_vec[i], sigmoid, params->label_offset, format == HAILO_FORMAT_TYPE_UINT16));
+                _layers.emplace_back(_tensors[i], params->anchors_vec[i]);
             }
         }
         params->check_params_logic(get_num_classes());
@@ -179,11 +144,10 @@ class TinyYolov4LicensePlates : public YoloPost
 {
 public:
     TinyYolov4LicensePlates(HailoROIPtr roi, YoloParams *params)
-        : YoloPost(params->labels, params->detection_threshold, params->iou_threshold, params->max_boxes), _tensors(roi->get_tensors())
+        : YoloPost(params, YOLO_LAYOUT_TINY_V4), _tensors(roi->get_tensors())
     {
         if (_tensors.size() > 0)
         {
-            bool sigmoid = (params->output_activation == "sigmoid");
             sort(_tensors.begin(), _tensors.end(),
                  [](const HailoTensorPtr &a, const HailoTensorPtr &b)
                  { return a->size() < b->size(); });
@@ -193,8 +157,7 @@ public:
 
             for (std::size_t i = 0; i < _tensors.size(); i++)
             {
-                hailo_format_type_t format = _tensors[i]->vstream_info().format.type;
-                _layers.push_back(std::make_shared<TinyYolov4OL>(_tensors[i], params->anchors_vec[i], sigmoid, params->label_offset, format == HAILO_FORMAT_TYPE_UINT16));
+                _layers.emplace_back(_tensors[i], params->anchors_vec[i]);
             }
         }
         params->check_params_logic(get_num_classes());
@@ -210,30 +173,22 @@ class Yolov4 : public YoloPost
 {
 public:
     Yolov4(HailoROIPtr roi, YoloParams *params)
-        : YoloPost(params->labels, params->detection_threshold, params->iou_threshold, params->max_boxes), _roi(roi)
+        : YoloPost(params, YOLO_LAYOUT_V4), _roi(roi)
     {
         if (_roi->has_tensors())
         {
-            bool sigmoid = (params->output_activation == "sigmoid");
-            hailo_format_type_t format;
             auto anchors = params->anchors_vec;
             m_image_width = _roi->get_tensor("yolov4_leaky/conv110_centers")->width() * 32;
             m_image_height = _roi->get_tensor("yolov4_leaky/conv110_centers")->height() * 32;
 
-            format = _roi->get_tensor("yolov4_leaky/conv110_centers")->vstream_info().format.type;
-            _layers.push_back(std::make_shared<Yolov4OL>(_roi->get_tensor("yolov4_leaky/conv110_centers"), _roi->get_tensor("yolov4_leaky/conv110_scales"),
-                                                         _roi->get_tensor("yolov4_leaky/conv110_obj"), _roi->get_tensor("yolov4_leaky/conv110_probs"),
-                                                         anchors[0], params->label_offset, sigmoid, format == HAILO_FORMAT_TYPE_UINT16));
+            _layers.emplace_back(_roi->get_tensor("yolov4_leaky/conv110_centers"), _roi->get_tensor("yolov4_leaky/conv110_scales"),
+                                 _roi->get_tensor("yolov4_leaky/conv110_obj"), _roi->get_tensor("yolov4_leaky/conv110_probs"), anchors[0]);
 
-            format = _roi->get_tensor("yolov4_leaky/conv103_centers")->vstream_info().format.type;
-            _layers.push_back(std::make_shared<Yolov4OL>(_roi->get_tensor("yolov4_leaky/conv103_centers"), _roi->get_tensor("yolov4_leaky/conv103_scales"),
-                                                         _roi->get_tensor("yolov4_leaky/conv103_obj"), _roi->get_tensor("yolov4_leaky/conv103_probs"),
-                                                         anchors[1], params->label_offset, sigmoid, format == HAILO_FORMAT_TYPE_UINT16));
+            _layers.emplace_back(_roi->get_tensor("yolov4_leaky/conv103_centers"), _roi->get_tensor("yolov4_leaky/conv103_scales"),
+                                 _roi->get_tensor("yolov4_leaky/conv103_obj"), _roi->get_tensor("yolov4_leaky/conv103_probs"), anchors[1]);
 
-            format = _roi->get_tensor("yolov4_leaky/conv95_centers")->vstream_info().format.type;
-            _layers.push_back(std::make_shared<Yolov4OL>(_roi->get_tensor("yolov4_leaky/conv95_centers"), _roi->get_tensor("yolov4_leaky/conv95_scales"),
-                                                         _roi->get_tensor("yolov4_leaky/conv95_obj"), _roi->get_tensor("yolov4_leaky/conv95_probs"),
-                                                         anchors[2], params->label_offset, sigmoid, format == HAILO_FORMAT_TYPE_UINT16));
+            _layers.emplace_back(_roi->get_tensor("yolov4_leaky/conv95_centers"), _roi->get_tensor("yolov4_leaky/conv95_scales"),
+                                 _roi->get_tensor("yolov4_leaky/conv95_obj"), _roi->get_tensor("yolov4_leaky/conv95_probs"), anchors[2]);
 
             params->check_params_logic(get_num_classes());
         }
@@ -248,25 +203,21 @@ class YoloX : public YoloPost
 {
 public:
     YoloX(HailoROIPtr roi, YoloParams *params)
-        : YoloPost(params->labels, params->detection_threshold, params->iou_threshold, params->max_boxes), _roi(roi)
+        : YoloPost(params, YOLO_LAYOUT_X), _roi(roi)
     {
         if (_roi->has_tensors())
         {
-            hailo_format_type_t format;
             m_image_width = _roi->get_tensor("yolox_l_leaky/conv130")->width() * 32;
             m_image_height = _roi->get_tensor("yolox_l_leaky/conv130")->height() * 32;
 
-            format = _roi->get_tensor("yolox_l_leaky/conv130")->vstream_info().format.type;
-            _layers.push_back(std::make_shared<YoloXOL>(_roi->get_tensor("yolox_l_leaky/conv130"), _roi->get_tensor("yolox_l_leaky/conv131"),
-                                                        _roi->get_tensor("yolox_l_leaky/conv129"), params->label_offset, format == HAILO_FORMAT_TYPE_UINT16));
+            _layers.emplace_back(_roi->get_tensor("yolox_l_leaky/conv130"), _roi->get_tensor("yolox_l_leaky/conv131"),
+                                 _roi->get_tensor("yolox_l_leaky/conv129"));
 
-            format = _roi->get_tensor("yolox_l_leaky/conv113")->vstream_info().format.type;
-            _layers.push_back(std::make_shared<YoloXOL>(_roi->get_tensor("yolox_l_leaky/conv113"), _roi->get_tensor("yolox_l_leaky/conv114"),
-                                                        _roi->get_tensor("yolox_l_leaky/conv112"), params->label_offset, format == HAILO_FORMAT_TYPE_UINT16));
+            _layers.emplace_back(_roi->get_tensor("yolox_l_leaky/conv113"), _roi->get_tensor("yolox_l_leaky/conv114"),
+                                 _roi->get_tensor("yolox_l_leaky/conv112"));
 
-            format = _roi->get_tensor("yolox_l_leaky/conv95")->vstream_info().format.type;
-            _layers.push_back(std::make_shared<YoloXOL>(_roi->get_tensor("yolox_l_leaky/conv95"), _roi->get_tensor("yolox_l_leaky/conv96"),
-                                                        _roi->get_tensor("yolox_l_leaky/conv94"), params->label_offset, format == HAILO_FORMAT_TYPE_UINT16));
+            _layers.emplace_back(_roi->get_tensor("yolox_l_leaky/conv95"), _roi->get_tensor("yolox_l_leaky/conv96"),
+                                 _roi->get_tensor("yolox_l_leaky/conv94"));
             params->check_params_logic(get_num_classes());
         }
     };
@@ -434,6 +385,23 @@ void filter(HailoROIPtr roi, void *params_void_ptr)
     yolov5(roi, params);
 }
 
+/**
+ * @brief The output layout of the network a postprocess function decodes.
+ */
+static yolo_layout_t get_layout(const std::string &function_name)
+{
+    if (function_name == "yolov3")
+        return YOLO_LAYOUT_V3;
+    if (function_name == "yolov4")
+        return YOLO_LAYOUT_V4;
+    if (function_name == "tiny_yolov4_license_plates")
+        return YOLO_LAYOUT_TINY_V4;
+    if (function_name == "yolox")
+        return YOLO_LAYOUT_X;
+    // filter and the yolov5 functions
+    return YOLO_LAYOUT_V5;
+}
+
 YoloParams *init(const std::string config_path, const std::string function_name)
 {
     YoloParams *params;
@@ -457,6 +425,7 @@ YoloParams *init(const std::string config_path, const std::string function_name)
             std::cerr << function_name << " network doesn't have default parameters, run might fail" << std::endl;
             params = new YoloParams;
         }
+        params->decoder = &YoloDecoder::select(get_layout(function_name), params->output_activation == "sigmoid");
         return params;
     }
     else
@@ -564,6 +533,7 @@ YoloParams *init(const std::string config_path, const std::string function_name)
         }
         fclose(fp);
     }
+    params->decoder = &YoloDecoder::select(get_layout(function_name), params->output_activation == "sigmoid");
     return params;
 }
 void YoloParams::check_params_logic(uint num_classes_tensors)
@@ -21,7 +21,8 @@ public:
     std::vector<std::vector<int>> anchors_vec;
     std::string output_activation; // can be "none" or "sigmoid"
     int label_offset;
-    YoloParams() : iou_threshold(0.45f), detection_threshold(0.3f), output_activation("none"), label_offset(1) {}
+    const YoloDecoder *decoder; // Selected at init by the function name and the output activation
+    YoloParams() : iou_threshold(0.45f), detection_threshold(0.3f), output_activation("none"), label_offset(1), decoder(nullptr) {}
     void check_params_logic(uint num_classes_tensors);
 };
 
@@ -0,0 +1,147 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#define BFM_POSE_DIM (12)       // 3x4 pose matrix: rotation and scale, and the offset in the last column
+#define BFM_FACES_BLOCK (8)     // Faces projected together, sharing every row of the bases while it is in cache
+#define BFM_VECTOR_ALIGN (16)   // Rows of the packed bases are padded to a multiple of this many floats
+
+/**
+ * @brief Dense projection of 3DMM (Basel Face Model) parameters to 2D landmarks, for a batch of faces.
+ *
+ * For every face the vertices are mean_base + W_SHP_BASE * alpha_shp + W_EXP_BASE * alpha_exp, rotated and
+ * offset by the pose matrix, then flipped and normalized to the face size. The two bases are packed once into a
+ * single transposed matrix, one padded row per alpha, so the vertices of a face are accumulated with contiguous
+ * multiply-adds over whole rows (vectorized by the compiler), and a block of faces is accumulated per row.
+ * Only the landmark vertices are part of the bases, the full mesh is never built.
+ */
+class BfmLandmarksKernel
+{
+private:
+    size_t m_num_points;              // Landmark vertices
+    size_t m_num_coords;              // x,y,z of every vertex
+    size_t m_stride;                  // m_num_coords padded to BFM_VECTOR_ALIGN
+    size_t m_num_alphas;              // Shape and expression alphas
+    size_t m_num_params;              // Pose and alphas
+    std::vector<float> m_bases;       // m_num_alphas rows of m_stride floats: row k is column k of [W_SHP_BASE | W_EXP_BASE]
+    std::vector<float> m_mean_base;   // m_stride floats
+    std::vector<float> m_params_mean;
+    std::vector<float> m_params_std;
+    float m_face_width;
+    float m_face_height;
+
+    void project_block(const float *raw_params, size_t num_faces, float *landmarks,
+                       std::vector<float> &params, std::vector<float> &vertices) const
+    {
+        // Rescale the network outputs to 3DMM parameters
+        for (size_t f = 0; f < num_faces; f++)
+        {
+            for (size_t i = 0; i < m_num_params; i++)
+            {
+                params[f * m_num_params + i] = raw_params[f * m_num_params + i] * m_params_std[i] + m_params_mean[i];
+            }
+            std::copy(m_mean_base.begin(), m_mean_base.end(), vertices.begin() + f * m_stride);
+        }
+
+        // vertices += alpha_k * bases[k], for every alpha and every face of the block
+        for (size_t k = 0; k < m_num_alphas; k++)
+        {
+            const float *__restrict base = m_bases.data() + k * m_stride;
+            for (size_t f = 0; f < num_faces; f++)
+            {
+                const float alpha = params[f * m_num_params + BFM_POSE_DIM + k];
+                float *__restrict face_vertices = vertices.data() + f * m_stride;
+                for (size_t i = 0; i < m_stride; i++)
+                {
+                    face_vertices[i] += alpha * base[i];
+                }
+            }
+        }
+
+        // Rotate and offset x and y (z is not drawn), flip y and normalize to the face
+        for (size_t f = 0; f < num_faces; f++)
+        {
+            const float *pose = params.data() + f * m_num_params;
+            const float *face_vertices = vertices.data() + f * m_stride;
+            float *face_landmarks = landmarks + f * m_num_points * 2;
+            for (size_t v = 0; v < m_num_points; v++)
+            {
+                const float *vertex = face_vertices + v * 3;
+                float x = pose[0] * vertex[0] + pose[1] * vertex[1] + pose[2] * vertex[2] + pose[3];
+                float y = pose[4] * vertex[0] + pose[5] * vertex[1] + pose[6] * vertex[2] + pose[7];
+                face_landmarks[v * 2] = x / m_face_width;
+                face_landmarks[v * 2 + 1] = (m_face_height - y) / m_face_height;
+            }
+        }
+    }
+
+public:
+    /**
+     * @param w_shp_base Shape base, num_points * 3 rows of shp_dim floats (row major).
+     * @param shp_dim Number of shape alphas.
+     * @param w_exp_base Expression base, num_points * 3 rows of exp_dim floats (row major).
+     * @param exp_dim Number of expression alphas.
+     * @param mean_base Mean face, x,y,z of every landmark vertex.
+     * @param num_points Number of landmark vertices.
+     * @param params_mean Mean of the 3DMM parameters, BFM_POSE_DIM + shp_dim + exp_dim floats.
+     * @param params_std Standard deviation of the 3DMM parameters, same size.
+     * @param face_width Width of the face crop the pose is relative to.
+     * @param face_height Height of the face crop the pose is relative to.
+     */
+    BfmLandmarksKernel(const float *w_shp_base, size_t shp_dim, const float *w_exp_base, size_t exp_dim,
+                       const float *mean_base, size_t num_points, const float *params_mean, const float *params_std,
+                       float face_width, float face_height)
+        : m_num_points(num_points), m_num_coords(num_points * 3),
+          m_stride((num_points * 3 + BFM_VECTOR_ALIGN - 1) / BFM_VECTOR_ALIGN * BFM_VECTOR_ALIGN),
+          m_num_alphas(shp_dim + exp_dim), m_num_params(BFM_POSE_DIM + shp_dim + exp_dim),
+          m_bases(m_num_alphas * m_stride, 0.0f), m_mean_base(m_stride, 0.0f),
+          m_params_mean(params_mean, params_mean + m_num_params), m_params_std(params_std, params_std + m_num_params),
+          m_face_width(face_width), m_face_height(face_height)
+    {
+        for (size_t i = 0; i < m_num_coords; i++)
+        {
+            for (size_t k = 0; k < shp_dim; k++)
+            {
+                m_bases[k * m_stride + i] = w_shp_base[i * shp_dim + k];
+            }
+            for (size_t k = 0; k < exp_dim; k++)
+            {
+                m_bases[(shp_dim + k) * m_stride + i] = w_exp_base[i * exp_dim + k];
+            }
+        }
+        std::copy(mean_base, mean_base + m_num_coords, m_mean_base.begin());
+    }
+
+    size_t num_params() const
+    {
+        return m_num_params;
+    }
+
+    size_t num_points() const
+    {
+        return m_num_points;
+    }
+
+    /**
+     * @brief Project the parameters of a batch of faces to landmarks.
+     *
+     * @param raw_params num_faces * num_params() dequantized network outputs, face after face.
+     * @param num_faces Number of faces.
+     * @param landmarks num_faces * num_points() * 2 floats, the x,y of every landmark relative to its face.
+     */
+    void project(const float *raw_params, size_t num_faces, float *landmarks) const
+    {
+        std::vector<float> params(BFM_FACES_BLOCK * m_num_params);
+        std::vector<float> vertices(BFM_FACES_BLOCK * m_stride);
+        for (size_t first = 0; first < num_faces; first += BFM_FACES_BLOCK)
+        {
+            size_t block = std::min<size_t>(BFM_FACES_BLOCK, num_faces - first);
+            project_block(raw_params + first * m_num_params, block, landmarks + first * m_num_points * 2, params, vertices);
+        }
+    }
+};
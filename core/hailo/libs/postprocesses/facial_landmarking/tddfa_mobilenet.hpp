@@ -3,6 +3,7 @@
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
 #pragma once
+#include <vector>
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
@@ -13,4 +14,9 @@ void filter(HailoROIPtr roi);
 void facial_landmarks_merged(HailoROIPtr roi);
 void facial_landmarks_yuy2(HailoROIPtr roi);
 void facial_landmarks_nv12(HailoROIPtr roi);
+// Batched variants, called with all the face crops of a frame.
+void filter_batch(std::vector<HailoROIPtr> &rois);
+void facial_landmarks_merged_batch(std::vector<HailoROIPtr> &rois);
+void facial_landmarks_yuy2_batch(std::vector<HailoROIPtr> &rois);
+void facial_landmarks_nv12_batch(std::vector<HailoROIPtr> &rois);
 __END_DECLS
\ No newline at end of file
@@ -0,0 +1,299 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "hailo_objects.hpp"
+#include "common/quantized.hpp"
+
+/**
+ * CTC decoding of the OCR output, on the quantized scores in place.
+ *
+ * The output is (height, time steps, classes): the scores of a time step are summed over the height as
+ * integers (the mean of the network is the sum with qp_scale / height), and one of the classes is the blank.
+ * - Greedy decoding takes the argmax of every step and collapses repeats and blanks. The softmax confidence
+ *   is only computed at the steps that emit a char.
+ * - Beam decoding is a CTC prefix beam search over the few chars that are likely at each step, optionally
+ *   constrained to plate formats: a prefix that can't start any format is dropped, and the text must
+ *   match a whole format.
+ * Either way the confidence of the text is the mean probability of its chars, each at the step it was emitted.
+ */
+
+// Plate format chars, any other char must match as is
+#define CTC_FORMAT_ANY_DIGIT '#'
+#define CTC_FORMAT_ANY_LETTER '@'
+#define CTC_FORMAT_ANY_CHAR '*'
+#define CTC_MAX_FORMATS (64)
+
+class CTCDecoderParams
+{
+public:
+    std::vector<char> alphabet;       // The char of every class
+    int blank;                        // Index of the blank class, -1 for the last class
+    uint beam_width;                  // Number of beams, 1 for greedy decoding
+    float prune_probability;          // Beam search only expands chars at least this likely at a step
+    std::vector<std::string> formats; // Plate formats the text must match (beam only), empty for any text
+    CTCDecoderParams() : blank(-1), beam_width(1), prune_probability(0.001f) {}
+};
+
+struct CTCResult
+{
+    std::string text;
+    float confidence; // Mean probability of the chars, 0 for an empty text
+};
+
+class CTCDecoder
+{
+private:
+    struct Beam
+    {
+        std::string prefix;
+        int last;             // Class of the last char of the prefix, -1 for the empty prefix
+        float blank;          // Probability of the paths of the prefix that end with a blank
+        float non_blank;      // Probability of the paths of the prefix that end with its last char
+        float best_paths;     // Probability of the paths that set the confidence
+        float confidence_sum; // Sum of the probabilities of the chars, each at the step it was emitted
+        uint64_t formats;     // The formats the prefix can still become
+
+        float total() const { return blank + non_blank; }
+    };
+
+    CTCDecoderParams m_params;
+    int m_blank;
+    uint64_t m_all_formats;
+    std::vector<std::vector<uint64_t>> m_allowed;  // [position][class], the formats that accept the class at that position
+    std::vector<uint64_t> m_complete;              // [length], the formats of that length
+
+    // Scratch buffers, kept between decodes
+    std::vector<uint32_t> m_sums;
+    std::vector<float> m_probabilities;
+    std::vector<int> m_candidates;
+    std::vector<Beam> m_beams;
+    std::vector<Beam> m_next_beams;
+
+    static bool format_accepts(char format_char, char c)
+    {
+        switch (format_char)
+        {
+        case CTC_FORMAT_ANY_DIGIT:
+            return c >= '0' && c <= '9';
+        case CTC_FORMAT_ANY_LETTER:
+            return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+        case CTC_FORMAT_ANY_CHAR:
+            return true;
+        default:
+            return format_char == c;
+        }
+    }
+
+    /**
+     * @brief Adds paths to a beam of the next step. Paths of different beams can reach the same prefix,
+     *        the confidence is taken from the most likely ones.
+     */
+    void add_paths(const std::string &prefix, int last, uint64_t formats, float blank, float non_blank, float confidence_sum)
+    {
+        auto beam = std::find_if(m_next_beams.begin(), m_next_beams.end(), [&prefix](const Beam &b) { return b.prefix == prefix; });
+        if (beam == m_next_beams.end())
+        {
+            m_next_beams.push_back({prefix, last, 0.0f, 0.0f, 0.0f, 0.0f, formats});
+            beam = m_next_beams.end() - 1;
+        }
+        beam->blank += blank;
+        beam->non_blank += non_blank;
+        if (blank + non_blank > beam->best_paths)
+        {
+            beam->best_paths = blank + non_blank;
+            beam->confidence_sum = confidence_sum;
+        }
+    }
+
+    bool is_complete(const Beam &beam) const
+    {
+        return beam.prefix.size() < m_complete.size() && (beam.formats & m_complete[beam.prefix.size()]) != 0;
+    }
+
+    template <typename T>
+    CTCResult decode_greedy(const T *scores, int steps, int classes, const common::QuantizedSoftmax &softmax)
+    {
+        CTCResult result = {"", 0.0f};
+        float confidence_sum = 0.0f;
+        int previous = m_blank;
+        for (int step = 0; step < steps; step++)
+        {
+            const T *step_scores = scores + step * classes;
+            int best = common::quantized_argmax(step_scores, classes);
+            if (best != m_blank && best != previous)
+            {
+                result.text.push_back(m_params.alphabet[best]);
+                confidence_sum += 1.0f / softmax.sum(step_scores, classes, step_scores[best]);
+            }
+            previous = best;
+        }
+        if (!result.text.empty())
+            result.confidence = confidence_sum / result.text.size();
+        return result;
+    }
+
+    template <typename T>
+    CTCResult decode_beam(const T *scores, int steps, int classes, const common::QuantizedSoftmax &softmax)
+    {
+        m_probabilities.resize(classes);
+        m_beams.clear();
+        m_beams.push_back({"", -1, 1.0f, 0.0f, 0.0f, 0.0f, m_all_formats});
+
+        for (int step = 0; step < steps; step++)
+        {
+            softmax.softmax(scores + step * classes, classes, m_probabilities.data());
+            m_candidates.clear();
+            for (int c = 0; c < classes; c++)
+            {
+                if (c != m_blank && m_probabilities[c] >= m_params.prune_probability)
+                    m_candidates.push_back(c);
+            }
+
+            m_next_beams.clear();
+            for (const Beam &beam : m_beams)
+            {
+                const size_t length = beam.prefix.size();
+                // The prefix stays the same: a blank, or a repeat of its last char
+                add_paths(beam.prefix, beam.last, beam.formats, beam.total() * m_probabilities[m_blank],
+                          (beam.last < 0) ? 0.0f : beam.non_blank * m_probabilities[beam.last], beam.confidence_sum);
+
+                // The prefix is extended by a char
+                for (int c : m_candidates)
+                {
+                    uint64_t formats = beam.formats;
+                    if (m_all_formats != 0)
+                    {
+                        formats &= (length < m_allowed.size()) ? m_allowed[length][c] : 0;
+                        if (formats == 0)
+                            continue;
+                    }
+                    // A repeated char needs a blank in between, otherwise it collapses
+                    float probability = ((c == beam.last) ? beam.blank : beam.total()) * m_probabilities[c];
+                    if (probability <= 0.0f)
+                        continue;
+                    std::string prefix = beam.prefix;
+                    prefix.push_back(m_params.alphabet[c]);
+                    add_paths(prefix, c, formats, 0.0f, probability, beam.confidence_sum + m_probabilities[c]);
+                }
+            }
+
+            // Keep the most likely beams, rescaled so long texts don't underflow
+            size_t kept = std::min<size_t>(m_params.beam_width, m_next_beams.size());
+            std::partial_sort(m_next_beams.begin(), m_next_beams.begin() + kept, m_next_beams.end(),
+                              [](const Beam &a, const Beam &b) { return a.total() > b.total(); });
+            m_next_beams.resize(kept);
+            float scale = m_next_beams.front().total();
+            for (Beam &beam : m_next_beams)
+            {
+                if (scale <= 0.0f)
+                    break;
+                beam.blank /= scale;
+                beam.non_blank /= scale;
+            }
+            std::swap(m_beams, m_next_beams);
+        }
+
+        // The beams are sorted, the first one that is a whole format wins
+        for (const Beam &beam : m_beams)
+        {
+            if (m_all_formats != 0 && !is_complete(beam))
+                continue;
+            if (beam.prefix.empty())
+                break;
+            return {beam.prefix, beam.confidence_sum / beam.prefix.size()};
+        }
+        return {"", 0.0f};
+    }
+
+    template <typename T>
+    CTCResult decode_scores(const T *scores, int steps, int classes, const common::QuantizedSoftmax &softmax)
+    {
+        if (m_params.beam_width <= 1)
+            return decode_greedy(scores, steps, classes, softmax);
+        return decode_beam(scores, steps, classes, softmax);
+    }
+
+    template <typename T>
+    CTCResult decode_tensor(HailoTensorPtr &tensor)
+    {
+        const T *data = common::tensor_data<T>(tensor);
+        const int height = tensor->height();
+        const int steps = tensor->width();
+        const int classes = tensor->features();
+        const common::QuantizedSoftmax &softmax = common::QuantizedSoftmax::cached(tensor->vstream_info().quant_info.qp_scale / height,
+                                                                                   height * std::numeric_limits<T>::max());
+        if (height == 1)
+            return decode_scores(data, steps, classes, softmax);
+
+        // Sum the rows, the mean is applied through the softmax scale
+        const int row_size = steps * classes;
+        m_sums.assign(data, data + row_size);
+        for (int row = 1; row < height; row++)
+        {
+            const T *row_data = data + row * row_size;
+            for (int i = 0; i < row_size; i++)
+                m_sums[i] += row_data[i];
+        }
+        return decode_scores(m_sums.data(), steps, classes, softmax);
+    }
+
+public:
+    CTCDecoder(const CTCDecoderParams &params) : m_params(params), m_all_formats(0)
+    {
+        m_blank = (m_params.blank < 0) ? int(m_params.alphabet.size()) - 1 : m_params.blank;
+        if (m_params.formats.size() > CTC_MAX_FORMATS)
+            throw std::invalid_argument("CTCDecoder: at most " + std::to_string(CTC_MAX_FORMATS) + " plate formats are supported");
+
+        for (size_t f = 0; f < m_params.formats.size(); f++)
+        {
+            const std::string &format = m_params.formats[f];
+            const uint64_t bit = uint64_t(1) << f;
+            m_all_formats |= bit;
+            if (m_allowed.size() < format.size())
+                m_allowed.resize(format.size(), std::vector<uint64_t>(m_params.alphabet.size(), 0));
+            if (m_complete.size() <= format.size())
+                m_complete.resize(format.size() + 1, 0);
+            m_complete[format.size()] |= bit;
+            for (size_t position = 0; position < format.size(); position++)
+            {
+                for (size_t c = 0; c < m_params.alphabet.size(); c++)
+                {
+                    if (int(c) != m_blank && format_accepts(format[position], m_params.alphabet[c]))
+                        m_allowed[position][c] |= bit;
+                }
+            }
+        }
+    }
+
+    const CTCDecoderParams &params() const { return m_params; }
+
+    /**
+     * @brief Decodes the text of an OCR output tensor, uint8 or uint16.
+     */
+    CTCResult decode(HailoTensorPtr tensor)
+    {
+        if (common::is_uint16(tensor))
+            return decode_tensor<uint16_t>(tensor);
+        return decode_tensor<uint8_t>(tensor);
+    }
+
+    /**
+     * @brief Decodes the texts of all the plates of a frame, reusing the buffers and softmax tables between them.
+     */
+    void decode_batch(std::vector<HailoTensorPtr> &tensors, std::vector<CTCResult> &results)
+    {
+        results.clear();
+        results.reserve(tensors.size());
+        for (HailoTensorPtr &tensor : tensors)
+            results.emplace_back(decode(tensor));
+    }
+};
@@ -2,96 +2,144 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <iostream>
+#include <string>
 #include <vector>
 
-#include "xtensor/xarray.hpp"
-#include "xtensor/xtensor.hpp"
-#include "xtensor/xsort.hpp"
-#include "common/tensors.hpp"
-#include "common/math.hpp"
+#include "ctc_decoder.hpp"
 #include "ocr_postprocess.hpp"
 
 #define MIN_SCORE_THRESHOLD (0.90) // Min score threshold
 #define MIN_CHARS (6)              // Min number of characters
+#define BEAM_WIDTH (4)             // Number of beams of the beam search decoding
 
 const char *DEFAULT_OUTPUT_LAYER_NAME = "lprnet/conv31";
 const char *OUTPUT_LAYER_NAME_NV12 = "lprnet_304x75/conv31";
 
+// The plate formats of the beam search decoding ('#' is any digit, '@' any letter, see ctc_decoder.hpp)
+const std::vector<std::string> PLATE_FORMATS = {"#######", "########"};
+
+CTCDecoderParams ocr_decoder_params(bool beam_search)
+{
+    CTCDecoderParams params;
+    params.alphabet = AVAILABLE_CHARS;
+    if (beam_search)
+    {
+        params.beam_width = BEAM_WIDTH;
+        params.formats = PLATE_FORMATS;
+    }
+    return params;
+}
+
 /**
- * @brief recognize the characters that are in the license plate
- *
- * @param roi holds the network output data
+ * @brief The decoder of a decoding mode, one per thread as it keeps its buffers between plates.
  */
-void OCR_postprocess(HailoROIPtr roi, const char *layer_name)
+CTCDecoder &get_decoder(bool beam_search)
+{
+    thread_local CTCDecoder greedy_decoder(ocr_decoder_params(false));
+    thread_local CTCDecoder beam_decoder(ocr_decoder_params(true));
+    return beam_search ? beam_decoder : greedy_decoder;
+}
+
+HailoTensorPtr get_ocr_tensor(HailoROIPtr roi, const char *layer_name)
 {
     if (!roi->has_tensors())
     {
-        return;
+        return nullptr;
     }
     HailoTensorPtr net_output = roi->get_tensor(layer_name);
     if (nullptr == net_output)
     {
         std::cerr << "OCR_postprocess: No output tensor found" << std::endl;
-        return;
     }
+    return net_output;
+}
 
-    xt::xarray<float> output_dequantize;
-    output_dequantize = common::get_xtensor_float(net_output);
-
-    xt::xarray<float> prebs = xt::mean(output_dequantize, 0);
-    xt::xarray<int> preb_label = xt::argmax(prebs, 1);
-
-    common::softmax_2D(prebs.data(), prebs.shape(0), prebs.shape(1));
-    xt::xarray<float> conf_label = xt::amax(prebs, {1});
-
-    std::vector<int> no_repeat_label_index;
-    // this will hold the indices of the recognized chars, from the AVAILABLE_CHARS vector declared in the hpp file
-    std::vector<float> no_repeat_label_conf;
-    // this will hold the confidence of the recognized chars
-    std::ostringstream no_repeat_label;
-    // this will hold the the recognized chars, from the AVAILABLE_CHARS vector declared in the hpp file
+void add_ocr_result(HailoROIPtr roi, const CTCResult &result)
+{
+    if (result.confidence >= MIN_SCORE_THRESHOLD && result.text.size() > MIN_CHARS)
+    {
+        hailo_common::add_classification(roi, std::string("ocr"), result.text, result.confidence);
+    }
+}
 
-    int pre_char_index = preb_label[0];
-    if (int(pre_char_index) != int(AVAILABLE_CHARS.size()) - 1)
-    // the index is not the index of the "-" (the "-" char means this is not a valid char)
+/**
+ * @brief recognize the characters that are in the license plate
+ *
+ * @param roi holds the network output data
+ * @param layer_name the name of the output layer
+ * @param beam_search decode with a beam search constrained to PLATE_FORMATS, instead of greedy decoding
+ */
+void OCR_postprocess(HailoROIPtr roi, const char *layer_name, bool beam_search)
+{
+    HailoTensorPtr net_output = get_ocr_tensor(roi, layer_name);
+    if (nullptr == net_output)
     {
-        no_repeat_label_index.push_back(pre_char_index);
-        no_repeat_label << AVAILABLE_CHARS[pre_char_index];
-        no_repeat_label_conf.push_back(conf_label[0]);
+        return;
     }
+    add_ocr_result(roi, get_decoder(beam_search).decode(net_output));
+}
 
-    for (int i = 0; i < int(preb_label.size()); i++)
-    // this loop removes non valid chars
+/**
+ * @brief recognize the characters of all the license plates of a frame
+ */
+void OCR_postprocess_batch(std::vector<HailoROIPtr> &rois, const char *layer_name, bool beam_search)
+{
+    std::vector<HailoROIPtr> plates;
+    std::vector<HailoTensorPtr> tensors;
+    for (HailoROIPtr &roi : rois)
     {
-        if ((pre_char_index == int(preb_label[i])) || (int(preb_label[i]) == int(AVAILABLE_CHARS.size()) - 1))
-        {
-            if (int(preb_label[i]) == int(AVAILABLE_CHARS.size()) - 1)
-            {
-                pre_char_index = preb_label[i];
-                // no push to final classification
-            }
+        HailoTensorPtr net_output = get_ocr_tensor(roi, layer_name);
+        if (nullptr == net_output)
             continue;
-        }
-        no_repeat_label_index.push_back(preb_label[i]);
-        no_repeat_label << AVAILABLE_CHARS[preb_label[i]];
-        no_repeat_label_conf.push_back(conf_label[i]);
-
-        pre_char_index = preb_label[i];
+        plates.emplace_back(roi);
+        tensors.emplace_back(net_output);
     }
 
-    float conf_mean = std::accumulate(no_repeat_label_conf.begin(), no_repeat_label_conf.end(), 0.0) / no_repeat_label_conf.size();
-    if (conf_mean >= MIN_SCORE_THRESHOLD && no_repeat_label.str().size() > MIN_CHARS)
+    std::vector<CTCResult> results;
+    get_decoder(beam_search).decode_batch(tensors, results);
+    for (size_t i = 0; i < plates.size(); i++)
     {
-        hailo_common::add_classification(roi, std::string("ocr"), no_repeat_label.str(), conf_mean);
+        add_ocr_result(plates[i], results[i]);
     }
 }
 
 void filter(HailoROIPtr roi)
 {
-    OCR_postprocess(roi, DEFAULT_OUTPUT_LAYER_NAME);
+    OCR_postprocess(roi, DEFAULT_OUTPUT_LAYER_NAME, false);
 }
 
 void lprnet_nv12(HailoROIPtr roi)
 {
-    OCR_postprocess(roi, OUTPUT_LAYER_NAME_NV12);
+    OCR_postprocess(roi, OUTPUT_LAYER_NAME_NV12, false);
+}
+
+void filter_beam(HailoROIPtr roi)
+{
+    OCR_postprocess(roi, DEFAULT_OUTPUT_LAYER_NAME, true);
+}
+
+void lprnet_nv12_beam(HailoROIPtr roi)
+{
+    OCR_postprocess(roi, OUTPUT_LAYER_NAME_NV12, true);
+}
+
+void filter_batch(std::vector<HailoROIPtr> &rois)
+{
+    OCR_postprocess_batch(rois, DEFAULT_OUTPUT_LAYER_NAME, false);
+}
+
+void lprnet_nv12_batch(std::vector<HailoROIPtr> &rois)
+{
+    OCR_postprocess_batch(rois, OUTPUT_LAYER_NAME_NV12, false);
+}
+
+void filter_beam_batch(std::vector<HailoROIPtr> &rois)
+{
+    OCR_postprocess_batch(rois, DEFAULT_OUTPUT_LAYER_NAME, true);
+}
+
+void lprnet_nv12_beam_batch(std::vector<HailoROIPtr> &rois)
+{
+    OCR_postprocess_batch(rois, OUTPUT_LAYER_NAME_NV12, true);
 }
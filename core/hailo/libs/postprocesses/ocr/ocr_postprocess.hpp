@@ -3,11 +3,18 @@
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
 #pragma once
+#include <vector>
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 __BEGIN_DECLS
 void filter(HailoROIPtr roi);
 void lprnet_nv12(HailoROIPtr roi);
+void filter_beam(HailoROIPtr roi);
+void lprnet_nv12_beam(HailoROIPtr roi);
+void filter_batch(std::vector<HailoROIPtr> &rois);
+void lprnet_nv12_batch(std::vector<HailoROIPtr> &rois);
+void filter_beam_batch(std::vector<HailoROIPtr> &rois);
+void lprnet_nv12_beam_batch(std::vector<HailoROIPtr> &rois);
 std::vector<char> AVAILABLE_CHARS{'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '-'};
 
 __END_DECLS
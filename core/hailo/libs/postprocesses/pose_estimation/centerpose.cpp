@@ -16,6 +16,7 @@
 #include "common/tensors.hpp"
 #include "common/math.hpp"
 #include "common/nms.hpp"
+#include "common/heatmap.hpp"
 
 #include "xtensor/xadapt.hpp"
 #include "xtensor/xarray.hpp"
@@ -90,148 +91,60 @@ xt::xarray<int> map_to_flat_indices(const xt::xarray<int> &array_to_map, const x
 }
 
 /**
- * @brief Top K function
+ * @brief get top k cells of a single channel heatmap
  *
- * @param array array
- * @param k take k best results
- * @return xt::xarray<int>
+ * @param scores output tensor of scores
+ * @param k take k best scores and ignore the others
+ * @return std::pair<xt::xarray<int>, xt::xarray<T>> pair of indices of scores and scores
  */
-xt::xarray<int> nd_topk(xt::xarray<float> &array, const int k)
+template <typename T>
+std::pair<xt::xarray<int>, xt::xarray<T>> top_k_centers(HailoTensorPtr scores, const int k)
 {
-    // Since top_k partitions on a flattened array (xt::xnone()),
-    // for arrays of more than 1 row we must topk for each row.
-    int rows = array.shape(0);
-    int cols = array.shape(1);
-    xt::xarray<int> indices = xt::empty<int>({rows, k}); // prepare an empty array to fill
-    for (int index = 0; index < rows; index++)
-    {
-        // For each row, get the topk of the row, and add cols*index to get true flat indices
-        xt::xarray<uint8_t> expanded_row = xt::expand_dims(xt::row(array, index), 0);
-        xt::row(indices, index) = xt::flatten(common::top_k(expanded_row, k)) + (cols * index);
-    }
-    return indices;
-}
+    std::vector<common::HeatmapPeak> peaks;
+    common::heatmap_top_k((const T *)scores->data(), scores->width(), scores->height(), scores->features(), 0, k, peaks);
 
-xt::xarray<int> nd_topk_uint16(xt::xarray<float> &array, const int k)
-{
-    // Since top_k partitions on a flattened array (xt::xnone()),
-    // for arrays of more than 1 row we must topk for each row.
-    int rows = array.shape(0);
-    int cols = array.shape(1);
-    xt::xarray<int> indices = xt::empty<int>({rows, k}); // prepare an empty array to fill
-    for (int index = 0; index < rows; index++)
+    xt::xarray<int> topk_score_indices = xt::empty<int>({(int)peaks.size()});
+    xt::xarray<T> topk_scores = xt::empty<T>({(int)peaks.size()});
+    for (size_t i = 0; i < peaks.size(); i++)
     {
-        // For each row, get the topk of the row, and add cols*index to get true flat indices
-        xt::xarray<uint16_t> expanded_row = xt::expand_dims(xt::row(array, index), 0);
-        xt::row(indices, index) = xt::flatten(common::top_k(expanded_row, k)) + (cols * index);
+        topk_score_indices(i) = peaks[i].index;
+        topk_scores(i) = (T)peaks[i].value;
     }
-    return indices;
-}
-
-/**
- * @brief get top k centers
- *
- * @param scores output tensors of scores
- * @param k take k best scores and ignore the others
- * @return std::pair<xt::xarray<int>, xt::xarray<uint8_t>> pair of indices of scores and scores
- */
-std::pair<xt::xarray<int>, xt::xarray<uint8_t>> top_k_centers(HailoTensorPtr scores, const int k)
-{
-    // Adapt the tensor into an xarray of proper shape and size
-    auto xscores = common::get_xtensor(scores);
-
-    // Get the indices of the top k scoring cells
-    int size = scores->size();
-    xt::xarray<uint8_t> xscores_view = xt::reshape_view(xscores, {1, size});
-    xt::xarray<int> topk_score_indices = common::top_k(xscores_view, k);
-    topk_score_indices = xt::flatten(topk_score_indices);
-
-    // We want a flattened view of the scores to sort by
-    auto flat_scores = xt::flatten(xscores);
-
-    // Using the top k indices, get the top k scores
-    auto topk_scores = xt::view(flat_scores, xt::keep(topk_score_indices));
 
     // Return the top scores and their indices
-    return std::pair<xt::xarray<int>, xt::xarray<uint8_t>>(std::move(topk_score_indices), std::move(topk_scores));
-}
-
-std::pair<xt::xarray<int>, xt::xarray<uint16_t>> top_k_centers_uint16(HailoTensorPtr scores, const int k)
-{
-    // Adapt the tensor into an xarray of proper shape and size
-    auto xscores = common::get_xtensor_uint16(scores);
-
-    // Get the indices of the top k scoring cells
-    int size = scores->size();
-    xt::xarray<uint16_t> xscores_view = xt::reshape_view(xscores, {1, size});
-    xt::xarray<int> topk_score_indices = common::top_k(xscores_view, k);
-    topk_score_indices = xt::flatten(topk_score_indices);
-
-    // We want a flattened view of the scores to sort by
-    auto flat_scores = xt::flatten(xscores);
-
-    // Using the top k indices, get the top k scores
-    auto topk_scores = xt::view(flat_scores, xt::keep(topk_score_indices));
-
-    // Return the top scores and their indices
-    return std::pair<xt::xarray<int>, xt::xarray<uint16_t>>(std::move(topk_score_indices), std::move(topk_scores));
+    return std::pair<xt::xarray<int>, xt::xarray<T>>(std::move(topk_score_indices), std::move(topk_scores));
 }
 
 /**
- * @brief get top k joints
+ * @brief get top k joints, the top k cells of every channel (joint) of the heatmap
  *
  * @param joint_scores output tensors of scores
  * @param k take k best scores and ignore the others
- * @return std::pair<xt::xarray<int>, xt::xarray<uint8_t>> pair of indices of scores and scores
+ * @return std::pair<xt::xarray<int>, xt::xarray<T>> pair of indices of scores and scores, of shape {joints, k}.
+ *         The indices are of a {joints, height * width} heatmap.
  */
-std::pair<xt::xarray<int>, xt::xarray<uint8_t>> top_k_joints(HailoTensorPtr joint_scores, const int k)
+template <typename T>
+std::pair<xt::xarray<int>, xt::xarray<T>> top_k_joints(HailoTensorPtr joint_scores, const int k)
 {
-    // Adapt the tensor into an xarray of proper shape and size
-    auto xjoint_scores = common::get_xtensor(joint_scores);
-    // Transpose the joints so that we lead by joint class {17, 160, 160} instead of {160, 160, 17}
-    auto transposed_scores = xt::transpose(xjoint_scores, {2, 0, 1});
-    // Create a reshape view that we can sort by {17, 160, 160} --> {17, 25600}
-    xt::xarray<float> scores_to_sort = xt::reshape_view(transposed_scores,
-                                                        {joint_scores->features(), joint_scores->width() * joint_scores->height()});
-
-    // Get the indices of the top k scoring cells
-    auto topk_score_indices = nd_topk(scores_to_sort, k);
-    auto topk_score_indices_flat = xt::flatten(topk_score_indices);
-
-    // Using the top k indices, get the top k scores
-    // We use a reshaped view of the scores from {17, 25600} to {435200} so that when we take using topk_score_indices,
-    // we take {340} (17 * 20) instead of {17, 340}. We return a reshaped view that reformats back to proper {17, 20}.
-    auto scores_to_sort_flat = xt::flatten(scores_to_sort);
-    auto topk_scores_flat = xt::view(scores_to_sort_flat, xt::keep(topk_score_indices_flat));
-    auto topk_scores = xt::reshape_view(topk_scores_flat, {(int)joint_scores->features(), k});
-
-    // Return the top scores and their indices
-    return std::pair<xt::xarray<int>, xt::xarray<uint8_t>>(std::move(topk_score_indices), std::move(topk_scores));
-}
-
-std::pair<xt::xarray<int>, xt::xarray<uint16_t>> top_k_joints_uint16(HailoTensorPtr joint_scores, const int k)
-{
-    // Adapt the tensor into an xarray of proper shape and size
-    auto xjoint_scores = common::get_xtensor_uint16(joint_scores);
-    // Transpose the joints so that we lead by joint class {17, 160, 160} instead of {160, 160, 17}
-    auto transposed_scores = xt::transpose(xjoint_scores, {2, 0, 1});
-    // Create a reshape view that we can sort by {17, 160, 160} --> {17, 25600}
-    xt::xarray<float> scores_to_sort = xt::reshape_view(transposed_scores,
-                                                        {joint_scores->features(), joint_scores->width() * joint_scores->height()});
-
-    // Get the indices of the top k scoring cells
-    auto topk_score_indices = nd_topk_uint16(scores_to_sort, k);
-    auto topk_score_indices_flat = xt::flatten(topk_score_indices);
-
-    // Using the top k indices, get the top k scores
-    // We use a reshaped view of the scores from {17, 25600} to {435200} so that when we take using topk_score_indices,
-    // we take {340} (17 * 20) instead of {17, 340}. We return a reshaped view that reformats back to proper {17, 20}.
-    auto scores_to_sort_flat = xt::flatten(scores_to_sort);
-    auto topk_scores_flat = xt::view(scores_to_sort_flat, xt::keep(topk_score_indices_flat));
-    auto topk_scores = xt::reshape_view(topk_scores_flat, {(int)joint_scores->features(), k});
+    const int num_joints = joint_scores->features();
+    const int cells = joint_scores->width() * joint_scores->height();
+    xt::xarray<int> topk_score_indices = xt::empty<int>({num_joints, k});
+    xt::xarray<T> topk_scores = xt::empty<T>({num_joints, k});
+
+    // Every channel is searched in place in the HWC tensor, there is no transposed copy
+    std::vector<common::HeatmapPeak> peaks;
+    for (int joint = 0; joint < num_joints; joint++)
+    {
+        common::heatmap_top_k((const T *)joint_scores->data(), joint_scores->width(), joint_scores->height(), num_joints, joint, k, peaks);
+        for (int i = 0; i < k; i++)
+        {
+            topk_score_indices(joint, i) = peaks[i].index + cells * joint;
+            topk_scores(joint, i) = (T)peaks[i].value;
+        }
+    }
 
     // Return the top scores and their indices
-    return std::pair<xt::xarray<int>, xt::xarray<uint16_t>>(std::move(topk_score_indices), std::move(topk_scores));
+    return std::pair<xt::xarray<int>, xt::xarray<T>>(std::move(topk_score_indices), std::move(topk_scores));
 }
 
 /**
@@ -383,7 +296,7 @@ std::vector<HailoDetection> centerpose_postprocess(HailoROIPtr roi,
 
     if (output_layers["center_heatmap"].second) // uint16
     {
-        auto top_scores = top_k_centers_uint16(center_heatmap, k);           // Returns both the top scores and their indices
+        auto top_scores = top_k_centers<uint16_t>(center_heatmap, k);        // Returns both the top scores and their indices
         topk_score_indices = top_scores.first;                               // Separate out the top score indices
         xt::xarray<uint16_t> topk_scores = top_scores.second;                // Separate out the top scores
         topk_scores_y_index = topk_score_indices / center_heatmap->height(); // Find the y index of the cells
@@ -411,7 +324,7 @@ std::vector<HailoDetection> centerpose_postprocess(HailoROIPtr roi,
 
     else
     {
-        auto top_scores = top_k_centers(center_heatmap, k);                  // Returns both the top scores and their indices
+        auto top_scores = top_k_centers<uint8_t>(center_heatmap, k);         // Returns both the top scores and their indices
         topk_score_indices = top_scores.first;                               // Separate out the top score indices
         xt::xarray<uint8_t> topk_scores = top_scores.second;                 // Separate out the top scores
         topk_scores_y_index = topk_score_indices / center_heatmap->height(); // Find the y index of the cells
@@ -447,14 +360,14 @@ std::vector<HailoDetection> centerpose_postprocess(HailoROIPtr roi,
 
     if (output_layers["joint_heatmap"].second) // uint16
     {
-        auto top_k_joint_heatmap = top_k_joints_uint16(joint_heatmap, k); // Returns both the top scores and their indices
+        auto top_k_joint_heatmap = top_k_joints<uint16_t>(joint_heatmap, k); // Returns both the top scores and their indices
         topk_joint_heatmap_indices = top_k_joint_heatmap.first;           // Separate out the top score indices
         topk_joint_score_rescaled = common::dequantize(top_k_joint_heatmap.second,
                                                        joint_heatmap->vstream_info().quant_info.qp_scale, joint_heatmap->vstream_info().quant_info.qp_zp);
     }
     else
     {
-        auto top_k_joint_heatmap = top_k_joints(joint_heatmap, k); // Returns both the top scores and their indices
+        auto top_k_joint_heatmap = top_k_joints<uint8_t>(joint_heatmap, k); // Returns both the top scores and their indices
         topk_joint_heatmap_indices = top_k_joint_heatmap.first;    // Separate out the top score indices
         topk_joint_score_rescaled = common::dequantize(top_k_joint_heatmap.second,
                                                        joint_heatmap->vstream_info().quant_info.qp_scale, joint_heatmap->vstream_info().quant_info.qp_zp);
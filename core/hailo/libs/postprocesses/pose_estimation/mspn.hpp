@@ -3,6 +3,7 @@
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
 #pragma once
+#include <vector>
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
@@ -18,6 +19,7 @@ public:
 
 void mspn(HailoROIPtr roi);
 void filter(HailoROIPtr roi, void *params_void_ptr);
+void filter_batch(std::vector<HailoROIPtr> &rois, void *params_void_ptr);
 void free_resources(void *params_void_ptr);
 MSPNParams *init(const std::string config_path);
 __END_DECLS
\ No newline at end of file
@@ -2,6 +2,7 @@
  * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
  * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
  **/
+#include <cmath>
 #include <vector>
 #include "common/tensors.hpp"
 #include "common/math.hpp"
@@ -52,6 +53,57 @@ void arcface(HailoROIPtr roi, std::string layer_name)
     }
 }
 
+/**
+ * @brief Embeddings of the crops of a frame. Every embedding is dequantized and normalized in a single pass
+ *        over the quantized tensor, without intermediate xarrays.
+ */
+void arcface_batch(std::vector<HailoROIPtr> &rois, std::string layer_name)
+{
+    for (auto &roi : rois)
+    {
+        if (!roi->has_tensors())
+            continue;
+
+        std::string jde_tracker_name = tracker_name + "_" + roi->get_stream_id();
+        auto unique_ids = hailo_common::get_hailo_track_id(roi);
+        // Remove previous matrices
+        if (unique_ids.empty())
+            roi->remove_objects_typed(HAILO_MATRIX);
+        else
+            HailoTracker::GetInstance().remove_matrices_from_track(jde_tracker_name, unique_ids[0]->get_id());
+
+        auto tensor = roi->get_tensor(layer_name);
+        const uint8_t *data = tensor->data();
+        const float scale = tensor->vstream_info().quant_info.qp_scale;
+        const float zp = tensor->vstream_info().quant_info.qp_zp;
+        std::vector<float> embedding(tensor->size());
+        float sum_squared = 0.0f;
+        for (size_t i = 0; i < embedding.size(); i++)
+        {
+            embedding[i] = (float(data[i]) - zp) * scale;
+            sum_squared += embedding[i] * embedding[i];
+        }
+        const float inverse_norm = 1.0f / std::sqrt(sum_squared);
+        for (float &value : embedding)
+        {
+            value *= inverse_norm;
+        }
+
+        HailoMatrixPtr hailo_matrix = std::make_shared<HailoMatrix>(std::move(embedding), tensor->height(), tensor->width(), tensor->features());
+        if (unique_ids.empty())
+        {
+            roi->add_object(hailo_matrix);
+        }
+        else
+        {
+            // Update the tracker with the results
+            HailoTracker::GetInstance().add_object_to_track(jde_tracker_name,
+                                                            unique_ids[0]->get_id(),
+                                                            hailo_matrix);
+        }
+    }
+}
+
 void arcface_rgb(HailoROIPtr roi)
 {
     arcface(roi, OUTPUT_LAYER_NAME_RGB);
@@ -71,3 +123,23 @@ void filter(HailoROIPtr roi)
 {
     arcface(roi, OUTPUT_LAYER_NAME_RGB);
 }
+
+void arcface_rgb_batch(std::vector<HailoROIPtr> &rois)
+{
+    arcface_batch(rois, OUTPUT_LAYER_NAME_RGB);
+}
+
+void arcface_rgba_batch(std::vector<HailoROIPtr> &rois)
+{
+    arcface_batch(rois, OUTPUT_LAYER_NAME_RGBA);
+}
+
+void arcface_nv12_batch(std::vector<HailoROIPtr> &rois)
+{
+    arcface_batch(rois, OUTPUT_LAYER_NAME_NV12);
+}
+
+void filter_batch(std::vector<HailoROIPtr> &rois)
+{
+    arcface_batch(rois, OUTPUT_LAYER_NAME_RGB);
+}
@@ -3,6 +3,7 @@
 * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
 **/
 #pragma once
+#include <vector>
 #include "hailo_objects.hpp"
 #include "hailo_common.hpp"
 
@@ -11,4 +12,8 @@ void arcface_rgb(HailoROIPtr roi);
 void arcface_rgba(HailoROIPtr roi);
 void arcface_nv12(HailoROIPtr roi);
 void filter(HailoROIPtr roi);
+void arcface_rgb_batch(std::vector<HailoROIPtr> &rois);
+void arcface_rgba_batch(std::vector<HailoROIPtr> &rois);
+void arcface_nv12_batch(std::vector<HailoROIPtr> &rois);
+void filter_batch(std::vector<HailoROIPtr> &rois);
 __END_DECLS
\ No newline at end of file
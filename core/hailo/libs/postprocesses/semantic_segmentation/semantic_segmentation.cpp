@@ -27,12 +27,20 @@ void semantic_segmentation(HailoROIPtr roi)
         std::cerr << "Semantic Segmentation post process: No argmax tensor found" << std::endl;
         return;
     }
-    xt::xarray<uint8_t> tensor_data = common::get_xtensor(tensor_ptr);
-
-    // allocate and memcpy to a new memory so it points to the right data
-    std::vector<uint8_t> data(tensor_ptr->size());
-    memcpy(data.data(), tensor_ptr->data(), sizeof(uint8_t) * tensor_ptr->size());
-    auto obj_ptr = std::make_shared<HailoClassMask>(std::move(data), tensor_ptr->width(), tensor_ptr->height(), 0.3);
+    // reference the argmax in the output buffer when it can be kept alive, no copy is made
+    HailoClassMaskPtr obj_ptr;
+    std::shared_ptr<const uint8_t> shared_data = tensor_ptr->shared_data();
+    if (shared_data)
+    {
+        obj_ptr = std::make_shared<HailoClassMask>(std::move(shared_data), tensor_ptr->width(), tensor_ptr->height(), 0.3);
+    }
+    else
+    {
+        // allocate and memcpy to a new memory so it points to the right data
+        std::vector<uint8_t> data(tensor_ptr->size());
+        memcpy(data.data(), tensor_ptr->data(), sizeof(uint8_t) * tensor_ptr->size());
+        obj_ptr = std::make_shared<HailoClassMask>(std::move(data), tensor_ptr->width(), tensor_ptr->height(), 0.3);
+    }
     hailo_common::add_object(roi, obj_ptr);
 }
 
@@ -0,0 +1,62 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "synthetic_detections.hpp"
+
+#define DEFAULT_NUM_DETECTIONS (32)
+
+// Adds a fixed number of detections to every frame, for benchmarking elements that handle the metadata
+// without running a network. Every detection holds a classification and a tracking id, so the frames carry
+// a tree of 3 * N objects. classify_detections stands in for the attribute network of a branch.
+
+int *init(std::string config_path, std::string func_name)
+{
+    // Use the config path as the number of detections to add to every frame
+    int num_detections = DEFAULT_NUM_DETECTIONS;
+    try
+    {
+        num_detections = std::max(0, std::stoi(config_path));
+    }
+    catch (const std::exception &e)
+    {
+    }
+    return new int(num_detections);
+}
+
+void filter(HailoROIPtr roi, void *params)
+{
+    int num_detections = *reinterpret_cast<int *>(params);
+    // Lay the boxes on a grid over the frame
+    int columns = std::max(1, (int)std::ceil(std::sqrt(num_detections)));
+    float size = 1.0f / columns;
+    std::vector<HailoObjectPtr> detections;
+    detections.reserve(num_detections);
+    for (int i = 0; i < num_detections; i++)
+    {
+        HailoBBox bbox((i % columns) * size, (i / columns) * size, size * 0.9f, size * 0.9f);
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(bbox, 1, "person", 0.9f);
+        detection->add_object(std::make_shared<HailoClassification>("age", "adult", 0.8f));
+        detection->add_object(std::make_shared<HailoUniqueID>(i, TRACKING_ID));
+        detections.emplace_back(detection);
+    }
+    roi->add_objects(detections);
+}
+
+void classify_detections(HailoROIPtr roi, void *params)
+{
+    for (HailoDetectionPtr &detection : hailo_common::get_hailo_detections(roi))
+    {
+        detection->add_object(std::make_shared<HailoClassification>("attribute", "synthetic", 0.5f));
+    }
+}
+
+void free_resources(void *params_void_ptr)
+{
+    delete reinterpret_cast<int *>(params_void_ptr);
+}
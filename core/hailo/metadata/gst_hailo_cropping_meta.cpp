@@ -46,6 +46,8 @@ static gboolean gst_hailo_cropping_meta_init(GstMeta *meta, gpointer params, Gst
 {
     GstHailoCroppingMeta *gst_hailo_cropping_meta = (GstHailoCroppingMeta *)meta;
     gst_hailo_cropping_meta->num_of_crops = 0;
+    gst_hailo_cropping_meta->crop_index = -1;
+    gst_hailo_cropping_meta->stream = 0;
     return TRUE;
 }
 
@@ -59,7 +61,12 @@ static gboolean gst_hailo_cropping_meta_transform(GstBuffer *transbuf, GstMeta *
                                                   GQuark type, gpointer data)
 {
     GstHailoCroppingMeta *gst_hailo_cropping_meta = (GstHailoCroppingMeta *)meta;
-    gst_buffer_add_hailo_cropping_meta(transbuf, gst_hailo_cropping_meta->num_of_crops);
+    GstHailoCroppingMeta *new_meta = gst_buffer_add_hailo_cropping_meta(transbuf, gst_hailo_cropping_meta->num_of_crops);
+    if (new_meta != NULL)
+    {
+        new_meta->crop_index = gst_hailo_cropping_meta->crop_index;
+        new_meta->stream = gst_hailo_cropping_meta->stream;
+    }
     return TRUE;
 }
 
@@ -85,6 +92,16 @@ GstHailoCroppingMeta *gst_buffer_add_hailo_cropping_meta(GstBuffer *buffer, guin
     return gst_hailo_cropping_meta;
 }
 
+GstHailoCroppingMeta *gst_buffer_add_hailo_crop_index_meta(GstBuffer *buffer, guint number_of_crops, guint crop_index)
+{
+    GstHailoCroppingMeta *gst_hailo_cropping_meta = gst_buffer_add_hailo_cropping_meta(buffer, number_of_crops);
+
+    if (gst_hailo_cropping_meta != NULL)
+        gst_hailo_cropping_meta->crop_index = crop_index;
+
+    return gst_hailo_cropping_meta;
+}
+
 gboolean gst_buffer_remove_hailo_cropping_meta(GstBuffer *buffer)
 {
     g_return_val_if_fail((int)GST_IS_BUFFER(buffer), false);
@@ -17,7 +17,9 @@ struct _GstHailoCroppingMeta
 {
 
     GstMeta meta;
-    guint num_of_crops;
+    guint num_of_crops; // Crops of the frame
+    gint crop_index;    // Index of this buffer among the crops of its frame, -1 on the frame itself
+    GQuark stream;      // The input stream of the frame, so (stream, offset) identifies it across streams
 };
 
 GType gst_hailo_cropping_meta_api_get_type(void);
@@ -28,6 +30,9 @@ const GstMetaInfo *gst_hailo_cropping_meta_get_info(void);
 GST_EXPORT
 GstHailoCroppingMeta *gst_buffer_add_hailo_cropping_meta(GstBuffer *buffer, guint number_of_crops);
 
+GST_EXPORT
+GstHailoCroppingMeta *gst_buffer_add_hailo_crop_index_meta(GstBuffer *buffer, guint number_of_crops, guint crop_index);
+
 GST_EXPORT
 gboolean gst_buffer_remove_hailo_cropping_meta(GstBuffer *buffer);
 
@@ -61,6 +61,7 @@ static gboolean gst_hailo_meta_init(GstMeta *meta, gpointer params, GstBuffer *b
     // Opened an issue to replace this line with right initialization - MAD-1158.
     memset((void *)&gst_hailo_meta->main_object, 0, sizeof(gst_hailo_meta->main_object));
     gst_hailo_meta->main_object = nullptr;
+    gst_hailo_meta->clone_on_copy = FALSE;
     return TRUE;
 }
 
@@ -82,12 +83,22 @@ static gboolean gst_hailo_meta_transform(GstBuffer *transbuf, GstMeta *meta, Gst
     GstHailoMeta *gst_hailo_meta = (GstHailoMeta *)meta;
     HailoMainObjectPtr main_object = gst_hailo_meta->main_object;
 
+    // By default the copy shares the main object. Elements that rely on it (croppers write the results of the
+    // sub frames into the detections of the main frame) keep working, branches that need to diverge opt in.
+    if (gst_hailo_meta->clone_on_copy && main_object && GST_META_TRANSFORM_IS_COPY(type))
+    {
+        HailoMainObjectPtr main_object_clone = std::dynamic_pointer_cast<HailoMainObject>(main_object->clone());
+        if (main_object_clone)
+            main_object = main_object_clone;
+    }
+
     GstHailoMeta *new_hailo_meta = gst_buffer_add_hailo_meta(transbuf, main_object);
     if(!new_hailo_meta)
     {
         GST_ERROR("gst_hailo_meta_transform: failed to transform hailo_meta");
         return FALSE;
     }
+    new_hailo_meta->clone_on_copy = gst_hailo_meta->clone_on_copy;
 
     return TRUE;
 }
@@ -98,6 +109,20 @@ GstHailoMeta *gst_buffer_get_hailo_meta(GstBuffer *buffer)
     GstHailoMeta *meta = (GstHailoMeta *)gst_buffer_get_meta((buffer), GST_HAILO_META_API_TYPE);
     return meta;
 }
+/**
+ * @brief Sets whether copies of the buffer get their own main object.
+ *        When set, the transform of the meta attaches a copy on write clone of the main object to the copy.
+ *        Cloning is O(1), the objects are copied only when they are first accessed in the copy or in the original.
+ *
+ * @param meta The meta to configure.
+ * @param clone_on_copy TRUE to clone the main object on copy, FALSE to share it (the default).
+ */
+void gst_hailo_meta_set_clone_on_copy(GstHailoMeta *meta, gboolean clone_on_copy)
+{
+    g_return_if_fail(meta != NULL);
+    meta->clone_on_copy = clone_on_copy;
+}
+
 /**
  * @brief Addes a new GstHailoMeta to a given buffer, this meta is initialized with a given HailoMainObjectPtr.
  *
@@ -25,6 +25,8 @@ struct _GstHailoMeta
     GstMeta meta;
     // Custom fields
     HailoMainObjectPtr main_object;
+    // When set, copies of the buffer get a copy on write clone of main_object instead of sharing it
+    gboolean clone_on_copy;
 };
 
 GType gst_hailo_meta_api_get_type(void);
@@ -41,6 +43,9 @@ gboolean gst_buffer_remove_hailo_meta(GstBuffer *buffer);
 GST_EXPORT
 GstHailoMeta *gst_buffer_get_hailo_meta(GstBuffer *b);
 
+GST_EXPORT
+void gst_hailo_meta_set_clone_on_copy(GstHailoMeta *meta, gboolean clone_on_copy);
+
 HailoROIPtr get_hailo_main_roi(GstBuffer *buffer, gboolean create_if_missing = false);
 
 G_END_DECLS
\ No newline at end of file
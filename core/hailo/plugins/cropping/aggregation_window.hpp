@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/*
+ * aggregation_window.hpp: Bounded window of main frames waiting for their sub frames, used by hailoaggregator.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <vector>
+
+/**
+ * @brief Main frames waiting for the results of their sub frames, and the serialized events between them.
+ *
+ * Main frames are identified by (stream, offset): several streams may share a cropper (e.g. behind a round robin),
+ * each with its own non decreasing offsets. Entries are released in arrival order. A frame is released once all
+ * its sub frames arrived, when no more sub frames will arrive (forced), or once it waited longer than the timeout. An event is released as soon as the frames before it are, so it never overtakes
+ * them.
+ *
+ * Not thread safe, the caller serializes access.
+ *
+ * @tparam T The type of the main frames (a GstBuffer* in the element).
+ * @tparam E The type of the events (a GstEvent* in the element).
+ */
+template <typename T, typename E>
+class AggregationWindow
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class SubFrameMatch
+    {
+        // Accounted to its main frame, which stays in the window until it is released.
+        MATCHED,
+        // Its main frame did not arrive yet.
+        WAIT,
+        // Its main frame was already released (timed out), or already got all its sub frames.
+        DROP,
+    };
+
+    struct Entry
+    {
+        bool is_event;
+        T frame;
+        E event;
+        uint64_t stream;
+        uint64_t offset;
+        unsigned int expected;
+        unsigned int received;
+        Clock::time_point arrival;
+    };
+
+private:
+    std::deque<Entry> m_entries;
+    size_t m_frames;
+    size_t m_max_in_flight;
+    Clock::duration m_timeout;
+    // The offset of the newest main frame released from each stream.
+    std::map<uint64_t, uint64_t> m_released;
+
+    bool head_ready(const Entry &head, bool force, Clock::time_point now) const
+    {
+        if (head.is_event || force || head.received >= head.expected)
+            return true;
+        return m_timeout != Clock::duration::zero() && now - head.arrival >= m_timeout;
+    }
+
+public:
+    AggregationWindow(size_t max_in_flight = 1, Clock::duration timeout = Clock::duration::zero())
+        : m_frames(0), m_max_in_flight(std::max<size_t>(max_in_flight, 1)), m_timeout(timeout){};
+
+    void set_max_in_flight(size_t max_in_flight)
+    {
+        m_max_in_flight = std::max<size_t>(max_in_flight, 1);
+    }
+
+    /**
+     * @brief Set how long the oldest frame waits for its sub frames, zero waits forever.
+     */
+    void set_timeout(Clock::duration timeout)
+    {
+        m_timeout = timeout;
+    }
+
+    /**
+     * @brief Add a main frame that expects the given number of sub frames.
+     */
+    void push_frame(T frame, uint64_t stream, uint64_t offset, unsigned int expected, Clock::time_point now = Clock::now())
+    {
+        m_entries.push_back({false, frame, E(), stream, offset, expected, 0, now});
+        m_frames++;
+    }
+
+    /**
+     * @brief Add an event, it is released right after the frames added before it.
+     */
+    void push_event(E event, Clock::time_point now = Clock::now())
+    {
+        m_entries.push_back({true, T(), event, 0, 0, 0, 0, now});
+    }
+
+    /**
+     * @brief Account a sub frame to the oldest main frame of its stream and offset that still waits for sub frames.
+     *
+     * @param[out] main The main frame, set when MATCHED.
+     * @param[out] complete Whether the main frame got all its sub frames, set when MATCHED.
+     */
+    SubFrameMatch match_sub(uint64_t stream, uint64_t offset, T &main, bool &complete)
+    {
+        bool passed = false;
+        for (Entry &entry : m_entries)
+        {
+            if (entry.is_event || entry.stream != stream)
+                continue;
+            if (entry.offset == offset && entry.received < entry.expected)
+            {
+                entry.received++;
+                main = entry.frame;
+                complete = entry.received >= entry.expected;
+                return SubFrameMatch::MATCHED;
+            }
+            passed = passed || entry.offset >= offset;
+        }
+
+        auto released = m_released.find(stream);
+        if (passed || (released != m_released.end() && released->second >= offset))
+            return SubFrameMatch::DROP;
+        return SubFrameMatch::WAIT;
+    }
+
+    /**
+     * @brief Release the entries at the head of the window that are ready, in arrival order.
+     *
+     * @param[out] released Released entries are appended, the caller owns their frames and events.
+     * @param force Release all the entries, e.g. when no more sub frames will arrive.
+     */
+    void pop_ready(std::vector<Entry> &released, bool force = false, Clock::time_point now = Clock::now())
+    {
+        while (!m_entries.empty() && head_ready(m_entries.front(), force, now))
+        {
+            Entry &head = m_entries.front();
+            if (!head.is_event)
+            {
+                m_frames--;
+                m_released[head.stream] = head.offset;
+            }
+            released.emplace_back(head);
+            m_entries.pop_front();
+        }
+    }
+
+    /**
+     * @brief The time the oldest pending frame times out at, Clock::time_point::max() without a timeout or pending frames.
+     */
+    Clock::time_point head_deadline() const
+    {
+        if (m_timeout == Clock::duration::zero())
+            return Clock::time_point::max();
+        for (const Entry &entry : m_entries)
+        {
+            if (!entry.is_event)
+                return entry.arrival + m_timeout;
+        }
+        return Clock::time_point::max();
+    }
+
+    /**
+     * @brief Whether new main frames should wait for older ones to be released.
+     */
+    bool full() const
+    {
+        return m_frames >= m_max_in_flight;
+    }
+
+    size_t frames() const
+    {
+        return m_frames;
+    }
+
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    /**
+     * @brief Remove all the entries, the caller owns their frames and events.
+     */
+    void clear(std::vector<T> &frames, std::vector<E> &events)
+    {
+        for (Entry &entry : m_entries)
+        {
+            if (entry.is_event)
+                events.emplace_back(entry.event);
+            else
+                frames.emplace_back(entry.frame);
+        }
+        m_entries.clear();
+        m_frames = 0;
+        m_released.clear();
+    }
+};
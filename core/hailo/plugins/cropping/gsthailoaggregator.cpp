@@ -24,13 +24,22 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailoaggregator_debug);
 static void gst_hailoaggregator_post_aggregation(GstHailoAggregator *hailoaggregator, HailoROIPtr hailo_roi);
 static void gst_hailoaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoaggregator, HailoROIPtr sub_buffer_roi);
 static GstStateChangeReturn gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition);
+static void gst_hailoaggregator_finalize(GObject *object);
+static void gst_hailoaggregator_start_timeout_thread(GstHailoAggregator *hailoaggregator);
+static void gst_hailoaggregator_stop_timeout_thread(GstHailoAggregator *hailoaggregator);
 
 #define DEFAULT_FORWARD_STICKY_EVENTS TRUE
+#define DEFAULT_MAX_IN_FLIGHT 1
+#define MAX_MAX_IN_FLIGHT 64
+#define DEFAULT_TIMEOUT 0
+#define MAX_TIMEOUT 10000
 
 enum
 {
     PROP_0,
     PROP_FLATTEN_DETECTIONS,
+    PROP_MAX_IN_FLIGHT,
+    PROP_TIMEOUT,
 };
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
@@ -74,6 +83,7 @@ gst_hailoaggregator_class_init(GstHailoAggregatorClass *klass)
 
     gobject_class->set_property = gst_hailoaggregator_set_property;
     gobject_class->get_property = gst_hailoaggregator_get_property;
+    gobject_class->finalize = gst_hailoaggregator_finalize;
 
     gst_element_class_set_static_metadata(gstelement_class,
                                           "hailoaggregator - Cascading",
@@ -90,6 +100,18 @@ gst_hailoaggregator_class_init(GstHailoAggregatorClass *klass)
     g_object_class_install_property(gobject_class, PROP_FLATTEN_DETECTIONS,
                                     g_param_spec_boolean("flatten-detections", "Flatten detections", "perform a 'flattening' functionality on the detection metadata when receiving each frame", false,
                                                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MAX_IN_FLIGHT,
+                                    g_param_spec_uint("max-in-flight", "Max in flight",
+                                                      "Maximal number of main frames waiting for their sub frames at once. "
+                                                      "The main sink pad blocks while this many frames are pending, 1 aggregates one frame at a time.",
+                                                      1, MAX_MAX_IN_FLIGHT, DEFAULT_MAX_IN_FLIGHT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_TIMEOUT,
+                                    g_param_spec_uint("timeout", "Timeout",
+                                                      "Time in ms to wait for the sub frames of the oldest pending main frame, "
+                                                      "after that the frame is sent with the results received so far. 0 waits forever.",
+                                                      0, MAX_TIMEOUT, DEFAULT_TIMEOUT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_PLAYING)));
 }
 
 static void
@@ -115,10 +137,15 @@ gst_hailoaggregator_init(GstHailoAggregator *hailoaggregator)
     gst_pad_use_fixed_caps(hailoaggregator->srcpad);
 
     gst_element_add_pad(GST_ELEMENT(hailoaggregator), hailoaggregator->srcpad);
-    hailoaggregator->num_of_frames = 0;
     hailoaggregator->mainframe = NULL;
+    hailoaggregator->window = std::make_unique<GstHailoAggregatorWindow>(DEFAULT_MAX_IN_FLIGHT, std::chrono::milliseconds(DEFAULT_TIMEOUT));
 
     hailoaggregator->flatten_detections = false;
+    hailoaggregator->max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+    hailoaggregator->timeout = DEFAULT_TIMEOUT;
+    hailoaggregator->flushing = false;
+    hailoaggregator->timeout_thread = nullptr;
+    hailoaggregator->timeout_thread_running = false;
     hailoaggregator->eos_main = false;
     hailoaggregator->eos_sub = false;
 }
@@ -134,6 +161,21 @@ gst_hailoaggregator_set_property(GObject *object, guint prop_id,
     case PROP_FLATTEN_DETECTIONS:
         hailoaggregator->flatten_detections = g_value_get_boolean(value);
         break;
+    case PROP_MAX_IN_FLIGHT:
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->max_in_flight = g_value_get_uint(value);
+        hailoaggregator->window->set_max_in_flight(hailoaggregator->max_in_flight);
+        break;
+    }
+    case PROP_TIMEOUT:
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->timeout = g_value_get_uint(value);
+        hailoaggregator->window->set_timeout(std::chrono::milliseconds(hailoaggregator->timeout));
+        hailoaggregator->cv_timeout.notify_all();
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -151,12 +193,26 @@ gst_hailoaggregator_get_property(GObject *object, guint prop_id, GValue *value,
     case PROP_FLATTEN_DETECTIONS:
         g_value_set_boolean(value, hailoaggregator->flatten_detections);
         break;
+    case PROP_MAX_IN_FLIGHT:
+        g_value_set_uint(value, hailoaggregator->max_in_flight);
+        break;
+    case PROP_TIMEOUT:
+        g_value_set_uint(value, hailoaggregator->timeout);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
     }
 }
 
+static void
+gst_hailoaggregator_finalize(GObject *object)
+{
+    GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(object);
+    hailoaggregator->window.reset();
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
 /**
  * Callback for gst_pad_sticky_events_foreach, that forward this event to a given srcpad
  *
@@ -230,6 +286,83 @@ gst_hailoaggregator_update_eos(GstHailoAggregator *hailoaggregator, GstPad *pad,
     }
 }
 
+/**
+ * Releases the pending main frames that are ready, oldest first, and pushes them downstream together with the
+ * serialized events queued between them.
+ * May be called from any streaming thread, the frames and events are still pushed in arrival order.
+ *
+ * @param[in] hailoaggregator   aggregator element
+ * @param[in] force             Release all the pending frames, even if they are not ready.
+ * @return The flow return of the first push that failed, GST_FLOW_OK otherwise.
+ */
+static GstFlowReturn
+gst_hailoaggregator_release_frames(GstHailoAggregator *hailoaggregator, bool force)
+{
+    GstHailoAggregatorClass *hailoaggregator_class = GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator);
+    GstFlowReturn ret = GST_FLOW_OK;
+    std::vector<GstHailoAggregatorWindow::Entry> ready;
+
+    std::lock_guard<std::mutex> release_lock(hailoaggregator->release_mutex);
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        // No more sub frames will arrive after the sub pad got EOS
+        hailoaggregator->window->pop_ready(ready, force || hailoaggregator->eos_sub);
+        if (!ready.empty())
+            hailoaggregator->cv_main.notify_all();
+    }
+
+    for (GstHailoAggregatorWindow::Entry &entry : ready)
+    {
+        if (entry.is_event)
+        {
+            if (!gst_pad_push_event(hailoaggregator->srcpad, entry.event))
+                GST_DEBUG_OBJECT(hailoaggregator, "Failed to push queued event downstream");
+            continue;
+        }
+
+        if (entry.received < entry.expected)
+        {
+            GST_WARNING_OBJECT(hailoaggregator, "Sending main frame of offset %" G_GUINT64_FORMAT " with %u of %u sub frames",
+                               entry.offset, entry.received, entry.expected);
+        }
+        hailoaggregator_class->handle_main_roi_post_aggregation(hailoaggregator, get_hailo_main_roi(entry.frame));
+
+        // Remove the cropping meta from the main frame.
+        if (!gst_buffer_remove_hailo_cropping_meta(entry.frame))
+        {
+            GST_ERROR_OBJECT(hailoaggregator, "Failed to remove cropping meta from main frame");
+        }
+
+        // Push main buffer into the src pad, frames after a failed push are dropped.
+        if (ret == GST_FLOW_OK)
+            ret = gst_pad_push(hailoaggregator->srcpad, entry.frame);
+        else
+            gst_buffer_unref(entry.frame);
+    }
+    return ret;
+}
+
+/**
+ * Drops all the pending main frames and queued events without pushing them.
+ *
+ * @param[in] hailoaggregator   aggregator element
+ */
+static void
+gst_hailoaggregator_drop_frames(GstHailoAggregator *hailoaggregator)
+{
+    std::vector<GstBuffer *> frames;
+    std::vector<GstEvent *> events;
+
+    std::lock_guard<std::mutex> release_lock(hailoaggregator->release_mutex);
+    std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+    hailoaggregator->window->clear(frames, events);
+    for (GstBuffer *frame : frames)
+        gst_buffer_unref(frame);
+    for (GstEvent *event : events)
+        gst_event_unref(event);
+    hailoaggregator->cv_main.notify_all();
+}
+
 static gboolean
 gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 {
@@ -240,6 +373,19 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 
     GST_DEBUG_OBJECT(pad, "received event %" GST_PTR_FORMAT, event);
 
+    // Serialized events of the main pad wait behind the pending main frames, so they don't overtake them.
+    // EOS is sent once the frames are released, and flushes drop the frames.
+    if (pad == hailoaggregator->sinkpad_main && GST_EVENT_IS_SERIALIZED(event) &&
+        GST_EVENT_TYPE(event) != GST_EVENT_EOS && GST_EVENT_TYPE(event) != GST_EVENT_FLUSH_STOP)
+    {
+        {
+            std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+            hailoaggregator->window->push_event(event);
+        }
+        gst_hailoaggregator_release_frames(hailoaggregator, false);
+        return TRUE;
+    }
+
     if (GST_EVENT_IS_STICKY(event))
     {
         unlock = TRUE;
@@ -247,27 +393,41 @@ gst_hailoaggregator_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 
         if (GST_EVENT_TYPE(event) == GST_EVENT_EOS)
         {
-            GST_OBJECT_LOCK(hailoaggregator);
-            gst_hailoaggregator_update_eos(hailoaggregator, pad, true);
-            // Unlocking both condition variables in order to finish the chain function.
-            // After that the pads can be freed by the change_state of base class.
-            hailoaggregator->cv_main.notify_all();
-            hailoaggregator->cv_sub.notify_all();
-            forward = gst_hailoaggregator_all_sinkpads_eos_unlocked(hailoaggregator);
-            GST_OBJECT_UNLOCK(hailoaggregator);
+            bool release = false;
+            {
+                std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+                gst_hailoaggregator_update_eos(hailoaggregator, pad, true);
+                // Unlocking both condition variables in order to finish the chain function.
+                // After that the pads can be freed by the change_state of base class.
+                hailoaggregator->cv_main.notify_all();
+                hailoaggregator->cv_sub.notify_all();
+                forward = gst_hailoaggregator_all_sinkpads_eos_unlocked(hailoaggregator);
+                release = hailoaggregator->eos_sub;
+            }
+            // No more sub frames will arrive, send the pending main frames before the EOS.
+            if (release)
+                gst_hailoaggregator_release_frames(hailoaggregator, true);
         }
         else if (pad != hailoaggregator->sinkpad_main)
         {
             forward = FALSE;
         }
     }
+    else if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_START)
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->flushing = true;
+        hailoaggregator->cv_main.notify_all();
+        hailoaggregator->cv_sub.notify_all();
+    }
     else if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
     {
         unlock = TRUE;
         GST_PAD_STREAM_LOCK(hailoaggregator->srcpad);
-        GST_OBJECT_LOCK(hailoaggregator);
+        gst_hailoaggregator_drop_frames(hailoaggregator);
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
         gst_hailoaggregator_update_eos(hailoaggregator, pad, false);
-        GST_OBJECT_UNLOCK(hailoaggregator);
+        hailoaggregator->flushing = false;
     }
 
     if (forward && GST_EVENT_IS_SERIALIZED(event))
@@ -303,70 +463,131 @@ gst_hailoaggregator_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
     GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(parent);
     GstHailoAggregatorClass *hailoaggregator_class = GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator);
+    bool completed = false;
+
+    GstHailoCroppingMeta *cropping_meta = gst_buffer_get_hailo_cropping_meta(buf);
+    guint64 stream = (cropping_meta != NULL) ? cropping_meta->stream : 0;
+    GstBuffer *mainframe = NULL;
+    GstHailoAggregatorWindow::SubFrameMatch match = GstHailoAggregatorWindow::SubFrameMatch::WAIT;
 
     std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
 
-    // Wait until main frame is not null & the offset of main frame is not smaller.
-    if (hailoaggregator->mainframe == NULL || hailoaggregator->mainframe->offset < buf->offset)
-    {
-        hailoaggregator->cv_sub.wait(lock);
-    }
+    // Wait while the main frame of this sub frame did not arrive yet.
+    hailoaggregator->cv_sub.wait(lock, [hailoaggregator, buf, stream, &mainframe, &completed, &match]()
+                                 {
+                                     match = hailoaggregator->window->match_sub(stream, buf->offset, mainframe, completed);
+                                     return hailoaggregator->flushing || hailoaggregator->eos_main ||
+                                            match != GstHailoAggregatorWindow::SubFrameMatch::WAIT; });
 
-    if (hailoaggregator->mainframe != NULL)
+    if (match == GstHailoAggregatorWindow::SubFrameMatch::MATCHED)
     {
         HailoROIPtr sub_buffer_roi = get_hailo_main_roi(buf);
+        hailoaggregator->mainframe = mainframe;
         hailoaggregator_class->handle_sub_frame_roi(hailoaggregator, sub_buffer_roi);
-
-        // Increase the number of received frames.
-        hailoaggregator->num_of_frames++;
-        if (hailoaggregator->num_of_frames >= hailoaggregator->expected_frames)
-        {
-            // Release the mutex in the main chain if all the frames received.
-            hailoaggregator->cv_main.notify_one();
-            hailoaggregator->num_of_frames = 0;
-        }
+        hailoaggregator->mainframe = NULL;
     }
+    else
+    {
+        // The main frame was already sent (timed out), nothing to aggregate into.
+        GST_DEBUG_OBJECT(hailoaggregator, "Dropping sub frame with offset %" G_GUINT64_FORMAT ", its main frame was released", buf->offset);
+    }
+    lock.unlock();
 
     gst_buffer_remove_hailo_meta(buf);
     gst_buffer_unref(buf);
+
+    if (completed)
+        return gst_hailoaggregator_release_frames(hailoaggregator, false);
     return GST_FLOW_OK;
 }
 
+/**
+ * Releases the oldest pending main frame once it waits longer than the timeout, so it is sent even when no
+ * more frames or sub frames arrive to release it.
+ *
+ * @param[in] hailoaggregator   aggregator element
+ */
+static void gst_hailoaggregator_timeout_loop(GstHailoAggregator *hailoaggregator)
+{
+    std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
+    while (hailoaggregator->timeout_thread_running)
+    {
+        GstHailoAggregatorWindow::Clock::time_point deadline = hailoaggregator->window->head_deadline();
+        if (hailoaggregator->flushing || deadline == GstHailoAggregatorWindow::Clock::time_point::max())
+        {
+            hailoaggregator->cv_timeout.wait(lock);
+            continue;
+        }
+        if (GstHailoAggregatorWindow::Clock::now() < deadline)
+        {
+            hailoaggregator->cv_timeout.wait_until(lock, deadline);
+            continue;
+        }
+
+        lock.unlock();
+        GstFlowReturn ret = gst_hailoaggregator_release_frames(hailoaggregator, false);
+        if (ret != GST_FLOW_OK)
+            GST_DEBUG_OBJECT(hailoaggregator, "Failed to push timed out frames: %s", gst_flow_get_name(ret));
+        lock.lock();
+    }
+}
+
+static void gst_hailoaggregator_start_timeout_thread(GstHailoAggregator *hailoaggregator)
+{
+    if (hailoaggregator->timeout_thread)
+        return;
+    hailoaggregator->timeout_thread_running = true;
+    hailoaggregator->timeout_thread = std::make_unique<std::thread>(gst_hailoaggregator_timeout_loop, hailoaggregator);
+}
+
+static void gst_hailoaggregator_stop_timeout_thread(GstHailoAggregator *hailoaggregator)
+{
+    {
+        std::lock_guard<std::mutex> lock(hailoaggregator->mutex);
+        hailoaggregator->timeout_thread_running = false;
+    }
+    hailoaggregator->cv_timeout.notify_all();
+    if (hailoaggregator->timeout_thread)
+    {
+        hailoaggregator->timeout_thread->join();
+        hailoaggregator->timeout_thread.reset();
+    }
+}
+
 static GstFlowReturn
 gst_hailoaggregator_chain_main(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
-    GstFlowReturn ret = GST_FLOW_ERROR;
+    GstFlowReturn ret = GST_FLOW_OK;
     GstHailoAggregator *hailoaggregator = GST_HAILO_AGGREGATOR_CAST(parent);
-    GstHailoAggregatorClass *hailoaggregator_class = GST_HAILO_AGGREGATOR_GET_CLASS(hailoaggregator);
     std::unique_lock<std::mutex> lock(hailoaggregator->mutex);
 
-    // Get excpected frames from the main frame ROI
-    HailoROIPtr hailo_roi = get_hailo_main_roi(buf);
-
-    hailoaggregator->expected_frames = gst_buffer_get_hailo_cropping_meta(buf)->num_of_crops;
-
-    if (hailoaggregator->expected_frames != 0 && !hailoaggregator->eos_sub)
+    if (hailoaggregator->flushing)
     {
-        hailoaggregator->mainframe = buf;
-        hailoaggregator->cv_sub.notify_one();
-        hailoaggregator->cv_main.wait(lock);
-        hailoaggregator->mainframe = NULL;
+        gst_buffer_unref(buf);
+        return GST_FLOW_FLUSHING;
     }
-    lock.unlock();
 
-    
-    hailoaggregator_class->handle_main_roi_post_aggregation(hailoaggregator, hailo_roi);
+    // Get excpected frames from the cropping meta, the frame waits in the window until they all arrive.
+    GstHailoCroppingMeta *cropping_meta = gst_buffer_get_hailo_cropping_meta(buf);
+    hailoaggregator->window->push_frame(buf, cropping_meta->stream, buf->offset, cropping_meta->num_of_crops);
+    hailoaggregator->cv_sub.notify_all();
+    hailoaggregator->cv_timeout.notify_all();
+    lock.unlock();
 
-    gst_pad_sticky_events_foreach(hailoaggregator->sinkpad_main, forward_events, hailoaggregator->srcpad);
+    ret = gst_hailoaggregator_release_frames(hailoaggregator, false);
 
-    // Remove the cropping meta from the main frame.
-    if (! gst_buffer_remove_hailo_cropping_meta(buf))
+    // Block while the window is full, the oldest frame is released by the sub chain once complete,
+    // or by the timeout thread once it times out.
+    lock.lock();
+    while (ret == GST_FLOW_OK && !hailoaggregator->flushing && hailoaggregator->window->full())
     {
-        GST_ERROR_OBJECT(hailoaggregator, "Failed to remove cropping meta from main frame");
+        hailoaggregator->cv_main.wait(lock);
+        lock.unlock();
+        ret = gst_hailoaggregator_release_frames(hailoaggregator, false);
+        lock.lock();
     }
-
-    // Push main buffer into the src pad.
-    ret = gst_pad_push(hailoaggregator->srcpad, buf);
+    if (ret == GST_FLOW_OK && hailoaggregator->flushing)
+        ret = GST_FLOW_FLUSHING;
     return ret;
 }
 
@@ -394,7 +615,7 @@ static void gst_hailoaggregator_handle_sub_frame_roi(GstHailoAggregator *hailoag
 
 /**
  * Functionality to perform after all frames are aggregated succesfully.
- * Called from the chain_main method before releasing the mutex and the buffers.
+ * Called for every main frame when it is released, in arrival order, without holding the mutex.
  * Base implementation does nothing, derived elements can override.
  * 
  * @param[in] hailoaggregator   GstHailoAggregator.
@@ -409,10 +630,21 @@ gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
     GstHailoAggregator *aggregator = GST_HAILO_AGGREGATOR(element);
     switch (transition)
     {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        {
+            std::lock_guard<std::mutex> lock(aggregator->mutex);
+            aggregator->flushing = false;
+        }
+        gst_hailoaggregator_start_timeout_thread(aggregator);
+        break;
+    }
     case GST_STATE_CHANGE_PAUSED_TO_READY:
     {
         // Unlocking both condition variables in order to finish the chain function.
         // After that the pads can be freed by the change_state of base class.
+        std::lock_guard<std::mutex> lock(aggregator->mutex);
+        aggregator->flushing = true;
         aggregator->cv_main.notify_all();
         aggregator->cv_sub.notify_all();
         break;
@@ -426,5 +658,12 @@ gst_hailoaggregator_change_state(GstElement *element, GstStateChange transition)
     if (ret == GST_STATE_CHANGE_FAILURE)
         return ret;
 
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+    {
+        // The pads are inactive, a push of the timeout thread returns right away
+        gst_hailoaggregator_stop_timeout_thread(aggregator);
+        gst_hailoaggregator_drop_frames(aggregator);
+    }
+
     return ret;
 }
@@ -12,8 +12,12 @@
 #include <gst/gst.h>
 #include <mutex>
 #include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <thread>
 
 #include "hailo_objects.hpp"
+#include "aggregation_window.hpp"
 
 G_BEGIN_DECLS
 
@@ -34,6 +38,8 @@ G_BEGIN_DECLS
 typedef struct _GstHailoAggregator GstHailoAggregator;
 typedef struct _GstHailoAggregatorClass GstHailoAggregatorClass;
 
+using GstHailoAggregatorWindow = AggregationWindow<GstBuffer *, GstEvent *>;
+
 struct _GstHailoAggregator
 {
     GstElement element;
@@ -44,15 +50,28 @@ struct _GstHailoAggregator
     bool eos_main;
     GstPad *sinkpad_sub;
     bool eos_sub;
+    // The main frame the current sub frame belongs to, valid only during handle_sub_frame_roi.
     GstBuffer *mainframe;
-    uint num_of_frames;
-    uint expected_frames;
-    uint last_offset;
     gboolean flatten_detections;
+    uint max_in_flight;
+    uint timeout;
+    bool flushing;
+    // Main frames and the serialized events of the main pad in arrival order, released in that order once
+    // complete (or timed out).
+    std::unique_ptr<GstHailoAggregatorWindow> window;
 
     std::mutex mutex;
+    // Serializes releasing main frames, so they are pushed in order from any streaming thread.
+    std::mutex release_mutex;
+    // Signaled when a pending main frame is released or completed.
     std::condition_variable cv_main;
+    // Signaled when a new main frame is pending.
     std::condition_variable cv_sub;
+    // Releases the oldest main frame once it waits longer than the timeout, whether or not the window is full.
+    std::unique_ptr<std::thread> timeout_thread;
+    bool timeout_thread_running;
+    // Signaled when a main frame is pending, the timeout changes or the timeout thread stops.
+    std::condition_variable cv_timeout;
 };
 
 struct _GstHailoAggregatorClass
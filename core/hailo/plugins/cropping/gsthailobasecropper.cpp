@@ -824,12 +824,14 @@ static GstBuffer *handle_one_crop(GstHailoBaseCropper *hailo_basecropper, GstBuf
  * @param[in] hailo_basecropper      cropping element.
  * @param[in] buf               Buffer to crop.
  * @param[in] crop_rois        Vector of HailoROI of buf to crop from.
+ * @param[in] stream           The input stream of buf, set in the cropping meta of the crops.
  * @return boolean, whether all cropping were successful.
  */
-static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois)
+static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *buf, std::vector<HailoROIPtr> &crop_rois, GQuark stream)
 {
-    for (HailoROIPtr &crop_roi : crop_rois)
+    for (guint crop_index = 0; crop_index < crop_rois.size(); crop_index++)
     {
+        HailoROIPtr &crop_roi = crop_rois[crop_index];
         if (!gst_pad_is_active(hailo_basecropper->srcpad_crop))
         {
             GST_INFO_OBJECT(hailo_basecropper, "Crop src pad is not active, dropping buffer");
@@ -842,6 +844,10 @@ static gboolean handle_crops(GstHailoBaseCropper *hailo_basecropper, GstBuffer *
             return FALSE;
         }
         newbuf->offset = buf->offset;
+        // Lets elements on the crop branch group the crops of a frame (e.g. batched postprocesses in hailofilter)
+        GstHailoCroppingMeta *crop_meta = gst_buffer_add_hailo_crop_index_meta(newbuf, crop_rois.size(), crop_index);
+        if (crop_meta != NULL)
+            crop_meta->stream = stream;
 
         // Push the cropped buffer into the crop src pad.
         gst_pad_push(hailo_basecropper->srcpad_crop, newbuf);
@@ -907,7 +913,13 @@ static GstFlowReturn gst_hailo_basecropper_chain(GstPad *pad, GstObject *parent,
     }
     hailo_basecropper->stream_ids_buff_offset[streamid_key]++;
 
-    gst_buffer_add_hailo_cropping_meta(buf, crop_rois.size());
+    // In a nested cascade the frame is itself a crop, replace its crop index meta
+    // Several streams may share the cropper (e.g. behind a round robin), each with its own offsets
+    GQuark stream = g_quark_from_string(input_stream_meta ? input_stream_meta->pad_name : stream_id);
+    gst_buffer_remove_hailo_cropping_meta(buf);
+    GstHailoCroppingMeta *cropping_meta = gst_buffer_add_hailo_cropping_meta(buf, crop_rois.size());
+    if (cropping_meta != NULL)
+        cropping_meta->stream = stream;
 
     // Push the main buffer into the main src pad.
     if (crop_rois.empty())
@@ -917,7 +929,7 @@ static GstFlowReturn gst_hailo_basecropper_chain(GstPad *pad, GstObject *parent,
     else
     {
         gst_pad_push(hailo_basecropper->srcpad_main, gst_buffer_ref(buf));
-        gboolean handle_crops_ret = handle_crops(hailo_basecropper, buf, crop_rois);
+        gboolean handle_crops_ret = handle_crops(hailo_basecropper, buf, crop_rois, stream);
         gst_buffer_unref(buf);
         if (!handle_crops_ret)
         {
@@ -5,10 +5,12 @@
 #include "gsthailofilter.hpp"
 #include "tensor_meta.hpp"
 #include "gst_hailo_meta.hpp"
+#include "gst_hailo_cropping_meta.hpp"
 #include "hailo/hailort.h"
 #include <gst/video/video.h>
 #include <gst/gst.h>
 #include <dlfcn.h>
+#include <chrono>
 #include <map>
 #include <iostream>
 
@@ -17,6 +19,8 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailofilter_debug_category);
 #define DEFAULT_FUNCTION_NAME "filter"
 #define INIT_FUNC_NAME "init"
 #define FREE_FUNC_NAME "free_resources"
+#define BATCH_FUNC_SUFFIX "_batch"
+#define DEFAULT_BATCH_TIMEOUT (10)
 
 static void gst_hailofilter_set_property(GObject *object,
                                          guint property_id, const GValue *value, GParamSpec *pspec);
@@ -27,6 +31,10 @@ static void gst_hailofilter_finalize(GObject *object);
 
 static gboolean gst_hailofilter_start(GstBaseTransform *trans);
 static gboolean gst_hailofilter_stop(GstBaseTransform *trans);
+static gboolean gst_hailofilter_sink_event(GstBaseTransform *trans, GstEvent *event);
+static void gst_hailofilter_drop_crops(GstHailofilter *hailofilter);
+static void gst_hailofilter_start_flush_thread(GstHailofilter *hailofilter);
+static void gst_hailofilter_stop_flush_thread(GstHailofilter *hailofilter);
 static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
                                                   GstBuffer *buffer);
 
@@ -38,6 +46,8 @@ enum
     PROP_USE_GST_BUFFER,
     PROP_CONFIG_FILE_PATH,
     PROP_REMOVE_TENSORS,
+    PROP_BATCH_CROPS,
+    PROP_BATCH_TIMEOUT,
 };
 
 G_DEFINE_TYPE_WITH_CODE(GstHailofilter, gst_hailofilter, GST_TYPE_BASE_TRANSFORM,
@@ -82,11 +92,22 @@ gst_hailofilter_class_init(GstHailofilterClass *klass)
     g_object_class_install_property(gobject_class, PROP_REMOVE_TENSORS,
                                     g_param_spec_boolean("remove-tensors", "remove-tensors", "whether hailofilter should delete tensors at the end", true,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_CROPS,
+                                    g_param_spec_boolean("batch-crops", "batch-crops",
+                                                         "If the so exports <function-name>_batch, call it once with all the crops of a frame instead of calling the function for every crop",
+                                                         false,
+                                                         (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_BATCH_TIMEOUT,
+                                    g_param_spec_uint("batch-timeout", "batch-timeout",
+                                                      "With batch-crops, call the batch function with the crops of a frame that arrived so far once the first of them waited this long in milliseconds. 0 waits for the next frame",
+                                                      0, G_MAXUINT, DEFAULT_BATCH_TIMEOUT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
 
     gobject_class->dispose = gst_hailofilter_dispose;
     gobject_class->finalize = gst_hailofilter_finalize;
     base_transform_class->start = GST_DEBUG_FUNCPTR(gst_hailofilter_start);
     base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailofilter_stop);
+    base_transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_hailofilter_sink_event);
     base_transform_class->transform_ip = GST_DEBUG_FUNCPTR(gst_hailofilter_transform_ip);
 }
 
@@ -97,6 +118,17 @@ gst_hailofilter_init(GstHailofilter *hailofilter)
     hailofilter->remove_tensors = true;
     hailofilter->params = nullptr;
     hailofilter->config_path = g_strdup("NULL");
+    hailofilter->batch_crops = false;
+    hailofilter->batch_handler = nullptr;
+    hailofilter->batch_handler_no_config = nullptr;
+    hailofilter->pending_crops = new std::vector<GstBuffer *>();
+    hailofilter->batch_timeout = DEFAULT_BATCH_TIMEOUT;
+    hailofilter->pending_since = 0;
+    hailofilter->batch_result = GST_FLOW_OK;
+    hailofilter->batch_mutex = new std::mutex();
+    hailofilter->batch_cond = new std::condition_variable();
+    hailofilter->flush_thread = nullptr;
+    hailofilter->flush_thread_running = false;
 }
 
 void gst_hailofilter_set_property(GObject *object, guint property_id,
@@ -123,6 +155,12 @@ void gst_hailofilter_set_property(GObject *object, guint property_id,
     case PROP_REMOVE_TENSORS:
         hailofilter->remove_tensors = g_value_get_boolean(value);
         break;
+    case PROP_BATCH_CROPS:
+        hailofilter->batch_crops = g_value_get_boolean(value);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        hailofilter->batch_timeout = g_value_get_uint(value);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -154,6 +192,12 @@ void gst_hailofilter_get_property(GObject *object, guint property_id,
     case PROP_REMOVE_TENSORS:
         g_value_set_boolean(value, hailofilter->remove_tensors);
         break;
+    case PROP_BATCH_CROPS:
+        g_value_set_boolean(value, hailofilter->batch_crops);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        g_value_set_uint(value, hailofilter->batch_timeout);
+        break;
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
@@ -202,6 +246,14 @@ void gst_hailofilter_finalize(GObject *object)
     GST_DEBUG_OBJECT(hailofilter, "finalize");
 
     /* clean up object here */
+    gst_hailofilter_stop_flush_thread(hailofilter);
+    gst_hailofilter_drop_crops(hailofilter);
+    delete hailofilter->pending_crops;
+    hailofilter->pending_crops = nullptr;
+    delete hailofilter->batch_cond;
+    hailofilter->batch_cond = nullptr;
+    delete hailofilter->batch_mutex;
+    hailofilter->batch_mutex = nullptr;
 
     G_OBJECT_CLASS(gst_hailofilter_parent_class)->finalize(object);
 }
@@ -275,6 +327,29 @@ static gboolean gst_hailofilter_start(GstBaseTransform *trans)
         dlclose(hailofilter->loaded_lib);
     }
 
+    // The batch function is optional, and can't modify the buffer data
+    hailofilter->batch_handler = nullptr;
+    hailofilter->batch_handler_no_config = nullptr;
+    if (!dlsym_error && hailofilter->batch_crops && !hailofilter->use_gst_buffer)
+    {
+        std::string batch_function_name = std::string(hailofilter->function_name) + BATCH_FUNC_SUFFIX;
+        if (hailofilter->use_config)
+        {
+            hailofilter->batch_handler = (void (*)(std::vector<HailoROIPtr> &, void *))dlsym(hailofilter->loaded_lib, batch_function_name.c_str());
+        }
+        else
+        {
+            hailofilter->batch_handler_no_config = (void (*)(std::vector<HailoROIPtr> &))dlsym(hailofilter->loaded_lib, batch_function_name.c_str());
+        }
+        dlerror();
+        if (hailofilter->batch_handler || hailofilter->batch_handler_no_config)
+        {
+            GST_INFO_OBJECT(hailofilter, "Using batch function %s", batch_function_name.c_str());
+        }
+    }
+    hailofilter->batch_result = GST_FLOW_OK;
+    gst_hailofilter_start_flush_thread(hailofilter);
+
     GST_DEBUG_OBJECT(hailofilter, "start");
 
     return TRUE;
@@ -287,6 +362,10 @@ gst_hailofilter_stop(GstBaseTransform *trans)
 
     GST_DEBUG_OBJECT(hailofilter, "stop");
 
+    // The pads are inactive, a push of the flush thread returns right away
+    gst_hailofilter_stop_flush_thread(hailofilter);
+    gst_hailofilter_drop_crops(hailofilter);
+
     return TRUE;
 }
 
@@ -302,20 +381,34 @@ void get_tensors_from_meta(GstBuffer *buffer, HailoROIPtr roi)
     gpointer state = NULL;
     GstMeta *meta;
     GstParentBufferMeta *pmeta;
-    GstMapInfo info;
     while ((meta = gst_buffer_iterate_meta_filtered(buffer, &state, GST_PARENT_BUFFER_META_API_TYPE)))
     {
         pmeta = reinterpret_cast<GstParentBufferMeta *>(meta);
-        (void)gst_buffer_map(pmeta->buffer, &info, GST_MAP_READWRITE);
         // check if the buffer has tensor metadata
         if (!gst_buffer_get_meta(pmeta->buffer, g_type_from_name(TENSOR_META_API_NAME)))
         {
-            gst_buffer_unmap(pmeta->buffer, &info);
             continue;
         }
         const hailo_vstream_info_t vstream_info = reinterpret_cast<GstHailoTensorMeta *>(gst_buffer_get_meta(pmeta->buffer, g_type_from_name(TENSOR_META_API_NAME)))->info;
-        roi->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info.data), vstream_info));
-        gst_buffer_unmap(pmeta->buffer, &info);
+
+        // The tensor owns a mapped reference to its buffer, so postprocess results (e.g. masks) can reference
+        // the data without a copy after the tensors are removed from the frame
+        // (mapped before the extra ref, a write map needs the buffer to be writable)
+        GstMapInfo *info = new GstMapInfo;
+        if (!gst_buffer_map(pmeta->buffer, info, GST_MAP_READWRITE))
+        {
+            GST_WARNING("Failed to map the buffer of tensor %s, skipping it", vstream_info.name);
+            delete info;
+            continue;
+        }
+        GstBuffer *tensor_buffer = gst_buffer_ref(pmeta->buffer);
+        HailoTensorPtr tensor = std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info->data), vstream_info);
+        tensor->set_owner(std::shared_ptr<GstMapInfo>(info, [tensor_buffer](GstMapInfo *map_info)
+                                                      {
+                                                          gst_buffer_unmap(tensor_buffer, map_info);
+                                                          gst_buffer_unref(tensor_buffer);
+                                                          delete map_info; }));
+        roi->add_tensor(tensor);
     }
 }
 
@@ -346,6 +439,183 @@ gboolean remove_tensors(GstBuffer *buffer, HailoROIPtr roi)
     return true;
 }
 
+/**
+ * @brief Call the batch function with the held crops of a frame (and the current buffer), then push the held crops.
+ *        The caller holds batch_mutex.
+ *
+ * @param hailofilter The element.
+ * @param buffer The buffer being transformed that completes the batch, pushed by the base transform. May be NULL.
+ * @return GstFlowReturn The result of pushing the held crops.
+ */
+static GstFlowReturn gst_hailofilter_process_batch(GstHailofilter *hailofilter, GstBuffer *buffer)
+{
+    std::vector<GstBuffer *> buffers(*hailofilter->pending_crops);
+    hailofilter->pending_crops->clear();
+    if (buffer != nullptr)
+    {
+        buffers.push_back(buffer);
+    }
+    if (buffers.empty())
+    {
+        return GST_FLOW_OK;
+    }
+
+    std::vector<HailoROIPtr> rois;
+    rois.reserve(buffers.size());
+    for (GstBuffer *crop : buffers)
+    {
+        rois.emplace_back(get_hailo_main_roi(crop, true));
+    }
+
+    if (hailofilter->use_config)
+    {
+        hailofilter->batch_handler(rois, hailofilter->params);
+    }
+    else
+    {
+        hailofilter->batch_handler_no_config(rois);
+    }
+
+    GstFlowReturn ret = GST_FLOW_OK;
+    for (size_t i = 0; i < buffers.size(); i++)
+    {
+        if (hailofilter->remove_tensors)
+        {
+            remove_tensors(buffers[i], rois[i]);
+        }
+        if (buffers[i] == buffer)
+        {
+            continue;
+        }
+        if (ret == GST_FLOW_OK)
+        {
+            ret = gst_pad_push(GST_BASE_TRANSFORM_SRC_PAD(hailofilter), buffers[i]);
+        }
+        else
+        {
+            gst_buffer_unref(buffers[i]);
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief Release the held crops without pushing them.
+ */
+static void gst_hailofilter_drop_crops(GstHailofilter *hailofilter)
+{
+    for (GstBuffer *crop : *hailofilter->pending_crops)
+    {
+        gst_buffer_unref(crop);
+    }
+    hailofilter->pending_crops->clear();
+}
+
+/**
+ * @brief Keep the result of a batch that was not pushed from transform_ip, the next buffer returns it upstream.
+ *        Errors nobody else reports are posted here.
+ */
+static void gst_hailofilter_batch_failed(GstHailofilter *hailofilter, GstFlowReturn result)
+{
+    GST_DEBUG_OBJECT(hailofilter, "Pushing held crops failed: %s", gst_flow_get_name(result));
+    hailofilter->batch_result = result;
+    if (result == GST_FLOW_NOT_LINKED || result == GST_FLOW_NOT_NEGOTIATED)
+    {
+        GST_ELEMENT_FLOW_ERROR(hailofilter, result);
+    }
+}
+
+/**
+ * @brief Process and push the held crops once the first of them waited batch-timeout. The other crops of the frame
+ *        may have been dropped upstream, and an aggregator downstream waits for the crops that arrived.
+ */
+static void gst_hailofilter_flush_loop(GstHailofilter *hailofilter)
+{
+    std::unique_lock<std::mutex> lock(*hailofilter->batch_mutex);
+    while (hailofilter->flush_thread_running)
+    {
+        if (hailofilter->pending_crops->empty())
+        {
+            hailofilter->batch_cond->wait(lock);
+            continue;
+        }
+
+        gint64 deadline = hailofilter->pending_since + (gint64)hailofilter->batch_timeout * 1000;
+        gint64 now = g_get_monotonic_time();
+        if (now < deadline)
+        {
+            hailofilter->batch_cond->wait_for(lock, std::chrono::microseconds(deadline - now));
+            continue;
+        }
+
+        GST_DEBUG_OBJECT(hailofilter, "Batch timeout, processing %zu held crops", hailofilter->pending_crops->size());
+        GstFlowReturn result = gst_hailofilter_process_batch(hailofilter, nullptr);
+        if (result != GST_FLOW_OK)
+        {
+            gst_hailofilter_batch_failed(hailofilter, result);
+        }
+    }
+}
+
+static void gst_hailofilter_start_flush_thread(GstHailofilter *hailofilter)
+{
+    if ((!hailofilter->batch_handler && !hailofilter->batch_handler_no_config) || hailofilter->batch_timeout == 0 ||
+        hailofilter->flush_thread != nullptr)
+    {
+        return;
+    }
+    hailofilter->flush_thread_running = true;
+    hailofilter->flush_thread = new std::thread(gst_hailofilter_flush_loop, hailofilter);
+}
+
+static void gst_hailofilter_stop_flush_thread(GstHailofilter *hailofilter)
+{
+    {
+        std::lock_guard<std::mutex> lock(*hailofilter->batch_mutex);
+        hailofilter->flush_thread_running = false;
+    }
+    hailofilter->batch_cond->notify_all();
+    if (hailofilter->flush_thread != nullptr)
+    {
+        hailofilter->flush_thread->join();
+        delete hailofilter->flush_thread;
+        hailofilter->flush_thread = nullptr;
+    }
+}
+
+static gboolean gst_hailofilter_sink_event(GstBaseTransform *trans, GstEvent *event)
+{
+    GstHailofilter *hailofilter = GST_HAILO_FILTER(trans);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+    {
+        std::lock_guard<std::mutex> lock(*hailofilter->batch_mutex);
+        gst_hailofilter_drop_crops(hailofilter);
+        hailofilter->batch_result = GST_FLOW_OK;
+    }
+    else if (GST_EVENT_IS_SERIALIZED(event))
+    {
+        // Held crops go downstream before the events that came after them
+        std::unique_lock<std::mutex> lock(*hailofilter->batch_mutex);
+        GstFlowReturn result = gst_hailofilter_process_batch(hailofilter, nullptr);
+        if (result != GST_FLOW_OK)
+        {
+            gst_hailofilter_batch_failed(hailofilter, result);
+        }
+        lock.unlock();
+
+        if (result != GST_FLOW_OK && result != GST_FLOW_EOS)
+        {
+            GST_WARNING_OBJECT(hailofilter, "Dropping %s event, the held crops were not pushed",
+                               GST_EVENT_TYPE_NAME(event));
+            gst_event_unref(event);
+            return FALSE;
+        }
+    }
+
+    return GST_BASE_TRANSFORM_CLASS(gst_hailofilter_parent_class)->sink_event(trans, event);
+}
+
 static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
                                                   GstBuffer *buffer)
 {
@@ -363,6 +633,45 @@ static GstFlowReturn gst_hailofilter_transform_ip(GstBaseTransform *trans,
         hailo_roi->set_stream_id(stream_id);
     }
 
+    // Crops of a frame are held until the last one arrives, then passed to the batch function at once.
+    // A crop of another frame (some crops were dropped upstream) or a buffer that is not a crop releases the held crops.
+    // Offsets may all be unset (file sources without internal-offset), so the first crop of a frame starts a new batch too.
+    // Crops that wait longer than batch-timeout are released by the flush thread.
+    if (hailofilter->batch_handler || hailofilter->batch_handler_no_config)
+    {
+        std::lock_guard<std::mutex> lock(*hailofilter->batch_mutex);
+        if (hailofilter->batch_result != GST_FLOW_OK)
+        {
+            return hailofilter->batch_result;
+        }
+        GstHailoCroppingMeta *cropping_meta = gst_buffer_get_hailo_cropping_meta(buffer);
+        bool is_crop = cropping_meta != nullptr && cropping_meta->crop_index >= 0;
+        if (!hailofilter->pending_crops->empty() &&
+            (!is_crop || cropping_meta->crop_index == 0 ||
+             GST_BUFFER_OFFSET(hailofilter->pending_crops->front()) != GST_BUFFER_OFFSET(buffer)))
+        {
+            GstFlowReturn ret = gst_hailofilter_process_batch(hailofilter, nullptr);
+            if (ret != GST_FLOW_OK)
+            {
+                return ret;
+            }
+        }
+        if (is_crop)
+        {
+            if (hailofilter->pending_crops->size() + 1 >= cropping_meta->num_of_crops)
+            {
+                return gst_hailofilter_process_batch(hailofilter, buffer);
+            }
+            if (hailofilter->pending_crops->empty())
+            {
+                hailofilter->pending_since = g_get_monotonic_time();
+                hailofilter->batch_cond->notify_one();
+            }
+            hailofilter->pending_crops->push_back(gst_buffer_ref(buffer));
+            return GST_BASE_TRANSFORM_FLOW_DROPPED;
+        }
+    }
+
     // Call all functions.
     if (hailofilter->use_gst_buffer)
     {
@@ -6,7 +6,10 @@
 
 #include <gst/base/gstbasetransform.h>
 #include <gst/video/video.h>
+#include <condition_variable>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "hailo_objects.hpp"
 
@@ -38,6 +41,19 @@ struct _GstHailofilter
     void (*handler_gst)(HailoROIPtr, GstVideoFrame *, void *);
     void (*handler_gst_no_config)(HailoROIPtr, GstVideoFrame *);
     gboolean use_gst_buffer;
+
+    // Optional <function-name>_batch symbols, called once with all the crops of a frame
+    gboolean batch_crops;
+    void (*batch_handler)(std::vector<HailoROIPtr> &, void *);
+    void (*batch_handler_no_config)(std::vector<HailoROIPtr> &);
+    std::vector<GstBuffer *> *pending_crops; // Crops of the current frame held for the batch
+    guint batch_timeout;                     // Longest wait of the held crops for the rest of their frame, in ms
+    gint64 pending_since;                    // Arrival time of the oldest held crop
+    GstFlowReturn batch_result;              // Result of the last batch pushed by the flush thread
+    std::mutex *batch_mutex;                 // Guards the held crops, held while a batch is processed and pushed
+    std::condition_variable *batch_cond;
+    std::thread *flush_thread; // Releases the held crops of a frame whose other crops never arrive
+    bool flush_thread_running;
 };
 
 struct _GstHailofilterClass
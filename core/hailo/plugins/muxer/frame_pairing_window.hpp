@@ -0,0 +1,267 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/*
+ * frame_pairing_window.hpp: Bounded reorder windows that pair the frames of two streams, used by the hailomuxer match modes.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ * @brief Pairs the frames of a main stream with the frames of a sub stream by a key (offset or pts).
+ *
+ * Both streams are expected to arrive with non decreasing keys, each at its own pace. Frames wait in a bounded
+ * window per stream until a frame of the other stream with a key within the tolerance arrives.
+ * Nothing here blocks: main frames are released in arrival order once paired, once no matching sub frame can
+ * arrive anymore (the sub stream moved past them), or when the main window overflows. Sub frames that can no
+ * longer be paired, or that overflow the sub window, are dropped. Events of the main stream wait behind the main
+ * frames that arrived before them, so they never overtake them.
+ *
+ * Not thread safe, the caller serializes access.
+ *
+ * @tparam T The type of the frames (a GstBuffer* in the element).
+ * @tparam E The type of the main stream events (a GstEvent* in the element).
+ */
+template <typename T, typename E>
+class FramePairingWindow
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Stats
+    {
+        uint64_t paired = 0;
+        uint64_t unpaired = 0;
+        uint64_t dropped_sub = 0;
+        // Time between the arrival of the first and the second frame of each pair.
+        Clock::duration total_pairing_latency = Clock::duration::zero();
+        Clock::duration max_pairing_latency = Clock::duration::zero();
+    };
+
+    struct Released
+    {
+        bool is_event;
+        T frame;
+        E event;
+        // Whether the main frame was paired, always false for events.
+        bool paired;
+    };
+
+private:
+    struct Entry
+    {
+        bool is_event;
+        T value;
+        E event;
+        uint64_t key;
+        Clock::time_point arrival;
+        bool paired;
+    };
+
+    // Main frames and the events between them, in arrival order.
+    std::deque<Entry> m_main;
+    std::deque<Entry> m_sub;
+    size_t m_main_frames;
+    size_t m_main_size;
+    size_t m_sub_size;
+    uint64_t m_tolerance;
+    bool m_seen_main;
+    bool m_seen_sub;
+    uint64_t m_newest_main_key;
+    uint64_t m_newest_sub_key;
+    Stats m_stats;
+
+    bool matches(uint64_t a, uint64_t b) const
+    {
+        return ((a > b) ? a - b : b - a) <= m_tolerance;
+    }
+
+    // Whether key is older than the other key by more than the tolerance.
+    bool passed(uint64_t key, uint64_t other_key) const
+    {
+        return key < other_key && other_key - key > m_tolerance;
+    }
+
+    void record_pair(Clock::time_point first_arrival, Clock::time_point now)
+    {
+        Clock::duration latency = now - first_arrival;
+        m_stats.paired++;
+        m_stats.total_pairing_latency += latency;
+        m_stats.max_pairing_latency = std::max(m_stats.max_pairing_latency, latency);
+    }
+
+public:
+    FramePairingWindow(size_t main_size = 8, size_t sub_size = 8, uint64_t tolerance = 0)
+        : m_main_frames(0), m_main_size(std::max<size_t>(main_size, 1)), m_sub_size(std::max<size_t>(sub_size, 1)), m_tolerance(tolerance),
+          m_seen_main(false), m_seen_sub(false), m_newest_main_key(0), m_newest_sub_key(0){};
+
+    void set_window_size(size_t main_size, size_t sub_size)
+    {
+        m_main_size = std::max<size_t>(main_size, 1);
+        m_sub_size = std::max<size_t>(sub_size, 1);
+    }
+
+    void set_tolerance(uint64_t tolerance)
+    {
+        m_tolerance = tolerance;
+    }
+
+    /**
+     * @brief Add a main frame, pairs it with a waiting sub frame if there is one.
+     *
+     * @param[out] sub The paired sub frame, the caller owns it.
+     * @param[out] dropped_subs Sub frames that can no longer be paired are appended, the caller owns them.
+     * @return true if the main frame was paired.
+     */
+    bool push_main(T value, uint64_t key, T &sub, std::vector<T> &dropped_subs)
+    {
+        auto now = Clock::now();
+        m_seen_main = true;
+        m_newest_main_key = std::max(m_newest_main_key, key);
+
+        bool paired = false;
+        auto it = m_sub.begin();
+        while (it != m_sub.end())
+        {
+            if (!paired && matches(it->key, key))
+            {
+                sub = it->value;
+                record_pair(it->arrival, now);
+                paired = true;
+                it = m_sub.erase(it);
+            }
+            else if (passed(it->key, key))
+            {
+                // Later main frames have larger keys, this sub frame will never be paired.
+                dropped_subs.emplace_back(it->value);
+                m_stats.dropped_sub++;
+                it = m_sub.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        m_main.push_back({false, value, E(), key, now, paired});
+        m_main_frames++;
+        return paired;
+    }
+
+    /**
+     * @brief Add an event of the main stream, it is released right after the main frames added before it.
+     */
+    void push_event(E event)
+    {
+        m_main.push_back({true, T(), event, 0, Clock::now(), false});
+    }
+
+    /**
+     * @brief Add a sub frame, pairs it with the oldest waiting main frame it matches.
+     *
+     * @param[out] main The paired main frame, it stays in the window until it is released by pop_ready.
+     * @param[out] dropped_subs Sub frames dropped on the way are appended (including this one if it can never be paired).
+     * @return true if the sub frame was paired, the caller still owns it.
+     */
+    bool push_sub(T value, uint64_t key, T &main, std::vector<T> &dropped_subs)
+    {
+        auto now = Clock::now();
+        m_seen_sub = true;
+        m_newest_sub_key = std::max(m_newest_sub_key, key);
+
+        for (auto &entry : m_main)
+        {
+            if (!entry.is_event && !entry.paired && matches(entry.key, key))
+            {
+                entry.paired = true;
+                main = entry.value;
+                record_pair(entry.arrival, now);
+                return true;
+            }
+        }
+
+        if (m_seen_main && passed(key, m_newest_main_key))
+        {
+            // Its main frame was already released or skipped.
+            dropped_subs.emplace_back(value);
+            m_stats.dropped_sub++;
+            return false;
+        }
+
+        m_sub.push_back({false, value, E(), key, now, false});
+        while (m_sub.size() > m_sub_size)
+        {
+            dropped_subs.emplace_back(m_sub.front().value);
+            m_stats.dropped_sub++;
+            m_sub.pop_front();
+        }
+        return false;
+    }
+
+    /**
+     * @brief Release the main frames at the head of the window that are done, and the events between them, in arrival order.
+     *
+     * @param[out] released Released main frames and events are appended, the caller owns them.
+     * @param flush Release all the main frames, paired or not.
+     */
+    void pop_ready(std::vector<Released> &released, bool flush = false)
+    {
+        while (!m_main.empty())
+        {
+            Entry &head = m_main.front();
+            if (!head.is_event)
+            {
+                bool sub_passed = m_seen_sub && passed(head.key, m_newest_sub_key);
+                if (!head.paired && !flush && !sub_passed && m_main_frames <= m_main_size)
+                    break;
+                if (!head.paired)
+                    m_stats.unpaired++;
+                m_main_frames--;
+            }
+            released.push_back({head.is_event, head.value, head.event, head.paired});
+            m_main.pop_front();
+        }
+    }
+
+    /**
+     * @brief Remove all the frames and events, the caller owns them.
+     */
+    void clear(std::vector<T> &main_frames, std::vector<T> &sub_frames, std::vector<E> &events)
+    {
+        for (auto &entry : m_main)
+        {
+            if (entry.is_event)
+                events.emplace_back(entry.event);
+            else
+                main_frames.emplace_back(entry.value);
+        }
+        for (auto &entry : m_sub)
+            sub_frames.emplace_back(entry.value);
+        m_main.clear();
+        m_sub.clear();
+        m_main_frames = 0;
+        m_seen_main = m_seen_sub = false;
+        m_newest_main_key = m_newest_sub_key = 0;
+    }
+
+    size_t main_depth() const
+    {
+        return m_main_frames;
+    }
+
+    size_t sub_depth() const
+    {
+        return m_sub.size();
+    }
+
+    const Stats &get_stats() const
+    {
+        return m_stats;
+    }
+};
@@ -23,17 +23,50 @@ GST_DEBUG_CATEGORY_STATIC(gst_hailomuxer_debug);
 #define GST_CAT_DEFAULT gst_hailomuxer_debug
 
 static void gst_hailomuxer_handle_sub_frame_roi(HailoROIPtr main_buffer_roi, HailoROIPtr sub_buffer_roi);
+static void gst_hailomuxer_finalize(GObject *object);
 static GstStateChangeReturn gst_hailomuxer_change_state(GstElement *element, GstStateChange transition);
 
 #define DEFAULT_FORWARD_STICKY_EVENTS TRUE
+#define DEFAULT_MATCH_MODE GST_HAILO_MUXER_MATCH_MODE_NONE
+#define DEFAULT_WINDOW_SIZE 8
+#define MAX_WINDOW_SIZE 64
+#define DEFAULT_MATCH_TOLERANCE 0
 
 enum
 {
     PROP_0,
     PROP_SYNC_COUNTERS,
     PROP_LEAKY_SUB,
+    PROP_MATCH_MODE,
+    PROP_WINDOW_SIZE,
+    PROP_MATCH_TOLERANCE,
+    PROP_MAIN_QUEUE_DEPTH,
+    PROP_SUB_QUEUE_DEPTH,
+    PROP_PAIRING_LATENCY,
+    PROP_MAX_PAIRING_LATENCY,
+    PROP_UNPAIRED_FRAMES,
+    PROP_DROPPED_SUB_FRAMES,
 };
 
+#define GST_TYPE_HAILO_MUXER_MATCH_MODE (gst_hailomuxer_match_mode_get_type())
+static GType
+gst_hailomuxer_match_mode_get_type(void)
+{
+    static GType hailomuxer_match_mode_type = 0;
+    static const GEnumValue hailomuxer_match_modes[] = {
+        {GST_HAILO_MUXER_MATCH_MODE_NONE, "No matching (the main stream waits for a sub frame on every frame)", "none"},
+        {GST_HAILO_MUXER_MATCH_MODE_OFFSET, "Pair frames with matching buffer offsets, without blocking either stream", "offset"},
+        {GST_HAILO_MUXER_MATCH_MODE_PTS, "Pair frames with matching presentation timestamps, without blocking either stream", "pts"},
+        {0, NULL, NULL},
+    };
+    if (!hailomuxer_match_mode_type)
+    {
+        hailomuxer_match_mode_type =
+            g_enum_register_static("GstHailoMuxerMatchMode", hailomuxer_match_modes);
+    }
+    return hailomuxer_match_mode_type;
+}
+
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink",
                                                                     GST_PAD_SINK,
                                                                     GST_PAD_ALWAYS,
@@ -63,6 +96,11 @@ static GstFlowReturn gst_hailomuxer_chain_main(GstPad *pad, GstObject *parent, G
 static GstFlowReturn gst_hailomuxer_chain_sub(GstPad *pad, GstObject *parent, GstBuffer *buf);
 static GstFlowReturn gst_hailomuxer_chain_main_leaky_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
 static GstFlowReturn gst_hailomuxer_chain_sub_leaky_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static GstFlowReturn gst_hailomuxer_chain_main_match_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static GstFlowReturn gst_hailomuxer_chain_sub_match_mode(GstPad *pad, GstObject *parent, GstBuffer *buf);
+static GstFlowReturn gst_hailomuxer_release_frames(GstHailoMuxer *hailomuxer, bool flush);
+static void gst_hailomuxer_drop_frames(GstHailoMuxer *hailomuxer);
+static void gst_hailomuxer_update_chain_functions(GstHailoMuxer *hailomuxer);
 static GstFlowReturn gst_hailomuxer_sync_and_drop(GstBuffer *buf, GstHailoMuxer *hailomuxer, bool main_stream);
 static void gst_hailomuxer_merge_rois(GstBuffer *main_buf, GstBuffer *sub_buf, GstHailoMuxer *hailomuxer);
 static void gst_hailomuxer_wait_for_main(GstHailoMuxer *hailomuxer, std::unique_lock<std::mutex> &lock);
@@ -79,6 +117,7 @@ gst_hailomuxer_class_init(GstHailoMuxerClass *klass)
 
     gobject_class->set_property = gst_hailomuxer_set_property;
     gobject_class->get_property = gst_hailomuxer_get_property;
+    gobject_class->finalize = gst_hailomuxer_finalize;
 
     gst_element_class_set_static_metadata(gstelement_class,
                                           "Muxer pipeline merging",
@@ -97,6 +136,43 @@ gst_hailomuxer_class_init(GstHailoMuxerClass *klass)
     g_object_class_install_property(gobject_class, PROP_LEAKY_SUB,
                                     g_param_spec_boolean("leaky-sub", "leaky-sub", "allow main frames to pass through the element even if a sub frame is not available (Can't be enabled with sync-counters)", false,
                                                          (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_MODE,
+                                    g_param_spec_enum("match-mode", "Match mode",
+                                                      "Pair main and sub frames by a key in reorder windows instead of waiting on every frame. "
+                                                      "Overrides leaky-sub and sync-counters.",
+                                                      GST_TYPE_HAILO_MUXER_MATCH_MODE, DEFAULT_MATCH_MODE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_WINDOW_SIZE,
+                                    g_param_spec_uint("window-size", "Window size",
+                                                      "Match modes: number of frames each stream may hold while waiting for a pair. "
+                                                      "The oldest main frame is sent without a pair when its window overflows, the oldest sub frame is dropped.",
+                                                      1, MAX_WINDOW_SIZE, DEFAULT_WINDOW_SIZE,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MATCH_TOLERANCE,
+                                    g_param_spec_uint64("match-tolerance", "Match tolerance",
+                                                        "Match modes: maximal difference between the keys of paired frames, in offsets or in nanoseconds.",
+                                                        0, G_MAXUINT64, DEFAULT_MATCH_TOLERANCE,
+                                                        (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY)));
+    g_object_class_install_property(gobject_class, PROP_MAIN_QUEUE_DEPTH,
+                                    g_param_spec_uint("main-queue-depth", "Main queue depth", "Match modes: main frames currently waiting for a pair",
+                                                      0, G_MAXUINT, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_SUB_QUEUE_DEPTH,
+                                    g_param_spec_uint("sub-queue-depth", "Sub queue depth", "Match modes: sub frames currently waiting for a pair",
+                                                      0, G_MAXUINT, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_PAIRING_LATENCY,
+                                    g_param_spec_uint64("pairing-latency", "Pairing latency",
+                                                        "Match modes: mean time in microseconds the first frame of a pair waited for the second one",
+                                                        0, G_MAXUINT64, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_MAX_PAIRING_LATENCY,
+                                    g_param_spec_uint64("max-pairing-latency", "Max pairing latency",
+                                                        "Match modes: maximal time in microseconds the first frame of a pair waited for the second one",
+                                                        0, G_MAXUINT64, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_UNPAIRED_FRAMES,
+                                    g_param_spec_uint64("unpaired-frames", "Unpaired frames", "Match modes: main frames sent without a pair",
+                                                        0, G_MAXUINT64, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class, PROP_DROPPED_SUB_FRAMES,
+                                    g_param_spec_uint64("dropped-sub-frames", "Dropped sub frames", "Match modes: sub frames dropped without a pair",
+                                                        0, G_MAXUINT64, 0, (GParamFlags)(G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -131,6 +207,47 @@ gst_hailomuxer_init(GstHailoMuxer *hailomuxer)
     hailomuxer->sync_counters = false;
     hailomuxer->leaky_sub = false;
     hailomuxer->sub_buffers_queue = std::queue<GstBuffer *>();
+
+    hailomuxer->match_mode = DEFAULT_MATCH_MODE;
+    hailomuxer->window_size = DEFAULT_WINDOW_SIZE;
+    hailomuxer->match_tolerance = DEFAULT_MATCH_TOLERANCE;
+    hailomuxer->pairing_window = std::make_unique<GstHailoMuxerPairingWindow>(DEFAULT_WINDOW_SIZE, DEFAULT_WINDOW_SIZE, DEFAULT_MATCH_TOLERANCE);
+    hailomuxer->arrival_main = 0;
+    hailomuxer->arrival_sub = 0;
+    hailomuxer->warned_arrival_order = false;
+}
+
+static void
+gst_hailomuxer_finalize(GObject *object)
+{
+    GstHailoMuxer *hailomuxer = GST_HAILO_MUXER_CAST(object);
+    hailomuxer->pairing_window.reset();
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+/**
+ * Sets the chain functions of the sink pads according to the matching and leaky modes.
+ *
+ * @param[in] hailomuxer   muxer element
+ */
+static void
+gst_hailomuxer_update_chain_functions(GstHailoMuxer *hailomuxer)
+{
+    if (hailomuxer->match_mode != GST_HAILO_MUXER_MATCH_MODE_NONE)
+    {
+        gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main_match_mode));
+        gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub_match_mode));
+    }
+    else if (hailomuxer->leaky_sub)
+    {
+        gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main_leaky_mode));
+        gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub_leaky_mode));
+    }
+    else
+    {
+        gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main));
+        gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub));
+    }
 }
 
 static void
@@ -147,26 +264,34 @@ gst_hailomuxer_set_property(GObject *object, guint prop_id,
         {
             hailomuxer->leaky_sub = false;
             // set the chain function to the non-leaky mode
-            gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main));
-            gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub));
+            gst_hailomuxer_update_chain_functions(hailomuxer);
         }
         break;
     case PROP_LEAKY_SUB:
         if (!hailomuxer->sync_counters) // If sync_counters is enabled, leaky_sub is not allowed
         {
             hailomuxer->leaky_sub = g_value_get_boolean(value);
-            if (hailomuxer->leaky_sub)
-            {
-                gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main_leaky_mode));
-                gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub_leaky_mode));
-            }
-            else
-            {
-                gst_pad_set_chain_function(hailomuxer->sinkpad_main, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_main));
-                gst_pad_set_chain_function(hailomuxer->sinkpad_sub, GST_DEBUG_FUNCPTR(gst_hailomuxer_chain_sub));
-            }
+            gst_hailomuxer_update_chain_functions(hailomuxer);
         }
         break;
+    case PROP_MATCH_MODE:
+        hailomuxer->match_mode = (GstHailoMuxerMatchMode)g_value_get_enum(value);
+        gst_hailomuxer_update_chain_functions(hailomuxer);
+        break;
+    case PROP_WINDOW_SIZE:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        hailomuxer->window_size = g_value_get_uint(value);
+        hailomuxer->pairing_window->set_window_size(hailomuxer->window_size, hailomuxer->window_size);
+        break;
+    }
+    case PROP_MATCH_TOLERANCE:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        hailomuxer->match_tolerance = g_value_get_uint64(value);
+        hailomuxer->pairing_window->set_tolerance(hailomuxer->match_tolerance);
+        break;
+    }
 
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -188,6 +313,54 @@ gst_hailomuxer_get_property(GObject *object, guint prop_id, GValue *value,
     case PROP_LEAKY_SUB:
         g_value_set_boolean(value, hailomuxer->leaky_sub);
         break;
+    case PROP_MATCH_MODE:
+        g_value_set_enum(value, hailomuxer->match_mode);
+        break;
+    case PROP_WINDOW_SIZE:
+        g_value_set_uint(value, hailomuxer->window_size);
+        break;
+    case PROP_MATCH_TOLERANCE:
+        g_value_set_uint64(value, hailomuxer->match_tolerance);
+        break;
+    case PROP_MAIN_QUEUE_DEPTH:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        g_value_set_uint(value, hailomuxer->pairing_window->main_depth());
+        break;
+    }
+    case PROP_SUB_QUEUE_DEPTH:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        g_value_set_uint(value, hailomuxer->pairing_window->sub_depth());
+        break;
+    }
+    case PROP_PAIRING_LATENCY:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        const GstHailoMuxerPairingWindow::Stats &stats = hailomuxer->pairing_window->get_stats();
+        guint64 total_us = std::chrono::duration_cast<std::chrono::microseconds>(stats.total_pairing_latency).count();
+        g_value_set_uint64(value, (stats.paired == 0) ? 0 : total_us / stats.paired);
+        break;
+    }
+    case PROP_MAX_PAIRING_LATENCY:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        const GstHailoMuxerPairingWindow::Stats &stats = hailomuxer->pairing_window->get_stats();
+        g_value_set_uint64(value, std::chrono::duration_cast<std::chrono::microseconds>(stats.max_pairing_latency).count());
+        break;
+    }
+    case PROP_UNPAIRED_FRAMES:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        g_value_set_uint64(value, hailomuxer->pairing_window->get_stats().unpaired);
+        break;
+    }
+    case PROP_DROPPED_SUB_FRAMES:
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        g_value_set_uint64(value, hailomuxer->pairing_window->get_stats().dropped_sub);
+        break;
+    }
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -250,6 +423,19 @@ gst_hailomuxer_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
 
     GST_DEBUG_OBJECT(pad, "received event %" GST_PTR_FORMAT, event);
 
+    // In the match modes, serialized events of the main pad wait behind the main frames in the pairing window,
+    // so they don't overtake them. EOS is sent once the frames are released, and flushes drop the frames.
+    if (hailomuxer->match_mode != GST_HAILO_MUXER_MATCH_MODE_NONE && pad == hailomuxer->sinkpad_main &&
+        GST_EVENT_IS_SERIALIZED(event) && GST_EVENT_TYPE(event) != GST_EVENT_EOS && GST_EVENT_TYPE(event) != GST_EVENT_FLUSH_STOP)
+    {
+        {
+            std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+            hailomuxer->pairing_window->push_event(event);
+        }
+        gst_hailomuxer_release_frames(hailomuxer, false);
+        return TRUE;
+    }
+
     if (GST_EVENT_IS_STICKY(event))
     {
         unlock = TRUE;
@@ -265,6 +451,10 @@ gst_hailomuxer_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
             gst_hailomuxer_update_eos(hailomuxer, pad, true);
             forward = gst_hailomuxer_all_sinkpads_eos_unlocked(hailomuxer);
             GST_OBJECT_UNLOCK(hailomuxer);
+
+            // No more sub frames will arrive, send the main frames still waiting for a pair before the EOS.
+            if (hailomuxer->match_mode != GST_HAILO_MUXER_MATCH_MODE_NONE && pad == hailomuxer->sinkpad_sub)
+                gst_hailomuxer_release_frames(hailomuxer, true);
         }
         else if (pad != hailomuxer->sinkpad_main)
         {
@@ -278,6 +468,7 @@ gst_hailomuxer_sink_event(GstPad *pad, GstObject *parent, GstEvent *event)
         GST_OBJECT_LOCK(hailomuxer);
         gst_hailomuxer_update_eos(hailomuxer, pad, false);
         GST_OBJECT_UNLOCK(hailomuxer);
+        gst_hailomuxer_drop_frames(hailomuxer);
     }
 
     if (forward && GST_EVENT_IS_SERIALIZED(event))
@@ -368,16 +559,29 @@ static GstBuffer *gst_hailomuxer_dequeue_sub_frame_leaky_mode(GstHailoMuxer *hai
     return buf;
 }
 
+/**
+ * Adds the metadata of a sub frame to its main frame through handle_sub_frame_roi.
+ *
+ * @param[in] main_buf     The main frame.
+ * @param[in] sub_buf      The sub frame.
+ * @param[in] hailomuxer   muxer element
+ */
 static void
-gst_hailomuxer_merge_rois(GstBuffer *main_buf, GstBuffer *sub_buf, GstHailoMuxer *hailomuxer)
+gst_hailomuxer_merge_buffer_rois(GstBuffer *main_buf, GstBuffer *sub_buf, GstHailoMuxer *hailomuxer)
 {
     GstHailoMuxerClass *hailomuxer_class = GST_HAILO_MUXER_GET_CLASS(hailomuxer);
+    HailoROIPtr main_buffer_roi = get_hailo_main_roi(main_buf, true);
+    HailoROIPtr sub_buffer_roi = get_hailo_main_roi(sub_buf);
+
+    hailomuxer_class->handle_sub_frame_roi(main_buffer_roi, sub_buffer_roi);
+}
+
+static void
+gst_hailomuxer_merge_rois(GstBuffer *main_buf, GstBuffer *sub_buf, GstHailoMuxer *hailomuxer)
+{
     if (hailomuxer->mainframe != NULL)
     {
-        HailoROIPtr main_buffer_roi = get_hailo_main_roi(main_buf, true);
-        HailoROIPtr sub_buffer_roi = get_hailo_main_roi(sub_buf);
-
-        hailomuxer_class->handle_sub_frame_roi(main_buffer_roi, sub_buffer_roi);
+        gst_hailomuxer_merge_buffer_rois(main_buf, sub_buf, hailomuxer);
 
         if(!hailomuxer->leaky_sub)
         {
@@ -501,6 +705,181 @@ gst_hailomuxer_chain_main_leaky_mode(GstPad *pad, GstObject *parent, GstBuffer *
     return ret;
 }
 
+/**
+ * Gets the key frames are paired by in the match modes.
+ * In the offset mode a frame without a valid offset is keyed by its arrival order on its pad. Arrival order can't
+ * stand in for a timestamp, so in the pts mode a frame without a valid pts is an error.
+ * Called from the streaming thread of the pad, outside the mutex.
+ *
+ * @param[in] hailomuxer   muxer element
+ * @param[in] pad          The pad the frame arrived on.
+ * @param[in] buf          The frame.
+ * @param[out] key         The key of the frame.
+ * @return FALSE if the frame has no valid key, an error was posted.
+ */
+static gboolean
+gst_hailomuxer_match_key(GstHailoMuxer *hailomuxer, GstPad *pad, GstBuffer *buf, guint64 &key)
+{
+    guint64 &arrival = (pad == hailomuxer->sinkpad_main) ? hailomuxer->arrival_main : hailomuxer->arrival_sub;
+    guint64 arrival_index = arrival++;
+
+    if (hailomuxer->match_mode == GST_HAILO_MUXER_MATCH_MODE_PTS)
+    {
+        if (!GST_BUFFER_PTS_IS_VALID(buf))
+        {
+            GST_ELEMENT_ERROR(hailomuxer, STREAM, FAILED, ("Can't match frames by pts, a frame has no pts"),
+                              ("Frame %" G_GUINT64_FORMAT " of pad %s has no pts, use match-mode=offset", arrival_index, GST_PAD_NAME(pad)));
+            return FALSE;
+        }
+        key = GST_BUFFER_PTS(buf);
+        return TRUE;
+    }
+
+    if (!GST_BUFFER_OFFSET_IS_VALID(buf))
+    {
+        if (!hailomuxer->warned_arrival_order.exchange(true))
+        {
+            GST_ELEMENT_WARNING(hailomuxer, STREAM, FAILED, ("Frames without a buffer offset are matched by arrival order"),
+                                ("Frame %" G_GUINT64_FORMAT " of pad %s has no offset", arrival_index, GST_PAD_NAME(pad)));
+        }
+        key = arrival_index;
+        return TRUE;
+    }
+    key = GST_BUFFER_OFFSET(buf);
+    return TRUE;
+}
+
+static void
+gst_hailomuxer_unref_sub_frames(std::vector<GstBuffer *> &sub_frames)
+{
+    for (GstBuffer *sub_buffer : sub_frames)
+    {
+        gst_buffer_remove_hailo_meta(sub_buffer);
+        gst_buffer_unref(sub_buffer);
+    }
+}
+
+/**
+ * Releases the main frames at the head of the pairing window that are done, and pushes them downstream together
+ * with the main pad serialized events queued between them.
+ * May be called from both streaming threads, the frames and events are still pushed in arrival order.
+ *
+ * @param[in] hailomuxer   muxer element
+ * @param[in] flush        Release all the waiting main frames, paired or not.
+ * @return The flow return of the first push that failed, GST_FLOW_OK otherwise.
+ */
+static GstFlowReturn
+gst_hailomuxer_release_frames(GstHailoMuxer *hailomuxer, bool flush)
+{
+    GstFlowReturn ret = GST_FLOW_OK;
+    std::vector<GstHailoMuxerPairingWindow::Released> released;
+
+    std::lock_guard<std::mutex> release_lock(hailomuxer->release_mutex);
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        hailomuxer->pairing_window->pop_ready(released, flush || hailomuxer->eos_sub);
+    }
+
+    for (auto &entry : released)
+    {
+        if (entry.is_event)
+        {
+            if (!gst_pad_push_event(hailomuxer->srcpad, entry.event))
+                GST_DEBUG_OBJECT(hailomuxer, "Failed to push queued event downstream");
+            continue;
+        }
+
+        if (!entry.paired)
+            GST_DEBUG_OBJECT(hailomuxer, "Sending main frame with offset %" G_GUINT64_FORMAT " without a sub frame", GST_BUFFER_OFFSET(entry.frame));
+
+        // Frames after a failed push are dropped.
+        if (ret != GST_FLOW_OK)
+        {
+            gst_buffer_unref(entry.frame);
+            continue;
+        }
+        ret = gst_pad_push(hailomuxer->srcpad, entry.frame);
+    }
+    return ret;
+}
+
+/**
+ * Drops all the frames and queued events waiting in the pairing window.
+ *
+ * @param[in] hailomuxer   muxer element
+ */
+static void
+gst_hailomuxer_drop_frames(GstHailoMuxer *hailomuxer)
+{
+    std::vector<GstBuffer *> main_frames;
+    std::vector<GstBuffer *> sub_frames;
+    std::vector<GstEvent *> events;
+    {
+        std::lock_guard<std::mutex> release_lock(hailomuxer->release_mutex);
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        hailomuxer->pairing_window->clear(main_frames, sub_frames, events);
+        hailomuxer->arrival_main = 0;
+        hailomuxer->arrival_sub = 0;
+    }
+    for (GstBuffer *main_buffer : main_frames)
+        gst_buffer_unref(main_buffer);
+    for (GstEvent *event : events)
+        gst_event_unref(event);
+    gst_hailomuxer_unref_sub_frames(sub_frames);
+}
+
+static GstFlowReturn
+gst_hailomuxer_chain_main_match_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoMuxer *hailomuxer = GST_HAILO_MUXER_CAST(parent);
+    std::vector<GstBuffer *> done_sub_frames;
+    guint64 key;
+    if (!gst_hailomuxer_match_key(hailomuxer, pad, buf, key))
+    {
+        gst_buffer_unref(buf);
+        return GST_FLOW_ERROR;
+    }
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        GstBuffer *sub_buffer = NULL;
+        if (hailomuxer->pairing_window->push_main(buf, key, sub_buffer, done_sub_frames))
+        {
+            gst_hailomuxer_merge_buffer_rois(buf, sub_buffer, hailomuxer);
+            done_sub_frames.emplace_back(sub_buffer);
+        }
+    }
+    gst_hailomuxer_unref_sub_frames(done_sub_frames);
+
+    return gst_hailomuxer_release_frames(hailomuxer, false);
+}
+
+static GstFlowReturn
+gst_hailomuxer_chain_sub_match_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
+{
+    GstHailoMuxer *hailomuxer = GST_HAILO_MUXER_CAST(parent);
+    std::vector<GstBuffer *> done_sub_frames;
+    guint64 key;
+    if (!gst_hailomuxer_match_key(hailomuxer, pad, buf, key))
+    {
+        gst_buffer_remove_hailo_meta(buf);
+        gst_buffer_unref(buf);
+        return GST_FLOW_ERROR;
+    }
+    {
+        std::lock_guard<std::mutex> lock(hailomuxer->mutex);
+        GstBuffer *main_buffer = NULL;
+        if (hailomuxer->pairing_window->push_sub(buf, key, main_buffer, done_sub_frames))
+        {
+            // The main frame stays in the window until it is released, so it is safe to update its metadata here.
+            gst_hailomuxer_merge_buffer_rois(main_buffer, buf, hailomuxer);
+            done_sub_frames.emplace_back(buf);
+        }
+    }
+    gst_hailomuxer_unref_sub_frames(done_sub_frames);
+
+    return gst_hailomuxer_release_frames(hailomuxer, false);
+}
+
 /**
  * Functionality to perform for each incoming sub frame.
  * Called from the chain_sub method before the releasing the mutex and the buffers.
@@ -556,5 +935,8 @@ gst_hailomuxer_change_state(GstElement *element, GstStateChange transition)
     if (ret == GST_STATE_CHANGE_FAILURE)
         return ret;
 
+    if (transition == GST_STATE_CHANGE_PAUSED_TO_READY)
+        gst_hailomuxer_drop_frames(muxer);
+
     return ret;
 }
@@ -11,10 +11,13 @@
 
 #pragma once
 #include <gst/gst.h>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <queue>
+#include <memory>
 #include "hailo_objects.hpp"
+#include "frame_pairing_window.hpp"
 
 G_BEGIN_DECLS
 
@@ -32,9 +35,18 @@ G_BEGIN_DECLS
 #define GST_HAILO_MUXER_GET_CLASS(obj) \
         (G_TYPE_INSTANCE_GET_CLASS ((obj), GST_TYPE_HAILO_MUXER, GstHailoMuxerClass))
 
+typedef enum
+{
+    GST_HAILO_MUXER_MATCH_MODE_NONE = 0,
+    GST_HAILO_MUXER_MATCH_MODE_OFFSET = 1,
+    GST_HAILO_MUXER_MATCH_MODE_PTS = 2,
+} GstHailoMuxerMatchMode;
+
 typedef struct _GstHailoMuxer GstHailoMuxer;
 typedef struct _GstHailoMuxerClass GstHailoMuxerClass;
 
+using GstHailoMuxerPairingWindow = FramePairingWindow<GstBuffer *, GstEvent *>;
+
 struct _GstHailoMuxer
 {
     GstElement element;
@@ -52,8 +64,19 @@ struct _GstHailoMuxer
     gboolean sync_counters;
     uint current_counter_main;
     uint current_counter_sub;
+    // Match modes: frames wait in reorder windows and are paired by offset / pts, no streaming thread blocks.
+    GstHailoMuxerMatchMode match_mode;
+    uint window_size;
+    guint64 match_tolerance;
+    std::unique_ptr<GstHailoMuxerPairingWindow> pairing_window;
+    // Number of frames each pad received in the offset mode, the key of frames without a valid offset.
+    guint64 arrival_main;
+    guint64 arrival_sub;
+    std::atomic<bool> warned_arrival_order;
 
     std::mutex mutex;
+    // Serializes releasing main frames in the match modes, so they are pushed in order from any streaming thread.
+    std::mutex release_mutex;
     std::condition_variable cv_main;
     std::condition_variable cv_sub;
 };
@@ -45,6 +45,14 @@ GType gst_hailo_round_robin_pad_get_type(void);
 #define MAX_PREROLL_FRAMES 30
 #define MIN_PREROLL_FRAMES 1
 
+#define DEFAULT_MAX_LATENCY 0
+#define MAX_MAX_LATENCY 10000
+#define MIN_MAX_LATENCY 0
+
+#define DEFAULT_PAD_WEIGHT 1
+#define MAX_PAD_WEIGHT 16
+#define MIN_PAD_WEIGHT 1
+
 typedef struct _GstHailoRoundRobinPad GstHailoRoundRobinPad;
 typedef struct _GstHailoRoundRobinPadClass GstHailoRoundRobinPadClass;
 
@@ -71,6 +79,7 @@ struct _GstHailoRoundRobinPad
 {
     GstPad parent;
     gboolean got_eos;
+    guint weight;
 };
 
 struct _GstHailoRoundRobinPadClass
@@ -100,17 +109,81 @@ enum
     PROP_QUEUE_SIZE,
     PROP_WAIT_TIME,
     PROP_PREROLL_FRAMES,
+    PROP_MAX_LATENCY,
 };
 
+enum
+{
+    PROP_PAD_0,
+    PROP_PAD_WEIGHT,
+};
+
+static void
+gst_hailo_round_robin_pad_set_property(GObject *object, guint prop_id,
+                                       const GValue *value, GParamSpec *pspec)
+{
+    GstHailoRoundRobinPad *pad = GST_HAILO_ROUND_ROBIN_PAD_CAST(object);
+
+    switch (prop_id)
+    {
+    case PROP_PAD_WEIGHT:
+    {
+        pad->weight = g_value_get_uint(value);
+        GstObject *parent = gst_pad_get_parent(GST_PAD_CAST(pad));
+        if (parent != NULL)
+        {
+            GST_HAILO_ROUND_ROBIN_CAST(parent)->scheduler->set_weight(get_pad_num(GST_PAD_CAST(pad)), pad->weight);
+            gst_object_unref(parent);
+        }
+        break;
+    }
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+gst_hailo_round_robin_pad_get_property(GObject *object, guint prop_id,
+                                       GValue *value, GParamSpec *pspec)
+{
+    GstHailoRoundRobinPad *pad = GST_HAILO_ROUND_ROBIN_PAD_CAST(object);
+
+    switch (prop_id)
+    {
+    case PROP_PAD_WEIGHT:
+        g_value_set_uint(value, pad->weight);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
 static void
 gst_hailo_round_robin_pad_class_init(GstHailoRoundRobinPadClass *klass)
 {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->set_property = gst_hailo_round_robin_pad_set_property;
+    gobject_class->get_property = gst_hailo_round_robin_pad_get_property;
+
+    g_object_class_install_property(gobject_class,
+                                    PROP_PAD_WEIGHT,
+                                    g_param_spec_uint("weight",
+                                                      "Weight",
+                                                      "Number of buffers the pad may push on its turn (only relevant when using non-blocking mode)",
+                                                      MIN_PAD_WEIGHT,
+                                                      MAX_PAD_WEIGHT,
+                                                      DEFAULT_PAD_WEIGHT,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
 gst_hailo_round_robin_pad_init(GstHailoRoundRobinPad *pad)
 {
     pad->got_eos = FALSE;
+    pad->weight = DEFAULT_PAD_WEIGHT;
 }
 
 static GstStaticPadTemplate sink_template = GST_STATIC_PAD_TEMPLATE("sink_%u",
@@ -126,7 +199,9 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE("src",
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT(gst_hailo_round_robin_debug, "hailo_round_robin", 0, "hailo_round_robin element");
 #define gst_hailo_round_robin_parent_class parent_class
-G_DEFINE_TYPE_WITH_CODE(GstHailoRoundRobin, gst_hailo_round_robin, GST_TYPE_ELEMENT, _do_init);
+static void gst_hailo_round_robin_child_proxy_init(gpointer g_iface, gpointer iface_data);
+G_DEFINE_TYPE_WITH_CODE(GstHailoRoundRobin, gst_hailo_round_robin, GST_TYPE_ELEMENT, _do_init
+                        G_IMPLEMENT_INTERFACE(GST_TYPE_CHILD_PROXY, gst_hailo_round_robin_child_proxy_init));
 
 static GstStateChangeReturn gst_hailo_round_robin_change_state(GstElement *element,
                                                                GstStateChange transition);
@@ -156,6 +231,13 @@ static GstPad *gst_hailo_round_robin_request_new_pad(GstElement *element,
 static void gst_hailo_round_robin_release_pad(GstElement *element, GstPad *pad);
 static void gst_hailo_round_robin_dispose(GObject *object);
 
+static void
+update_turn_wait(GstHailoRoundRobin *hailo_round_robin)
+{
+    // A pad that is not ready on its turn is waited for retries-num times wait-time before it is skipped
+    hailo_round_robin->scheduler->set_turn_wait(std::chrono::milliseconds(hailo_round_robin->retries_num * hailo_round_robin->wait_time));
+}
+
 static void
 gst_hailo_round_robin_set_property(GObject *object, guint prop_id,
                                    const GValue *value, GParamSpec *pspec)
@@ -170,16 +252,25 @@ gst_hailo_round_robin_set_property(GObject *object, guint prop_id,
     case PROP_RETRIES_NUM:
     {
         GST_HAILO_ROUND_ROBIN(object)->retries_num = g_value_get_uint(value);
+        update_turn_wait(GST_HAILO_ROUND_ROBIN(object));
         break;
     }
     case PROP_QUEUE_SIZE:
     {
         GST_HAILO_ROUND_ROBIN(object)->queue_size = g_value_get_uint(value);
+        GST_HAILO_ROUND_ROBIN(object)->scheduler->set_queue_size(GST_HAILO_ROUND_ROBIN(object)->queue_size);
         break;
     }
     case PROP_WAIT_TIME:
     {
         GST_HAILO_ROUND_ROBIN(object)->wait_time = g_value_get_uint(value);
+        update_turn_wait(GST_HAILO_ROUND_ROBIN(object));
+        break;
+    }
+    case PROP_MAX_LATENCY:
+    {
+        GST_HAILO_ROUND_ROBIN(object)->max_latency = g_value_get_uint(value);
+        GST_HAILO_ROUND_ROBIN(object)->scheduler->set_max_latency(std::chrono::milliseconds(GST_HAILO_ROUND_ROBIN(object)->max_latency));
         break;
     }
     case PROP_PREROLL_FRAMES:
@@ -214,6 +305,9 @@ gst_hailo_round_robin_get_property(GObject *object, guint prop_id, GValue *value
     case PROP_PREROLL_FRAMES:
         g_value_set_uint(value, GST_HAILO_ROUND_ROBIN(object)->preroll_frames);
         break;
+    case PROP_MAX_LATENCY:
+        g_value_set_uint(value, GST_HAILO_ROUND_ROBIN(object)->max_latency);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
         break;
@@ -265,70 +359,94 @@ forward_events(GstPad *pad, GstEvent **event, gpointer user_data)
     return res;
 }
 
-void schedule(GstHailoRoundRobin *hailo_round_robin)
+static GstPad *
+get_sink_pad_by_num(GstHailoRoundRobin *hailo_round_robin, size_t pad_num)
+{
+    GstPad *pad = gst_element_get_static_pad(GST_ELEMENT_CAST(hailo_round_robin), ("sink_" + std::to_string(pad_num)).c_str());
+
+    if (pad == NULL) // not found, will try different method - maybe the pad names are hailoroundrobinpad0, hailoroundrobinpad1, etc.
+    {
+        pad = gst_element_get_static_pad(GST_ELEMENT_CAST(hailo_round_robin), ("hailoroundrobinpad" + std::to_string(pad_num)).c_str());
+    }
+    return pad;
+}
+
+static void
+unref_buffers(std::vector<GstBuffer *> &buffers)
+{
+    for (GstBuffer *buf : buffers)
+    {
+        gst_buffer_unref(buf);
+    }
+    buffers.clear();
+}
+
+/**
+ * Scheduler thread of the non-blocking mode.
+ * Sleeps until a pad has a pending buffer, and pushes the buffers in the order chosen by the scheduler.
+ * Buffers that waited longer than max-latency are dropped.
+ */
+static void
+schedule(GstHailoRoundRobin *hailo_round_robin)
 {
     GstFlowReturn res;
-    while (!hailo_round_robin->stop_thread)
+    std::vector<GstBuffer *> expired;
+    size_t pad_num;
+    GstBuffer *buf;
+
+    while (hailo_round_robin->scheduler->pop(pad_num, buf, expired))
     {
-        // iterate the pad queues and push the first buffer in each queueq
-        for (uint i = 0; i < hailo_round_robin->pad_queues.size(); i++)
+        if (!expired.empty())
         {
-            if (hailo_round_robin->pad_queues[i] != NULL)
-            {
-                for (uint j = 0; j <= hailo_round_robin->retries_num; j++)
-                {
-                    if (hailo_round_robin->pad_queues[i]->empty())
-                    {
-                        if (j < hailo_round_robin->retries_num) // don't sleep on the last iteration
-                        {
-                            sleep((float)hailo_round_robin->wait_time / 1000.0);
-                        }
-                    }
-                    else
-                    {
-                        set_current_pad_num(hailo_round_robin, i);
-                        GstBuffer *buf = hailo_round_robin->pad_queues[i]->front();
-                        hailo_round_robin->pad_queues[i]->pop();
-                        if (hailo_round_robin->condition_vars_non_blocking[i] == NULL)
-                        {
-                            continue;
-                        }
-                        hailo_round_robin->condition_vars_non_blocking[i]->notify_one();
-
-                        GstPad *pad = gst_element_get_static_pad(GST_ELEMENT_CAST(hailo_round_robin), ("sink_" + std::to_string(i)).c_str());
-
-                        if (pad == NULL) // not found, will try different method - maybe the pad names are hailoroundrobinpad0, hailoroundrobinpad1, etc.
-                        {
-                            pad = gst_element_get_static_pad(GST_ELEMENT_CAST(hailo_round_robin), ("hailoroundrobinpad" + std::to_string(i)).c_str());
-                            if (pad == NULL)
-                            {
-                                GST_ERROR_OBJECT(hailo_round_robin, "Failed to get pad %d", i);
-                                continue;
-                            }
-                        }
-                        gchar *pad_name = gst_pad_get_name(pad);
-                        gchar *stream_id = gst_pad_get_stream_id(pad);
-
-                        // Add stream meta to the buffer including the pad name and stream id.
-                        gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
-
-                        // Forward sticky events.
-                        gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
-
-                        // Push out_buffer forward.
-                        res = gst_pad_push(hailo_round_robin->srcpad, buf);
-                        if (res != GST_FLOW_OK)
-                        {
-                            GST_ERROR_OBJECT(hailo_round_robin, "Failed to push buffer to srcpad");
-                        }
-                        gst_object_unref(pad);
-                        g_free(pad_name);
-                        g_free(stream_id);
-                        break; // make sure it only pushes 1 buffer per pad
-                    }
-                }
-            }
+            GST_DEBUG_OBJECT(hailo_round_robin, "Dropping %zu buffers that exceeded max-latency", expired.size());
+            unref_buffers(expired);
+        }
+
+        GstPad *pad = get_sink_pad_by_num(hailo_round_robin, pad_num);
+        if (pad == NULL)
+        {
+            GST_ERROR_OBJECT(hailo_round_robin, "Failed to get pad %zu", pad_num);
+            gst_buffer_unref(buf);
+            continue;
         }
+        set_current_pad_num(hailo_round_robin, pad_num);
+
+        // Forward sticky events.
+        gst_pad_sticky_events_foreach(pad, forward_events, hailo_round_robin->srcpad);
+
+        // Push out_buffer forward.
+        res = gst_pad_push(hailo_round_robin->srcpad, buf);
+        if (res != GST_FLOW_OK && res != GST_FLOW_FLUSHING)
+        {
+            GST_ERROR_OBJECT(hailo_round_robin, "Failed to push buffer to srcpad");
+        }
+        gst_object_unref(pad);
+    }
+    unref_buffers(expired);
+}
+
+static void
+start_scheduler_thread(GstHailoRoundRobin *hailo_round_robin)
+{
+    std::lock_guard<std::mutex> lock(*hailo_round_robin->scheduler_thread_mutex);
+    if (!hailo_round_robin->scheduler_thread)
+    {
+        hailo_round_robin->scheduler_thread = std::make_unique<std::thread>(schedule, hailo_round_robin);
+    }
+}
+
+static void
+stop_scheduler_thread(GstHailoRoundRobin *hailo_round_robin)
+{
+    // Release the blocked chain functions and the scheduler thread, and drop the queued buffers
+    std::vector<GstBuffer *> pending = hailo_round_robin->scheduler->stop();
+    unref_buffers(pending);
+
+    std::lock_guard<std::mutex> lock(*hailo_round_robin->scheduler_thread_mutex);
+    if (hailo_round_robin->scheduler_thread)
+    {
+        hailo_round_robin->scheduler_thread->join();
+        hailo_round_robin->scheduler_thread.reset();
     }
 }
 
@@ -400,6 +518,15 @@ gst_hailo_round_robin_class_init(GstHailoRoundRobinClass *klass)
                                                       MAX_PREROLL_FRAMES,
                                                       DEFAULT_PREROLL_FRAMES,
                                                       (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(gobject_class,
+                                    PROP_MAX_LATENCY,
+                                    g_param_spec_uint("max-latency",
+                                                      "Max latency",
+                                                      "Time in ms a buffer may wait in a pad queue before it is dropped, 0 - never drop (only relevant when using non-blocking mode)",
+                                                      MIN_MAX_LATENCY,
+                                                      MAX_MAX_LATENCY,
+                                                      DEFAULT_MAX_LATENCY,
+                                                      (GParamFlags)(GST_PARAM_CONTROLLABLE | G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void
@@ -407,16 +534,16 @@ gst_hailo_round_robin_init(GstHailoRoundRobin *hailo_round_robin)
 {
     hailo_round_robin->current_pad_num = 0;
     hailo_round_robin->mutexes_blocking.clear();
-    hailo_round_robin->mutexes_non_blocking.clear();
-    hailo_round_robin->pad_queues.clear();
     hailo_round_robin->condition_vars_blocking.clear();
-    hailo_round_robin->condition_vars_non_blocking.clear();
     hailo_round_robin->preroll_buffer_counter = 0;
     hailo_round_robin->retries_num = DEFAULT_RETRIES_NUM;
     hailo_round_robin->queue_size = DEFAULT_QUEUE_SIZE;
     hailo_round_robin->wait_time = DEFAULT_WAIT_TIME;
     hailo_round_robin->preroll_frames = DEFAULT_PREROLL_FRAMES;
-    hailo_round_robin->stop_thread = false;
+    hailo_round_robin->max_latency = DEFAULT_MAX_LATENCY;
+    hailo_round_robin->scheduler = std::make_unique<RoundRobinScheduler<GstBuffer *>>(DEFAULT_QUEUE_SIZE);
+    update_turn_wait(hailo_round_robin);
+    hailo_round_robin->scheduler_thread_mutex = std::make_unique<std::mutex>();
     hailo_round_robin->srcpad = gst_pad_new_from_static_template(&src_template, "src");
     hailo_round_robin->mode = GST_HAILO_ROUND_ROBIN_MODE_BLOCKING;
     hailo_round_robin->current_pad_mutex = std::make_unique<std::shared_mutex>();
@@ -433,13 +560,10 @@ gst_hailo_round_robin_dispose(GObject *object)
     GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN_CAST(object);
     hailo_round_robin->srcpad = NULL;
     hailo_round_robin->current_pad_num = 0;
-    hailo_round_robin->pad_queues.clear();
     hailo_round_robin->preroll_buffer_counter = 0;
     hailo_round_robin->num_of_sink_pads = 0;
     hailo_round_robin->mutexes_blocking.clear();
-    hailo_round_robin->mutexes_non_blocking.clear();
     hailo_round_robin->condition_vars_blocking.clear();
-    hailo_round_robin->condition_vars_non_blocking.clear();
     G_OBJECT_CLASS(parent_class)->dispose(object);
 }
 
@@ -501,12 +625,10 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
     GST_OBJECT_FLAG_SET(sinkpad, GST_PAD_FLAG_PROXY_ALLOCATION);
 
     hailo_round_robin->mutexes_blocking.emplace_back(std::make_unique<std::mutex>());
-    hailo_round_robin->mutexes_non_blocking.emplace_back(std::make_unique<std::mutex>());
-
-    // create a new queue for the new pad
-    hailo_round_robin->pad_queues.emplace_back(std::make_unique<std::queue<GstBuffer *>>());
     hailo_round_robin->condition_vars_blocking.emplace_back(std::make_unique<std::condition_variable>());
-    hailo_round_robin->condition_vars_non_blocking.emplace_back(std::make_unique<std::condition_variable>());
+
+    // Register the pad queue in the non-blocking mode scheduler
+    hailo_round_robin->scheduler->add_stream(get_pad_num(sinkpad), GST_HAILO_ROUND_ROBIN_PAD_CAST(sinkpad)->weight);
 
     gst_pad_set_active(sinkpad, TRUE);
 
@@ -515,6 +637,8 @@ gst_hailo_round_robin_request_new_pad(GstElement *element, GstPadTemplate *templ
     GST_DEBUG_OBJECT(element, "requested pad %s:%s",
                      GST_DEBUG_PAD_NAME(sinkpad));
 
+    gst_child_proxy_child_added(GST_CHILD_PROXY(element), G_OBJECT(sinkpad), GST_OBJECT_NAME(sinkpad));
+
     return sinkpad;
 }
 
@@ -557,8 +681,8 @@ gst_hailo_round_robin_release_pad(GstElement *element, GstPad *pad)
     if (hailo_round_robin->condition_vars_blocking[get_pad_num(pad)] != NULL)
         hailo_round_robin->condition_vars_blocking[get_pad_num(pad)]->notify_all();
 
-    if (hailo_round_robin->condition_vars_non_blocking[get_pad_num(pad)] != NULL)
-        hailo_round_robin->condition_vars_non_blocking[get_pad_num(pad)]->notify_all();
+    std::vector<GstBuffer *> pending = hailo_round_robin->scheduler->remove_stream(get_pad_num(pad));
+    unref_buffers(pending);
     gst_element_remove_pad(GST_ELEMENT_CAST(hailo_round_robin), pad);
 }
 
@@ -613,9 +737,6 @@ gst_hailo_round_robin_sink_chain_preroll(GstPad *pad, GstObject *parent, GstBuff
     if (get_buffer_counter_value(hailo_round_robin) == (int)(hailo_round_robin->mutexes_blocking.size() * hailo_round_robin->preroll_frames))
     {
         set_buffer_counter_value(hailo_round_robin, -1); // don't use it anymore
-        std::thread schedule_thread(schedule, hailo_round_robin);
-        hailo_round_robin->thread = std::move(&schedule_thread);
-        hailo_round_robin->thread->detach();
         set_chain_to_all_pads(hailo_round_robin, gst_hailo_round_robin_sink_chain_non_blocking_mode);
         hailo_round_robin->current_pad_num = 0;
 
@@ -734,25 +855,25 @@ gst_hailo_round_robin_sink_chain_funnel_mode(GstPad *pad, GstObject *parent, Gst
 static GstFlowReturn
 gst_hailo_round_robin_sink_chain_non_blocking_mode(GstPad *pad, GstObject *parent, GstBuffer *buf)
 {
-    GstFlowReturn ret = GST_FLOW_ERROR;
     GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN_CAST(parent);
     size_t pad_num = get_pad_num(pad);
 
-    if (hailo_round_robin->condition_vars_non_blocking[pad_num] != NULL)
-    {
-        std::unique_lock lock(*hailo_round_robin->mutexes_non_blocking[pad_num].get());
-        hailo_round_robin->condition_vars_non_blocking[pad_num]->wait(lock, [hailo_round_robin, pad_num]
-                                                                      { return hailo_round_robin->pad_queues[pad_num]->size() < hailo_round_robin->queue_size; });
+    buf = gst_buffer_make_writable(buf);
+    gchar *pad_name = gst_pad_get_name(pad);
+    gchar *stream_id = gst_pad_get_stream_id(pad);
 
-        hailo_round_robin->pad_queues[pad_num]->push(buf);
-    }
-    else
+    // Add stream meta to the buffer including the pad name and stream id.
+    gst_buffer_add_hailo_stream_meta(buf, pad_name, stream_id);
+    g_free(pad_name);
+    g_free(stream_id);
+
+    // Blocks while the pad queue is full
+    if (!hailo_round_robin->scheduler->push(pad_num, buf))
     {
         gst_buffer_unref(buf);
-        return ret;
+        return GST_FLOW_FLUSHING;
     }
-    ret = GST_FLOW_OK;
-    return ret;
+    return GST_FLOW_OK;
 }
 
 static gboolean
@@ -768,6 +889,13 @@ gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event
 
     GST_DEBUG_OBJECT(pad, "received event %" GST_PTR_FORMAT, event);
 
+    if (GST_EVENT_TYPE(event) == GST_EVENT_EOS && get_buffer_counter_value(hailo_round_robin) == -1)
+    {
+        // Let the scheduler push the buffers that are still queued for this pad before the EOS
+        hailo_round_robin->scheduler->wait_drained(pad_num);
+        hailo_round_robin->scheduler->set_eos(pad_num, true);
+    }
+
     if (GST_EVENT_IS_STICKY(event))
     {
         unlock = TRUE;
@@ -778,7 +906,6 @@ gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event
             GST_OBJECT_LOCK(hailo_round_robin);
             fpad->got_eos = TRUE;
             hailo_round_robin->condition_vars_blocking[pad_num]->notify_all();
-            hailo_round_robin->condition_vars_non_blocking[pad_num]->notify_all();
             forward = gst_hailo_round_robin_all_sinkpads_eos_unlocked(hailo_round_robin);
             GST_OBJECT_UNLOCK(hailo_round_robin);
         }
@@ -794,6 +921,7 @@ gst_hailo_round_robin_sink_event(GstPad *pad, GstObject *parent, GstEvent *event
         GST_OBJECT_LOCK(hailo_round_robin);
         fpad->got_eos = FALSE;
         GST_OBJECT_UNLOCK(hailo_round_robin);
+        hailo_round_robin->scheduler->set_eos(pad_num, false);
     }
 
     if (forward && GST_EVENT_IS_SERIALIZED(event))
@@ -832,21 +960,35 @@ gst_hailo_round_robin_change_state(GstElement *element, GstStateChange transitio
 
     switch (transition)
     {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+    {
+        hailo_round_robin->scheduler->start();
+        // Started only here and stopped only when going to READY, so a chain call racing with the state
+        // change can't leave behind a thread that already exited on the stopped scheduler
+        if (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING)
+        {
+            start_scheduler_thread(hailo_round_robin);
+        }
+        break;
+    }
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+    {
+        // Must be done before the pads are deactivated, the chain functions may be blocked on full queues
+        if (hailo_round_robin->mode == GST_HAILO_ROUND_ROBIN_MODE_NON_BLOCKING)
+        {
+            stop_scheduler_thread(hailo_round_robin);
+        }
+        break;
+    }
     case GST_STATE_CHANGE_READY_TO_NULL:
     {
         if (hailo_round_robin->mode != GST_HAILO_ROUND_ROBIN_MODE_FUNNEL_MODE)
         {
-            hailo_round_robin->stop_thread = true;
             for (uint i = 0; i < hailo_round_robin->condition_vars_blocking.size(); i++)
             {
                 if (hailo_round_robin->condition_vars_blocking[i] != NULL)
                     hailo_round_robin->condition_vars_blocking[i]->notify_all();
             }
-            for (uint i = 0; i < hailo_round_robin->condition_vars_non_blocking.size(); i++)
-            {
-                if (hailo_round_robin->condition_vars_non_blocking[i] != NULL)
-                    hailo_round_robin->condition_vars_non_blocking[i]->notify_all();
-            }
             break;
         }
     }
@@ -858,3 +1000,42 @@ gst_hailo_round_robin_change_state(GstElement *element, GstStateChange transitio
 
     return ret;
 }
+
+/* GstChildProxy implementation - for using pad properties */
+static guint
+gst_hailo_round_robin_child_proxy_get_children_count(GstChildProxy *child_proxy)
+{
+    guint count = 0;
+    GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN(child_proxy);
+
+    GST_OBJECT_LOCK(hailo_round_robin);
+    count = GST_ELEMENT_CAST(hailo_round_robin)->numsinkpads;
+    GST_OBJECT_UNLOCK(hailo_round_robin);
+
+    return count;
+}
+
+static GObject *
+gst_hailo_round_robin_child_proxy_get_child_by_index(GstChildProxy *child_proxy,
+                                                     guint index)
+{
+    GstHailoRoundRobin *hailo_round_robin = GST_HAILO_ROUND_ROBIN(child_proxy);
+    GObject *obj = NULL;
+
+    GST_OBJECT_LOCK(hailo_round_robin);
+    obj = G_OBJECT(g_list_nth_data(GST_ELEMENT_CAST(hailo_round_robin)->sinkpads, index));
+    if (obj)
+        gst_object_ref(obj);
+    GST_OBJECT_UNLOCK(hailo_round_robin);
+
+    return obj;
+}
+
+static void
+gst_hailo_round_robin_child_proxy_init(gpointer g_iface, gpointer iface_data)
+{
+    GstChildProxyInterface *iface = (GstChildProxyInterface *)g_iface;
+
+    iface->get_child_by_index = gst_hailo_round_robin_child_proxy_get_child_by_index;
+    iface->get_children_count = gst_hailo_round_robin_child_proxy_get_children_count;
+}
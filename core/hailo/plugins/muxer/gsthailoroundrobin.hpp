@@ -19,6 +19,7 @@
 #include <condition_variable>
 #include <pthread.h>
 #include <thread>
+#include "round_robin_scheduler.hpp"
 
 G_BEGIN_DECLS
 
@@ -61,15 +62,15 @@ struct _GstHailoRoundRobin
     uint queue_size;
     uint wait_time;
     uint preroll_frames;
+    uint max_latency;
     std::vector<std::unique_ptr<std::mutex>> mutexes_blocking;
-    std::vector<std::unique_ptr<std::mutex>> mutexes_non_blocking;
     std::unique_ptr<std::shared_mutex> counter_mutex;
     int preroll_buffer_counter;
     std::vector<std::unique_ptr<std::condition_variable>> condition_vars_blocking;
-    std::vector<std::unique_ptr<std::condition_variable>> condition_vars_non_blocking;
-    std::vector<std::unique_ptr<std::queue<GstBuffer *>>> pad_queues;
-    std::thread *thread;
-    gboolean stop_thread;
+    // Non-blocking mode: buffers are queued per pad and pushed by the scheduler thread
+    std::unique_ptr<RoundRobinScheduler<GstBuffer *>> scheduler;
+    std::unique_ptr<std::thread> scheduler_thread;
+    std::unique_ptr<std::mutex> scheduler_thread_mutex;
     std::unique_ptr<std::shared_mutex> current_pad_mutex;
 };
 
@@ -34,6 +34,24 @@ GType gst_hailo_stream_router_pad_get_type(void);
 
 #define GST_HAILO_STREAM_ROUTER_MAX_INPUT_PADS 40
 
+#define GST_TYPE_HAILO_STREAM_ROUTER_FAN_OUT_MODE (gst_hailo_stream_router_fan_out_mode_get_type())
+static GType
+gst_hailo_stream_router_fan_out_mode_get_type(void)
+{
+    static GType hailo_stream_router_fan_out_mode_type = 0;
+    static const GEnumValue hailo_stream_router_fan_out_modes[] = {
+        {GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_COPY, "Copy Mode (every target gets a copy of the buffer, all copies share the same metadata)", "copy"},
+        {GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_SHARED, "Shared Mode (targets share the buffer memory, every target gets its own copy on write clone of the metadata)", "shared"},
+        {0, NULL, NULL},
+    };
+    if (!hailo_stream_router_fan_out_mode_type)
+    {
+        hailo_stream_router_fan_out_mode_type =
+            g_enum_register_static("GstHailoStreamRouterFanOutMode", hailo_stream_router_fan_out_modes);
+    }
+    return hailo_stream_router_fan_out_mode_type;
+}
+
 typedef struct _GstHailoStreamRouterPad GstHailoStreamRouterPad;
 typedef struct _GstHailoStreamRouterPadClass GstHailoStreamRouterPadClass;
 
@@ -55,6 +73,12 @@ struct _GstHailoStreamRouterPadClass
 
 G_DEFINE_TYPE(GstHailoStreamRouterPad, gst_hailo_stream_router_pad, GST_TYPE_PAD);
 
+enum
+{
+    PROP_0,
+    PROP_FAN_OUT_MODE,
+};
+
 enum
 {
     PROP_PAD_0,
@@ -79,6 +103,12 @@ static void gst_hailo_stream_router_release_pad(GstElement *element, GstPad *pad
 static GstStateChangeReturn gst_hailo_stream_router_change_state(GstElement *element, GstStateChange transition);
 static GstFlowReturn gst_hailo_stream_router_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *buffer);
 
+static void gst_hailo_stream_router_set_property(GObject *object, guint prop_id,
+                                                 const GValue *value, GParamSpec *pspec);
+
+static void gst_hailo_stream_router_get_property(GObject *object, guint prop_id,
+                                                 GValue *value, GParamSpec *pspec);
+
 static void gst_hailo_stream_router_pad_set_property(GObject *object, guint prop_id,
                                                      const GValue *value, GParamSpec *pspec);
 
@@ -110,6 +140,15 @@ gst_hailo_stream_router_class_init(GstHailoStreamRouterClass *klass)
 
     gobject_class->finalize = GST_DEBUG_FUNCPTR(gst_hailo_stream_router_finalize);
     gobject_class->dispose = GST_DEBUG_FUNCPTR(gst_hailo_stream_router_dispose);
+    gobject_class->set_property = gst_hailo_stream_router_set_property;
+    gobject_class->get_property = gst_hailo_stream_router_get_property;
+
+    g_object_class_install_property(gobject_class, PROP_FAN_OUT_MODE,
+                                    g_param_spec_enum("fan-out-mode", "Fan out mode",
+                                                      "How a buffer is passed to multiple target src pads (copy - every target gets a copy of the buffer that shares the metadata with the other targets, shared - the buffer memory is shared and every target gets its own copy on write clone of the metadata, so targets can modify it independently)",
+                                                      GST_TYPE_HAILO_STREAM_ROUTER_FAN_OUT_MODE,
+                                                      (gint)GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_COPY,
+                                                      (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 
     // Request and release pads
     gstelement_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_hailo_stream_router_request_new_pad);
@@ -136,6 +175,8 @@ gst_hailo_stream_router_init(GstHailoStreamRouter *hailo_stream_router)
     // Initialize hash table (of key -> value: input stream name -> target src_pads)
     hailo_stream_router->targets_table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)g_array_unref);
 
+    hailo_stream_router->fan_out_mode = GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_COPY;
+
     // Initialize element mutex
     g_mutex_init(&hailo_stream_router->lock);
 
@@ -154,6 +195,40 @@ gst_hailo_stream_router_dispose(GObject *object)
     G_OBJECT_CLASS(parent_class)->dispose(object);
 }
 
+static void
+gst_hailo_stream_router_set_property(GObject *object, guint prop_id,
+                                     const GValue *value, GParamSpec *pspec)
+{
+    GstHailoStreamRouter *hailo_stream_router = GST_HAILO_STREAM_ROUTER(object);
+
+    switch (prop_id)
+    {
+    case PROP_FAN_OUT_MODE:
+        hailo_stream_router->fan_out_mode = (GstHailoStreamRouterFanOutMode)g_value_get_enum(value);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
+static void
+gst_hailo_stream_router_get_property(GObject *object, guint prop_id,
+                                     GValue *value, GParamSpec *pspec)
+{
+    GstHailoStreamRouter *hailo_stream_router = GST_HAILO_STREAM_ROUTER(object);
+
+    switch (prop_id)
+    {
+    case PROP_FAN_OUT_MODE:
+        g_value_set_enum(value, hailo_stream_router->fan_out_mode);
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+        break;
+    }
+}
+
 static gpointer
 gst_pads_lookup(GstHailoStreamRouter *hailo_stream_router, const gchar *input_pad_name)
 {
@@ -405,9 +480,34 @@ forward_events(GstPad *pad, GstEvent **event, gpointer user_data)
     return TRUE;
 }
 
+/**
+ * Prepares the incoming buffer of a shared fan out: its hailo meta is set to clone on copy, so every copy of it
+ * (every target but the last) holds its own copy on write clone of the main object. Cloning is O(1), the objects
+ * are copied only when a branch first accesses them, so the branches can modify the metadata independently.
+ * The copies only reference the memory of the incoming buffer (pixels are not copied), GStreamer copies
+ * the memory only if a branch maps it for writing.
+ *
+ * @param buffer The incoming buffer
+ * @return GstBuffer* The incoming buffer, made writable to set its meta
+ */
+static GstBuffer *
+prepare_shared_fan_out(GstBuffer *buffer)
+{
+    GstHailoMeta *hailo_meta = gst_buffer_get_hailo_meta(buffer);
+    if (!hailo_meta || hailo_meta->clone_on_copy)
+    {
+        return buffer;
+    }
+    buffer = gst_buffer_make_writable(buffer);
+    gst_hailo_meta_set_clone_on_copy(gst_buffer_get_hailo_meta(buffer), TRUE);
+    return buffer;
+}
+
 /**
  * Chain method of the sink pad
  * On incomming buffer, get the target src_pad from the hash table, and forward the buffer to it.
+ * In shared fan out mode the last target gets the incoming buffer itself, and every other target gets a buffer
+ * that shares its memory and holds its own copy on write clone of the metadata.
  *
  * @param pad  The sink pad
  * @param parent GstObject stream_router element
@@ -420,6 +520,7 @@ gst_hailo_stream_router_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *bu
     GstHailoStreamRouter *stream_router = GST_HAILO_STREAM_ROUTER(parent);
 
     GstFlowReturn result = GST_FLOW_OK;
+    gboolean shared_fan_out = stream_router->fan_out_mode == GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_SHARED;
 
     // Get the input stream name from the stream metadata on the buffer
     gchar *input_pad_name = gst_buffer_get_hailo_stream_meta(buffer)->pad_name;
@@ -431,6 +532,22 @@ gst_hailo_stream_router_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *bu
         guint i;
         GArray *src_pads = (GArray *)pads_ptr;
         GstHailoStreamRouterPad *src_pad;
+        // Find the last valid target, it takes ownership of the incoming buffer in shared mode
+        gint last_target = -1;
+        guint num_targets = 0;
+        for (i = 0; i < src_pads->len; i++)
+        {
+            if (GST_IS_PAD(g_array_index(src_pads, GstHailoStreamRouterPad *, i)))
+            {
+                last_target = i;
+                num_targets++;
+            }
+        }
+        // With a single target there is nothing to share
+        if (shared_fan_out && num_targets > 1)
+        {
+            buffer = prepare_shared_fan_out(buffer);
+        }
         // Iterate over the target src_pads
         for (i = 0; i < src_pads->len; i++)
         {
@@ -440,7 +557,16 @@ gst_hailo_stream_router_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *bu
                 // Forward sticky events.
                 gst_pad_sticky_events_foreach(pad, forward_events, src_pad);
 
-                GstBuffer *buffer_copy = gst_buffer_copy(buffer);
+                GstBuffer *buffer_copy;
+                if (shared_fan_out && (gint)i == last_target)
+                {
+                    buffer_copy = buffer;
+                    buffer = NULL;
+                }
+                else
+                {
+                    buffer_copy = gst_buffer_copy(buffer);
+                }
 
                 // Push the buffer to the src_pad
                 result = gst_pad_push(GST_PAD(src_pad), buffer_copy);
@@ -448,7 +574,10 @@ gst_hailo_stream_router_sink_chain(GstPad *pad, GstObject *parent, GstBuffer *bu
         }
     }
 
-    gst_buffer_unref(buffer);
+    if (buffer)
+    {
+        gst_buffer_unref(buffer);
+    }
     return result;
 }
 
@@ -33,6 +33,12 @@ G_BEGIN_DECLS
 typedef struct _GstHailoStreamRouter GstHailoStreamRouter;
 typedef struct _GstHailoStreamRouterClass GstHailoStreamRouterClass;
 
+typedef enum
+{
+  GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_COPY = 0,
+  GST_HAILO_STREAM_ROUTER_FAN_OUT_MODE_SHARED = 1,
+} GstHailoStreamRouterFanOutMode;
+
 /**
  * GstHailoStreamRouter:
  *
@@ -46,6 +52,7 @@ struct _GstHailoStreamRouter
   GstPad *sinkpad;
   GMutex lock;
   GHashTable *targets_table;
+  GstHailoStreamRouterFanOutMode fan_out_mode;
 };
 
 struct _GstHailoStreamRouterClass
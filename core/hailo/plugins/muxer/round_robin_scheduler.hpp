@@ -0,0 +1,383 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/*
+ * round_robin_scheduler.hpp: Weighted round robin scheduler of the hailoroundrobin non-blocking mode.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Schedules the items of several streams into a single output.
+ *
+ * Producers push items into bounded per stream queues, a single consumer pops them one at a time.
+ * Streams with pending items are kept in a ready set (a bitmask), so the consumer sleeps on a condition
+ * variable until there is work instead of polling the queues, and finds the next ready stream with a
+ * few bit operations.
+ *
+ * Fairness follows deficit round robin: on its turn a stream may send up to its weight in items, a stream
+ * that runs out of items loses the rest of its turn. When the stream next in line has no pending items the
+ * consumer waits up to turn_wait for it, and then skips to the next ready stream.
+ * Items that waited longer than max_latency are not sent, they are returned to the consumer as expired.
+ *
+ * @tparam T The type of the scheduled items (a GstBuffer* in the element).
+ */
+template <typename T>
+class RoundRobinScheduler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct StreamStats
+    {
+        uint64_t pushed = 0;
+        uint64_t popped = 0;
+        uint64_t expired = 0;
+    };
+
+private:
+    static constexpr size_t NO_STREAM = SIZE_MAX;
+    static constexpr size_t WORD_BITS = 64;
+
+    struct Item
+    {
+        T value;
+        Clock::time_point arrival;
+    };
+
+    struct Stream
+    {
+        std::deque<Item> queue;
+        uint weight = 1;
+        uint deficit = 0;
+        bool active = false;
+        bool eos = false;
+        StreamStats stats;
+        std::condition_variable space_cv;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_ready_cv;
+    std::vector<std::unique_ptr<Stream>> m_streams;
+    std::vector<uint64_t> m_ready_set;
+    size_t m_queue_size;
+    Clock::duration m_turn_wait;
+    Clock::duration m_max_latency;
+    size_t m_current;
+    bool m_stopped;
+
+    bool is_ready(size_t index) const
+    {
+        return m_ready_set[index / WORD_BITS] & (uint64_t(1) << (index % WORD_BITS));
+    }
+
+    void set_ready(size_t index, bool ready)
+    {
+        uint64_t bit = uint64_t(1) << (index % WORD_BITS);
+        if (ready)
+            m_ready_set[index / WORD_BITS] |= bit;
+        else
+            m_ready_set[index / WORD_BITS] &= ~bit;
+    }
+
+    // Returns the first ready stream in [begin, end), or NO_STREAM.
+    size_t find_ready(size_t begin, size_t end) const
+    {
+        for (size_t word = begin / WORD_BITS; word * WORD_BITS < end; word++)
+        {
+            uint64_t bits = m_ready_set[word];
+            if (word == begin / WORD_BITS)
+                bits &= ~uint64_t(0) << (begin % WORD_BITS);
+            if (bits == 0)
+                continue;
+            size_t index = word * WORD_BITS + __builtin_ctzll(bits);
+            return index < end ? index : NO_STREAM;
+        }
+        return NO_STREAM;
+    }
+
+    // Returns the next ready stream after the current one in circular order, or NO_STREAM.
+    size_t find_next_ready() const
+    {
+        size_t start = (m_current == NO_STREAM) ? 0 : m_current + 1;
+        size_t index = find_ready(start, m_streams.size());
+        if (index == NO_STREAM)
+            index = find_ready(0, std::min(start, m_streams.size()));
+        return index;
+    }
+
+    // Returns the next active stream after the current one in circular order, or NO_STREAM.
+    size_t find_next_active() const
+    {
+        for (size_t i = 1; i <= m_streams.size(); i++)
+        {
+            size_t index = (m_current == NO_STREAM) ? i - 1 : (m_current + i) % m_streams.size();
+            if (m_streams[index]->active)
+                return index;
+        }
+        return NO_STREAM;
+    }
+
+    void ensure_stream(size_t index)
+    {
+        while (m_streams.size() <= index)
+            m_streams.emplace_back(std::make_unique<Stream>());
+        m_ready_set.resize((m_streams.size() + WORD_BITS - 1) / WORD_BITS, 0);
+    }
+
+    // Moves the expired items at the head of a stream queue to expired, returns whether the stream is still ready.
+    bool drop_expired(size_t index, Clock::time_point now, std::vector<T> &expired)
+    {
+        Stream &stream = *m_streams[index];
+        bool dropped = false;
+        while (!stream.queue.empty() && (now - stream.queue.front().arrival) > m_max_latency)
+        {
+            expired.emplace_back(stream.queue.front().value);
+            stream.queue.pop_front();
+            stream.stats.expired++;
+            dropped = true;
+        }
+        if (dropped)
+            stream.space_cv.notify_all();
+        if (stream.queue.empty())
+        {
+            set_ready(index, false);
+            stream.deficit = 0;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    RoundRobinScheduler(size_t queue_size = 3)
+        : m_queue_size(queue_size), m_turn_wait(Clock::duration::zero()), m_max_latency(Clock::duration::zero()),
+          m_current(NO_STREAM), m_stopped(false){};
+
+    void set_queue_size(size_t queue_size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue_size = queue_size;
+        for (auto &stream : m_streams)
+            stream->space_cv.notify_all();
+    }
+
+    /**
+     * @brief Set how long to wait for the stream next in line before skipping it, zero never waits.
+     */
+    void set_turn_wait(Clock::duration turn_wait)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_turn_wait = turn_wait;
+    }
+
+    /**
+     * @brief Set how long an item may wait in its queue before it expires, zero never expires items.
+     */
+    void set_max_latency(Clock::duration max_latency)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_max_latency = max_latency;
+    }
+
+    void add_stream(size_t index, uint weight = 1)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ensure_stream(index);
+        m_streams[index]->active = true;
+        m_streams[index]->eos = false;
+        m_streams[index]->weight = std::max(weight, 1u);
+    }
+
+    /**
+     * @brief Remove a stream, producers blocked on it are released.
+     *
+     * @return std::vector<T> The items that were pending in the stream queue.
+     */
+    std::vector<T> remove_stream(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<T> pending;
+        if (index >= m_streams.size())
+            return pending;
+        Stream &stream = *m_streams[index];
+        for (auto &item : stream.queue)
+            pending.emplace_back(item.value);
+        stream.queue.clear();
+        stream.active = false;
+        stream.deficit = 0;
+        set_ready(index, false);
+        stream.space_cv.notify_all();
+        m_ready_cv.notify_all();
+        return pending;
+    }
+
+    void set_weight(size_t index, uint weight)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ensure_stream(index);
+        m_streams[index]->weight = std::max(weight, 1u);
+    }
+
+    /**
+     * @brief Mark a stream as ended (or not), the consumer does not wait for the turn of an ended stream.
+     */
+    void set_eos(size_t index, bool eos)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ensure_stream(index);
+        m_streams[index]->eos = eos;
+        m_ready_cv.notify_all();
+    }
+
+    /**
+     * @brief Push an item to a stream, blocks while the stream queue is full.
+     *
+     * @return true if the item was queued, false if the scheduler is stopped or the stream was removed,
+     *         in that case the item is still owned by the caller.
+     */
+    bool push(size_t index, T value)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        ensure_stream(index);
+        Stream &stream = *m_streams[index];
+        stream.space_cv.wait(lock, [this, &stream]
+                             { return m_stopped || !stream.active || stream.queue.size() < m_queue_size; });
+        if (m_stopped || !stream.active)
+            return false;
+
+        stream.queue.push_back({value, Clock::now()});
+        stream.stats.pushed++;
+        if (!is_ready(index))
+        {
+            set_ready(index, true);
+            m_ready_cv.notify_all();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Pop the next item, blocks until there is one or the scheduler is stopped.
+     *
+     * @param[out] index The stream the item belongs to.
+     * @param[out] value The item.
+     * @param[out] expired Expired items found on the way are appended, the caller owns them.
+     * @return false if the scheduler was stopped.
+     */
+    bool pop(size_t &index, T &value, std::vector<T> &expired)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_stopped)
+        {
+            size_t next = NO_STREAM;
+            // The current stream keeps its turn while it has a deficit left
+            if (m_current != NO_STREAM && m_current < m_streams.size() && m_streams[m_current]->deficit > 0 && is_ready(m_current))
+            {
+                next = m_current;
+            }
+            else
+            {
+                size_t in_line = find_next_active();
+                if (in_line != NO_STREAM && !is_ready(in_line) && !m_streams[in_line]->eos &&
+                    m_turn_wait > Clock::duration::zero())
+                {
+                    m_ready_cv.wait_for(lock, m_turn_wait, [this, in_line]
+                                        { return m_stopped || is_ready(in_line) || !m_streams[in_line]->active || m_streams[in_line]->eos; });
+                    if (m_stopped)
+                        break;
+                }
+                next = find_next_ready();
+                if (next == NO_STREAM)
+                {
+                    m_ready_cv.wait(lock, [this]
+                                    { return m_stopped || find_ready(0, m_streams.size()) != NO_STREAM; });
+                    continue;
+                }
+                if (next != m_current || m_streams[next]->deficit == 0)
+                    m_streams[next]->deficit += m_streams[next]->weight;
+                // Streams skipped on the way lose their turn
+                if (m_current != NO_STREAM && next != m_current && m_current < m_streams.size())
+                    m_streams[m_current]->deficit = 0;
+                m_current = next;
+            }
+
+            if (m_max_latency > Clock::duration::zero() && !drop_expired(next, Clock::now(), expired))
+                continue;
+
+            Stream &stream = *m_streams[next];
+            value = stream.queue.front().value;
+            stream.queue.pop_front();
+            stream.stats.popped++;
+            stream.deficit--;
+            if (stream.queue.empty())
+            {
+                set_ready(next, false);
+                stream.deficit = 0;
+            }
+            stream.space_cv.notify_all();
+            index = next;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Wait until all the items of a stream were popped, or the scheduler is stopped.
+     */
+    void wait_drained(size_t index)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (index >= m_streams.size())
+            return;
+        Stream &stream = *m_streams[index];
+        stream.space_cv.wait(lock, [this, &stream]
+                             { return m_stopped || !stream.active || stream.queue.empty(); });
+    }
+
+    /**
+     * @brief Stop the scheduler, blocked producers and consumer are released.
+     *
+     * @return std::vector<T> The items that were pending in all the queues.
+     */
+    std::vector<T> stop()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<T> pending;
+        m_stopped = true;
+        for (size_t i = 0; i < m_streams.size(); i++)
+        {
+            for (auto &item : m_streams[i]->queue)
+                pending.emplace_back(item.value);
+            m_streams[i]->queue.clear();
+            m_streams[i]->deficit = 0;
+            set_ready(i, false);
+            m_streams[i]->space_cv.notify_all();
+        }
+        m_ready_cv.notify_all();
+        return pending;
+    }
+
+    void start()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = false;
+        m_current = NO_STREAM;
+    }
+
+    StreamStats get_stats(size_t index)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (index >= m_streams.size())
+            return StreamStats();
+        return m_streams[index]->stats;
+    }
+};
@@ -13,6 +13,7 @@
 #include <gst/gst.h>
 #include <gst/video/gstvideofilter.h>
 #include <gst/video/video.h>
+#include <chrono>
 
 #if __GNUC__ > 8
 #include <filesystem>
@@ -25,6 +26,8 @@ namespace fs = std::experimental::filesystem;
 #define DEFAULT_MODULE "processor.py"
 #define DEFAULT_FUNCTION "run"
 #define DEFAULT_FINALIZE_FUNCTION "none"
+#define DEFAULT_BATCH_SIZE (1)
+#define DEFAULT_BATCH_TIMEOUT (0)
 
 GST_DEBUG_CATEGORY_STATIC(gst_hailopython_debug_category);
 #define GST_CAT_DEFAULT gst_hailopython_debug_category
@@ -41,6 +44,8 @@ static void gst_hailopython_finalize(GObject *object);
 static gboolean gst_hailopython_set_caps(GstBaseTransform *trans, GstCaps *incaps, GstCaps *outcaps);
 static gboolean gst_hailopython_start(GstBaseTransform *trans);
 static gboolean gst_hailopython_stop(GstBaseTransform *trans);
+static gboolean gst_hailopython_sink_event(GstBaseTransform *trans, GstEvent *event);
+static GstFlowReturn gst_hailopython_generate_output(GstBaseTransform *trans, GstBuffer **outbuf);
 static GstFlowReturn gst_hailopython_transform_frame_ip(GstVideoFilter *filter,
                                                         GstVideoFrame *frame);
 
@@ -49,7 +54,9 @@ enum
     PROP_0,
     PROP_MODULE,
     PROP_FUNCTION,
-    PROP_FINALIZE_FUNCTION
+    PROP_FINALIZE_FUNCTION,
+    PROP_BATCH_SIZE,
+    PROP_BATCH_TIMEOUT
 };
 
 /* pad templates */
@@ -90,6 +97,8 @@ static void gst_hailopython_class_init(GstHailoPythonClass *klass)
     base_transform_class->set_caps = GST_DEBUG_FUNCPTR(gst_hailopython_set_caps);
     base_transform_class->start = GST_DEBUG_FUNCPTR(gst_hailopython_start);
     base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_hailopython_stop);
+    base_transform_class->sink_event = GST_DEBUG_FUNCPTR(gst_hailopython_sink_event);
+    base_transform_class->generate_output = GST_DEBUG_FUNCPTR(gst_hailopython_generate_output);
     video_filter_class->transform_frame_ip = GST_DEBUG_FUNCPTR(gst_hailopython_transform_frame_ip);
 
     g_object_class_install_property(
@@ -106,6 +115,20 @@ static void gst_hailopython_class_init(GstHailoPythonClass *klass)
         g_param_spec_string("finalize-function", "Python finalize function name", "Python finalize function name",
                             DEFAULT_FINALIZE_FUNCTION,
                             (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_BATCH_SIZE,
+        g_param_spec_uint("batch-size", "Batch size",
+                          "Number of buffers passed to the Python function in one call, as a list of VideoFrames. "
+                          "1 calls the function with a single VideoFrame for every buffer",
+                          1, 1024, DEFAULT_BATCH_SIZE,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+    g_object_class_install_property(
+        gobject_class, PROP_BATCH_TIMEOUT,
+        g_param_spec_uint("batch-timeout", "Batch timeout",
+                          "Call the Python function with a partial batch when its oldest buffer has waited this long "
+                          "in milliseconds. 0 waits for a full batch",
+                          0, G_MAXUINT, DEFAULT_BATCH_TIMEOUT,
+                          (GParamFlags)(G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 }
 
 static void gst_hailopython_init(GstHailoPython *hailopython)
@@ -119,6 +142,15 @@ static void gst_hailopython_init(GstHailoPython *hailopython)
     hailopython->finalize_function_name = g_strdup(DEFAULT_FINALIZE_FUNCTION);
     hailopython->python_callback = nullptr;
     hailopython->python_finalize_callback = nullptr;
+    hailopython->batch_size = DEFAULT_BATCH_SIZE;
+    hailopython->batch_timeout = DEFAULT_BATCH_TIMEOUT;
+    hailopython->pending_buffers = g_ptr_array_new();
+    hailopython->pending_since = 0;
+    hailopython->batch_result = GST_FLOW_OK;
+    hailopython->batch_mutex = std::make_unique<std::mutex>();
+    hailopython->batch_cond = std::make_unique<std::condition_variable>();
+    hailopython->flush_thread = nullptr;
+    hailopython->flush_thread_running = false;
 }
 
 void gst_hailopython_set_property(GObject *object, guint property_id, const GValue *value,
@@ -142,6 +174,12 @@ void gst_hailopython_set_property(GObject *object, guint property_id, const GVal
         g_free(hailopython->finalize_function_name);
         hailopython->finalize_function_name = g_value_dup_string(value);
         break;
+    case PROP_BATCH_SIZE:
+        hailopython->batch_size = g_value_get_uint(value);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        hailopython->batch_timeout = g_value_get_uint(value);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
@@ -165,12 +203,149 @@ void gst_hailopython_get_property(GObject *object, guint property_id, GValue *va
     case PROP_FINALIZE_FUNCTION:
         g_value_set_string(value, hailopython->finalize_function_name);
         break;
+    case PROP_BATCH_SIZE:
+        g_value_set_uint(value, hailopython->batch_size);
+        break;
+    case PROP_BATCH_TIMEOUT:
+        g_value_set_uint(value, hailopython->batch_timeout);
+        break;
     default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID(object, property_id, pspec);
         break;
     }
 }
 
+/**
+ * @brief Release the buffers held for the next batch without pushing them.
+ */
+static void gst_hailopython_drop_batch(GstHailoPython *hailopython)
+{
+    for (guint i = 0; i < hailopython->pending_buffers->len; i++)
+    {
+        gst_buffer_unref(GST_BUFFER(g_ptr_array_index(hailopython->pending_buffers, i)));
+    }
+    g_ptr_array_set_size(hailopython->pending_buffers, 0);
+}
+
+/**
+ * @brief Call the Python function once with the buffers held for the batch, then push them downstream in order.
+ *        The caller holds batch_mutex.
+ *
+ * @param hailopython The element.
+ * @return GstFlowReturn The error of the Python function, or the result of the pushes.
+ */
+static GstFlowReturn gst_hailopython_push_batch(GstHailoPython *hailopython)
+{
+    GPtrArray *pending = hailopython->pending_buffers;
+    if (pending->len == 0)
+    {
+        return GST_FLOW_OK;
+    }
+
+    std::vector<PythonFrame> frames;
+    frames.reserve(pending->len);
+    for (guint i = 0; i < pending->len; i++)
+    {
+        GstBuffer *buffer = GST_BUFFER(g_ptr_array_index(pending, i));
+        // The main ROI is owned by the meta of the buffer, which is held until the push
+        frames.push_back({buffer, (py_descriptor_t)get_hailo_main_roi(buffer, true).get()});
+    }
+
+    char *error_msg;
+    GstFlowReturn result = invoke_python_callback(hailopython->python_callback, frames, &error_msg);
+    if (result != GST_FLOW_OK)
+    {
+        GST_ELEMENT_ERROR(hailopython, LIBRARY, FAILED, ("%s", error_msg), (NULL));
+        gst_hailopython_drop_batch(hailopython);
+        return result;
+    }
+
+    GstPad *srcpad = GST_BASE_TRANSFORM_SRC_PAD(hailopython);
+    for (guint i = 0; i < pending->len; i++)
+    {
+        GstBuffer *buffer = GST_BUFFER(g_ptr_array_index(pending, i));
+        if (result == GST_FLOW_OK)
+        {
+            result = gst_pad_push(srcpad, buffer);
+        }
+        else
+        {
+            gst_buffer_unref(buffer);
+        }
+    }
+    g_ptr_array_set_size(pending, 0);
+
+    return result;
+}
+
+/**
+ * @brief Keep the result of a batch that was not pushed from the chain function, the next buffer returns it
+ *        upstream. Errors nobody else reports are posted here.
+ */
+static void gst_hailopython_batch_failed(GstHailoPython *hailopython, GstFlowReturn result)
+{
+    GST_DEBUG_OBJECT(hailopython, "Pushing a batch failed: %s", gst_flow_get_name(result));
+    hailopython->batch_result = result;
+    if (result == GST_FLOW_NOT_LINKED || result == GST_FLOW_NOT_NEGOTIATED)
+    {
+        GST_ELEMENT_FLOW_ERROR(hailopython, result);
+    }
+}
+
+/**
+ * @brief Push the partial batch once its oldest buffer waited batch-timeout, even if no buffer arrives after it.
+ */
+static void gst_hailopython_flush_loop(GstHailoPython *hailopython)
+{
+    std::unique_lock<std::mutex> lock(*hailopython->batch_mutex);
+    while (hailopython->flush_thread_running)
+    {
+        if (hailopython->pending_buffers->len == 0)
+        {
+            hailopython->batch_cond->wait(lock);
+            continue;
+        }
+
+        gint64 deadline = hailopython->pending_since + (gint64)hailopython->batch_timeout * 1000;
+        gint64 now = g_get_monotonic_time();
+        if (now < deadline)
+        {
+            hailopython->batch_cond->wait_for(lock, std::chrono::microseconds(deadline - now));
+            continue;
+        }
+
+        GstFlowReturn result = gst_hailopython_push_batch(hailopython);
+        if (result != GST_FLOW_OK)
+        {
+            gst_hailopython_batch_failed(hailopython, result);
+        }
+    }
+}
+
+static void gst_hailopython_start_flush_thread(GstHailoPython *hailopython)
+{
+    if (hailopython->batch_size <= 1 || hailopython->batch_timeout == 0 || hailopython->flush_thread)
+    {
+        return;
+    }
+    hailopython->flush_thread_running = true;
+    hailopython->flush_thread = std::make_unique<std::thread>(gst_hailopython_flush_loop, hailopython);
+}
+
+static void gst_hailopython_stop_flush_thread(GstHailoPython *hailopython)
+{
+    {
+        std::lock_guard<std::mutex> lock(*hailopython->batch_mutex);
+        hailopython->flush_thread_running = false;
+    }
+    hailopython->batch_cond->notify_all();
+    if (hailopython->flush_thread)
+    {
+        hailopython->flush_thread->join();
+        hailopython->flush_thread.reset();
+    }
+}
+
 void gst_hailopython_dispose(GObject *object)
 {
     GstHailoPython *hailopython = GST_HAILO_PYTHON(object);
@@ -187,6 +362,8 @@ void gst_hailopython_finalize(GObject *object)
 
     GST_DEBUG_OBJECT(hailopython, "finalize");
 
+    gst_hailopython_stop_flush_thread(hailopython);
+
     if (hailopython->python_finalize_callback != nullptr) 
     {
         char *error_msg;
@@ -216,6 +393,12 @@ void gst_hailopython_finalize(GObject *object)
     g_free(hailopython->finalize_function_name);
     hailopython->finalize_function_name = nullptr;
 
+    gst_hailopython_drop_batch(hailopython);
+    g_ptr_array_unref(hailopython->pending_buffers);
+    hailopython->pending_buffers = nullptr;
+    hailopython->batch_cond.reset();
+    hailopython->batch_mutex.reset();
+
     G_OBJECT_CLASS(gst_hailopython_parent_class)->finalize(object);
 }
 
@@ -307,6 +490,9 @@ static gboolean gst_hailopython_start(GstBaseTransform *trans)
         }
     }
 
+    hailopython->batch_result = GST_FLOW_OK;
+    gst_hailopython_start_flush_thread(hailopython);
+
     return TRUE;
 }
 
@@ -316,9 +502,46 @@ static gboolean gst_hailopython_stop(GstBaseTransform *trans)
 
     GST_DEBUG_OBJECT(hailopython, "stop");
 
+    // The pads are inactive, a push of the flush thread returns right away
+    gst_hailopython_stop_flush_thread(hailopython);
+    gst_hailopython_drop_batch(hailopython);
+
     return TRUE;
 }
 
+static gboolean gst_hailopython_sink_event(GstBaseTransform *trans, GstEvent *event)
+{
+    GstHailoPython *hailopython = GST_HAILO_PYTHON(trans);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+    {
+        std::lock_guard<std::mutex> lock(*hailopython->batch_mutex);
+        gst_hailopython_drop_batch(hailopython);
+        hailopython->batch_result = GST_FLOW_OK;
+    }
+    else if (GST_EVENT_IS_SERIALIZED(event))
+    {
+        // Buffers held for a batch go downstream before the events that came after them (caps, segment, EOS)
+        std::unique_lock<std::mutex> lock(*hailopython->batch_mutex);
+        GstFlowReturn result = gst_hailopython_push_batch(hailopython);
+        if (result != GST_FLOW_OK)
+        {
+            gst_hailopython_batch_failed(hailopython, result);
+        }
+        lock.unlock();
+
+        if (result != GST_FLOW_OK && result != GST_FLOW_EOS)
+        {
+            GST_WARNING_OBJECT(hailopython, "Dropping %s event, the pending batch was not pushed",
+                               GST_EVENT_TYPE_NAME(event));
+            gst_event_unref(event);
+            return FALSE;
+        }
+    }
+
+    return GST_BASE_TRANSFORM_CLASS(gst_hailopython_parent_class)->sink_event(trans, event);
+}
+
 /**
  * @brief Get the tensors from meta object
  *
@@ -331,15 +554,74 @@ static void get_tensors_from_meta(GstBuffer *buffer, HailoROIPtr roi)
     gpointer state = NULL;
     GstMeta *meta;
     GstParentBufferMeta *pmeta;
-    GstMapInfo info;
     while ((meta = gst_buffer_iterate_meta_filtered(buffer, &state, GST_PARENT_BUFFER_META_API_TYPE)))
     {
         pmeta = reinterpret_cast<GstParentBufferMeta *>(meta);
-        (void)gst_buffer_map(pmeta->buffer, &info, GST_MAP_READWRITE);
         const hailo_vstream_info_t vstream_info = reinterpret_cast<GstHailoTensorMeta *>(gst_buffer_get_meta(pmeta->buffer, g_type_from_name(TENSOR_META_API_NAME)))->info;
-        roi->add_tensor(std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info.data), vstream_info));
-        gst_buffer_unmap(pmeta->buffer, &info);
+
+        // The tensor owns a mapped reference to its buffer, so numpy views of the tensor (HailoTensor.numpy())
+        // stay valid while the Python function runs and after it returns
+        GstMapInfo *info = new GstMapInfo;
+        if (!gst_buffer_map(pmeta->buffer, info, GST_MAP_READWRITE))
+        {
+            GST_WARNING("Failed to map the buffer of tensor %s, skipping it", vstream_info.name);
+            delete info;
+            continue;
+        }
+        GstBuffer *tensor_buffer = gst_buffer_ref(pmeta->buffer);
+        HailoTensorPtr tensor = std::make_shared<HailoTensor>(reinterpret_cast<uint8_t *>(info->data), vstream_info);
+        tensor->set_owner(std::shared_ptr<GstMapInfo>(info, [tensor_buffer](GstMapInfo *map_info)
+                                                      {
+                                                          gst_buffer_unmap(tensor_buffer, map_info);
+                                                          gst_buffer_unref(tensor_buffer);
+                                                          delete map_info; }));
+        roi->add_tensor(tensor);
+    }
+}
+
+/**
+ * @brief With batch-size > 1, take the input buffer from the base class and hold it for the batch, the batch is
+ *        pushed by gst_hailopython_push_batch. The held buffer has no other reference, so the Python function can
+ *        map the frames writable. Otherwise the base class calls gst_hailopython_transform_frame_ip.
+ */
+static GstFlowReturn gst_hailopython_generate_output(GstBaseTransform *trans, GstBuffer **outbuf)
+{
+    GstHailoPython *hailopython = GST_HAILO_PYTHON(trans);
+    if (hailopython->batch_size <= 1)
+    {
+        return GST_BASE_TRANSFORM_CLASS(gst_hailopython_parent_class)->generate_output(trans, outbuf);
+    }
+
+    *outbuf = NULL;
+    GstBuffer *buffer = trans->queued_buf;
+    trans->queued_buf = NULL;
+    if (buffer == NULL)
+    {
+        return GST_FLOW_OK;
+    }
+
+    buffer = gst_buffer_make_writable(buffer);
+    get_tensors_from_meta(buffer, get_hailo_main_roi(buffer, true));
+
+    std::lock_guard<std::mutex> lock(*hailopython->batch_mutex);
+    if (hailopython->batch_result != GST_FLOW_OK)
+    {
+        gst_buffer_unref(buffer);
+        return hailopython->batch_result;
+    }
+
+    if (hailopython->pending_buffers->len == 0)
+    {
+        hailopython->pending_since = g_get_monotonic_time();
+        hailopython->batch_cond->notify_one();
+    }
+    g_ptr_array_add(hailopython->pending_buffers, buffer);
+
+    if (hailopython->pending_buffers->len >= hailopython->batch_size)
+    {
+        return gst_hailopython_push_batch(hailopython);
     }
+    return GST_FLOW_OK;
 }
 
 static GstFlowReturn gst_hailopython_transform_frame_ip(GstVideoFilter *filter, GstVideoFrame *frame)
@@ -6,6 +6,10 @@
 
 #include <gst/video/gstvideofilter.h>
 #include <gst/video/video.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 G_BEGIN_DECLS
 
@@ -29,6 +33,18 @@ struct _GstHailoPython
     gchar *module_name;
     gchar *function_name;
     gchar *finalize_function_name;
+    guint batch_size;
+    guint batch_timeout;
+    GPtrArray *pending_buffers; // Buffers held for the next batch
+    gint64 pending_since;       // Arrival time of the oldest pending buffer
+    // Result of the last batch pushed outside of the chain function, returned with the next buffer
+    GstFlowReturn batch_result;
+    // Guards the pending buffers, held while a batch is called and pushed so batches leave in order
+    std::unique_ptr<std::mutex> batch_mutex;
+    std::unique_ptr<std::condition_variable> batch_cond;
+    // Pushes the partial batch once its oldest buffer waited batch-timeout
+    std::unique_ptr<std::thread> flush_thread;
+    bool flush_thread_running;
 };
 
 struct _GstHailoPythonClass
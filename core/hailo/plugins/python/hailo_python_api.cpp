@@ -16,6 +16,7 @@
 #include <pybind11/numpy.h>
 #include <pybind11/operators.h>
 #include <pybind11/stl.h>
+#include <gst/video/video.h>
 #include <pygobject.h>
 
 namespace py = pybind11;
@@ -240,14 +241,30 @@ public:
     hailo_object_t get_type() override { PYBIND11_OVERRIDE(hailo_object_t, HailoUserMeta, get_type); }
 };
 
+/**
+ * @brief Owner handle of a python object (e.g. the numpy array of a tensor created in python),
+ *        the object is released with the GIL held.
+ */
+static std::shared_ptr<void> python_owner(py::object object)
+{
+    return std::shared_ptr<py::object>(new py::object(std::move(object)), [](py::object *owned)
+                                       {
+                                           py::gil_scoped_acquire gil;
+                                           delete owned; });
+}
+
 HailoTensor tensor_init(pybind11::array_t<uint8_t> data, const hailo_vstream_info_t &vstream_info)
 {
-    return HailoTensor(static_cast<uint8_t *>(data.request().ptr), vstream_info);
+    HailoTensor tensor(static_cast<uint8_t *>(data.request().ptr), vstream_info);
+    tensor.set_owner(python_owner(data));
+    return tensor;
 }
 
 HailoTensor tensor_init16(pybind11::array_t<uint16_t> data, const hailo_vstream_info_t &vstream_info)
 {
-    return HailoTensor(static_cast<uint8_t *>(data.request().ptr), vstream_info);
+    HailoTensor tensor(static_cast<uint8_t *>(data.request().ptr), vstream_info);
+    tensor.set_owner(python_owner(data));
+    return tensor;
 }
 
 HailoTensor tensor_init_full(pybind11::object data, std::string name, uint height, uint width, uint features, float qp_zp, float qp_scale, int type)
@@ -272,6 +289,139 @@ HailoTensor tensor_init_full(pybind11::object data, std::string name, uint heigh
     return tensor_init(new_data, info);
 }
 
+/**
+ * @brief Strided view of the data of a tensor, typed by the format of the tensor.
+ *        The view references the owner of the data (e.g. the mapped output buffer), so it stays valid after the
+ *        tensor is removed or the frame is pushed. A tensor without an owner falls back to base (the python tensor object).
+ */
+template <typename T>
+static py::array_t<T> tensor_view(HailoTensor &tensor, py::handle base)
+{
+    py::object owner = py::reinterpret_borrow<py::object>(base);
+    std::shared_ptr<const uint8_t> data = tensor.shared_data();
+    if (data)
+    {
+        owner = py::capsule(new std::shared_ptr<const uint8_t>(std::move(data)), [](void *shared_data)
+                            { delete static_cast<std::shared_ptr<const uint8_t> *>(shared_data); });
+    }
+    return py::array_t<T>({tensor.height(), tensor.width(), tensor.features()},
+                          {sizeof(T) * tensor.features() * tensor.width(), sizeof(T) * tensor.features(), sizeof(T)},
+                          reinterpret_cast<T *>(tensor.data()), owner);
+}
+
+template <typename T>
+static py::buffer_info tensor_buffer_info(HailoTensor &tensor)
+{
+    return py::buffer_info(reinterpret_cast<T *>(tensor.data()), sizeof(T),
+                           py::format_descriptor<T>::format(), 3,
+                           {tensor.height(), tensor.width(), tensor.features()},
+                           {sizeof(T) * tensor.features() * tensor.width(), sizeof(T) * tensor.features(), sizeof(T)});
+}
+
+template <typename T>
+static py::array_t<float> tensor_dequantize(HailoTensor &tensor)
+{
+    py::array_t<float> result({tensor.height(), tensor.width(), tensor.features()});
+    float *output = result.mutable_data();
+    const T *input = reinterpret_cast<const T *>(tensor.data());
+    const float qp_zp = tensor.vstream_info().quant_info.qp_zp;
+    const float qp_scale = tensor.vstream_info().quant_info.qp_scale;
+    const size_t count = size_t(tensor.height()) * tensor.width() * tensor.features();
+    {
+        py::gil_scoped_release release;
+        for (size_t i = 0; i < count; i++)
+        {
+            output[i] = (float(input[i]) - qp_zp) * qp_scale;
+        }
+    }
+    return result;
+}
+
+static bool is_uint16_tensor(HailoTensor &tensor)
+{
+    return tensor.vstream_info().format.type == HAILO_FORMAT_TYPE_UINT16;
+}
+
+/**
+ * @brief A Gst.Buffer mapped as a video frame, with its planes as strided numpy views.
+ *        Every view references the mapping, the buffer is unmapped when the mapping and all its views are released.
+ */
+class VideoFrameMapping
+{
+private:
+    GstVideoFrame m_frame;
+    bool m_writable;
+
+public:
+    VideoFrameMapping(py::object py_buffer, py::object py_caps, bool writable) : m_writable(writable)
+    {
+        GstBuffer *buffer = pyg_boxed_get(py_buffer.ptr(), GstBuffer);
+        GstCaps *caps = pyg_boxed_get(py_caps.ptr(), GstCaps);
+        GstVideoInfo info;
+        if (!gst_video_info_from_caps(&info, caps))
+        {
+            throw std::invalid_argument("Caps are not video caps");
+        }
+        if (GST_VIDEO_FORMAT_INFO_DEPTH(info.finfo, 0) != 8)
+        {
+            throw std::invalid_argument("Only 8 bit video formats can be viewed as numpy arrays");
+        }
+        // A writable mapping requires a writable buffer (a single reference)
+        if (!gst_video_frame_map(&m_frame, &info, buffer, writable ? GST_MAP_READWRITE : GST_MAP_READ))
+        {
+            throw std::runtime_error("Could not map buffer data");
+        }
+    }
+
+    ~VideoFrameMapping()
+    {
+        gst_video_frame_unmap(&m_frame);
+    }
+
+    VideoFrameMapping(const VideoFrameMapping &other) = delete;
+    VideoFrameMapping &operator=(const VideoFrameMapping &other) = delete;
+
+    /**
+     * @brief Views of the planes of the frame: (height, width) for planes of one byte per pixel (the Y and chroma
+     *        planes of NV12 and I420), (height, width, bytes per pixel) for packed planes (RGB, RGBA, the
+     *        interleaved UV plane of NV12, the Y0U/Y1V pairs of YUY2).
+     * @param base The python mapping object, referenced by the views.
+     */
+    py::list planes(py::handle base)
+    {
+        py::list planes;
+        for (guint plane = 0; plane < GST_VIDEO_FRAME_N_PLANES(&m_frame); plane++)
+        {
+            // The first component of the plane defines its size and pixel stride
+            guint component = 0;
+            while (GST_VIDEO_FRAME_COMP_PLANE(&m_frame, component) != plane)
+            {
+                component++;
+            }
+            size_t height = GST_VIDEO_FRAME_COMP_HEIGHT(&m_frame, component);
+            size_t width = GST_VIDEO_FRAME_COMP_WIDTH(&m_frame, component);
+            size_t row_stride = GST_VIDEO_FRAME_PLANE_STRIDE(&m_frame, plane);
+            size_t pixel_stride = GST_VIDEO_FRAME_COMP_PSTRIDE(&m_frame, component);
+            uint8_t *data = static_cast<uint8_t *>(GST_VIDEO_FRAME_PLANE_DATA(&m_frame, plane));
+
+            py::array_t<uint8_t> view = (pixel_stride > 1)
+                                            ? py::array_t<uint8_t>({height, width, pixel_stride}, {row_stride, pixel_stride, size_t(1)}, data, base)
+                                            : py::array_t<uint8_t>({height, width}, {row_stride, size_t(1)}, data, base);
+            if (!m_writable)
+            {
+                view.attr("setflags")("write"_a = false);
+            }
+            planes.append(view);
+        }
+        return planes;
+    }
+
+    std::string format()
+    {
+        return GST_VIDEO_FRAME_FORMAT(&m_frame) == GST_VIDEO_FORMAT_UNKNOWN ? "unknown" : gst_video_format_to_string(GST_VIDEO_FRAME_FORMAT(&m_frame));
+    }
+};
+
 PYBIND11_MODULE(hailo, m)
 {
     m.doc() = "HAILO postprocessing python extensions library";
@@ -725,10 +875,17 @@ PYBIND11_MODULE(hailo, m)
             .def(py::init(&tensor_init_full), py::arg("data"), py::arg("name"), py::arg("height"), py::arg("width"), py::arg("features"),
                  py::arg("qp_zp"), py::arg("qp_scale"), py::arg("type"))
             .def_buffer([](HailoTensor &obj) -> py::buffer_info
-                        { return py::buffer_info(obj.data(), sizeof(uint8_t),
-                                                 py::format_descriptor<uint8_t>::format(), 3,
-                                                 {obj.height(), obj.width(), obj.features()},
-                                                 {sizeof(uint8_t) * obj.features() * obj.width(), sizeof(uint8_t) * obj.features(), sizeof(uint8_t)}); })
+                        { return is_uint16_tensor(obj) ? tensor_buffer_info<uint16_t>(obj) : tensor_buffer_info<uint8_t>(obj); })
+            .def("numpy", [](py::object self) -> py::array
+                 { HailoTensor &obj = self.cast<HailoTensor &>();
+                   return is_uint16_tensor(obj) ? py::array(tensor_view<uint16_t>(obj, self)) : py::array(tensor_view<uint8_t>(obj, self)); },
+                 "Zero copy (height, width, features) view of the quantized data, uint8 or uint16 by the tensor format")
+            .def("dequantize", [](HailoTensor &obj)
+                 { return is_uint16_tensor(obj) ? tensor_dequantize<uint16_t>(obj) : tensor_dequantize<uint8_t>(obj); },
+                 "Dequantized (height, width, features) float32 copy of the data")
+            .def("qp_zp", [](HailoTensor &obj) { return obj.vstream_info().quant_info.qp_zp; }, "Quantization zero point")
+            .def("qp_scale", [](HailoTensor &obj) { return obj.vstream_info().quant_info.qp_scale; }, "Quantization scale")
+            .def("is_uint16", &is_uint16_tensor, "Whether the data is uint16 (uint8 otherwise)")
             .def("name", &HailoTensor::name, "Name")
             .def("vstream_info", &HailoTensor::vstream_info, "Vstream info")
             .def("data", &HailoTensor::data, "Data", py::return_value_policy::reference_internal)
@@ -748,6 +905,18 @@ PYBIND11_MODULE(hailo, m)
                           std::to_string(reinterpret_cast<unsigned long>(&obj)) + ")" + ">"; });
     }
 
+    {
+        py::class_<VideoFrameMapping, std::shared_ptr<VideoFrameMapping>>(m, "VideoFrameMapping")
+            .def(py::init<py::object, py::object, bool>(), py::arg("buffer"), py::arg("caps"), py::arg("writable") = false)
+            .def("planes", [](py::object self)
+                 { return self.cast<VideoFrameMapping &>().planes(self); },
+                 "Zero copy numpy views of the planes, valid while the buffer is alive")
+            .def("format", &VideoFrameMapping::format, "Video format")
+            .def("__repr__", [](const VideoFrameMapping &obj)
+                 { return "<hailo.VideoFrameMapping"s + "(" +
+                          std::to_string(reinterpret_cast<unsigned long>(&obj)) + ")" + ">"; });
+    }
+
     m.def("access_HailoMainObject_from_desc", &access_HailoMainObject_from_desc,
           "Access HailoMainObject from low-level py descriptor");
     m.def("access_HailoROI_from_desc", &access_HailoROI_from_desc,
@@ -87,6 +87,31 @@ GstFlowReturn invoke_python_callback(PythonCallback *python_callback, GstBuffer
     }
 }
 
+GstFlowReturn invoke_python_callback(PythonCallback *python_callback, const std::vector<PythonFrame> &frames,
+                                     char **error_msg)
+{
+    if (!python_callback)
+    {
+        GST_ERROR("python_callback is not initialized");
+        return GST_FLOW_ERROR;
+    }
+
+    // The GIL is taken once for the whole batch
+    auto context_initializer = PythonContextInitializer();
+    try
+    {
+        return python_callback->CallPython(frames);
+    }
+    catch (const std::exception &e)
+    {
+        PythonError python_err;
+        std::string msg = std::string(e.what()) + std::string(": \n") + std::string(python_err.get());
+        *error_msg = strdup(msg.c_str());
+
+        return GST_FLOW_ERROR;
+    }
+}
+
 GstFlowReturn set_python_callback_caps(PythonCallback *python_callback, GstCaps *caps, char **error_msg)
 {
     if (nullptr == python_callback)
@@ -112,13 +137,15 @@ GstFlowReturn set_python_callback_caps(PythonCallback *python_callback, GstCaps
     }
 }
 
-GstFlowReturn PythonCallback::CallPython(GstBuffer *buffer, py_descriptor_t desc)
+PyObject *PythonCallback::CreateFrame(GstBuffer *buffer, py_descriptor_t desc)
 {
+    if (!(PyObject *)py_caps)
+    {
+        throw std::runtime_error("Caps are not set");
+    }
     // Convert py_descriptor_t to python Class of HailoROI. via python function.
-    // The 'k' stands for the parameter type for this function (unsigned long).
-    // https://docs.python.org/3/c-api/arg.html#c.Py_BuildValue
-    __PYFILTER_DECL_WRAPPER(roi_as_unsigned_long, Py_BuildValue("(k)", desc));
-    __PYFILTER_DECL_WRAPPER(hailo_roi, PyObject_CallObject(get_python_roi_function, roi_as_unsigned_long));
+    __PYFILTER_DECL_WRAPPER(roi_as_unsigned_long, PyLong_FromUnsignedLong(desc));
+    __PYFILTER_DECL_WRAPPER(hailo_roi, PyObject_CallFunctionObjArgs(get_python_roi_function, (PyObject *)roi_as_unsigned_long, nullptr));
     if (!(PyObject *)hailo_roi)
     {
         throw std::runtime_error("Could not convert HailoROI to python");
@@ -126,14 +153,42 @@ GstFlowReturn PythonCallback::CallPython(GstBuffer *buffer, py_descriptor_t desc
     // Create a Gst.Buffer object.
     __PYFILTER_DECL_WRAPPER(py_buffer, pyg_boxed_new(buffer->mini_object.type, buffer,
                                                      FALSE /*copy_boxed*/, FALSE /*own_ref*/));
-    __PYFILTER_DECL_WRAPPER(py_caps, pyg_boxed_new(caps_ptr->mini_object.type, caps_ptr,
-                                                   FALSE /*copy_boxed*/, FALSE /*own_ref*/));
+
+    // Reuse a VideoFrame of the same caps, its video info is already parsed
+    Py_ssize_t num_free_frames = PyList_GET_SIZE((PyObject *)free_frames);
+    if (num_free_frames > 0)
+    {
+        // PyList_GET_ITEM borrows the reference, take one before removing the frame from the list
+        PyObject *free_frame = PyList_GET_ITEM((PyObject *)free_frames, num_free_frames - 1);
+        Py_INCREF(free_frame);
+        PyObjectWrapper frame(free_frame, "free_frame");
+        PyList_SetSlice(free_frames, num_free_frames - 1, num_free_frames, nullptr);
+        __PYFILTER_DECL_WRAPPER(result, PyObject_CallMethodObjArgs(frame, rebind_method_name, (PyObject *)py_buffer,
+                                                                   (PyObject *)hailo_roi, nullptr));
+        return frame.release();
+    }
+
     __PYFILTER_DECL_WRAPPER(frame, PyObject_CallFunctionObjArgs(python_frame_class, (PyObject *)py_buffer, (PyObject *)py_caps,
                                                                 (PyObject *)hailo_roi, nullptr));
+    return frame.release();
+}
 
-    // Create the arguments for the user function and call it.
-    __PYFILTER_DECL_WRAPPER(args, Py_BuildValue("(O)", (PyObject *)frame));
-    PyObjectWrapper result(PyObject_CallObject(user_python_function, args));
+void PythonCallback::RecycleFrame(PyObject *frame)
+{
+    PyObjectWrapper frame_wrapper(frame);
+    // A frame the user function kept a reference to stays with the user
+    if (Py_REFCNT(frame) != 1)
+    {
+        return;
+    }
+    // The Gst.Buffer wrapper doesn't own the buffer, it must not outlive the call
+    __PYFILTER_DECL_WRAPPER(result, PyObject_CallMethodObjArgs(frame, rebind_method_name, Py_None, Py_None, nullptr));
+    PyList_Append(free_frames, frame);
+}
+
+GstFlowReturn PythonCallback::CallUserFunction(PyObject *arg)
+{
+    PyObjectWrapper result(PyObject_CallFunctionObjArgs(user_python_function, arg, nullptr));
 
     if (((PyObject *)result) == nullptr)
     {
@@ -143,6 +198,37 @@ GstFlowReturn PythonCallback::CallPython(GstBuffer *buffer, py_descriptor_t desc
     return (GstFlowReturn)PyLong_AsLong(result);
 }
 
+GstFlowReturn PythonCallback::CallPython(GstBuffer *buffer, py_descriptor_t desc)
+{
+    __PYFILTER_DECL_WRAPPER(frame, CreateFrame(buffer, desc));
+    GstFlowReturn result = CallUserFunction(frame);
+    RecycleFrame(frame.release());
+    return result;
+}
+
+GstFlowReturn PythonCallback::CallPython(const std::vector<PythonFrame> &frames)
+{
+    __PYFILTER_DECL_WRAPPER(frame_list, PyList_New(frames.size()));
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        // PyList_SET_ITEM steals the reference, on an error the list releases the frames created so far
+        PyList_SET_ITEM((PyObject *)frame_list, i, CreateFrame(frames[i].buffer, frames[i].desc));
+    }
+    GstFlowReturn result = CallUserFunction(frame_list);
+    // The frames of a list the user function kept stay with the user
+    if (Py_REFCNT((PyObject *)frame_list) == 1)
+    {
+        for (size_t i = 0; i < frames.size(); i++)
+        {
+            PyObject *frame = PyList_GET_ITEM((PyObject *)frame_list, i);
+            Py_INCREF(Py_None);
+            PyList_SET_ITEM((PyObject *)frame_list, i, Py_None);
+            RecycleFrame(frame);
+        }
+    }
+    return result;
+}
+
 GstFlowReturn PythonCallback::CallPython()
 {
     PyObjectWrapper result(PyObject_CallObject(user_python_function, NULL));
@@ -215,6 +301,13 @@ PythonCallback::PythonCallback(const char *module_path, const char *function_nam
     }
 
     python_frame_class.reset(PyObject_GetAttrString(gsthailo_module, "VideoFrame"), "videoframe_class");
+    rebind_method_name.reset(PyUnicode_FromString("_rebind"), "rebind_method_name");
+    free_frames.reset(PyList_New(0), "free_frames");
+}
+
+PythonCallback::~PythonCallback()
+{
+    gst_caps_replace(&caps_ptr, nullptr);
 }
 
 PythonContextInitializer::PythonContextInitializer()
@@ -277,7 +370,10 @@ void PythonContextInitializer::extendPath(const std::string &module_path)
 void PythonCallback::SetCaps(GstCaps *caps)
 {
     assert(caps && "Expected vaild caps in PythonCallback::SetCaps!");
-    caps_ptr = caps;
+    gst_caps_replace(&caps_ptr, caps);
+    py_caps.reset(pyg_boxed_new(caps_ptr->mini_object.type, caps_ptr, FALSE /*copy_boxed*/, FALSE /*own_ref*/), "py_caps");
+    // The video info of the free frames is of the old caps
+    PyList_SetSlice(free_frames, 0, PyList_GET_SIZE((PyObject *)free_frames), nullptr);
 }
 
 PythonError::PythonError()
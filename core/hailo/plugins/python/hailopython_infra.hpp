@@ -14,9 +14,17 @@
 #include <gst/video/video.h>
 #include <iostream>
 #include <stdexcept>
+#include <vector>
 
 using py_descriptor_t = unsigned long;
 
+// A buffer of a batch and the descriptor of its main HailoROI
+struct PythonFrame
+{
+    GstBuffer *buffer;
+    py_descriptor_t desc;
+};
+
 class PyObjectWrapper
 {
     PyObject *object;
@@ -67,18 +75,28 @@ class PythonCallback
     PyObjectWrapper user_python_function;
     PyObjectWrapper get_python_roi_function;
     PyObjectWrapper python_frame_class;
+    PyObjectWrapper py_caps; // Gst.Caps wrapper shared by all the frames, until the caps change
+    PyObjectWrapper rebind_method_name;
+    // VideoFrames of the current caps the user function did not keep, reused for the next buffers
+    PyObjectWrapper free_frames;
     std::string module_name;
-    GstCaps *caps_ptr;
+    GstCaps *caps_ptr = nullptr;
+
+    PyObject *CreateFrame(GstBuffer *buffer, py_descriptor_t desc);
+    void RecycleFrame(PyObject *frame);
+    GstFlowReturn CallUserFunction(PyObject *arg);
 
 public:
     PythonCallback(const char *module_path, const char *function_name,
                    const char *args_string, const char *kwargs_string);
 
-    ~PythonCallback() = default;
+    ~PythonCallback();
 
     void SetCaps(GstCaps *caps);
     GstFlowReturn CallPython();
     GstFlowReturn CallPython(GstBuffer *buffer, py_descriptor_t desc);
+    // Calls the user function once, with a list of the VideoFrames of the batch
+    GstFlowReturn CallPython(const std::vector<PythonFrame> &frames);
 };
 
 class PythonContextInitializer
@@ -99,6 +117,7 @@ private:
 
 GstFlowReturn set_python_callback_caps(PythonCallback *python_callback, GstCaps *caps, char **error_msg);
 GstFlowReturn invoke_python_callback(PythonCallback *pycb, GstBuffer *buffer, py_descriptor_t desc, char **error_msg);
+GstFlowReturn invoke_python_callback(PythonCallback *pycb, const std::vector<PythonFrame> &frames, char **error_msg);
 GstFlowReturn invoke_python_callback(PythonCallback *pycb, char **error_msg);
 PythonCallback *create_python_callback(const char *module_path, const char *function_name,
                                        const char *args_string, const char *keyword_args_string, char **error_msg);
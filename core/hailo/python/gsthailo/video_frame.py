@@ -24,6 +24,7 @@ from gi.repository import Gst, GstVideo
 class VideoFrame:
     def __init__(self, buffer: Gst.Buffer, caps: Gst.Caps, roi: hailo.HailoROI):
         self._buffer = buffer
+        self._caps = caps
         self._roi = roi
         self._video_info = GstVideo.VideoInfo()
         
@@ -37,6 +38,11 @@ class VideoFrame:
         else:
             self._video_info.new_from_caps(caps)
 
+    def _rebind(self, buffer: Gst.Buffer, roi: hailo.HailoROI):
+        """Point the frame at another buffer of the same caps, hailopython reuses the frames it passes."""
+        self._buffer = buffer
+        self._roi = roi
+
     @property
     def roi(self) -> hailo.HailoROI:
         return self._roi
@@ -68,6 +74,17 @@ class VideoFrame:
         finally:
             self._buffer.unmap(map_info)
 
+    def numpy_planes(self, writable: bool = False) -> list:
+        """
+        Zero copy numpy views of the planes of the frame, with the strides of the buffer:
+        RGB / RGBA - one (height, width, channels) plane.
+        YUY2 - one (height, width, 2) plane of Y0 U / Y1 V pairs.
+        NV12 - a (height, width) Y plane and a (height / 2, width / 2, 2) interleaved UV plane.
+        I420 - (height, width) Y, (height / 2, width / 2) U and V planes.
+        The buffer stays mapped while any of the views is alive. Writable views require a writable buffer.
+        """
+        return hailo.VideoFrameMapping(self._buffer, self._caps, writable).planes()
+
     @classmethod
     def numpy_array_from_buffer(cls, map_info: Gst.MapInfo, caps: Gst.Caps = None, video_info: GstVideo.VideoInfo = None):
         if not caps and not video_info:
@@ -47,13 +47,14 @@ GST_DEBUG_CATEGORY_STATIC (gst_interlatency_debug);
 #define _do_init GST_DEBUG_CATEGORY_INIT (gst_interlatency_debug, "interlatency", 0, "interlatency tracer");
 #define gst_interlatency_tracer_parent_class parent_class
 G_DEFINE_TYPE_WITH_CODE (GstInterLatencyTracer, gst_interlatency_tracer,
-    GST_SHARK_TYPE_TRACER, _do_init);
+    GST_TYPE_PERIODIC_TRACER, _do_init);
 
 static GQuark latency_probe_id;
 static GQuark latency_probe_pad;
 static GQuark latency_probe_ts;
 
 static GstTracerRecord *tr_interlatency;
+static GstTracerRecord *tr_interlatency_stats;
 
 static const gchar interlatency_metadata_event[] = "event {\n\
     name = interlatency;\n\
@@ -68,6 +69,8 @@ static const gchar interlatency_metadata_event[] = "event {\n\
 \n";
 
 static void gst_interlatency_tracer_dispose (GObject * object);
+static void gst_interlatency_tracer_constructed (GObject * object);
+static void gst_interlatency_tracer_finalize (GObject * object);
 
 /* data helpers */
 
@@ -105,37 +108,191 @@ get_real_pad_parent (GstPad * pad)
   return GST_ELEMENT_CAST (parent);
 }
 
+/* aggregation */
+
+static void
+log_latency_stats (const gchar * src, const gchar * sink,
+    const GstLatencyStats * stats, gpointer user_data)
+{
+  if (0 == stats->count) {
+    return;
+  }
+
+  gst_tracer_record_log (tr_interlatency_stats, src, sink, stats->count,
+      stats->p50, stats->p90, stats->p99, stats->max);
+}
+
+static gboolean
+interlatency_timer_callback (GstPeriodicTracer * tracer)
+{
+  GstInterLatencyTracer *self = GST_INTERLATENCY_TRACER (tracer);
+
+  if (self->aggregate) {
+    gst_latency_histogram_table_foreach (self->histograms, log_latency_stats,
+        NULL, TRUE);
+  }
+
+  return TRUE;
+}
+
+/* Action signal handler, logs the statistics of the running window without
+   resetting it */
+static void
+interlatency_dump_stats (GstInterLatencyTracer * self)
+{
+  gst_latency_histogram_table_foreach (self->histograms, log_latency_stats,
+      NULL, FALSE);
+}
+
+/* pad bookkeeping
+ *
+ * Entries are added and removed together with their pads under the writer
+ * lock. Streaming threads only take the reader lock to find an entry, plus
+ * the entry lock for the probe and the cached source of that probe, so
+ * buffers flowing through different pads do not contend. */
+
+static void
+free_pad_entry (gpointer data)
+{
+  GstInterLatencyPad *entry = (GstInterLatencyPad *) data;
+
+  if (NULL != entry->probe) {
+    gst_event_unref (entry->probe);
+  }
+  g_mutex_clear (&entry->lock);
+  g_free (entry);
+}
+
+/* Names are interned so they can be logged without allocating on every
+ * buffer */
+static const gchar *
+intern_pad_name (GstPad * pad)
+{
+  const gchar *interned;
+  gchar *name;
+
+  name = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (pad));
+  interned = g_intern_string (name);
+  g_free (name);
+
+  return interned;
+}
+
+static void
+add_pad_entry (GstInterLatencyTracer * interlatency_tracer, GstPad * pad)
+{
+  GstInterLatencyPad *entry;
+
+  g_rw_lock_writer_lock (&interlatency_tracer->pads_lock);
+  if (!g_hash_table_contains (interlatency_tracer->pads, pad)) {
+    entry = g_new0 (GstInterLatencyPad, 1);
+    g_mutex_init (&entry->lock);
+    entry->name = intern_pad_name (pad);
+    g_hash_table_insert (interlatency_tracer->pads, gst_object_ref (pad),
+        entry);
+  }
+  g_rw_lock_writer_unlock (&interlatency_tracer->pads_lock);
+}
+
+/* Must be called with the pads lock held */
+static GstInterLatencyPad *
+lookup_pad_entry_unlocked (GstInterLatencyTracer * interlatency_tracer,
+    GstPad * pad)
+{
+  return (GstInterLatencyPad *) g_hash_table_lookup (interlatency_tracer->pads,
+      pad);
+}
+
+/* Must be called with the pads lock held */
+static const gchar *
+get_pad_name_unlocked (GstInterLatencyTracer * interlatency_tracer,
+    GstPad * pad)
+{
+  GstInterLatencyPad *entry;
+
+  entry = lookup_pad_entry_unlocked (interlatency_tracer, pad);
+  if (NULL != entry) {
+    return entry->name;
+  }
+
+  return intern_pad_name (pad);
+}
+
+static void
+store_latency_probe (GstInterLatencyTracer * interlatency_tracer,
+    GstPad * pad, GstEvent * ev)
+{
+  GstInterLatencyPad *entry;
+
+  g_rw_lock_reader_lock (&interlatency_tracer->pads_lock);
+  entry = lookup_pad_entry_unlocked (interlatency_tracer, pad);
+  if (NULL == entry) {
+    /* Pads added before the tracer was created are registered on their
+       first probe */
+    g_rw_lock_reader_unlock (&interlatency_tracer->pads_lock);
+    add_pad_entry (interlatency_tracer, pad);
+    g_rw_lock_reader_lock (&interlatency_tracer->pads_lock);
+    entry = lookup_pad_entry_unlocked (interlatency_tracer, pad);
+  }
+
+  if (NULL != entry) {
+    g_mutex_lock (&entry->lock);
+    gst_event_replace (&entry->probe, ev);
+    g_mutex_unlock (&entry->lock);
+  }
+  g_rw_lock_reader_unlock (&interlatency_tracer->pads_lock);
+}
+
 /* hooks */
 
+/* Must be called with the pads lock held */
 static void
 log_latency (GstInterLatencyTracer * interlatency_tracer,
-    const GstStructure * data, GstPad * sink_pad, guint64 sink_ts)
+    const GstStructure * data, GstInterLatencyPad * sink_entry,
+    GstPad * sink_pad, guint64 sink_ts)
 {
   GstPad *src_pad = NULL;
   guint64 src_ts;
-  gchar *src = NULL, *sink = NULL;
+  const gchar *src = NULL;
+  GstLatencyHistogram *histogram;
   guint64 time;
-  GString *time_string = NULL;
-
-  gst_structure_id_get (data,
-      latency_probe_pad, GST_TYPE_PAD, &src_pad,
-      latency_probe_ts, G_TYPE_UINT64, &src_ts, NULL);
+  gchar time_string[32];
 
-  src = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (src_pad));
-  sink = g_strdup_printf ("%s_%s", GST_DEBUG_PAD_NAME (sink_pad));
+  /* The probe event holds a reference to the pad for us */
+  src_pad = GST_PAD (g_value_get_object (gst_structure_id_get_value (data,
+              latency_probe_pad)));
+  src_ts = g_value_get_uint64 (gst_structure_id_get_value (data,
+          latency_probe_ts));
 
   time = GST_CLOCK_DIFF (src_ts, sink_ts);
 
-  time_string = g_string_new ("");
-  g_string_printf (time_string, "%" GST_TIME_FORMAT, GST_TIME_ARGS (time));
+  /* The source of the probes reaching a pad rarely changes, resolve its
+     name and histogram only when it does */
+  g_mutex_lock (&sink_entry->lock);
+  if (sink_entry->last_src != src_pad) {
+    sink_entry->last_src = src_pad;
+    sink_entry->last_src_name =
+        get_pad_name_unlocked (interlatency_tracer, src_pad);
+    sink_entry->histogram = interlatency_tracer->aggregate ?
+        gst_latency_histogram_table_get (interlatency_tracer->histograms,
+        src_pad, sink_pad, sink_entry->last_src_name, sink_entry->name) : NULL;
+  }
+  src = sink_entry->last_src_name;
+  histogram = sink_entry->histogram;
+  g_mutex_unlock (&sink_entry->lock);
+
+  if (interlatency_tracer->aggregate) {
+    gst_latency_histogram_record (histogram, time);
+    return;
+  }
 
-  gst_tracer_record_log (tr_interlatency, src, sink, time_string->str);
+  g_snprintf (time_string, sizeof (time_string), "%" GST_TIME_FORMAT,
+      GST_TIME_ARGS (time));
 
-  do_print_interlatency_event (INTERLATENCY_EVENT_ID, src, sink, time);
+  gst_tracer_record_log (tr_interlatency, src, sink_entry->name, time_string);
 
-  g_string_free (time_string, TRUE);
-  g_free (src);
-  g_free (sink);
+  do_print_interlatency_event (INTERLATENCY_EVENT_ID, (gchar *) src,
+      (gchar *) sink_entry->name, time);
 }
 
 static void
@@ -158,16 +315,33 @@ static void
 calculate_latency (GstInterLatencyTracer * interlatency_tracer,
     GstElement * parent, GstPad * pad, guint64 ts)
 {
+  GstInterLatencyPad *entry;
+  GstEvent *ev = NULL;
+
   g_return_if_fail (interlatency_tracer);
   g_return_if_fail (parent);
   g_return_if_fail (pad);
 
-  if (!GST_IS_BIN (parent)) {
-    GstEvent *ev = (GstEvent*)g_object_get_qdata ((GObject *) pad, latency_probe_id);
+  if (GST_IS_BIN (parent)) {
+    return;
+  }
+
+  g_rw_lock_reader_lock (&interlatency_tracer->pads_lock);
+  entry = lookup_pad_entry_unlocked (interlatency_tracer, pad);
+  if (NULL != entry) {
+    g_mutex_lock (&entry->lock);
+    if (NULL != entry->probe) {
+      ev = gst_event_ref (entry->probe);
+    }
+    g_mutex_unlock (&entry->lock);
+  }
 
-    if (GST_IS_EVENT (ev))
-      log_latency (interlatency_tracer, gst_event_get_structure (ev), pad, ts);
+  if (NULL != ev) {
+    log_latency (interlatency_tracer, gst_event_get_structure (ev), entry,
+        pad, ts);
+    gst_event_unref (ev);
   }
+  g_rw_lock_reader_unlock (&interlatency_tracer->pads_lock);
 }
 
 static void
@@ -233,6 +407,9 @@ do_push_event_pre (GstTracer * self, guint64 ts, GstPad * pad, GstEvent * ev)
   GstPad *peer_pad = GST_PAD_PEER (pad);
   GstElement *parent = get_real_pad_parent (pad);
   GstElement *parent_peer = get_real_pad_parent (peer_pad);
+  GstInterLatencyTracer *interlatency_tracer;
+
+  interlatency_tracer = GST_INTERLATENCY_TRACER_CAST (self);
 
   if (parent_peer && (!GST_IS_BIN (parent_peer)) &&
       !GST_OBJECT_FLAG_IS_SET (parent, GST_ELEMENT_FLAG_SOURCE)) {
@@ -242,25 +419,46 @@ do_push_event_pre (GstTracer * self, guint64 ts, GstPad * pad, GstEvent * ev)
       if (gst_structure_get_name_id (data) == latency_probe_id) {
         /* store event and calculate latency when the buffer that follows
          * has been processed */
-        g_object_set_qdata_full ((GObject *) pad, latency_probe_id,
-            gst_event_ref (ev), (GDestroyNotify) gst_event_unref);
+        store_latency_probe (interlatency_tracer, pad, ev);
         if (GST_OBJECT_FLAG_IS_SET (parent_peer, GST_ELEMENT_FLAG_SINK))
-          g_object_set_qdata_full ((GObject *) peer_pad, latency_probe_id,
-              gst_event_ref (ev), (GDestroyNotify) gst_event_unref);
+          store_latency_probe (interlatency_tracer, peer_pad, ev);
       }
     }
   }
 }
 
+static void
+do_element_add_pad (GstTracer * self, guint64 ts, GstElement * element,
+    GstPad * pad)
+{
+  /* Resolve the pad name once, when the pad is created */
+  add_pad_entry (GST_INTERLATENCY_TRACER_CAST (self), pad);
+}
+
+static void
+do_element_remove_pad (GstTracer * self, guint64 ts, GstElement * element,
+    GstPad * pad)
+{
+  GstInterLatencyTracer *interlatency_tracer;
+
+  interlatency_tracer = GST_INTERLATENCY_TRACER_CAST (self);
+
+  g_rw_lock_writer_lock (&interlatency_tracer->pads_lock);
+  g_hash_table_remove (interlatency_tracer->pads, pad);
+  g_rw_lock_writer_unlock (&interlatency_tracer->pads_lock);
+}
+
 /* tracer class */
 
 static void
 gst_interlatency_tracer_class_init (GstInterLatencyTracerClass * klass)
 {
   GObjectClass *oclass;
+  GstPeriodicTracerClass *ptracer_class;
   gchar *metadata_event;
 
   oclass = G_OBJECT_CLASS (klass);
+  ptracer_class = GST_PERIODIC_TRACER_CLASS (klass);
 
   latency_probe_id = g_quark_from_static_string ("latency_probe.id");
   latency_probe_pad = g_quark_from_static_string ("latency_probe.pad");
@@ -282,8 +480,43 @@ gst_interlatency_tracer_class_init (GstInterLatencyTracerClass * klass)
           NULL),
       NULL);
 
+  tr_interlatency_stats = gst_tracer_record_new ("interlatencystats.class",
+      "from_pad", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_PAD,
+          NULL),
+      "to_pad", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_PAD,
+          NULL),
+      "count", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Buffers measured in the period",
+          NULL),
+      "p50", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Median latency [ns]", NULL),
+      "p90", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "90th percentile latency [ns]", NULL),
+      "p99", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "99th percentile latency [ns]", NULL),
+      "max", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Maximal latency [ns]", NULL),
+      NULL);
 
+  oclass->constructed = gst_interlatency_tracer_constructed;
   oclass->dispose = gst_interlatency_tracer_dispose;
+  oclass->finalize = gst_interlatency_tracer_finalize;
+
+  ptracer_class->timer_callback =
+      GST_DEBUG_FUNCPTR (interlatency_timer_callback);
+
+  g_signal_new_class_handler ("dump-stats", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_CALLBACK (interlatency_dump_stats), NULL, NULL, NULL, G_TYPE_NONE, 0);
 
   metadata_event =
       g_strdup_printf (interlatency_metadata_event, INTERLATENCY_EVENT_ID, 0);
@@ -296,6 +529,12 @@ gst_interlatency_tracer_init (GstInterLatencyTracer * self)
 {
   GstTracer *tracer = GST_TRACER (self);
 
+  self->aggregate = FALSE;
+  self->histograms = gst_latency_histogram_table_new ();
+  g_rw_lock_init (&self->pads_lock);
+  self->pads = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      gst_object_unref, free_pad_entry);
+
   /* In push mode, pre/post will be called before/after the peer chain
    * function has been called. For this reason, we only use -pre to avoid
    * accounting for the processing time of the peer element (the sink).
@@ -316,9 +555,43 @@ gst_interlatency_tracer_init (GstInterLatencyTracer * self)
       G_CALLBACK (do_pull_range_post));
   gst_tracing_register_hook (tracer, "pad-push-event-pre",
       G_CALLBACK (do_push_event_pre));
+  gst_tracing_register_hook (tracer, "element-add-pad",
+      G_CALLBACK (do_element_add_pad));
+  gst_tracing_register_hook (tracer, "element-remove-pad",
+      G_CALLBACK (do_element_remove_pad));
+}
+
+static void
+gst_interlatency_tracer_constructed (GObject * object)
+{
+  GstInterLatencyTracer *self = GST_INTERLATENCY_TRACER (object);
+  GList *mode;
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  /* Parameters are only available once the shark tracer has been
+     constructed */
+  mode = gst_shark_tracer_get_param (GST_SHARK_TRACER (self), "mode");
+  self->aggregate = (NULL != mode)
+      && (0 == g_strcmp0 ((const gchar *) mode->data, "aggregate"));
 }
 
 static void
 gst_interlatency_tracer_dispose (GObject * object)
 {
 }
+
+static void
+gst_interlatency_tracer_finalize (GObject * object)
+{
+  GstInterLatencyTracer *self = GST_INTERLATENCY_TRACER (object);
+
+  gst_latency_histogram_table_free (self->histograms);
+  self->histograms = NULL;
+
+  g_hash_table_destroy (self->pads);
+  self->pads = NULL;
+  g_rw_lock_clear (&self->pads_lock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
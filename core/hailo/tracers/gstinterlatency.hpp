@@ -22,7 +22,8 @@
  */
 #pragma once
 
-#include "gstsharktracer.hpp"
+#include "gstperiodictracer.hpp"
+#include "gstlatencyhistogram.hpp"
 
 G_BEGIN_DECLS
 #define GST_TYPE_INTERLATENCY_TRACER \
@@ -38,6 +39,21 @@ G_BEGIN_DECLS
 #define GST_INTERLATENCY_TRACER_CAST(obj) ((GstInterLatencyTracer *)(obj))
 typedef struct _GstInterLatencyTracer GstInterLatencyTracer;
 typedef struct _GstInterLatencyTracerClass GstInterLatencyTracerClass;
+typedef struct _GstInterLatencyPad GstInterLatencyPad;
+
+/* Per pad bookkeeping: the last latency probe seen on the pad, its interned
+ * "element_pad" name, and the name and histogram of the last source pad
+ * that reached it, so they are not looked up on every buffer. Everything
+ * but the name is protected by the entry lock. */
+struct _GstInterLatencyPad
+{
+  GMutex lock;
+  GstEvent *probe;
+  const gchar *name;
+  gconstpointer last_src;
+  const gchar *last_src_name;
+  GstLatencyHistogram *histogram;
+};
 
 /**
  * GstInterLatencyTracer:
@@ -46,13 +62,17 @@ typedef struct _GstInterLatencyTracerClass GstInterLatencyTracerClass;
  */
 struct _GstInterLatencyTracer
 {
-  GstSharkTracer parent;
+  GstPeriodicTracer parent;
   /*< private > */
+  gboolean aggregate;
+  GstLatencyHistogramTable *histograms;
+  GRWLock pads_lock;
+  GHashTable *pads;
 };
 
 struct _GstInterLatencyTracerClass
 {
-  GstSharkTracerClass parent_class;
+  GstPeriodicTracerClass parent_class;
 
   /* signals */
 };
@@ -0,0 +1,198 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/**
+ * SECTION:gstlatencyhistogram
+ * @short_description: lock free log-linear latency histograms
+ *
+ * See latency_buckets.hpp for the bucket layout. Recording never allocates
+ * or locks, so histograms can be fed from any streaming thread.
+ */
+
+#include <atomic>
+#include "gstlatencyhistogram.hpp"
+#include "latency_buckets.hpp"
+
+struct _GstLatencyHistogram
+{
+  gchar *from;
+  gchar *to;
+  std::atomic<guint64> max;
+  std::atomic<guint64> buckets[LATENCY_HISTOGRAM_BUCKETS];
+};
+
+typedef struct _GstLatencyHistogramKey GstLatencyHistogramKey;
+struct _GstLatencyHistogramKey
+{
+  gconstpointer from;
+  gconstpointer to;
+};
+
+struct _GstLatencyHistogramTable
+{
+  GMutex mutex;
+  GHashTable *histograms;
+};
+
+static GstLatencyHistogram *
+gst_latency_histogram_new (const gchar * from, const gchar * to)
+{
+  GstLatencyHistogram *histogram;
+  guint i;
+
+  histogram = new GstLatencyHistogram;
+  histogram->from = g_strdup (from);
+  histogram->to = g_strdup (to);
+  histogram->max.store (0, std::memory_order_relaxed);
+  for (i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i) {
+    histogram->buckets[i].store (0, std::memory_order_relaxed);
+  }
+
+  return histogram;
+}
+
+static void
+gst_latency_histogram_free (gpointer data)
+{
+  GstLatencyHistogram *histogram = (GstLatencyHistogram *) data;
+
+  g_free (histogram->from);
+  g_free (histogram->to);
+  delete histogram;
+}
+
+void
+gst_latency_histogram_record (GstLatencyHistogram * histogram,
+    GstClockTime value)
+{
+  guint64 max;
+
+  g_return_if_fail (histogram);
+
+  histogram->buckets[latency_bucket_index (value)].fetch_add (1,
+      std::memory_order_relaxed);
+
+  max = histogram->max.load (std::memory_order_relaxed);
+  while (value > max && !histogram->max.compare_exchange_weak (max, value,
+          std::memory_order_relaxed)) {
+  }
+}
+
+void
+gst_latency_histogram_get_stats (GstLatencyHistogram * histogram,
+    GstLatencyStats * stats, gboolean reset)
+{
+  guint64 counts[LATENCY_HISTOGRAM_BUCKETS];
+  guint64 total = 0;
+  guint i;
+
+  g_return_if_fail (histogram);
+  g_return_if_fail (stats);
+
+  /* Take a consistent copy first, records arriving meanwhile simply land in
+   * the next window */
+  for (i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i) {
+    if (reset) {
+      counts[i] = histogram->buckets[i].exchange (0, std::memory_order_relaxed);
+    } else {
+      counts[i] = histogram->buckets[i].load (std::memory_order_relaxed);
+    }
+    total += counts[i];
+  }
+
+  stats->count = total;
+  stats->max = reset ? histogram->max.exchange (0, std::memory_order_relaxed)
+      : histogram->max.load (std::memory_order_relaxed);
+  latency_bucket_percentiles (counts, total, stats->max, &stats->p50,
+      &stats->p90, &stats->p99);
+}
+
+static guint
+histogram_key_hash (gconstpointer data)
+{
+  const GstLatencyHistogramKey *key = (const GstLatencyHistogramKey *) data;
+
+  return g_direct_hash (key->from) * 31 + g_direct_hash (key->to);
+}
+
+static gboolean
+histogram_key_equal (gconstpointer a, gconstpointer b)
+{
+  const GstLatencyHistogramKey *key_a = (const GstLatencyHistogramKey *) a;
+  const GstLatencyHistogramKey *key_b = (const GstLatencyHistogramKey *) b;
+
+  return key_a->from == key_b->from && key_a->to == key_b->to;
+}
+
+GstLatencyHistogramTable *
+gst_latency_histogram_table_new (void)
+{
+  GstLatencyHistogramTable *table;
+
+  table = (GstLatencyHistogramTable *) g_malloc (sizeof (GstLatencyHistogramTable));
+
+  g_mutex_init (&table->mutex);
+  table->histograms = g_hash_table_new_full (histogram_key_hash,
+      histogram_key_equal, g_free, gst_latency_histogram_free);
+
+  return table;
+}
+
+GstLatencyHistogram *
+gst_latency_histogram_table_get (GstLatencyHistogramTable * table,
+    gconstpointer from_key, gconstpointer to_key, const gchar * from_name,
+    const gchar * to_name)
+{
+  GstLatencyHistogramKey lookup_key = { from_key, to_key };
+  GstLatencyHistogramKey *key;
+  GstLatencyHistogram *histogram;
+
+  g_return_val_if_fail (table, NULL);
+
+  g_mutex_lock (&table->mutex);
+  histogram =
+      (GstLatencyHistogram *) g_hash_table_lookup (table->histograms,
+      &lookup_key);
+  if (NULL == histogram) {
+    key = g_new (GstLatencyHistogramKey, 1);
+    *key = lookup_key;
+    histogram = gst_latency_histogram_new (from_name, to_name);
+    g_hash_table_insert (table->histograms, key, histogram);
+  }
+  g_mutex_unlock (&table->mutex);
+
+  return histogram;
+}
+
+void
+gst_latency_histogram_table_foreach (GstLatencyHistogramTable * table,
+    GstLatencyHistogramFunc func, gpointer user_data, gboolean reset)
+{
+  GHashTableIter iter;
+  gpointer value;
+  GstLatencyHistogram *histogram;
+  GstLatencyStats stats;
+
+  g_return_if_fail (table);
+  g_return_if_fail (func);
+
+  g_mutex_lock (&table->mutex);
+  g_hash_table_iter_init (&iter, table->histograms);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    histogram = (GstLatencyHistogram *) value;
+    gst_latency_histogram_get_stats (histogram, &stats, reset);
+    func (histogram->from, histogram->to, &stats, user_data);
+  }
+  g_mutex_unlock (&table->mutex);
+}
+
+void
+gst_latency_histogram_table_free (GstLatencyHistogramTable * table)
+{
+  g_return_if_fail (table);
+
+  g_hash_table_destroy (table->histograms);
+  g_mutex_clear (&table->mutex);
+  g_free (table);
+}
@@ -0,0 +1,51 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+#pragma once
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstLatencyHistogram GstLatencyHistogram;
+typedef struct _GstLatencyHistogramTable GstLatencyHistogramTable;
+typedef struct _GstLatencyStats GstLatencyStats;
+
+/* Summary of a latency histogram, all times are in nanoseconds */
+struct _GstLatencyStats
+{
+  guint64 count;
+  GstClockTime p50;
+  GstClockTime p90;
+  GstClockTime p99;
+  GstClockTime max;
+};
+
+typedef void (*GstLatencyHistogramFunc) (const gchar * from,
+    const gchar * to, const GstLatencyStats * stats, gpointer user_data);
+
+/* Recording into a histogram is lock free and may be done from any
+ * streaming thread. */
+void gst_latency_histogram_record (GstLatencyHistogram * histogram,
+    GstClockTime value);
+
+void gst_latency_histogram_get_stats (GstLatencyHistogram * histogram,
+    GstLatencyStats * stats, gboolean reset);
+
+GstLatencyHistogramTable *gst_latency_histogram_table_new (void);
+
+/* Histograms are keyed by a (from, to) pointer pair, normally pads. The
+ * names are only copied when the histogram is first created. The lookup
+ * takes the table lock, callers resolve a histogram once and keep the
+ * pointer, which stays valid until the table is freed. */
+GstLatencyHistogram *gst_latency_histogram_table_get (GstLatencyHistogramTable
+    * table, gconstpointer from_key, gconstpointer to_key,
+    const gchar * from_name, const gchar * to_name);
+
+void gst_latency_histogram_table_foreach (GstLatencyHistogramTable * table,
+    GstLatencyHistogramFunc func, gpointer user_data, gboolean reset);
+
+void gst_latency_histogram_table_free (GstLatencyHistogramTable * table);
+
+G_END_DECLS
@@ -26,6 +26,7 @@
 
 #include "gstproctimecompute.hpp"
 #include "gstproctime.hpp"
+#include "gstlatencyhistogram.hpp"
 #include "gstctf.hpp"
 
 GST_DEBUG_CATEGORY_STATIC (gst_proc_time_debug);
@@ -38,18 +39,24 @@ GST_DEBUG_CATEGORY_STATIC (gst_proc_time_debug);
  */
 struct _GstProcTimeTracer
 {
-  GstSharkTracer parent;
+  GstPeriodicTracer parent;
 
   GstProcTime *proc_time;
+  /* When set, processing times are aggregated into histograms and only
+     their percentiles are logged periodically, instead of one record
+     per buffer */
+  gboolean aggregate;
+  GstLatencyHistogramTable *histograms;
 };
 
 #define _do_init \
     GST_DEBUG_CATEGORY_INIT (gst_proc_time_debug, "proctime", 0, "proctime tracer");
 
 G_DEFINE_TYPE_WITH_CODE (GstProcTimeTracer, gst_proc_time_tracer,
-    GST_SHARK_TYPE_TRACER, _do_init);
+    GST_TYPE_PERIODIC_TRACER, _do_init);
 
 static GstTracerRecord *tr_proc_time;
+static GstTracerRecord *tr_proc_time_stats;
 
 static const gchar proc_time_metadata_event[] = "event {\n\
     name = proctime;\n\
@@ -72,6 +79,7 @@ do_push_buffer_pre (GstTracer * self, guint64 ts, GstPad * pad)
   GstPad *pad_peer;
   gchar *name;
   GstClockTime time;
+  GstLatencyHistogram *histogram = NULL;
   gchar *time_string;
   gboolean should_log;
   gboolean should_calculate;
@@ -89,9 +97,18 @@ do_push_buffer_pre (GstTracer * self, guint64 ts, GstPad * pad)
   should_calculate = gst_shark_tracer_element_is_filtered (shark_tracer, name);
   should_log =
       gst_proctime_proc_time (proc_time, &time, pad_peer, pad, ts,
-      should_calculate);
-
-  if (should_log) {
+      should_calculate, (gpointer *) & histogram);
+
+  if (should_log && proc_time_tracer->aggregate) {
+    /* Resolved on the first buffer, once the element has its final name,
+       and cached in the element entry from then on */
+    if (NULL == histogram) {
+      histogram = gst_latency_histogram_table_get (proc_time_tracer->histograms,
+          GST_OBJECT_PARENT (pad), NULL, name, NULL);
+      gst_proctime_set_data (proc_time, pad, histogram);
+    }
+    gst_latency_histogram_record (histogram, time);
+  } else if (should_log) {
     time_string = g_strdup_printf ("%" GST_TIME_FORMAT, GST_TIME_ARGS (time));
 
     gst_tracer_record_log (tr_proc_time, name, time_string);
@@ -116,8 +133,72 @@ do_element_new (GObject * self, GstClockTime ts, GstElement * element)
   gst_proctime_add_new_element (proc_time, element);
 }
 
+static void
+log_proc_time_stats (const gchar * element, const gchar * unused,
+    const GstLatencyStats * stats, gpointer user_data)
+{
+  if (0 == stats->count) {
+    return;
+  }
+
+  gst_tracer_record_log (tr_proc_time_stats, element, stats->count,
+      stats->p50, stats->p90, stats->p99, stats->max);
+}
+
+static gboolean
+proc_time_timer_callback (GstPeriodicTracer * tracer)
+{
+  GstProcTimeTracer *self = GST_PROC_TIME_TRACER (tracer);
+
+  if (self->aggregate) {
+    gst_latency_histogram_table_foreach (self->histograms,
+        log_proc_time_stats, NULL, TRUE);
+  }
+
+  return TRUE;
+}
+
+/* Action signal handler, logs the statistics of the running window without
+   resetting it */
+static void
+proc_time_dump_stats (GstProcTimeTracer * self)
+{
+  gst_latency_histogram_table_foreach (self->histograms, log_proc_time_stats,
+      NULL, FALSE);
+}
+
+static void
+do_element_add_pad (GObject * self, GstClockTime ts, GstElement * element,
+    GstPad * pad)
+{
+  GstProcTimeTracer *proc_time_tracer;
+
+  proc_time_tracer = GST_PROC_TIME_TRACER (self);
+
+  /* Pads created after the element (e.g. sometimes pads) change the
+     element's pad bookkeeping, so re-register it */
+  gst_proctime_add_new_element (proc_time_tracer->proc_time, element);
+}
+
 /* tracer class */
 
+static void
+gst_proc_time_tracer_constructed (GObject * obj)
+{
+  GstProcTimeTracer *self;
+  GList *mode;
+
+  G_OBJECT_CLASS (gst_proc_time_tracer_parent_class)->constructed (obj);
+
+  self = GST_PROC_TIME_TRACER (obj);
+
+  /* Parameters are only available once the shark tracer has been
+     constructed */
+  mode = gst_shark_tracer_get_param (GST_SHARK_TRACER (self), "mode");
+  self->aggregate = (NULL != mode)
+      && (0 == g_strcmp0 ((const gchar *) mode->data, "aggregate"));
+}
+
 static void
 gst_proc_time_tracer_finalize (GObject * obj)
 {
@@ -128,6 +209,9 @@ gst_proc_time_tracer_finalize (GObject * obj)
   gst_proctime_free (self->proc_time);
   self->proc_time = NULL;
 
+  gst_latency_histogram_table_free (self->histograms);
+  self->histograms = NULL;
+
   G_OBJECT_CLASS (gst_proc_time_tracer_parent_class)->finalize (obj);
 }
 
@@ -135,10 +219,18 @@ static void
 gst_proc_time_tracer_class_init (GstProcTimeTracerClass * klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstPeriodicTracerClass *ptracer_class = GST_PERIODIC_TRACER_CLASS (klass);
   gchar *metadata_event;
 
+  gobject_class->constructed = gst_proc_time_tracer_constructed;
   gobject_class->finalize = gst_proc_time_tracer_finalize;
 
+  ptracer_class->timer_callback = GST_DEBUG_FUNCPTR (proc_time_timer_callback);
+
+  g_signal_new_class_handler ("dump-stats", G_TYPE_FROM_CLASS (klass),
+      (GSignalFlags) (G_SIGNAL_RUN_LAST | G_SIGNAL_ACTION),
+      G_CALLBACK (proc_time_dump_stats), NULL, NULL, NULL, G_TYPE_NONE, 0);
+
   tr_proc_time = gst_tracer_record_new ("proctime.class",
       "element", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
           "type", G_TYPE_GTYPE, G_TYPE_STRING,
@@ -148,6 +240,31 @@ gst_proc_time_tracer_class_init (GstProcTimeTracerClass * klass)
           "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
           GST_TRACER_VALUE_SCOPE_PROCESS, NULL), NULL);
 
+  tr_proc_time_stats = gst_tracer_record_new ("proctimestats.class",
+      "element", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related-to", GST_TYPE_TRACER_VALUE_SCOPE,
+          GST_TRACER_VALUE_SCOPE_ELEMENT, NULL),
+      "count", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Buffers measured in the period",
+          NULL),
+      "p50", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Median processing time [ns]", NULL),
+      "p90", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "90th percentile processing time [ns]",
+          NULL),
+      "p99", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "99th percentile processing time [ns]",
+          NULL),
+      "max", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Maximal processing time [ns]", NULL),
+      NULL);
+
   metadata_event =
       g_strdup_printf (proc_time_metadata_event, PROCTIME_EVENT_ID, 0);
   add_metadata_event_struct (metadata_event);
@@ -162,10 +279,15 @@ gst_proc_time_tracer_init (GstProcTimeTracer * self)
 
 
   self->proc_time = gst_proctime_new ();
+  self->aggregate = FALSE;
+  self->histograms = gst_latency_histogram_table_new ();
 
   gst_tracing_register_hook (tracer, "pad-push-pre",
       G_CALLBACK (do_push_buffer_pre));
 
   gst_tracing_register_hook (tracer, "element-new",
       G_CALLBACK (do_element_new));
+
+  gst_tracing_register_hook (tracer, "element-add-pad",
+      G_CALLBACK (do_element_add_pad));
 }
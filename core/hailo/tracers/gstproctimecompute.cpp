@@ -18,6 +18,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <atomic>
 #include "gstproctimecompute.hpp"
 
 typedef struct _GstProcTimeElement GstProcTimeElement;
@@ -25,17 +26,27 @@ struct _GstProcTimeElement
 {
   GstPad *src_pad;
   GstPad *sink_pad;
-  GstClockTime start_time;
+  /* Written by the upstream streaming thread and read by the element's own
+     one, both only hold the reader lock */
+  std::atomic<GstClockTime> start_time;
+  /* Set once from the streaming thread, read on every buffer */
+  std::atomic<gpointer> data;
 };
 
+/* Elements are indexed by both of their pads, so that the buffer push hook
+ * finds the receiving and the producing element in constant time regardless
+ * of the pipeline size. The elements table owns the entries. */
 struct _GstProcTime
 {
-  GList *elements;
+  GRWLock lock;
+  GHashTable *elements;
+  GHashTable *by_sink_pad;
+  GHashTable *by_src_pad;
 };
 
 static void free_element (gpointer data);
-static void gst_proctime_add_in_list (GstProcTime * proc_time,
-    GstPad * sink_pad, GstPad * src_pad);
+static void gst_proctime_add_in_table (GstProcTime * proc_time,
+    GstElement * element, GstPad * sink_pad, GstPad * src_pad);
 
 static void
 free_element (gpointer data)
@@ -50,7 +61,7 @@ free_element (gpointer data)
   gst_object_unref (element->sink_pad);
   element->sink_pad = NULL;
 
-  g_free (element);
+  delete element;
 }
 
 GstProcTime *
@@ -62,7 +73,11 @@ gst_proctime_new (void)
 
   g_return_val_if_fail (self, NULL);
 
-  self->elements = NULL;
+  g_rw_lock_init (&self->lock);
+  self->elements = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, free_element);
+  self->by_sink_pad = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->by_src_pad = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   return self;
 }
@@ -72,31 +87,52 @@ gst_proctime_free (GstProcTime * self)
 {
   g_return_if_fail (self);
 
-  g_list_free_full (self->elements, free_element);
+  g_hash_table_destroy (self->by_sink_pad);
+  g_hash_table_destroy (self->by_src_pad);
+  g_hash_table_destroy (self->elements);
+  g_rw_lock_clear (&self->lock);
   g_free (self);
 }
 
-/* Add a new element in the list.
+/* Add a new element in the tables.
  * The element added must be an element with only one src pad and one 
- * sink pad.
+ * sink pad. Adding an element again replaces its previous pads.
  */
 static void
-gst_proctime_add_in_list (GstProcTime * proc_time, GstPad * sink_pad,
-    GstPad * src_pad)
+gst_proctime_add_in_table (GstProcTime * proc_time, GstElement * element,
+    GstPad * sink_pad, GstPad * src_pad)
 {
   GstProcTimeElement *new_element;
+  GstProcTimeElement *old_element;
 
   g_return_if_fail (proc_time);
+  g_return_if_fail (element);
   g_return_if_fail (sink_pad);
   g_return_if_fail (src_pad);
 
-  new_element = (GstProcTimeElement*)g_malloc0 (sizeof (GstProcTimeElement));
-  new_element->start_time = GST_CLOCK_TIME_NONE;
+  new_element = new GstProcTimeElement;
+  new_element->start_time.store (GST_CLOCK_TIME_NONE,
+      std::memory_order_relaxed);
+  new_element->data.store (NULL, std::memory_order_relaxed);
 
   new_element->sink_pad = (GstPad*)gst_object_ref (sink_pad);
   new_element->src_pad = (GstPad*)gst_object_ref (src_pad);
 
-  proc_time->elements = g_list_append (proc_time->elements, new_element);
+  g_rw_lock_writer_lock (&proc_time->lock);
+
+  old_element = (GstProcTimeElement*)g_hash_table_lookup (proc_time->elements,
+      element);
+  if (NULL != old_element) {
+    g_hash_table_remove (proc_time->by_sink_pad, old_element->sink_pad);
+    g_hash_table_remove (proc_time->by_src_pad, old_element->src_pad);
+  }
+
+  /* Replacing frees the previous entry of this element */
+  g_hash_table_replace (proc_time->elements, element, new_element);
+  g_hash_table_replace (proc_time->by_sink_pad, sink_pad, new_element);
+  g_hash_table_replace (proc_time->by_src_pad, src_pad, new_element);
+
+  g_rw_lock_writer_unlock (&proc_time->lock);
 }
 
 void
@@ -137,7 +173,7 @@ gst_proctime_add_new_element (GstProcTime * proc_time, GstElement * element)
 
   /* We are only interested in elements with one sink and src pad */
   if (num_src_pads == 1 && num_sink_pads == 1) {
-    gst_proctime_add_in_list (proc_time, sink_pad, src_pad);
+    gst_proctime_add_in_table (proc_time, element, sink_pad, src_pad);
   }
 
 out:
@@ -157,59 +193,83 @@ out:
 gboolean
 gst_proctime_proc_time (GstProcTime * proc_time, GstClockTime * time,
     GstPad * peer_pad, GstPad * src_pad, GstClockTime ts,
-    gboolean do_calculation)
+    gboolean do_calculation, gpointer * data)
 {
   GstProcTimeElement *element;
+  GstClockTime start_time;
   GstClockTime stop_time;
-  guint elem_num;
-  guint elem_idx;
   gboolean found = FALSE;
 
   g_return_val_if_fail (proc_time, FALSE);
   g_return_val_if_fail (time, FALSE);
   g_return_val_if_fail (src_pad, FALSE);
   g_return_val_if_fail (peer_pad, FALSE);
+  g_return_val_if_fail (data, FALSE);
+
+  *data = NULL;
+
+  g_rw_lock_reader_lock (&proc_time->lock);
 
-  elem_num = g_list_length (proc_time->elements);
-  /* Search the peer pad in the list 
+  /* Search the peer pad in the table
    * The peer pad is used to identify which is the element where the 
    * buffer is received.
    */
-  for (elem_idx = 0; elem_idx < elem_num; ++elem_idx) {
-    element = (GstProcTimeElement*)g_list_nth_data (proc_time->elements, elem_idx);
-    if (element->sink_pad == peer_pad) {
-      element->start_time = ts;
-    }
+  element = (GstProcTimeElement*)g_hash_table_lookup (proc_time->by_sink_pad,
+      peer_pad);
+  if (NULL != element) {
+    element->start_time.store (ts, std::memory_order_relaxed);
   }
 
   if (!do_calculation)
     goto exit;
 
-  /* Search the src pad in the list 
-   * The peer pad is used to identify which is the element where the 
+  /* Search the src pad in the table
+   * The src pad is used to identify which is the element where the 
    * buffer was processed.
-   * If the src pad is not in the list, then it is a src element and the
+   * If the src pad is not in the table, then it is a src element and the
    * precessing time is not computed
    */
-  for (elem_idx = 0; elem_idx < elem_num; ++elem_idx) {
-    element = (GstProcTimeElement*)g_list_nth_data (proc_time->elements, elem_idx);
-    if (element->src_pad == src_pad) {
-      stop_time = ts;
-      if (stop_time > element->start_time) {
-        *time = stop_time - element->start_time;
-      } else {
-        /* FIXME: For elements storing buffers (e.g queues) there are
-           timestamps mismatches sometimes, because more than 1 buffer
-           is pushed before getting 1 at the output */
-        GST_WARNING_OBJECT (element->src_pad,
-            "Timestamps mismatch, this should not happen");
-        found = FALSE;
-        goto exit;
-      }
-      found = TRUE;
+  element = (GstProcTimeElement*)g_hash_table_lookup (proc_time->by_src_pad,
+      src_pad);
+  if (NULL != element) {
+    start_time = element->start_time.load (std::memory_order_relaxed);
+    stop_time = ts;
+    if (GST_CLOCK_TIME_IS_VALID (start_time) && stop_time > start_time) {
+      *time = stop_time - start_time;
+    } else {
+      /* FIXME: For elements storing buffers (e.g queues) there are
+         timestamps mismatches sometimes, because more than 1 buffer
+         is pushed before getting 1 at the output */
+      GST_WARNING_OBJECT (element->src_pad,
+          "Timestamps mismatch, this should not happen");
+      found = FALSE;
+      goto exit;
     }
+    *data = element->data.load (std::memory_order_acquire);
+    found = TRUE;
   }
 
 exit:
+  g_rw_lock_reader_unlock (&proc_time->lock);
   return found;
 }
+
+void
+gst_proctime_set_data (GstProcTime * proc_time, GstPad * src_pad,
+    gpointer data)
+{
+  GstProcTimeElement *element;
+
+  g_return_if_fail (proc_time);
+  g_return_if_fail (src_pad);
+
+  g_rw_lock_reader_lock (&proc_time->lock);
+
+  element = (GstProcTimeElement*)g_hash_table_lookup (proc_time->by_src_pad,
+      src_pad);
+  if (NULL != element) {
+    element->data.store (data, std::memory_order_release);
+  }
+
+  g_rw_lock_reader_unlock (&proc_time->lock);
+}
@@ -30,9 +30,16 @@ GstProcTime *gst_proctime_new (void);
 void gst_proctime_add_new_element (GstProcTime * proc_time,
     GstElement * element);
 
+/* On success data is set to the user data attached to the element that
+ * produced the buffer, NULL until gst_proctime_set_data() is called */
 gboolean gst_proctime_proc_time (GstProcTime * proc_time,
     GstClockTime * time, GstPad * peer_pad, GstPad * src_pad,
-    GstClockTime ts, gboolean do_calculation);
+    GstClockTime ts, gboolean do_calculation, gpointer * data);
+
+/* Attaches user data to the element owning src_pad, e.g. to cache state
+ * resolved on its first buffer. The data is not owned by proc_time. */
+void gst_proctime_set_data (GstProcTime * proc_time, GstPad * src_pad,
+    gpointer data);
 
 void gst_proctime_free (GstProcTime * proc_time);
 
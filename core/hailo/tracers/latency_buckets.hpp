@@ -0,0 +1,112 @@
+/**
+ * Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+ * Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+ **/
+/* Bucket layout and percentile math of the latency histograms.
+ *
+ * Values are stored in buckets with a fixed relative precision (HDR style):
+ * 2^SUB_BUCKET_BITS values are tracked exactly, after that every power of two
+ * is split into 2^(SUB_BUCKET_BITS - 1) linear buckets, giving ~3% precision
+ * over the whole range with a fixed amount of memory.
+ *
+ * Kept free of GLib so it can be unit tested on its own. */
+#pragma once
+
+#include <stdint.h>
+
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 6
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_HALF_SUB_BUCKETS (LATENCY_HISTOGRAM_SUB_BUCKETS / 2)
+/* Values above 2^40 nsec (~18 minutes) are clamped */
+#define LATENCY_HISTOGRAM_MAX_BIT 40
+#define LATENCY_HISTOGRAM_MAX_VALUE ((UINT64_C (1) << LATENCY_HISTOGRAM_MAX_BIT) - 1)
+/* The exact range plus HALF_SUB_BUCKETS for every power of two above it */
+#define LATENCY_HISTOGRAM_BUCKETS \
+  ((LATENCY_HISTOGRAM_MAX_BIT - LATENCY_HISTOGRAM_SUB_BUCKET_BITS) * \
+   LATENCY_HISTOGRAM_HALF_SUB_BUCKETS + LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+static inline unsigned int
+latency_bucket_index (uint64_t value)
+{
+  unsigned int msb;
+  unsigned int shift;
+
+  if (value < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+    return (unsigned int) value;
+  }
+
+  if (value > LATENCY_HISTOGRAM_MAX_VALUE) {
+    value = LATENCY_HISTOGRAM_MAX_VALUE;
+  }
+
+  msb = 63 - __builtin_clzll (value);
+  shift = msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1;
+
+  /* (value >> shift) is in [HALF_SUB_BUCKETS, SUB_BUCKETS) */
+  return shift * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS +
+      (unsigned int) (value >> shift);
+}
+
+/* Returns the middle of the value range covered by a bucket */
+static inline uint64_t
+latency_bucket_value (unsigned int index)
+{
+  unsigned int shift;
+  uint64_t sub;
+
+  if (index < LATENCY_HISTOGRAM_SUB_BUCKETS) {
+    return index;
+  }
+
+  shift = index / LATENCY_HISTOGRAM_HALF_SUB_BUCKETS - 1;
+  sub = index - shift * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS;
+
+  return (sub << shift) + ((UINT64_C (1) << shift) >> 1);
+}
+
+/* Nearest rank p50/p90/p99 of LATENCY_HISTOGRAM_BUCKETS counts summing up to
+ * total. The bucket midpoints are clamped to the recorded maximum, all
+ * percentiles are 0 for an empty histogram. */
+static inline void
+latency_bucket_percentiles (const uint64_t * counts, uint64_t total,
+    uint64_t max, uint64_t * p50, uint64_t * p90, uint64_t * p99)
+{
+  uint64_t p50_rank, p90_rank, p99_rank;
+  uint64_t seen = 0;
+  bool p50_found = false, p90_found = false;
+  unsigned int i;
+
+  *p50 = *p90 = *p99 = 0;
+
+  if (0 == total) {
+    return;
+  }
+
+  p50_rank = (total * 50 + 99) / 100;
+  p90_rank = (total * 90 + 99) / 100;
+  p99_rank = (total * 99 + 99) / 100;
+
+  for (i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i) {
+    if (0 == counts[i]) {
+      continue;
+    }
+    seen += counts[i];
+    if (seen >= p50_rank && !p50_found) {
+      *p50 = latency_bucket_value (i);
+      p50_found = true;
+    }
+    if (seen >= p90_rank && !p90_found) {
+      *p90 = latency_bucket_value (i);
+      p90_found = true;
+    }
+    if (seen >= p99_rank) {
+      *p99 = latency_bucket_value (i);
+      break;
+    }
+  }
+
+  /* The bucket midpoint may overshoot the real maximum */
+  *p50 = *p50 < max ? *p50 : max;
+  *p90 = *p90 < max ? *p90 : max;
+  *p99 = *p99 < max ? *p99 : max;
+}
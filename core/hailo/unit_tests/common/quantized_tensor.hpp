@@ -0,0 +1,67 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+#pragma once
+
+// General cpp includes
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_tensors.hpp"
+
+/**
+ * @brief Info of a quantized output, as hailort reports it.
+ *
+ * @param type  -  HAILO_FORMAT_TYPE_UINT8 or HAILO_FORMAT_TYPE_UINT16.
+ */
+inline hailo_vstream_info_t make_vstream_info(const std::string &name, uint32_t height, uint32_t width, uint32_t features,
+                                              float qp_zp, float qp_scale,
+                                              hailo_format_type_t type = HAILO_FORMAT_TYPE_UINT8)
+{
+    hailo_vstream_info_t info;
+    memset(&info, 0, sizeof(info));
+    strncpy(info.name, name.c_str(), sizeof(info.name) - 1);
+    info.format.type = type;
+    info.shape = {height, width, features};
+    info.quant_info.qp_zp = qp_zp;
+    info.quant_info.qp_scale = qp_scale;
+    return info;
+}
+
+/**
+ * @brief A tensor over the given buffer. The tensor owns the buffer (HailoTensor::set_owner),
+ *        fill it through tensor->data().
+ */
+inline HailoTensorPtr make_quantized_tensor(std::vector<uint8_t> data, const hailo_vstream_info_t &info)
+{
+    auto buffer = std::make_shared<std::vector<uint8_t>>(std::move(data));
+    auto tensor = std::make_shared<HailoTensor>(buffer->data(), info);
+    tensor->set_owner(buffer);
+    return tensor;
+}
+
+/**
+ * @brief A tensor over a zeroed buffer sized by its shape and format.
+ */
+inline HailoTensorPtr make_quantized_tensor(const hailo_vstream_info_t &info)
+{
+    size_t element_size = (info.format.type == HAILO_FORMAT_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint8_t);
+    size_t size = info.shape.height * info.shape.width * info.shape.features * element_size;
+    return make_quantized_tensor(std::vector<uint8_t>(size, 0), info);
+}
+
+/**
+ * @brief Labels of the classes 0 to num_classes, named label_<class>.
+ */
+inline std::map<uint8_t, std::string> make_labels(uint32_t num_classes)
+{
+    std::map<uint8_t, std::string> labels;
+    for (uint32_t class_index = 0; class_index <= num_classes; class_index++)
+        labels[class_index] = "label_" + std::to_string(class_index);
+    return labels;
+}
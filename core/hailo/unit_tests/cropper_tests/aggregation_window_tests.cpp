@@ -0,0 +1,218 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <chrono>
+#include <vector>
+
+// Tappas includes
+#include "aggregation_window.hpp"
+
+using Window = AggregationWindow<int, int>;
+using Match = Window::SubFrameMatch;
+
+// Frames are ints >= 0, events are ints < 0 in the released sequence
+static std::vector<int> pop_ready(Window &window, bool force = false, Window::Clock::time_point now = Window::Clock::now())
+{
+    std::vector<Window::Entry> ready;
+    std::vector<int> released;
+    window.pop_ready(ready, force, now);
+    for (auto &entry : ready)
+        released.emplace_back(entry.is_event ? entry.event : entry.frame);
+    return released;
+}
+
+static Match match_sub(Window &window, uint64_t stream, uint64_t offset, int &main, bool &complete)
+{
+    complete = false;
+    return window.match_sub(stream, offset, main, complete);
+}
+
+TEST_CASE( "A main frame is released once all its sub frames arrived.", "[aggregation_window]" ) {
+    Window window(4);
+    int main = -1;
+    bool complete;
+
+    window.push_frame(10, 0, 0, 2);
+    CHECK( pop_ready(window).empty() );
+
+    REQUIRE( match_sub(window, 0, 0, main, complete) == Match::MATCHED );
+    CHECK( main == 10 );
+    CHECK( !complete );
+    CHECK( pop_ready(window).empty() );
+
+    REQUIRE( match_sub(window, 0, 0, main, complete) == Match::MATCHED );
+    CHECK( complete );
+    CHECK( pop_ready(window) == std::vector<int>{10} );
+    CHECK( window.empty() );
+}
+
+TEST_CASE( "A main frame without crops is released right away.", "[aggregation_window]" ) {
+    Window window(4);
+    window.push_frame(10, 0, 0, 0);
+    CHECK( pop_ready(window) == std::vector<int>{10} );
+}
+
+TEST_CASE( "Frames are released in arrival order.", "[aggregation_window]" ) {
+    Window window(4);
+    int main;
+    bool complete;
+
+    window.push_frame(10, 0, 0, 1);
+    window.push_frame(11, 0, 1, 1);
+
+    // The newer frame completes first, it waits for the older one
+    REQUIRE( match_sub(window, 0, 1, main, complete) == Match::MATCHED );
+    CHECK( main == 11 );
+    CHECK( pop_ready(window).empty() );
+
+    REQUIRE( match_sub(window, 0, 0, main, complete) == Match::MATCHED );
+    CHECK( pop_ready(window) == std::vector<int>{10, 11} );
+}
+
+TEST_CASE( "Events are released after the frames that arrived before them.", "[aggregation_window]" ) {
+    Window window(4);
+    int main;
+    bool complete;
+
+    SECTION( "An event with no pending frames is released right away" ) {
+        window.push_event(-1);
+        CHECK( pop_ready(window) == std::vector<int>{-1} );
+    }
+
+    SECTION( "An event waits for the frames before it" ) {
+        window.push_frame(10, 0, 0, 1);
+        window.push_event(-1);
+        window.push_frame(11, 0, 1, 0);
+        CHECK( pop_ready(window).empty() );
+
+        REQUIRE( match_sub(window, 0, 0, main, complete) == Match::MATCHED );
+        CHECK( pop_ready(window) == std::vector<int>{10, -1, 11} );
+    }
+
+    SECTION( "Events don't count as frames in flight" ) {
+        Window small(1);
+        small.push_event(-1);
+        small.push_event(-2);
+        CHECK( !small.full() );
+        small.push_frame(10, 0, 0, 1);
+        CHECK( small.full() );
+        CHECK( small.frames() == 1 );
+    }
+}
+
+TEST_CASE( "Sub frames are matched by stream and offset.", "[aggregation_window]" ) {
+    Window window(4);
+    int main;
+    bool complete;
+
+    // Two streams behind one cropper, both starting at offset 0
+    window.push_frame(10, 1, 0, 1);
+    window.push_frame(20, 2, 0, 1);
+
+    REQUIRE( match_sub(window, 2, 0, main, complete) == Match::MATCHED );
+    CHECK( main == 20 );
+    CHECK( complete );
+    REQUIRE( match_sub(window, 1, 0, main, complete) == Match::MATCHED );
+    CHECK( main == 10 );
+
+    // Both completed, a third sub frame of stream 1 offset 0 has nothing to aggregate into
+    CHECK( match_sub(window, 1, 0, main, complete) == Match::DROP );
+    CHECK( pop_ready(window) == std::vector<int>{10, 20} );
+}
+
+TEST_CASE( "A sub frame waits for its main frame.", "[aggregation_window]" ) {
+    Window window(4);
+    int main;
+    bool complete;
+
+    CHECK( match_sub(window, 0, 5, main, complete) == Match::WAIT );
+
+    // Frames of other streams or older offsets don't release it
+    window.push_frame(10, 1, 7, 1);
+    window.push_frame(11, 0, 4, 1);
+    CHECK( match_sub(window, 0, 5, main, complete) == Match::WAIT );
+
+    window.push_frame(12, 0, 5, 1);
+    CHECK( match_sub(window, 0, 5, main, complete) == Match::MATCHED );
+    CHECK( main == 12 );
+}
+
+TEST_CASE( "Sub frames of a released main frame are dropped.", "[aggregation_window]" ) {
+    Window window(1, std::chrono::milliseconds(10));
+    auto start = Window::Clock::now();
+    int main;
+    bool complete;
+
+    window.push_frame(10, 0, 3, 2, start);
+    REQUIRE( match_sub(window, 0, 3, main, complete) == Match::MATCHED );
+    REQUIRE( pop_ready(window, false, start + std::chrono::milliseconds(20)) == std::vector<int>{10} );
+
+    // No newer frame of the stream is pending, the sub frame is still known to be late
+    CHECK( match_sub(window, 0, 3, main, complete) == Match::DROP );
+    CHECK( match_sub(window, 0, 2, main, complete) == Match::DROP );
+    CHECK( match_sub(window, 1, 3, main, complete) == Match::WAIT );
+}
+
+TEST_CASE( "The oldest frame times out whether or not the window is full.", "[aggregation_window]" ) {
+    Window window(4, std::chrono::milliseconds(10));
+    auto start = Window::Clock::now();
+    auto late = start + std::chrono::milliseconds(20);
+
+    window.push_frame(10, 0, 0, 1, start);
+    window.push_frame(11, 0, 1, 1, start + std::chrono::milliseconds(5));
+    CHECK( !window.full() );
+    CHECK( window.head_deadline() == start + std::chrono::milliseconds(10) );
+    CHECK( pop_ready(window, false, start + std::chrono::milliseconds(9)).empty() );
+
+    // Only the head times out, the next frame has its own deadline
+    CHECK( pop_ready(window, false, start + std::chrono::milliseconds(12)) == std::vector<int>{10} );
+    CHECK( window.head_deadline() == start + std::chrono::milliseconds(15) );
+    CHECK( pop_ready(window, false, late) == std::vector<int>{11} );
+    CHECK( window.head_deadline() == Window::Clock::time_point::max() );
+}
+
+TEST_CASE( "A window without a timeout waits forever.", "[aggregation_window]" ) {
+    Window window(1);
+    auto start = Window::Clock::now();
+    window.push_frame(10, 0, 0, 1, start);
+    CHECK( window.full() );
+    CHECK( window.head_deadline() == Window::Clock::time_point::max() );
+    CHECK( pop_ready(window, false, start + std::chrono::hours(1)).empty() );
+}
+
+TEST_CASE( "Forcing releases every entry.", "[aggregation_window]" ) {
+    Window window(4);
+    window.push_frame(10, 0, 0, 3);
+    window.push_event(-1);
+    window.push_frame(11, 0, 1, 3);
+
+    CHECK( pop_ready(window, true) == std::vector<int>{10, -1, 11} );
+    CHECK( window.empty() );
+    CHECK( window.frames() == 0 );
+}
+
+TEST_CASE( "Clearing returns the frames and events to the caller.", "[aggregation_window]" ) {
+    Window window(4);
+    int main;
+    bool complete;
+    window.push_frame(10, 0, 0, 1);
+    window.push_event(-1);
+    window.push_frame(11, 0, 1, 1);
+    REQUIRE( match_sub(window, 0, 0, main, complete) == Match::MATCHED );
+    pop_ready(window);
+
+    std::vector<int> frames, events;
+    window.clear(frames, events);
+    CHECK( frames == std::vector<int>{11} );
+    CHECK( events.empty() );
+    CHECK( window.empty() );
+
+    // Released offsets are forgotten, e.g. after a flush the stream may start over
+    CHECK( match_sub(window, 0, 0, main, complete) == Match::WAIT );
+}
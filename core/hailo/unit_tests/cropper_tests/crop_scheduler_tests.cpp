@@ -0,0 +1,144 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <set>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "common/crop_scheduler.hpp"
+
+std::vector<CropCandidate> make_candidates(int num_tracks, std::string label = "person", float quality = 1.0)
+{
+    std::vector<CropCandidate> candidates;
+    for (int id = 0; id < num_tracks; id++)
+    {
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(0.1, 0.1, 0.2, 0.2), label, 1.0);
+        detection->add_object(std::make_shared<HailoUniqueID>(id, TRACKING_ID));
+        candidates.push_back({detection, crop_tracking_id(detection), label, quality});
+    }
+    return candidates;
+}
+
+TEST_CASE( "The crop scheduler crops every track once per refresh interval.", "[crop_scheduler]" ) {
+    CropSchedulerParams params;
+    params.default_refresh_frames = 10;
+    params.refresh_frames["face"] = 3;
+    CropScheduler scheduler(params);
+    std::vector<CropCandidate> persons = make_candidates(3);
+    std::vector<CropCandidate> faces = make_candidates(1, "face");
+    faces[0].tracking_id = 100;
+
+    std::vector<CropCandidate> all = persons;
+    all.insert(all.end(), faces.begin(), faces.end());
+
+    // New tracks are cropped right away, then after their refresh interval
+    CHECK( scheduler.schedule(all).size() == 4 );
+    std::vector<size_t> crops_per_frame;
+    for (int frame = 1; frame < 10; frame++)
+        crops_per_frame.push_back(scheduler.schedule(all).size());
+    CHECK( crops_per_frame == std::vector<size_t>{0, 0, 1, 0, 0, 1, 0, 0, 1} );
+    CHECK( scheduler.schedule(all).size() == 3 );
+}
+
+TEST_CASE( "The crop scheduler keeps to the per-frame budget and serves all tracks.", "[crop_scheduler]" ) {
+    CropSchedulerParams params;
+    params.default_refresh_frames = 1;
+    params.max_crops_per_frame = 4;
+    CropScheduler scheduler(params);
+    std::vector<CropCandidate> candidates = make_candidates(10);
+
+    std::vector<int> times_cropped(10, 0);
+    for (int frame = 0; frame < 50; frame++)
+    {
+        std::vector<HailoROIPtr> crops = scheduler.schedule(candidates);
+        REQUIRE( crops.size() == 4 );
+        for (HailoROIPtr &crop : crops)
+            times_cropped[crop_tracking_id(std::dynamic_pointer_cast<HailoDetection>(crop))]++;
+    }
+
+    // 200 crops among 10 tracks, evenly
+    for (int times : times_cropped)
+        CHECK( times == 20 );
+}
+
+TEST_CASE( "The crop scheduler prefers new tracks, then the better quality.", "[crop_scheduler]" ) {
+    CropSchedulerParams params;
+    params.default_refresh_frames = 5;
+    params.max_crops_per_frame = 1;
+    CropScheduler scheduler(params);
+    std::vector<CropCandidate> candidates = make_candidates(3);
+    candidates[0].quality = 1.0;
+    candidates[1].quality = 3.0;
+    candidates[2].quality = 2.0;
+
+    std::vector<HailoROIPtr> first = scheduler.schedule(candidates);
+    REQUIRE( first.size() == 1 );
+    CHECK( first[0] == candidates[1].roi );
+    std::vector<HailoROIPtr> second = scheduler.schedule(candidates);
+    REQUIRE( second.size() == 1 );
+    CHECK( second[0] == candidates[2].roi );
+}
+
+TEST_CASE( "The crop scheduler waits for warm up and quality.", "[crop_scheduler]" ) {
+    CropSchedulerParams params;
+    params.warmup_frames = 3;
+    params.min_quality = 10.0;
+    CropScheduler scheduler(params);
+    std::vector<CropCandidate> candidates = make_candidates(2, "person", 20.0);
+    candidates[1].quality = 5.0;
+
+    for (int frame = 0; frame < 3; frame++)
+        CHECK( scheduler.schedule(candidates).empty() );
+    std::vector<HailoROIPtr> crops = scheduler.schedule(candidates);
+    REQUIRE( crops.size() == 1 );
+    CHECK( crops[0] == candidates[0].roi );
+
+    SECTION( "Untracked detections are always due" ) {
+        candidates[0].tracking_id = -1;
+        candidates[1].tracking_id = -1;
+        CHECK( scheduler.schedule(candidates).size() == 1 );
+        CHECK( scheduler.schedule(candidates).size() == 1 );
+    }
+}
+
+TEST_CASE( "The crop scheduler evicts tracks that are not seen anymore.", "[crop_scheduler]" ) {
+    CropSchedulerParams params;
+    params.default_refresh_frames = 1000;
+    params.evict_frames = 5;
+    CropScheduler scheduler(params);
+    std::vector<CropCandidate> candidates = make_candidates(2);
+
+    CHECK( scheduler.schedule(candidates).size() == 2 );
+    CHECK( scheduler.num_tracks() == 2 );
+    std::vector<CropCandidate> only_first = {candidates[0]};
+    for (int frame = 0; frame < 5; frame++)
+        CHECK( scheduler.schedule(only_first).empty() );
+    CHECK( scheduler.num_tracks() == 2 );
+    scheduler.schedule(only_first);
+    CHECK( scheduler.num_tracks() == 1 );
+
+    // An evicted track that comes back is new again
+    CHECK( scheduler.schedule(candidates).size() == 1 );
+}
+
+TEST_CASE( "Every stream has its own crop scheduler.", "[crop_scheduler]" ) {
+    CropSchedulerParams params;
+    params.default_refresh_frames = 10;
+    StreamCropSchedulers schedulers(params);
+    std::vector<CropCandidate> candidates = make_candidates(3);
+
+    CHECK( schedulers.schedule("stream0", candidates).size() == 3 );
+    // The same tracking ids on another stream are other tracks, due on their first frame
+    CHECK( schedulers.schedule("stream1", candidates).size() == 3 );
+    CHECK( schedulers.schedule("stream0", candidates).empty() );
+    CHECK( schedulers.num_streams() == 2 );
+    CHECK( &schedulers.get("stream0") == &schedulers.get("stream0") );
+    CHECK( schedulers.get("stream1").num_tracks() == 3 );
+}
@@ -14,6 +14,7 @@
 // Tappas includes
 #include "common/resources/license_plates/license_plates.hpp"
 #include "lpr_croppers.hpp"
+#include "common/quality_estimation.hpp"
 
 // Open source includes
 #include <opencv2/opencv.hpp>
@@ -68,6 +69,141 @@ TEST_CASE( "Given an image, quality estimation can determine if there is too muc
     }
 }
 
+TEST_CASE( "Quality estimation scores the luma the same for every image format.", "[quality_estimation]" ) {
+    HailoBBox bbox = HailoBBox(0.1, 0.2, 0.6, 0.5);
+    // A random gray image, with even sizes for NV12
+    cv::Mat gray = cv::Mat(240, 320, CV_8UC1);
+    cv::randu(gray, 0, 256);
+
+    // RGB with equal channels has exactly the gray as luma
+    cv::Mat rgb;
+    cv::cvtColor(gray, rgb, cv::COLOR_GRAY2RGB);
+    auto rgb_mat = std::make_shared<HailoRGBMat>(rgb, "rgb");
+
+    // NV12 with the gray as the Y plane
+    std::vector<uint8_t> nv12(gray.rows * gray.cols * 3 / 2, 128);
+    memcpy(nv12.data(), gray.data, gray.rows * gray.cols);
+    auto nv12_mat = std::make_shared<HailoNV12Mat>(nv12.data(), gray.rows, gray.cols, gray.cols, gray.cols);
+
+    // YUY2 with the gray as the Y bytes
+    std::vector<uint8_t> yuy2(gray.rows * gray.cols * 2, 128);
+    for (int i = 0; i < gray.rows * gray.cols; i++)
+        yuy2[i * 2] = gray.data[i];
+    auto yuy2_mat = std::make_shared<HailoYUY2Mat>(yuy2.data(), gray.rows, gray.cols, gray.cols * 2);
+
+    float rgb_quality = quality_estimation(rgb_mat, bbox, CROP_RATIO);
+    CHECK( rgb_quality > 0.0 );
+    CHECK( quality_estimation(nv12_mat, bbox, CROP_RATIO) == rgb_quality );
+    CHECK( quality_estimation(yuy2_mat, bbox, CROP_RATIO) == rgb_quality );
+
+    SECTION( "A flat image has no edges" ) {
+        auto flat_mat = std::make_shared<HailoRGBMat>(cv::Mat(240, 320, CV_8UC3, cv::Scalar(90, 90, 90)), "flat");
+        CHECK( quality_estimation(flat_mat, bbox, CROP_RATIO) == 0.0 );
+    }
+
+    SECTION( "A blurred image scores lower" ) {
+        cv::Mat blurred;
+        cv::GaussianBlur(rgb, blurred, cv::Size(9, 9), 0);
+        auto blurred_mat = std::make_shared<HailoRGBMat>(blurred, "blurred");
+        CHECK( quality_estimation(blurred_mat, bbox, CROP_RATIO) < rgb_quality );
+    }
+}
+
+TEST_CASE( "Linear resampling scores persons like the re-ID reference.", "[quality_estimation]" ) {
+    // The re-ID config: the grid of the network input, no blur or stretching
+    const QualityConfig person_config = {128, 256, false, false, QUALITY_INTER_LINEAR};
+
+    SECTION( "The score matches resizing with INTER_LINEAR" ) {
+        cv::Mat gray = cv::Mat(720, 1280, CV_8UC1);
+        cv::randu(gray, 0, 256);
+        cv::GaussianBlur(gray, gray, cv::Size(5, 5), 0);
+        cv::Mat rgb;
+        cv::cvtColor(gray, rgb, cv::COLOR_GRAY2RGB);
+        auto rgb_mat = std::make_shared<HailoRGBMat>(rgb, "rgb");
+        cv::Rect person(400, 100, 300, 560);
+
+        // The reference re-ID scoring: crop, resize, gray, Laplacian variance
+        cv::Mat resized, laplacian, mean, stddev;
+        cv::resize(gray(person), resized, cv::Size(128, 256), 0, 0, cv::INTER_LINEAR);
+        cv::Laplacian(resized, laplacian, CV_64F);
+        cv::meanStdDev(laplacian, mean, stddev);
+        double reference = stddev.at<double>(0) * stddev.at<double>(0);
+
+        float quality = laplacian_variance(luma_view(rgb_mat), person.x, person.y, person.width, person.height, person_config);
+        CHECK( quality == Approx(reference).epsilon(0.05) );
+    }
+
+    SECTION( "Shrinking samples the nearest pixels instead of averaging them" ) {
+        // Columns 4i+1 and 4i+2 are white for even i, so shrinking by 4 averages to half white and samples full white
+        cv::Mat gray = cv::Mat::zeros(256, 512, CV_8UC1);
+        for (int x = 0; x < gray.cols; x++)
+            if ((x / 4) % 2 == 0 && (x % 4 == 1 || x % 4 == 2))
+                gray.col(x).setTo(255);
+        cv::Mat rgb;
+        cv::cvtColor(gray, rgb, cv::COLOR_GRAY2RGB);
+        LumaView view = luma_view(std::make_shared<HailoRGBMat>(rgb, "stripes"));
+
+        QualityConfig area_config = person_config;
+        area_config.interpolation = QUALITY_INTER_AREA;
+        float linear_quality = laplacian_variance(view, 0, 0, gray.cols, gray.rows, person_config);
+        float area_quality = laplacian_variance(view, 0, 0, gray.cols, gray.rows, area_config);
+        CHECK( area_quality > 0.0 );
+        CHECK( linear_quality == Approx(4 * area_quality).epsilon(0.05) );
+    }
+}
+
+TEST_CASE( "The quality cache scores a track again only when its box changes.", "[quality_estimation]" ) {
+    QualityCache cache(0.9, 30, 60);
+    int computed = 0;
+    auto compute = [&]() { computed++; return float(computed); };
+
+    cache.new_frame("stream0");
+    CHECK( cache.get("stream0", 7, HailoBBox(0.1, 0.1, 0.2, 0.1), compute) == 1.0 );
+
+    SECTION( "A box that barely moved reuses the score" ) {
+        cache.new_frame("stream0");
+        CHECK( cache.get("stream0", 7, HailoBBox(0.101, 0.1, 0.2, 0.1), compute) == 1.0 );
+        CHECK( computed == 1 );
+    }
+
+    SECTION( "A box that moved is scored again" ) {
+        cache.new_frame("stream0");
+        CHECK( cache.get("stream0", 7, HailoBBox(0.15, 0.1, 0.2, 0.1), compute) == 2.0 );
+        CHECK( computed == 2 );
+    }
+
+    SECTION( "Another track is scored on its own" ) {
+        CHECK( cache.get("stream0", 8, HailoBBox(0.1, 0.1, 0.2, 0.1), compute) == 2.0 );
+        CHECK( cache.size() == 2 );
+    }
+
+    SECTION( "An old score is refreshed" ) {
+        for (int i = 0; i < 30; i++)
+        {
+            cache.new_frame("stream0");
+            cache.get("stream0", 7, HailoBBox(0.1, 0.1, 0.2, 0.1), compute);
+        }
+        CHECK( computed == 2 );
+    }
+
+    SECTION( "Tracks that are not seen anymore are evicted" ) {
+        for (int i = 0; i < 61; i++)
+            cache.new_frame("stream0");
+        CHECK( cache.size() == 0 );
+    }
+
+    SECTION( "Streams keep their own tracks and frames" ) {
+        // The same tracking id on another stream is another track
+        CHECK( cache.get("stream1", 7, HailoBBox(0.1, 0.1, 0.2, 0.1), compute) == 2.0 );
+        CHECK( cache.size() == 2 );
+        // Frames of one stream do not age the tracks of another
+        for (int i = 0; i < 61; i++)
+            cache.new_frame("stream1");
+        CHECK( cache.size() == 1 );
+        CHECK( cache.get("stream0", 7, HailoBBox(0.1, 0.1, 0.2, 0.1), compute) == 1.0 );
+    }
+}
+
 TEST_CASE( "Given a HailoROIPtr, vehicles_without_ocr will filter out detections with no OCR", "[vehicles_without_ocr]" ) {
     // Load a dummy image
     auto dummy_image = std::make_shared<HailoRGBMat>(cv::Mat(1920, 1080, CV_8UC3), "");
@@ -0,0 +1,268 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+
+// Counts the allocations of the test, to check what cloning costs
+static std::atomic<size_t> allocation_count(0);
+
+void *operator new(std::size_t size)
+{
+    allocation_count++;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    allocation_count++;
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+static HailoROIPtr create_main_roi()
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f), "stream_0");
+    HailoDetectionPtr person = std::make_shared<HailoDetection>(HailoBBox(0.1f, 0.1f, 0.2f, 0.4f), 1, "person", 0.9f);
+    person->add_object(std::make_shared<HailoClassification>("age", "adult", 0.8f));
+    roi->add_object(person);
+    roi->add_object(std::make_shared<HailoDetection>(HailoBBox(0.5f, 0.5f, 0.2f, 0.2f), 3, "car", 0.7f));
+    return roi;
+}
+
+TEST_CASE( "A cloned ROI keeps the content of the original ROI.", "[hailo_objects]" ) {
+    HailoROIPtr roi = create_main_roi();
+    HailoROIPtr roi_clone = std::dynamic_pointer_cast<HailoROI>(roi->clone());
+
+    REQUIRE( roi_clone != nullptr );
+    REQUIRE( roi_clone != roi );
+    CHECK( roi_clone->get_type() == HAILO_ROI );
+    CHECK( roi_clone->get_stream_id() == "stream_0" );
+    CHECK( roi_clone->get_bbox().width() == 1.0f );
+
+    std::vector<HailoObjectPtr> objects = roi_clone->get_objects();
+    REQUIRE( objects.size() == 2 );
+    HailoDetectionPtr person = std::dynamic_pointer_cast<HailoDetection>(objects[0]);
+    REQUIRE( person != nullptr );
+    CHECK( person->get_label() == "person" );
+    CHECK( person->get_class_id() == 1 );
+    CHECK( person->get_confidence() == 0.9f );
+    CHECK( person->get_objects_typed(HAILO_CLASSIFICATION).size() == 1 );
+}
+
+TEST_CASE( "Modifying a clone does not affect the original ROI.", "[hailo_objects]" ) {
+    HailoROIPtr roi = create_main_roi();
+    HailoROIPtr roi_clone = std::dynamic_pointer_cast<HailoROI>(roi->clone());
+
+    SECTION( "Objects added to the clone are not added to the original" ) {
+        roi_clone->add_object(std::make_shared<HailoDetection>(HailoBBox(0.0f, 0.0f, 0.1f, 0.1f), 2, "bicycle", 0.6f));
+        CHECK( roi_clone->get_objects().size() == 3 );
+        CHECK( roi->get_objects().size() == 2 );
+    }
+
+    SECTION( "Objects removed from the clone are not removed from the original" ) {
+        roi_clone->remove_objects_typed(HAILO_DETECTION);
+        CHECK( roi_clone->get_objects().empty() );
+        CHECK( roi->get_objects().size() == 2 );
+    }
+
+    SECTION( "Nested objects of the clone are copies" ) {
+        HailoDetectionPtr cloned_person = std::dynamic_pointer_cast<HailoDetection>(roi_clone->get_objects()[0]);
+        HailoDetectionPtr person = std::dynamic_pointer_cast<HailoDetection>(roi->get_objects()[0]);
+        REQUIRE( cloned_person != person );
+
+        cloned_person->set_label("pedestrian");
+        cloned_person->add_object(std::make_shared<HailoClassification>("gender", "female", 0.7f));
+        cloned_person->remove_objects_typed(HAILO_CLASSIFICATION);
+        cloned_person->add_object(std::make_shared<HailoUniqueID>(7));
+
+        CHECK( person->get_label() == "person" );
+        REQUIRE( person->get_objects().size() == 1 );
+        CHECK( person->get_objects()[0]->get_type() == HAILO_CLASSIFICATION );
+    }
+}
+
+TEST_CASE( "Modifying the original ROI does not affect a clone.", "[hailo_objects]" ) {
+    HailoROIPtr roi = create_main_roi();
+    HailoROIPtr roi_clone = std::dynamic_pointer_cast<HailoROI>(roi->clone());
+
+    roi->add_object(std::make_shared<HailoDetection>(HailoBBox(0.0f, 0.0f, 0.1f, 0.1f), 2, "bicycle", 0.6f));
+    roi->remove_object(0);
+
+    std::vector<HailoObjectPtr> objects = roi_clone->get_objects();
+    REQUIRE( objects.size() == 2 );
+    CHECK( std::dynamic_pointer_cast<HailoDetection>(objects[0])->get_label() == "person" );
+    CHECK( std::dynamic_pointer_cast<HailoDetection>(objects[1])->get_label() == "car" );
+}
+
+TEST_CASE( "Modifying nested objects of the original ROI does not affect a clone.", "[hailo_objects]" ) {
+    HailoROIPtr roi = create_main_roi();
+    std::dynamic_pointer_cast<HailoDetection>(roi->get_objects()[0])->add_object(
+        std::make_shared<HailoDetection>(HailoBBox(0.1f, 0.1f, 0.05f, 0.05f), 0, "face", 0.8f));
+    HailoROIPtr roi_clone = std::dynamic_pointer_cast<HailoROI>(roi->clone());
+
+    // Modify every level of the original, through the original, before the clone is accessed
+    HailoDetectionPtr person = std::dynamic_pointer_cast<HailoDetection>(roi->get_objects()[0]);
+    HailoDetectionPtr face = std::dynamic_pointer_cast<HailoDetection>(person->get_objects_typed(HAILO_DETECTION)[0]);
+    person->set_label("pedestrian");
+    person->add_object(std::make_shared<HailoUniqueID>(7));
+    face->set_label("mask");
+    face->add_object(std::make_shared<HailoClassification>("gender", "female", 0.7f));
+
+    HailoDetectionPtr cloned_person = std::dynamic_pointer_cast<HailoDetection>(roi_clone->get_objects()[0]);
+    REQUIRE( cloned_person != person );
+    CHECK( cloned_person->get_label() == "person" );
+    REQUIRE( cloned_person->get_objects().size() == 2 );
+    HailoDetectionPtr cloned_face = std::dynamic_pointer_cast<HailoDetection>(cloned_person->get_objects_typed(HAILO_DETECTION)[0]);
+    REQUIRE( cloned_face != face );
+    CHECK( cloned_face->get_label() == "face" );
+    CHECK( cloned_face->get_objects().empty() );
+
+    // The original keeps its own objects
+    CHECK( roi->get_objects()[0] == person );
+    CHECK( person->get_objects().size() == 3 );
+    CHECK( face->get_objects().size() == 1 );
+}
+
+TEST_CASE( "A clone allocates nothing until its first write.", "[hailo_objects]" ) {
+    HailoROIPtr small_roi = create_main_roi();
+    HailoROIPtr large_roi = create_main_roi();
+    for (int i = 0; i < 100; i++)
+    {
+        HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(0.1f, 0.1f, 0.1f, 0.1f), 1, "person", 0.9f);
+        detection->add_object(std::make_shared<HailoClassification>("age", "adult", 0.8f));
+        large_roi->add_object(detection);
+    }
+
+    // Cloning costs the same whatever the size of the tree: the clone and its mutex
+    size_t allocations = allocation_count;
+    HailoROIPtr small_clone = std::dynamic_pointer_cast<HailoROI>(small_roi->clone());
+    size_t small_clone_allocations = allocation_count - allocations;
+    allocations = allocation_count;
+    HailoROIPtr large_clone = std::dynamic_pointer_cast<HailoROI>(large_roi->clone());
+    CHECK( allocation_count - allocations == small_clone_allocations );
+    CHECK( small_clone_allocations <= 2 );
+
+    // Reading the fields of the clone copies nothing
+    allocations = allocation_count;
+    CHECK( large_clone->get_bbox().width() == 1.0f );
+    CHECK( large_clone->get_scaling_bbox().width() == 1.0f );
+    CHECK_FALSE( large_clone->has_tensors() );
+    CHECK( allocation_count == allocations );
+
+    // The first write copies only the level it goes through
+    large_clone->add_object(std::make_shared<HailoDetection>(HailoBBox(0.0f, 0.0f, 0.1f, 0.1f), 2, "bicycle", 0.6f));
+    CHECK( large_clone->get_objects().size() == 103 );
+    CHECK( large_roi->get_objects().size() == 102 );
+}
+
+TEST_CASE( "Clones of clones are independent.", "[hailo_objects]" ) {
+    HailoROIPtr roi = create_main_roi();
+    HailoROIPtr first_clone = std::dynamic_pointer_cast<HailoROI>(roi->clone());
+    HailoROIPtr second_clone = std::dynamic_pointer_cast<HailoROI>(first_clone->clone());
+
+    first_clone->remove_object(1);
+    second_clone->add_object(std::make_shared<HailoDetection>(HailoBBox(0.0f, 0.0f, 0.1f, 0.1f), 2, "bicycle", 0.6f));
+
+    CHECK( roi->get_objects().size() == 2 );
+    CHECK( first_clone->get_objects().size() == 1 );
+    CHECK( second_clone->get_objects().size() == 3 );
+}
+
+TEST_CASE( "Objects that can't be cloned are shared with the clone.", "[hailo_objects]" ) {
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+    HailoObjectPtr mask = std::make_shared<HailoDepthMask>(std::vector<float>(4, 1.0f), 2, 2, 1.0f);
+    roi->add_object(mask);
+
+    HailoROIPtr roi_clone = std::dynamic_pointer_cast<HailoROI>(roi->clone());
+    REQUIRE( roi_clone->get_objects().size() == 1 );
+    CHECK( roi_clone->get_objects()[0] == mask );
+}
+
+TEST_CASE( "Cloning a detection clones its type specific fields.", "[hailo_objects]" ) {
+    HailoDetectionPtr detection = std::make_shared<HailoDetection>(HailoBBox(0.1f, 0.2f, 0.3f, 0.4f), 5, "dog", 0.55f);
+    HailoTileROIPtr tile = std::make_shared<HailoTileROI>(HailoBBox(0.0f, 0.0f, 0.5f, 0.5f), 3, 0.1f, 0.2f, 1, SINGLE_SCALE);
+    tile->add_object(detection);
+
+    HailoTileROIPtr tile_clone = std::dynamic_pointer_cast<HailoTileROI>(tile->clone());
+    REQUIRE( tile_clone != nullptr );
+    CHECK( tile_clone->get_index() == 3 );
+    CHECK( tile_clone->get_layer() == 1 );
+
+    HailoDetectionPtr detection_clone = std::dynamic_pointer_cast<HailoDetection>(tile_clone->get_objects()[0]);
+    REQUIRE( detection_clone != nullptr );
+    CHECK( detection_clone != detection );
+    CHECK( detection_clone->get_label() == "dog" );
+    CHECK( detection_clone->get_class_id() == 5 );
+    CHECK( detection_clone->get_bbox().ymin() == 0.2f );
+}
+
+TEST_CASE( "A class mask can reference the tensor data without copying it.", "[hailo_objects]" ) {
+    auto buffer = std::make_shared<std::vector<uint8_t>>(std::vector<uint8_t>{0, 1, 2, 3, 4, 5});
+    hailo_vstream_info_t info = {};
+    info.shape = {2, 3, 1};
+    HailoTensorPtr tensor = std::make_shared<HailoTensor>(buffer->data(), info);
+
+    SECTION( "A tensor without an owner has no shared data" ) {
+        CHECK( tensor->shared_data() == nullptr );
+    }
+
+    SECTION( "The mask keeps the owner alive and reads it in place" ) {
+        tensor->set_owner(buffer);
+        std::weak_ptr<std::vector<uint8_t>> weak_buffer = buffer;
+        HailoClassMaskPtr mask = std::make_shared<HailoClassMask>(tensor->shared_data(), 3, 2, 0.5f);
+        tensor.reset();
+        buffer.reset();
+
+        REQUIRE( !weak_buffer.expired() );
+        CHECK( mask->data() == weak_buffer.lock()->data() );
+        CHECK( mask->get_data() == std::vector<uint8_t>{0, 1, 2, 3, 4, 5} );
+
+        mask.reset();
+        CHECK( weak_buffer.expired() );
+    }
+}
+
+TEST_CASE( "A quantized depth mask is dequantized only when its data is read.", "[hailo_objects]" ) {
+    auto buffer = std::make_shared<std::vector<uint16_t>>(std::vector<uint16_t>{10, 20, 30, 40});
+    std::shared_ptr<const void> data(buffer, buffer->data());
+    HailoDepthMask mask(data, true, 0.5f, 10.0f, 2, 2, 1.0f);
+
+    CHECK( mask.is_quantized() );
+    CHECK( mask.quantized_data() == buffer->data() );
+    CHECK( mask.get_data() == std::vector<float>{0.0f, 5.0f, 10.0f, 15.0f} );
+
+    // A copy shares the referenced data
+    HailoDepthMask mask_copy(mask);
+    CHECK( mask_copy.quantized_data() == buffer->data() );
+    CHECK( mask_copy.get_data() == mask.get_data() );
+
+    SECTION( "A float depth mask is not quantized" ) {
+        HailoDepthMask float_mask(std::vector<float>(4, 1.0f), 2, 2, 1.0f);
+        CHECK( !float_mask.is_quantized() );
+        CHECK( float_mask.get_data().size() == 4 );
+    }
+}
@@ -0,0 +1,188 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <utility>
+#include <vector>
+
+// Tappas includes
+#include "frame_pairing_window.hpp"
+
+using Window = FramePairingWindow<int, int>;
+// Released main frames with whether they were paired, events are returned as (-event, false).
+using Released = std::vector<std::pair<int, bool>>;
+
+static Released pop_ready(Window &window, bool flush = false)
+{
+    std::vector<Window::Released> entries;
+    window.pop_ready(entries, flush);
+
+    Released released;
+    for (auto &entry : entries)
+    {
+        if (entry.is_event)
+            released.emplace_back(-entry.event, false);
+        else
+            released.emplace_back(entry.frame, entry.paired);
+    }
+    return released;
+}
+
+TEST_CASE( "Frames with equal keys are paired in any arrival order.", "[frame_pairing_window]" ) {
+    Window window(4, 4);
+    std::vector<int> dropped;
+    int main, sub;
+
+    // Sub stream ahead of the main stream
+    CHECK_FALSE( window.push_sub(100, 0, main, dropped) );
+    CHECK_FALSE( window.push_sub(101, 1, main, dropped) );
+    REQUIRE( window.push_main(0, 0, sub, dropped) );
+    CHECK( sub == 100 );
+    REQUIRE( window.push_main(1, 1, sub, dropped) );
+    CHECK( sub == 101 );
+
+    // Main stream ahead of the sub stream
+    CHECK_FALSE( window.push_main(2, 2, sub, dropped) );
+    REQUIRE( window.push_sub(102, 2, main, dropped) );
+    CHECK( main == 2 );
+
+    CHECK( dropped.empty() );
+    CHECK( pop_ready(window) == Released({{0, true}, {1, true}, {2, true}}) );
+    CHECK( window.get_stats().paired == 3 );
+}
+
+TEST_CASE( "Main frames wait in the window until they are paired.", "[frame_pairing_window]" ) {
+    Window window(4, 4);
+    std::vector<int> dropped;
+    int main, sub;
+    window.push_main(0, 0, sub, dropped);
+    window.push_main(1, 1, sub, dropped);
+    CHECK( pop_ready(window).empty() );
+
+    REQUIRE( window.push_sub(100, 0, main, dropped) );
+    CHECK( pop_ready(window) == Released({{0, true}}) );
+    CHECK( window.main_depth() == 1 );
+    REQUIRE( window.push_sub(101, 1, main, dropped) );
+    CHECK( pop_ready(window) == Released({{1, true}}) );
+}
+
+TEST_CASE( "Keys within the tolerance are paired.", "[frame_pairing_window]" ) {
+    Window window(4, 4, 5);
+    std::vector<int> dropped;
+    int main, sub;
+    window.push_main(0, 1000, sub, dropped);
+    REQUIRE( window.push_sub(100, 1004, main, dropped) );
+    CHECK( main == 0 );
+    window.push_main(1, 2000, sub, dropped);
+    CHECK_FALSE( window.push_sub(101, 2006, main, dropped) );
+}
+
+TEST_CASE( "A main frame the sub stream moved past is released unpaired.", "[frame_pairing_window]" ) {
+    Window window(4, 4);
+    std::vector<int> dropped;
+    int main, sub;
+    window.push_main(0, 0, sub, dropped);
+    window.push_main(1, 1, sub, dropped);
+    CHECK( pop_ready(window).empty() );
+
+    // The sub frame of offset 0 was lost upstream
+    REQUIRE( window.push_sub(101, 1, main, dropped) );
+    CHECK( pop_ready(window) == Released({{0, false}, {1, true}}) );
+    CHECK( window.get_stats().unpaired == 1 );
+}
+
+TEST_CASE( "Overflowing the main window releases the oldest frame.", "[frame_pairing_window]" ) {
+    Window window(2, 2);
+    std::vector<int> dropped;
+    int sub;
+    for (int i = 0; i < 3; i++)
+        window.push_main(i, i, sub, dropped);
+
+    CHECK( pop_ready(window) == Released({{0, false}}) );
+    CHECK( window.main_depth() == 2 );
+    CHECK( pop_ready(window, true) == Released({{1, false}, {2, false}}) );
+}
+
+TEST_CASE( "Sub frames that can no longer be paired are dropped.", "[frame_pairing_window]" ) {
+    Window window(4, 2);
+    std::vector<int> dropped;
+    int main, sub;
+
+    // Its main frame was skipped upstream, a newer main frame shows it will never arrive
+    CHECK_FALSE( window.push_sub(100, 0, main, dropped) );
+    CHECK_FALSE( window.push_main(1, 1, sub, dropped) );
+    CHECK( dropped == std::vector<int>({100}) );
+
+    // Older than the newest main frame
+    CHECK_FALSE( window.push_sub(99, 0, main, dropped) );
+    CHECK( dropped == std::vector<int>({100, 99}) );
+
+    // Overflowing the sub window
+    REQUIRE( window.push_sub(101, 1, main, dropped) );
+    CHECK_FALSE( window.push_sub(102, 2, main, dropped) );
+    CHECK_FALSE( window.push_sub(103, 3, main, dropped) );
+    CHECK_FALSE( window.push_sub(104, 4, main, dropped) );
+    CHECK( dropped == std::vector<int>({100, 99, 102}) );
+    CHECK( window.sub_depth() == 2 );
+    CHECK( window.get_stats().dropped_sub == 3 );
+}
+
+TEST_CASE( "Events wait behind the main frames that arrived before them.", "[frame_pairing_window]" ) {
+    Window window(4, 4);
+    std::vector<int> dropped;
+    int main, sub;
+
+    // Nothing to wait for
+    window.push_event(1);
+    CHECK( pop_ready(window) == Released({{-1, false}}) );
+
+    window.push_main(0, 0, sub, dropped);
+    window.push_event(2);
+    window.push_main(1, 1, sub, dropped);
+    window.push_event(3);
+    CHECK( pop_ready(window).empty() );
+
+    REQUIRE( window.push_sub(100, 0, main, dropped) );
+    CHECK( pop_ready(window) == Released({{0, true}, {-2, false}}) );
+    REQUIRE( window.push_sub(101, 1, main, dropped) );
+    CHECK( pop_ready(window) == Released({{1, true}, {-3, false}}) );
+}
+
+TEST_CASE( "Events do not count in the main window size.", "[frame_pairing_window]" ) {
+    Window window(2, 2);
+    std::vector<int> dropped;
+    int sub;
+    window.push_main(0, 0, sub, dropped);
+    window.push_event(1);
+    window.push_event(2);
+    window.push_main(1, 1, sub, dropped);
+    CHECK( window.main_depth() == 2 );
+    CHECK( pop_ready(window).empty() );
+
+    // The third frame overflows the window, the events before the second frame follow the first one
+    window.push_main(2, 2, sub, dropped);
+    CHECK( pop_ready(window) == Released({{0, false}, {-1, false}, {-2, false}}) );
+    CHECK( window.main_depth() == 2 );
+}
+
+TEST_CASE( "Clearing the window returns all the frames and events.", "[frame_pairing_window]" ) {
+    Window window(4, 4);
+    std::vector<int> dropped, main_frames, sub_frames, events;
+    int sub;
+    window.push_main(0, 0, sub, dropped);
+    window.push_event(7);
+    window.push_main(1, 1, sub, dropped);
+    window.push_sub(102, 2, sub, dropped);
+
+    window.clear(main_frames, sub_frames, events);
+    CHECK( main_frames == std::vector<int>({0, 1}) );
+    CHECK( sub_frames == std::vector<int>({102}) );
+    CHECK( events == std::vector<int>({7}) );
+    CHECK( window.main_depth() == 0 );
+    CHECK( window.sub_depth() == 0 );
+}
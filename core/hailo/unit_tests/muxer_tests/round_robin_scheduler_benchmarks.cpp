@@ -0,0 +1,96 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Tappas includes
+#include "round_robin_scheduler.hpp"
+
+/**
+ * Synthetic load: 16 producer threads push items at 30 fps each while the consumer pops them with a fixed
+ * processing cost, so the output is the bottleneck. Reports the share of every stream (fairness),
+ * the time items spent in the scheduler and the CPU time used. Run with: round_robin_scheduler_benchmarks
+ */
+TEST_CASE( "Round robin scheduler with 16 synthetic streams.", "[benchmark]" ) {
+    using Clock = std::chrono::steady_clock;
+    const size_t num_streams = 16;
+    const auto frame_interval = std::chrono::microseconds(33333);
+    const auto processing_time = std::chrono::microseconds(2500);
+    const auto run_time = std::chrono::seconds(3);
+
+    RoundRobinScheduler<Clock::time_point> scheduler(3);
+    scheduler.set_turn_wait(std::chrono::milliseconds(5));
+    for (size_t stream = 0; stream < num_streams; stream++)
+        scheduler.add_stream(stream, (stream == 0) ? 2 : 1);
+
+    std::atomic<bool> running(true);
+    std::vector<std::thread> producers;
+    for (size_t stream = 0; stream < num_streams; stream++)
+    {
+        producers.emplace_back([&, stream]()
+                               {
+                                   auto next = Clock::now();
+                                   while (running && scheduler.push(stream, Clock::now()))
+                                   {
+                                       next += frame_interval;
+                                       std::this_thread::sleep_until(next);
+                                   } });
+    }
+
+    std::vector<uint64_t> popped(num_streams, 0);
+    std::vector<Clock::time_point> expired;
+    double total_latency_us = 0;
+    double max_latency_us = 0;
+    uint64_t total = 0;
+    std::clock_t cpu_start = std::clock();
+    auto end = Clock::now() + run_time;
+    size_t index;
+    Clock::time_point pushed_at;
+    while (Clock::now() < end && scheduler.pop(index, pushed_at, expired))
+    {
+        double latency_us = std::chrono::duration<double, std::micro>(Clock::now() - pushed_at).count();
+        total_latency_us += latency_us;
+        max_latency_us = std::max(max_latency_us, latency_us);
+        popped[index]++;
+        total++;
+        auto busy_until = Clock::now() + processing_time;
+        while (Clock::now() < busy_until)
+        {
+        }
+    }
+    double cpu_ms = 1000.0 * (std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    running = false;
+    scheduler.stop();
+    for (auto &producer : producers)
+        producer.join();
+
+    // Jain's fairness index of the equal weight streams, 1 is perfectly fair
+    double sum = 0, sum_squares = 0;
+    for (size_t stream = 1; stream < num_streams; stream++)
+    {
+        sum += popped[stream];
+        sum_squares += double(popped[stream]) * popped[stream];
+    }
+    double fairness = (sum * sum) / ((num_streams - 1) * sum_squares);
+
+    std::cout << "streams: " << num_streams << " items: " << total
+              << " weighted stream share: " << double(popped[0]) / (sum / (num_streams - 1))
+              << " fairness: " << fairness
+              << " mean latency [us]: " << total_latency_us / total
+              << " max latency [us]: " << max_latency_us
+              << " cpu (incl. processing) [ms]: " << cpu_ms << std::endl;
+
+    CHECK( fairness > 0.95 );
+}
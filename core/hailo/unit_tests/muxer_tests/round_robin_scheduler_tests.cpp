@@ -0,0 +1,136 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Tappas includes
+#include "round_robin_scheduler.hpp"
+
+using Scheduler = RoundRobinScheduler<int>;
+
+static std::vector<size_t> pop_order(Scheduler &scheduler, size_t count)
+{
+    std::vector<size_t> order;
+    std::vector<int> expired;
+    size_t index;
+    int value;
+    for (size_t i = 0; i < count && scheduler.pop(index, value, expired); i++)
+    {
+        order.push_back(index);
+    }
+    return order;
+}
+
+TEST_CASE( "Streams with equal weights are scheduled in round robin order.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(4);
+    for (size_t stream = 0; stream < 3; stream++)
+    {
+        scheduler.add_stream(stream);
+        for (int i = 0; i < 2; i++)
+            REQUIRE( scheduler.push(stream, i) );
+    }
+
+    CHECK( pop_order(scheduler, 6) == std::vector<size_t>({0, 1, 2, 0, 1, 2}) );
+}
+
+TEST_CASE( "Stream weights set the number of items sent on each turn.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(8);
+    scheduler.add_stream(0, 2);
+    scheduler.add_stream(1, 1);
+    for (int i = 0; i < 4; i++)
+        REQUIRE( scheduler.push(0, i) );
+    for (int i = 0; i < 2; i++)
+        REQUIRE( scheduler.push(1, i) );
+
+    CHECK( pop_order(scheduler, 6) == std::vector<size_t>({0, 0, 1, 0, 0, 1}) );
+}
+
+TEST_CASE( "Streams without pending items are skipped.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(4);
+    for (size_t stream = 0; stream < 4; stream++)
+        scheduler.add_stream(stream);
+    REQUIRE( scheduler.push(1, 0) );
+    REQUIRE( scheduler.push(3, 0) );
+    REQUIRE( scheduler.push(3, 1) );
+
+    CHECK( pop_order(scheduler, 3) == std::vector<size_t>({1, 3, 3}) );
+}
+
+TEST_CASE( "The stream next in line is waited for up to the turn wait.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(4);
+    scheduler.set_turn_wait(std::chrono::milliseconds(500));
+    scheduler.add_stream(0);
+    scheduler.add_stream(1);
+    REQUIRE( scheduler.push(0, 0) );
+    REQUIRE( scheduler.push(0, 1) );
+    std::vector<size_t> order = pop_order(scheduler, 1);
+
+    std::thread late_producer([&scheduler]()
+                              {
+                                  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                                  scheduler.push(1, 0);
+                              });
+    std::vector<size_t> rest = pop_order(scheduler, 2);
+    late_producer.join();
+    order.insert(order.end(), rest.begin(), rest.end());
+
+    CHECK( order == std::vector<size_t>({0, 1, 0}) );
+}
+
+TEST_CASE( "Items that waited longer than the maximal latency expire.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(4);
+    scheduler.set_max_latency(std::chrono::milliseconds(10));
+    scheduler.add_stream(0);
+    scheduler.add_stream(1);
+    REQUIRE( scheduler.push(0, 100) );
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    REQUIRE( scheduler.push(1, 200) );
+
+    std::vector<int> expired;
+    size_t index;
+    int value;
+    REQUIRE( scheduler.pop(index, value, expired) );
+    CHECK( index == 1 );
+    CHECK( value == 200 );
+    CHECK( expired == std::vector<int>({100}) );
+    CHECK( scheduler.get_stats(0).expired == 1 );
+}
+
+TEST_CASE( "Stopping the scheduler releases blocked producers and consumer.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(1);
+    scheduler.add_stream(0);
+    REQUIRE( scheduler.push(0, 0) );
+
+    std::atomic<bool> pushed(true);
+    std::thread producer([&scheduler, &pushed]()
+                         { pushed = scheduler.push(0, 1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<int> pending = scheduler.stop();
+    producer.join();
+
+    CHECK_FALSE( pushed );
+    CHECK( pending == std::vector<int>({0}) );
+    CHECK( pop_order(scheduler, 1).empty() );
+}
+
+TEST_CASE( "Removing a stream returns its pending items.", "[round_robin_scheduler]" ) {
+    Scheduler scheduler(4);
+    scheduler.add_stream(0);
+    scheduler.add_stream(1);
+    REQUIRE( scheduler.push(0, 1) );
+    REQUIRE( scheduler.push(0, 2) );
+    REQUIRE( scheduler.push(1, 3) );
+
+    CHECK( scheduler.remove_stream(0) == std::vector<int>({1, 2}) );
+    CHECK_FALSE( scheduler.push(0, 4) );
+    CHECK( pop_order(scheduler, 1) == std::vector<size_t>({1}) );
+}
@@ -0,0 +1,207 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Infra includes
+#include "batcher.hpp"
+
+// Records the submitted batches of a Batcher<int>
+class BatchRecorder
+{
+public:
+    std::vector<std::vector<int>> batches;
+    std::vector<std::thread::id> threads;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    Batcher<int>::SubmitFunction submit()
+    {
+        return [this](std::vector<int> &batch)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                batches.push_back(batch);
+                threads.push_back(std::this_thread::get_id());
+            }
+            cv.notify_all();
+        };
+    }
+
+    bool wait_for(size_t count, std::chrono::milliseconds timeout = std::chrono::milliseconds(2000))
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, timeout, [this, count] { return batches.size() >= count; });
+    }
+
+    size_t count()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return batches.size();
+    }
+};
+
+TEST_CASE( "The batch size doubles while the queue holds a full batch.", "[adaptive_batch_controller]" ) {
+    AdaptiveBatchController controller(1, 8);
+    CHECK( controller.batch_size() == 1 );
+    controller.update(1, false);
+    CHECK( controller.batch_size() == 2 );
+    controller.update(5, false);
+    CHECK( controller.batch_size() == 4 );
+    controller.update(4, true);
+    CHECK( controller.batch_size() == 8 );
+    controller.update(100, false);
+    CHECK( controller.batch_size() == 8 );
+}
+
+TEST_CASE( "The batch size shrinks when a batch leaves on its deadline with nothing queued.", "[adaptive_batch_controller]" ) {
+    AdaptiveBatchController controller(2, 16);
+    controller.update(2, false);
+    controller.update(4, false);
+    controller.update(8, false);
+    REQUIRE( controller.batch_size() == 16 );
+
+    // Waiting batches with a short queue, or full batches, keep the size
+    controller.update(3, true);
+    CHECK( controller.batch_size() == 16 );
+    controller.update(0, false);
+    CHECK( controller.batch_size() == 16 );
+
+    controller.update(0, true);
+    CHECK( controller.batch_size() == 12 );
+    controller.update(0, true);
+    CHECK( controller.batch_size() == 9 );
+    for (int i = 0; i < 10; i++)
+        controller.update(0, true);
+    CHECK( controller.batch_size() == 2 );
+}
+
+TEST_CASE( "The batch size stays within its bounds.", "[adaptive_batch_controller]" ) {
+    AdaptiveBatchController zero(0, 0);
+    CHECK( zero.batch_size() == 1 );
+    zero.update(10, false);
+    CHECK( zero.batch_size() == 1 );
+
+    AdaptiveBatchController inverted(4, 2);
+    CHECK( inverted.batch_size() == 4 );
+    inverted.update(10, false);
+    CHECK( inverted.batch_size() == 4 );
+}
+
+TEST_CASE( "Without batching every item is submitted on the calling thread.", "[batcher]" ) {
+    BatchRecorder recorder;
+    Batcher<int> batcher(recorder.submit(), nullptr, 1, std::chrono::microseconds(1000000));
+    batcher.start();
+    batcher.add(1);
+    batcher.add(2);
+    REQUIRE( recorder.count() == 2 );
+    CHECK( recorder.batches[0] == std::vector<int>{1} );
+    CHECK( recorder.batches[1] == std::vector<int>{2} );
+    CHECK( recorder.threads[0] == std::this_thread::get_id() );
+    CHECK( batcher.get_stats().deadline_batches == 0 );
+}
+
+TEST_CASE( "A full batch is submitted in order on the calling thread.", "[batcher]" ) {
+    BatchRecorder recorder;
+    Batcher<int> batcher(recorder.submit(), nullptr, 3, std::chrono::microseconds(1000000));
+    batcher.start();
+    for (int i = 0; i < 7; i++)
+        batcher.add(i);
+    REQUIRE( recorder.count() == 2 );
+    CHECK( recorder.batches[0] == std::vector<int>{0, 1, 2} );
+    CHECK( recorder.batches[1] == std::vector<int>{3, 4, 5} );
+    CHECK( recorder.threads[0] == std::this_thread::get_id() );
+
+    Batcher<int>::Stats stats = batcher.get_stats();
+    CHECK( stats.batches == 2 );
+    CHECK( stats.buffers == 6 );
+    CHECK( stats.deadline_batches == 0 );
+    CHECK( stats.batch_size == 3 );
+}
+
+TEST_CASE( "A partial batch is submitted once its first item waited the timeout.", "[batcher]" ) {
+    BatchRecorder recorder;
+    Batcher<int> batcher(recorder.submit(), nullptr, 4, std::chrono::microseconds(20000));
+    batcher.start();
+    auto begin = std::chrono::steady_clock::now();
+    batcher.add(1);
+    batcher.add(2);
+    REQUIRE( recorder.wait_for(1) );
+    CHECK( std::chrono::steady_clock::now() - begin >= std::chrono::milliseconds(20) );
+    CHECK( recorder.batches[0] == std::vector<int>{1, 2} );
+    CHECK( recorder.threads[0] != std::this_thread::get_id() );
+    CHECK( batcher.get_stats().deadline_batches == 1 );
+
+    // The next batch gets its own deadline
+    batcher.add(3);
+    REQUIRE( recorder.wait_for(2) );
+    CHECK( recorder.batches[1] == std::vector<int>{3} );
+    CHECK( batcher.get_stats().deadline_batches == 2 );
+}
+
+TEST_CASE( "A partial batch waits for its deadline or a flush.", "[batcher]" ) {
+    BatchRecorder recorder;
+    Batcher<int> batcher(recorder.submit(), nullptr, 4, std::chrono::microseconds(10000000));
+    batcher.start();
+    batcher.add(1);
+    batcher.add(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK( recorder.count() == 0 );
+
+    batcher.flush();
+    REQUIRE( recorder.count() == 1 );
+    CHECK( recorder.batches[0] == std::vector<int>{1, 2} );
+
+    // Nothing pending, nothing to submit
+    batcher.flush();
+    CHECK( recorder.count() == 1 );
+}
+
+TEST_CASE( "Stopping drops and counts the pending items.", "[batcher]" ) {
+    BatchRecorder recorder;
+    Batcher<int> batcher(recorder.submit(), nullptr, 4, std::chrono::microseconds(10000000));
+    batcher.start();
+    batcher.add(1);
+    batcher.add(2);
+    CHECK( batcher.stop() == 2 );
+    batcher.flush();
+    CHECK( recorder.count() == 0 );
+    CHECK( batcher.stop() == 0 );
+}
+
+TEST_CASE( "Adaptive batches follow the depth of the input queue.", "[batcher]" ) {
+    BatchRecorder recorder;
+    std::atomic<size_t> queue_depth{16};
+    Batcher<int> batcher(recorder.submit(), [&queue_depth]() -> size_t { return queue_depth; }, 8,
+                         std::chrono::microseconds(10000000), true, 1);
+    batcher.start();
+    CHECK( batcher.get_stats().batch_size == 1 );
+
+    // A deep queue grows the batch: 1, 2, 4, 8
+    int item = 0;
+    for (size_t expected : {1, 2, 4, 8})
+    {
+        for (size_t i = 0; i < expected; i++)
+            batcher.add(item++);
+        REQUIRE( recorder.batches.back().size() == expected );
+    }
+    CHECK( batcher.get_stats().batch_size == 8 );
+
+    // Batches that leave on their deadline with an empty queue shrink it
+    queue_depth = 0;
+    batcher.add(item++);
+    batcher.flush();
+    CHECK( batcher.get_stats().batch_size == 6 );
+    CHECK( batcher.get_stats().deadline_batches == 1 );
+}
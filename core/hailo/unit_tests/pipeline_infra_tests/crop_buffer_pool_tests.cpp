@@ -0,0 +1,247 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// Infra includes
+#include "crop_buffer_pool.hpp"
+
+// Buffers without frames, the test controls how many the backend has and whether acquiring fails
+class TestCropResizeBackend : public CropResizeBackend
+{
+public:
+    std::atomic<size_t> available{0};
+    std::atomic<bool> fail_acquire{false};
+
+    AppStatus init(int output_width, int output_height, int pool_size, std::string pool_name) override
+    {
+        available = pool_size;
+        return AppStatus::SUCCESS;
+    }
+
+    size_t get_available_buffers_count() override
+    {
+        return available;
+    }
+
+    BufferPtr acquire_buffer(HailoROIPtr roi) override
+    {
+        if (fail_acquire || available == 0)
+            return nullptr;
+        available--;
+        return BufferPtr(new Buffer(nullptr, roi), [this](Buffer *buffer)
+                         {
+            delete buffer;
+            available++; });
+    }
+
+    AppStatus multi_crop_resize(BufferPtr input, std::vector<CropRect> &crops, std::vector<BufferPtr> &outputs) override
+    {
+        return AppStatus::SUCCESS;
+    }
+};
+
+static CropBufferPoolPtr make_pool(std::shared_ptr<TestCropResizeBackend> backend, size_t size, size_t priority_reserve = 0)
+{
+    CropBufferPoolPtr pool = std::make_shared<CropBufferPool>("crops", 640, 640, size, priority_reserve);
+    pool->set_backend(backend);
+    REQUIRE( pool->init() == AppStatus::SUCCESS );
+    return pool;
+}
+
+static std::vector<BufferPtr> acquire_all(CropBufferPool::Reservation &reservation)
+{
+    std::vector<BufferPtr> buffers;
+    for (size_t i = 0; i < reservation.size(); i++)
+        buffers.push_back(reservation.acquire_buffer(nullptr));
+    return buffers;
+}
+
+TEST_CASE( "A pool without a backend does not initialize.", "[crop_buffer_pool]" ) {
+    CropBufferPoolPtr pool = std::make_shared<CropBufferPool>("crops", 640, 640, 4);
+    CHECK( pool->init() == AppStatus::CONFIGURATION_ERROR );
+    pool->add_consumer("stage");
+    CHECK( pool->reserve("stage", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+}
+
+TEST_CASE( "All or nothing reservations drop the frame when the pool is short.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("stage");
+
+    CHECK( pool->reserve("stage", 5, 5, std::chrono::milliseconds(0))->size() == 0 );
+    CropBufferPool::ReservationPtr reservation = pool->reserve("stage", 3, 3, std::chrono::milliseconds(0));
+    CHECK( reservation->size() == 3 );
+
+    PoolSnapshot stats = pool->get_stats("stage");
+    CHECK( stats.reservations == 2 );
+    CHECK( stats.granted == 3 );
+    CHECK( stats.partial == 0 );
+    CHECK( stats.dropped_frames == 1 );
+    CHECK( stats.dropped_crops == 5 );
+    CHECK( stats.in_use == 3 );
+    CHECK( stats.available == 1 );
+}
+
+TEST_CASE( "Partial reservations take the buffers that are available.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("stage");
+
+    CropBufferPool::ReservationPtr reservation = pool->reserve("stage", 6, 1, std::chrono::milliseconds(0));
+    CHECK( reservation->size() == 4 );
+    PoolSnapshot stats = pool->get_stats("stage");
+    CHECK( stats.partial == 1 );
+    CHECK( stats.dropped_frames == 0 );
+    CHECK( stats.dropped_crops == 2 );
+
+    // Nothing left, even for a single crop
+    CHECK( pool->reserve("stage", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+}
+
+TEST_CASE( "Buffers that were not acquired return with the reservation.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("stage");
+
+    BufferPtr kept;
+    {
+        CropBufferPool::ReservationPtr reservation = pool->reserve("stage", 3, 3, std::chrono::milliseconds(0));
+        REQUIRE( reservation->size() == 3 );
+        kept = reservation->acquire_buffer(nullptr);
+        REQUIRE( kept != nullptr );
+    }
+    CHECK( pool->get_stats("stage").in_use == 1 );
+    CHECK( pool->get_stats("stage").available == 3 );
+    CHECK( pool->reserve("stage", 3, 3, std::chrono::milliseconds(0))->size() == 3 );
+
+    // Acquired buffers return once released downstream
+    kept.reset();
+    CHECK( pool->get_stats("stage").in_use == 0 );
+    CHECK( backend->available == 4 );
+}
+
+TEST_CASE( "A reservation acquires up to its size.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("stage");
+
+    CropBufferPool::ReservationPtr reservation = pool->reserve("stage", 2, 2, std::chrono::milliseconds(0));
+    std::vector<BufferPtr> buffers = acquire_all(*reservation);
+    CHECK( buffers[0] != nullptr );
+    CHECK( buffers[1] != nullptr );
+    CHECK( reservation->acquire_buffer(nullptr) == nullptr );
+    CHECK( pool->get_stats("stage").in_use == 2 );
+}
+
+TEST_CASE( "A failed backend acquire returns the buffer to the pool and counts the crop.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("stage");
+
+    CropBufferPool::ReservationPtr reservation = pool->reserve("stage", 2, 2, std::chrono::milliseconds(0));
+    backend->fail_acquire = true;
+    CHECK( reservation->acquire_buffer(nullptr) == nullptr );
+    PoolSnapshot stats = pool->get_stats("stage");
+    CHECK( stats.dropped_crops == 1 );
+    CHECK( stats.in_use == 1 );
+}
+
+TEST_CASE( "Buffers the backend did not get back yet are not reserved.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("stage");
+
+    // Released by the pipeline, still on the way back to the backend pool
+    backend->available = 1;
+    CHECK( pool->reserve("stage", 2, 2, std::chrono::milliseconds(0))->size() == 0 );
+    CropBufferPool::ReservationPtr reservation = pool->reserve("stage", 2, 1, std::chrono::milliseconds(0));
+    CHECK( reservation->size() == 1 );
+    // The reserved buffer is still in the backend pool, it is not available to others
+    CHECK( pool->reserve("stage", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+}
+
+TEST_CASE( "Consumers hold up to their quota.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4);
+    pool->add_consumer("burst", 2);
+    pool->add_consumer("other");
+
+    CropBufferPool::ReservationPtr burst = pool->reserve("burst", 4, 1, std::chrono::milliseconds(0));
+    CHECK( burst->size() == 2 );
+    CHECK( pool->reserve("burst", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+    CHECK( pool->reserve("other", 2, 2, std::chrono::milliseconds(0))->size() == 2 );
+    CHECK( pool->get_stats("burst").quota == 2 );
+    CHECK( pool->get_stats("other").quota == 4 );
+}
+
+TEST_CASE( "The priority reserve is left to priority consumers.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 4, 1);
+    pool->add_consumer("low");
+    pool->add_consumer("high", 0, true);
+
+    CropBufferPool::ReservationPtr low = pool->reserve("low", 4, 1, std::chrono::milliseconds(0));
+    CHECK( low->size() == 3 );
+    CHECK( pool->reserve("low", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+    CHECK( pool->reserve("high", 1, 1, std::chrono::milliseconds(0))->size() == 1 );
+}
+
+TEST_CASE( "Reservations wait for released buffers up to the timeout.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 2);
+    pool->add_consumer("stage");
+
+    CropBufferPool::ReservationPtr held = pool->reserve("stage", 2, 2, std::chrono::milliseconds(0));
+    std::vector<BufferPtr> buffers = acquire_all(*held);
+
+    auto begin = std::chrono::steady_clock::now();
+    CHECK( pool->reserve("stage", 1, 1, std::chrono::milliseconds(20))->size() == 0 );
+    CHECK( std::chrono::steady_clock::now() - begin >= std::chrono::milliseconds(20) );
+    CHECK( pool->get_stats("stage").dropped_frames == 1 );
+
+    std::thread releaser([&buffers]()
+                         {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        buffers.clear(); });
+    CHECK( pool->reserve("stage", 2, 2, std::chrono::seconds(5))->size() == 2 );
+    releaser.join();
+}
+
+TEST_CASE( "Other consumers don't reserve while a priority consumer waits.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 3);
+    pool->add_consumer("low");
+    pool->add_consumer("high", 0, true);
+
+    CropBufferPool::ReservationPtr held = pool->reserve("low", 2, 2, std::chrono::milliseconds(0));
+    std::vector<BufferPtr> low_buffers = acquire_all(*held);
+
+    // The priority consumer needs both crops, one buffer is free
+    size_t high_granted = 0;
+    std::thread high([&pool, &high_granted]()
+                     { high_granted = pool->reserve("high", 2, 2, std::chrono::seconds(5))->size(); });
+    while (pool->get_stats("high").reservations == 0)
+        std::this_thread::yield();
+
+    CHECK( pool->reserve("low", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+    low_buffers.pop_back();
+    high.join();
+    CHECK( high_granted == 2 );
+}
+
+TEST_CASE( "Unknown consumers get nothing.", "[crop_buffer_pool]" ) {
+    auto backend = std::make_shared<TestCropResizeBackend>();
+    CropBufferPoolPtr pool = make_pool(backend, 2);
+    CHECK( pool->reserve("stage", 1, 1, std::chrono::milliseconds(0))->size() == 0 );
+    CHECK( pool->get_stats("stage").in_use == 0 );
+}
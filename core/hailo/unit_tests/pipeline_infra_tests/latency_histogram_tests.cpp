@@ -0,0 +1,87 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <chrono>
+#include <cstdint>
+
+// Infra includes
+#include "metrics.hpp"
+
+TEST_CASE( "An empty histogram has no percentiles.", "[latency_histogram]" ) {
+    LatencyHistogram histogram;
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK( snapshot.count == 0 );
+    CHECK( snapshot.mean_us == 0 );
+    CHECK( snapshot.p50_us == 0 );
+    CHECK( snapshot.p99_us == 0 );
+    CHECK( snapshot.max_us == 0 );
+}
+
+TEST_CASE( "Percentiles are the middle of their bucket.", "[latency_histogram]" ) {
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 100; value++)
+        histogram.record(value);
+
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK( snapshot.count == 100 );
+    CHECK( snapshot.mean_us == Approx(50.5) );
+    CHECK( snapshot.max_us == 100 );
+    // Values below 64 have a bucket each, 99 is in [98, 99]
+    CHECK( snapshot.p50_us == 50 );
+    CHECK( snapshot.p99_us == 99 );
+}
+
+TEST_CASE( "Percentiles do not exceed the largest recorded latency.", "[latency_histogram]" ) {
+    LatencyHistogram histogram;
+    histogram.record(5000);
+    histogram.record(5000);
+
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK( latency_bucket_value(latency_bucket_index(5000)) > 5000 );
+    CHECK( snapshot.p50_us == 5000 );
+    CHECK( snapshot.p99_us == 5000 );
+}
+
+TEST_CASE( "Latencies past the largest bucket are clamped to it.", "[latency_histogram]" ) {
+    LatencyHistogram histogram;
+    histogram.record(UINT64_MAX / 2);
+
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK( snapshot.count == 1 );
+    CHECK( snapshot.p99_us <= LATENCY_HISTOGRAM_MAX_VALUE );
+}
+
+TEST_CASE( "A single slow buffer shows in the p99 only.", "[latency_histogram]" ) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 99; i++)
+        histogram.record(10);
+    histogram.record(5000);
+
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK( snapshot.p50_us == 10 );
+    CHECK( snapshot.p99_us == 10 );
+    CHECK( snapshot.max_us == 5000 );
+
+    histogram.record(5000);
+    CHECK( histogram.snapshot().p99_us == 5000 );
+}
+
+TEST_CASE( "Durations are recorded in micro seconds, negative ones as zero.", "[latency_histogram]" ) {
+    LatencyHistogram histogram;
+    histogram.record(std::chrono::milliseconds(3));
+    histogram.record(-std::chrono::milliseconds(1));
+
+    LatencySnapshot snapshot = histogram.snapshot();
+    CHECK( snapshot.count == 2 );
+    CHECK( snapshot.max_us == 3000 );
+    CHECK( snapshot.mean_us == Approx(1500) );
+
+    histogram.reset();
+    CHECK( histogram.snapshot().count == 0 );
+}
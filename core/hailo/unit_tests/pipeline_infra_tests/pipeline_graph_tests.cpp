@@ -0,0 +1,273 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <string>
+#include <vector>
+
+// Infra includes
+#include "graph_config.hpp"
+
+static GraphStageConfig make_stage(std::string name, size_t queue_size = 5)
+{
+    GraphStageConfig config;
+    config.name = name;
+    config.type = "general";
+    config.queue_size = queue_size;
+    return config;
+}
+
+static GraphStageConfig make_aggregator(std::string name, std::string main_input, std::string sub_input)
+{
+    GraphStageConfig config = make_stage(name);
+    config.type = "aggregator";
+    config.aggregator = true;
+    config.sub_queue_size = 5;
+    config.required_inputs = {main_input, sub_input};
+    return config;
+}
+
+static bool contains_error(const std::vector<std::string> &errors, const std::string &text)
+{
+    for (auto &error : errors)
+    {
+        if (error.find(text) != std::string::npos)
+            return true;
+    }
+    return false;
+}
+
+// fe -> a -> b -> c -> enc
+static void build_chain(PipelineGraph &graph, std::vector<std::string> &errors)
+{
+    graph.add_input("fe");
+    graph.add_output("enc");
+    graph.add_stage(make_stage("a"), errors);
+    graph.add_stage(make_stage("b"), errors);
+    graph.add_stage(make_stage("c"), errors);
+    graph.connect("fe", "a", errors);
+    graph.connect("a", "b", errors);
+    graph.connect("b", "c", errors);
+    graph.connect("c", "enc", errors);
+}
+
+TEST_CASE( "A valid chain is ordered after its producers.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings, order;
+    build_chain(graph, errors);
+
+    REQUIRE( graph.validate(errors, warnings) );
+    CHECK( errors.empty() );
+    CHECK( warnings.empty() );
+    REQUIRE( graph.topological_order(order) );
+    CHECK( order == std::vector<std::string>({"a", "b", "c"}) );
+    CHECK( graph.get_stage("b")->inputs == std::vector<std::string>({"a"}) );
+    CHECK( graph.get_stage("c")->subscribers == std::vector<std::string>({"enc"}) );
+}
+
+TEST_CASE( "Stages must have a unique name.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors;
+    graph.add_input("fe");
+
+    CHECK_FALSE( graph.add_stage(make_stage(""), errors) );
+    CHECK( graph.add_stage(make_stage("a"), errors) );
+    CHECK_FALSE( graph.add_stage(make_stage("a"), errors) );
+    CHECK_FALSE( graph.add_stage(make_stage("fe"), errors) );
+    CHECK( errors.size() == 3 );
+    CHECK( graph.stages().size() == 1 );
+}
+
+TEST_CASE( "Connections must be between known stages, once.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors;
+    build_chain(graph, errors);
+    REQUIRE( errors.empty() );
+
+    CHECK_FALSE( graph.connect("nowhere", "a", errors) );
+    CHECK( contains_error(errors, "unknown stage or input 'nowhere'") );
+    CHECK_FALSE( graph.connect("a", "nowhere", errors) );
+    CHECK( contains_error(errors, "unknown stage or output 'nowhere'") );
+    CHECK_FALSE( graph.connect("a", "b", errors) );
+    CHECK( contains_error(errors, "more than once") );
+    CHECK( graph.get_stage("b")->inputs.size() == 1 );
+}
+
+TEST_CASE( "Invalid graphs are reported.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings;
+    graph.add_input("fe");
+
+    SECTION( "A stage without input" ) {
+        graph.add_stage(make_stage("orphan"), errors);
+        CHECK_FALSE( graph.validate(errors, warnings) );
+        CHECK( contains_error(errors, "'orphan' has no input") );
+    }
+    SECTION( "A stage with two inputs that is not an aggregator" ) {
+        graph.add_stage(make_stage("a"), errors);
+        graph.add_stage(make_stage("b"), errors);
+        graph.connect("fe", "a", errors);
+        graph.connect("fe", "b", errors);
+        graph.connect("a", "b", errors);
+        CHECK_FALSE( graph.validate(errors, warnings) );
+        CHECK( contains_error(errors, "'b' has 2 inputs") );
+    }
+    SECTION( "An aggregator input that is missing or unexpected" ) {
+        graph.add_stage(make_stage("crop"), errors);
+        graph.add_stage(make_stage("other"), errors);
+        graph.add_stage(make_aggregator("agg", "crop", "infer"), errors);
+        graph.connect("fe", "crop", errors);
+        graph.connect("fe", "other", errors);
+        graph.connect("crop", "agg", errors);
+        graph.connect("other", "agg", errors);
+        CHECK_FALSE( graph.validate(errors, warnings) );
+        CHECK( contains_error(errors, "input 'infer' is not connected") );
+        CHECK( contains_error(errors, "has no queue for input 'other'") );
+    }
+    SECTION( "A required subscriber that is not connected" ) {
+        GraphStageConfig crop = make_stage("crop");
+        crop.required_subscribers = {"infer"};
+        graph.add_stage(crop, errors);
+        graph.connect("fe", "crop", errors);
+        CHECK_FALSE( graph.validate(errors, warnings) );
+        CHECK( contains_error(errors, "output 'infer' is not connected") );
+    }
+    SECTION( "Zero sized queues and pools" ) {
+        GraphStageConfig stage = make_stage("a", 0);
+        stage.owns_pool = true;
+        graph.add_stage(stage, errors);
+        graph.connect("fe", "a", errors);
+        CHECK_FALSE( graph.validate(errors, warnings) );
+        CHECK( contains_error(errors, "queue size must be positive") );
+        CHECK( contains_error(errors, "pool size must be positive") );
+    }
+}
+
+TEST_CASE( "Cycles are reported with the stages on them.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings, order;
+    graph.add_input("fe");
+    graph.add_stage(make_stage("a"), errors);
+    graph.add_stage(make_aggregator("b", "a", "c"), errors);
+    graph.add_stage(make_stage("c"), errors);
+    graph.connect("fe", "a", errors);
+    graph.connect("a", "b", errors);
+    graph.connect("b", "c", errors);
+    graph.connect("c", "b", errors);
+    REQUIRE( errors.empty() );
+
+    CHECK_FALSE( graph.topological_order(order) );
+    CHECK( order == std::vector<std::string>({"a"}) );
+    CHECK_FALSE( graph.validate(errors, warnings) );
+    CHECK( contains_error(errors, "cycle through: b, c") );
+}
+
+TEST_CASE( "A pool covers the queues and stages its buffers pass through.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings;
+    graph.add_input("fe");
+    graph.add_output("enc");
+    GraphStageConfig source = make_stage("source");
+    source.owns_pool = true;
+    source.pool_size = 2;
+    graph.add_stage(source, errors);
+    graph.add_stage(make_stage("a", 3), errors);
+    graph.add_stage(make_stage("b", 2), errors);
+    graph.connect("fe", "source", errors);
+    graph.connect("source", "a", errors);
+    graph.connect("a", "b", errors);
+    graph.connect("b", "enc", errors);
+
+    // The source, then every queue and stage until the end of the graph
+    CHECK( graph.required_pool_size("source", 0) == 1 + (3 + 1) + (2 + 1) );
+    REQUIRE( graph.validate(errors, warnings) );
+    REQUIRE( warnings.size() == 1 );
+    CHECK( contains_error(warnings, "pool size 2 is smaller than the 8 buffers") );
+}
+
+TEST_CASE( "Pool buffers are released by an aggregator.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings;
+    graph.add_input("fe");
+    GraphStageConfig crop = make_stage("crop", 2);
+    crop.owns_pool = true;
+    crop.pool_size = 20;
+    crop.pool_subscribers = {"infer"};
+    graph.add_stage(crop, errors);
+    graph.add_stage(make_stage("infer", 4), errors);
+    graph.add_stage(make_aggregator("agg", "crop", "infer"), errors);
+    graph.add_stage(make_stage("after", 10), errors);
+    graph.connect("fe", "crop", errors);
+    graph.connect("crop", "agg", errors);
+    graph.connect("crop", "infer", errors);
+    graph.connect("infer", "agg", errors);
+    graph.connect("agg", "after", errors);
+
+    // Only the crops use the pool, they are released in the aggregator: its sub queue and itself, not "after"
+    CHECK( graph.required_pool_size("crop", 0) == 1 + (4 + 1) + (5 + 1) );
+    CHECK( graph.validate(errors, warnings) );
+    CHECK( warnings.empty() );
+}
+
+TEST_CASE( "Auto sizing follows Little's law.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings;
+    graph.add_input("fe");
+    graph.add_output("enc");
+    GraphStageConfig crop = make_stage("crop");
+    crop.owns_pool = true;
+    crop.pool_size = 1;
+    crop.pool_subscribers = {"infer"};
+    GraphStageConfig infer = make_stage("infer");
+    infer.items_per_frame = 4;    // 4 crops per frame
+    infer.latency_us = 25000;     // 30 fps * 4 * 25ms = 3 crops in flight
+    infer.in_flight_limit = 8;
+    GraphStageConfig slow = make_stage("slow");
+    slow.latency_us = 50000;      // 30 fps * 50ms = 1.5 buffers, more than it can work on
+    graph.add_stage(crop, errors);
+    graph.add_stage(infer, errors);
+    graph.add_stage(make_aggregator("agg", "crop", "infer"), errors);
+    graph.add_stage(slow, errors);
+    graph.connect("fe", "crop", errors);
+    graph.connect("crop", "agg", errors);
+    graph.connect("crop", "infer", errors);
+    graph.connect("infer", "agg", errors);
+    graph.connect("agg", "slow", errors);
+    graph.connect("slow", "enc", errors);
+    REQUIRE( errors.empty() );
+
+    graph.auto_size(30, warnings);
+
+    // The burst of a frame and the buffers in service
+    CHECK( graph.get_stage("infer")->queue_size == 4 + 3 );
+    // Stages without a measured latency work on one buffer at a time
+    CHECK( graph.get_stage("crop")->queue_size == 1 + 1 );
+    // The aggregator sub queue holds the crops of a frame coming out of the inference
+    CHECK( graph.get_stage("agg")->sub_queue_size == 4 + 3 );
+    // The in service buffers are bounded by the in flight limit
+    CHECK( graph.get_stage("slow")->queue_size == 2 );
+    REQUIRE( warnings.size() == 1 );
+    CHECK( contains_error(warnings, "'slow' cannot keep up") );
+    // The crop, the infer queue and the crops in service, the aggregator sub queue and the aggregator
+    CHECK( graph.get_stage("crop")->pool_size == 1 + (7 + 3) + (7 + 1) );
+
+    warnings.clear();
+    CHECK( graph.validate(errors, warnings, 30) );
+    CHECK( warnings.empty() );
+}
+
+TEST_CASE( "Auto sizing keeps a minimal queue size.", "[pipeline_graph]" ) {
+    PipelineGraph graph;
+    std::vector<std::string> errors, warnings;
+    build_chain(graph, errors);
+
+    graph.auto_size(30, warnings, 4);
+    for (auto &stage : graph.stages())
+        CHECK( stage.queue_size == 4 );
+    CHECK( warnings.empty() );
+}
@@ -0,0 +1,114 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "xtensor/xadapt.hpp"
+#include "xtensor/xarray.hpp"
+#include "xtensor/xview.hpp"
+#include "xtensor/xmanipulation.hpp"
+#include "facial_landmarking/const_tensors.hpp"
+#include "facial_landmarking/bfm_landmarks.hpp"
+
+#define NUM_POINTS (68)
+#define SHAPE_DIM (40)
+#define EXP_DIM (10)
+#define FACE_SIZE (120)
+
+// The xtensor implementation of tddfa_mobilenet before the dense kernel, kept as the reference
+xt::xarray<float> two_dim_dot_product(xt::xarray<float, xt::layout_type::row_major> matrix_1,
+                                      xt::xarray<float, xt::layout_type::row_major> matrix_2)
+{
+    xt::xarray<float>::shape_type shape = {matrix_1.shape(0), matrix_2.shape(1)};
+    xt::xarray<float, xt::layout_type::row_major> product_matrix(shape);
+    for (uint i = 0; i < matrix_1.shape(0); ++i)
+    {
+        for (uint j = 0; j < matrix_2.shape(1); ++j)
+        {
+            float row_sum = 0.0;
+            for (uint k = 0; k < matrix_1.shape(1); ++k)
+            {
+                row_sum += matrix_1(i, k) * matrix_2(k, j);
+            }
+            product_matrix(i, j) = row_sum;
+        }
+    }
+    return product_matrix;
+}
+
+xt::xarray<float> reference_landmarks(xt::xarray<float> bfm_params, xt::xarray<float> &w_shp_base, xt::xarray<float> &w_exp_base)
+{
+    xt::xarray<float> face_3dmm_params = (bfm_params * TDDFA_RESCALE_PARAMS_STD) + TDDFA_RESCALE_PARAMS_MEAN;
+    xt::xarray<float> face_params_view = xt::reshape_view(xt::eval(xt::view(face_3dmm_params, xt::range(0, BFM_POSE_DIM))), {3, 4});
+    xt::xarray<float> offset = xt::reshape_view(xt::eval(xt::view(face_params_view, xt::all(), -1)), {3, 1});
+
+    xt::xarray<float> alpha_shape = xt::reshape_view(xt::eval(xt::view(face_3dmm_params, xt::range(BFM_POSE_DIM, BFM_POSE_DIM + SHAPE_DIM))), {SHAPE_DIM, 1});
+    xt::xarray<float> alpha_exp = xt::reshape_view(xt::eval(xt::view(face_3dmm_params, xt::range(BFM_POSE_DIM + SHAPE_DIM, xt::placeholders::_))), {EXP_DIM, 1});
+    xt::xarray<float> sum = xt::transpose(bfm_u_base) + two_dim_dot_product(w_shp_base, alpha_shape) + two_dim_dot_product(w_exp_base, alpha_exp);
+    xt::xarray<float> transposed_sum = xt::transpose(xt::eval(xt::reshape_view(sum, {NUM_POINTS, 3})));
+
+    xt::xarray<float> rotation = xt::view(face_params_view, xt::all(), xt::range(0, 3));
+    xt::xarray<float> landmarks_raw = xt::transpose(xt::eval(two_dim_dot_product(rotation, transposed_sum) + offset));
+
+    xt::xarray<float> landmarks = xt::zeros<float>({NUM_POINTS, 2});
+    xt::col(landmarks, 0) = xt::col(landmarks_raw, 0) / FACE_SIZE;
+    xt::col(landmarks, 1) = (FACE_SIZE - xt::col(landmarks_raw, 1)) / FACE_SIZE;
+    return landmarks;
+}
+
+TEST_CASE("The dense BFM kernel matches the xtensor implementation", "[bfm_landmarks]")
+{
+    // The bases are loaded from .npy files on the device, random bases of the same shape are used here
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> base_distribution(-0.05f, 0.05f);
+    std::normal_distribution<float> param_distribution(0.0f, 1.0f);
+    xt::xarray<float> w_shp_base = xt::zeros<float>({NUM_POINTS * 3, SHAPE_DIM});
+    xt::xarray<float> w_exp_base = xt::zeros<float>({NUM_POINTS * 3, EXP_DIM});
+    for (auto &value : w_shp_base)
+        value = base_distribution(generator);
+    for (auto &value : w_exp_base)
+        value = base_distribution(generator) * 1000.0f;
+
+    BfmLandmarksKernel kernel(w_shp_base.data(), SHAPE_DIM, w_exp_base.data(), EXP_DIM, bfm_u_base.data(), NUM_POINTS,
+                              TDDFA_RESCALE_PARAMS_MEAN.data(), TDDFA_RESCALE_PARAMS_STD.data(), FACE_SIZE, FACE_SIZE);
+    REQUIRE(kernel.num_params() == BFM_POSE_DIM + SHAPE_DIM + EXP_DIM);
+    REQUIRE(kernel.num_points() == NUM_POINTS);
+
+    SECTION("A batch of faces, larger than a block and not a multiple of it")
+    {
+        const size_t num_faces = BFM_FACES_BLOCK * 2 + 3;
+        std::vector<float> params(num_faces * kernel.num_params());
+        for (auto &value : params)
+            value = param_distribution(generator);
+        std::vector<float> landmarks(num_faces * NUM_POINTS * 2);
+        kernel.project(params.data(), num_faces, landmarks.data());
+
+        for (size_t f = 0; f < num_faces; f++)
+        {
+            xt::xarray<float> face_params = xt::adapt(params.data() + f * kernel.num_params(), kernel.num_params(), xt::no_ownership(),
+                                                      std::vector<size_t>{kernel.num_params()});
+            xt::xarray<float> expected = reference_landmarks(face_params, w_shp_base, w_exp_base);
+            for (size_t v = 0; v < NUM_POINTS; v++)
+            {
+                CHECK(landmarks[(f * NUM_POINTS + v) * 2] == Approx(expected(v, 0)).epsilon(1e-3).margin(1e-3));
+                CHECK(landmarks[(f * NUM_POINTS + v) * 2 + 1] == Approx(expected(v, 1)).epsilon(1e-3).margin(1e-3));
+            }
+        }
+    }
+
+    SECTION("An empty batch writes nothing")
+    {
+        std::vector<float> landmarks(2, -1.0f);
+        kernel.project(nullptr, 0, landmarks.data());
+        CHECK(landmarks[0] == -1.0f);
+        CHECK(landmarks[1] == -1.0f);
+    }
+}
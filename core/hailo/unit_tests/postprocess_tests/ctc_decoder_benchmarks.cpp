@@ -0,0 +1,32 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// Tappas includes
+#include "ocr/ctc_decoder.hpp"
+#include "ctc_decoder_reference.hpp"
+
+// The quantized CTC decoding against the float decoding
+TEST_CASE( "Benchmark the CTC decoding.", "[benchmark]" ) {
+    CTCDecoderParams params;
+    params.alphabet = digits_alphabet();
+    CTCDecoder greedy(params);
+    params.beam_width = 4;
+    params.formats = {"#######", "########"};
+    CTCDecoder beam(params);
+    HailoTensorPtr output = make_text_output("-1-2-3-4--5-6-7-8--", 4, 0);
+
+    BENCHMARK( "float greedy decoding, 4x19x11" ) {
+        return reference_greedy(output, params.alphabet).confidence;
+    };
+    BENCHMARK( "quantized greedy decoding, 4x19x11" ) {
+        return greedy.decode(output).confidence;
+    };
+    BENCHMARK( "quantized beam decoding (4 beams, 2 formats), 4x19x11" ) {
+        return beam.decode(output).confidence;
+    };
+}
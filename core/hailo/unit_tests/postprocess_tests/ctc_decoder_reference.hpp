@@ -0,0 +1,90 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// OCR outputs and the float greedy decoding, shared by ctc_decoder_unit_tests and postprocess_benchmarks
+#pragma once
+
+// General cpp includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "ocr/ctc_decoder.hpp"
+#include "common/quantized_tensor.hpp"
+
+#define DIGITS "0123456789"
+
+/**
+ * @brief An lprnet output, zero point 128.
+ */
+inline HailoTensorPtr make_ocr_output(std::vector<uint8_t> data, int height, int steps, int classes, float qp_scale)
+{
+    return make_quantized_tensor(std::move(data), make_vstream_info("lprnet/conv31", height, steps, classes, 128.0f, qp_scale));
+}
+
+/**
+ * @brief An output where the text shows up with some noise: every step favors its char (or the blank).
+ */
+inline HailoTensorPtr make_text_output(const std::string &aligned_text, int height, uint seed)
+{
+    const std::string alphabet = DIGITS "-";
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> noise(60, 140);
+    std::vector<uint8_t> data(height * aligned_text.size() * alphabet.size());
+    for (int row = 0; row < height; row++)
+    {
+        for (size_t step = 0; step < aligned_text.size(); step++)
+        {
+            for (size_t c = 0; c < alphabet.size(); c++)
+            {
+                uint8_t value = noise(generator);
+                if (alphabet[c] == aligned_text[step])
+                    value = 200 + noise(generator) / 4;
+                data[(row * aligned_text.size() + step) * alphabet.size() + c] = value;
+            }
+        }
+    }
+    return make_ocr_output(data, height, aligned_text.size(), alphabet.size(), 0.1f);
+}
+
+/**
+ * @brief The float greedy decoding, as the OCR postprocess did it: mean over the height, argmax, softmax.
+ */
+inline CTCResult reference_greedy(HailoTensorPtr tensor, const std::vector<char> &alphabet)
+{
+    const int height = tensor->height(), steps = tensor->width(), classes = tensor->features();
+    CTCResult result = {"", 0.0f};
+    float confidence_sum = 0.0f;
+    int previous = classes - 1;
+    for (int step = 0; step < steps; step++)
+    {
+        std::vector<float> means(classes, 0.0f);
+        for (int row = 0; row < height; row++)
+            for (int c = 0; c < classes; c++)
+                means[c] += tensor->fix_scale(tensor->data()[(row * steps + step) * classes + c]) / height;
+        int best = std::max_element(means.begin(), means.end()) - means.begin();
+        float sum = 0.0f;
+        for (float mean : means)
+            sum += std::exp(mean - means[best]);
+        if (best != classes - 1 && best != previous)
+        {
+            result.text.push_back(alphabet[best]);
+            confidence_sum += 1.0f / sum;
+        }
+        previous = best;
+    }
+    if (!result.text.empty())
+        result.confidence = confidence_sum / result.text.size();
+    return result;
+}
+
+inline std::vector<char> digits_alphabet()
+{
+    std::string alphabet = DIGITS "-";
+    return std::vector<char>(alphabet.begin(), alphabet.end());
+}
@@ -0,0 +1,138 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cmath>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "ocr/ctc_decoder.hpp"
+#include "ctc_decoder_reference.hpp"
+
+// Defined in ocr/ocr_postprocess.cpp
+__BEGIN_DECLS
+void filter(HailoROIPtr roi);
+void filter_batch(std::vector<HailoROIPtr> &rois);
+__END_DECLS
+
+TEST_CASE( "Greedy CTC decoding matches the float decoding.", "[ctc_decoder]" ) {
+    CTCDecoderParams params;
+    params.alphabet = digits_alphabet();
+    CTCDecoder decoder(params);
+
+    for (int height : {1, 4})
+    {
+        for (uint seed = 0; seed < 20; seed++)
+        {
+            HailoTensorPtr output = make_text_output("-1123--45-5-6-7789-", height, seed);
+            CTCResult expected = reference_greedy(output, params.alphabet);
+            CTCResult result = decoder.decode(output);
+            CHECK( result.text == expected.text );
+            CHECK( result.confidence == Approx(expected.confidence).margin(1e-5) );
+        }
+    }
+
+    SECTION( "Repeats collapse unless a blank separates them" ) {
+        HailoTensorPtr output = make_text_output("-1123--45-5-6-7789-", 1, 0);
+        CHECK( decoder.decode(output).text == "1234556789" );
+    }
+}
+
+TEST_CASE( "Beam CTC decoding sums the paths of a text.", "[ctc_decoder]" ) {
+    // Each step: '1' with probability 0.4, blank with 0.6. The best path is blank-blank,
+    // but "1" (0.64 over its 3 paths) is more likely than "" (0.36).
+    const float qp_scale = std::log(0.6f / 0.4f) / 10.0f;
+    HailoTensorPtr output = make_ocr_output({118, 128, 118, 128}, 1, 2, 2, qp_scale);
+    CTCDecoderParams params;
+    params.alphabet = {'1', '-'};
+    CTCDecoder greedy(params);
+    CHECK( greedy.decode(output).text == "" );
+
+    params.beam_width = 4;
+    CTCDecoder beam(params);
+    CTCResult result = beam.decode(output);
+    CHECK( result.text == "1" );
+    CHECK( result.confidence == Approx(0.4f).margin(1e-4) );
+}
+
+TEST_CASE( "Beam CTC decoding keeps to the plate formats.", "[ctc_decoder]" ) {
+    // '2' is ahead of '1' on the first step, the format needs a leading '1'
+    const float qp_scale = 0.1f;
+    HailoTensorPtr output = make_ocr_output({140, 135, 100,
+                               100, 100, 160,
+                               100, 160, 100}, 1, 3, 3, qp_scale);
+    CTCDecoderParams params;
+    params.alphabet = {'2', '1', '-'};
+    params.beam_width = 4;
+    CHECK( CTCDecoder(params).decode(output).text == "21" );
+
+    params.formats = {"1#"};
+    CTCResult result = CTCDecoder(params).decode(output);
+    CHECK( result.text == "11" );
+    float first = std::exp(-0.5f) / (1.0f + std::exp(-0.5f) + std::exp(-4.0f));
+    float second = 1.0f / (1.0f + std::exp(-6.0f) * 2.0f);
+    CHECK( result.confidence == Approx((first + second) / 2).margin(1e-4) );
+
+    SECTION( "No text is returned if no format can match" ) {
+        params.formats = {"###"};
+        CTCResult no_result = CTCDecoder(params).decode(output);
+        CHECK( no_result.text == "" );
+        CHECK( no_result.confidence == 0.0f );
+    }
+}
+
+TEST_CASE( "Beam CTC decoding agrees with greedy decoding on clear plates.", "[ctc_decoder]" ) {
+    CTCDecoderParams params;
+    params.alphabet = digits_alphabet();
+    CTCDecoder greedy(params);
+    params.beam_width = 4;
+    params.formats = {"#######", "########"};
+    CTCDecoder beam(params);
+
+    std::vector<HailoTensorPtr> tensors;
+    for (uint seed = 0; seed < 10; seed++)
+        tensors.push_back(make_text_output("-1-2-3-4--5-6-7-8--", 4, seed));
+    std::vector<CTCResult> results;
+    beam.decode_batch(tensors, results);
+    REQUIRE( results.size() == tensors.size() );
+    for (size_t i = 0; i < tensors.size(); i++)
+    {
+        CTCResult expected = greedy.decode(tensors[i]);
+        CHECK( results[i].text == "12345678" );
+        CHECK( results[i].text == expected.text );
+        CHECK( results[i].confidence == Approx(expected.confidence).margin(0.05) );
+    }
+}
+
+TEST_CASE( "The OCR postprocess adds the text of every plate.", "[ctc_decoder]" ) {
+    std::vector<HailoTensorPtr> outputs = {make_text_output("-1-2-3-4--5-6-7-8--", 1, 0),
+                                           make_text_output("-1-2-3-4-----------", 1, 0)};
+    std::vector<HailoROIPtr> rois;
+    for (HailoTensorPtr &output : outputs)
+    {
+        // A clear plate, so the confidence is above the threshold
+        for (uint32_t i = 0; i < output->size(); i++)
+            output->data()[i] = (output->data()[i] >= 200) ? 255 : 0;
+        HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+        roi->add_tensor(output);
+        rois.push_back(roi);
+    }
+
+    filter_batch(rois);
+    std::vector<HailoClassificationPtr> classifications = hailo_common::get_hailo_classifications(rois[0]);
+    REQUIRE( classifications.size() == 1 );
+    CHECK( classifications[0]->get_label() == "12345678" );
+    // Too few chars
+    CHECK( hailo_common::get_hailo_classifications(rois[1]).empty() );
+
+    rois[0]->remove_objects_typed(HAILO_CLASSIFICATION);
+    filter(rois[0]);
+    CHECK( hailo_common::get_hailo_classifications(rois[0]).size() == 1 );
+}
@@ -0,0 +1,65 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "common/heatmap.hpp"
+#include "common/math.hpp"
+#include "heatmap_reference.hpp"
+
+// Defined in pose_estimation/mspn.cpp
+void mspn_postprocess(HailoROIPtr roi, const float score_threshold, bool perform_gaussian_blur);
+
+// The quantized heatmap decoding against the float decoding it replaced
+TEST_CASE("Heatmap decoding benchmark", "[benchmark]")
+{
+    std::mt19937 generator(3);
+    HailoTensorPtr mspn_tensor = make_heatmaps(generator, MSPN_WIDTH, MSPN_HEIGHT, MSPN_JOINTS, 4.0f, 0.004f);
+    HailoTensorPtr joint_tensor = make_heatmaps(generator, CENTERPOSE_SIZE, CENTERPOSE_SIZE, MSPN_JOINTS, 0.0f, 1.0f);
+
+    BENCHMARK("mspn reference (xtensor + opencv blur)")
+    {
+        return reference_mspn(mspn_tensor, true);
+    };
+
+    BENCHMARK("mspn quantized (fixed point blur)")
+    {
+        HailoROIPtr roi = make_roi(mspn_tensor);
+        mspn_postprocess(roi, 0.2, true);
+        return roi;
+    };
+
+    BENCHMARK("centerpose joints top k reference (common::top_k per row)")
+    {
+        xt::xarray<uint8_t> xscores = common::get_xtensor(joint_tensor);
+        xt::xarray<float> scores = xt::reshape_view(xt::transpose(xscores, {2, 0, 1}), {MSPN_JOINTS, CENTERPOSE_SIZE * CENTERPOSE_SIZE});
+        int sum = 0;
+        for (int joint = 0; joint < MSPN_JOINTS; joint++)
+        {
+            xt::xarray<uint8_t> row = xt::expand_dims(xt::row(scores, joint), 0);
+            sum += common::top_k(row, TOP_K)(0);
+        }
+        return sum;
+    };
+
+    BENCHMARK("centerpose joints top k quantized (in place partial selection)")
+    {
+        std::vector<common::HeatmapPeak> peaks;
+        int sum = 0;
+        for (int joint = 0; joint < MSPN_JOINTS; joint++)
+        {
+            common::heatmap_top_k(joint_tensor->data(), CENTERPOSE_SIZE, CENTERPOSE_SIZE, MSPN_JOINTS, joint, TOP_K, peaks);
+            sum += peaks[0].index;
+        }
+        return sum;
+    };
+}
@@ -0,0 +1,122 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Heatmap outputs and the float MSPN decoding, shared by heatmap_unit_tests and postprocess_benchmarks
+#pragma once
+
+// General cpp includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "common/tensors.hpp"
+#include "common/quantized_tensor.hpp"
+
+// Open source includes
+#include <opencv2/opencv.hpp>
+#include "xtensor/xarray.hpp"
+#include "xtensor/xsort.hpp"
+#include "xtensor/xview.hpp"
+
+#define MSPN_HEIGHT (64)
+#define MSPN_WIDTH (48)
+#define MSPN_JOINTS (17)
+#define CENTERPOSE_SIZE (160)
+#define TOP_K (20)
+
+//******************************************************************
+// REFERENCE: THE XTENSOR / OPENCV MSPN DECODING BEFORE THE HEATMAP MODULE
+//******************************************************************
+inline void reference_gaussian_blur(xt::xarray<float> &heatmaps, int num_joints, int width, int height)
+{
+    const int kernel_size = 5;
+    int border = (kernel_size - 1) / 2;
+    for (int j = 0; j < num_joints; j++)
+    {
+        xt::xarray<float> sliced_view = xt::view(heatmaps, j, xt::all(), xt::all());
+        xt::xarray<float> origin_max = xt::amax(sliced_view);
+        cv::Mat dr = cv::Mat::zeros(height + 2 * border, width + 2 * border, CV_32F);
+        cv::Mat sliced_view_mat(sliced_view.shape()[0], sliced_view.shape()[1], CV_32F, sliced_view.data(), 0);
+        cv::copyMakeBorder(sliced_view_mat, dr, border, border, border, border, cv::BORDER_CONSTANT, 0);
+        cv::Mat gaussian_image;
+        cv::GaussianBlur(dr, gaussian_image, cv::Size(kernel_size, kernel_size), 0);
+        cv::Mat sliced_view_mat2(sliced_view.shape()[0], sliced_view.shape()[1], CV_32F, sliced_view.data(), 0);
+        cv::Mat gaussian_image_roi = gaussian_image(cv::Rect(border, border, width, height));
+        gaussian_image_roi.copyTo(sliced_view_mat2);
+        float new_max = std::max(xt::amax(sliced_view)(0), (float)1e-12);
+        xt::xarray<float> sliced_view_mul = sliced_view * (origin_max / new_max);
+        xt::view(heatmaps, j, xt::all(), xt::all()) = sliced_view_mul;
+    }
+}
+
+inline std::vector<HailoPoint> reference_mspn(HailoTensorPtr tensor, bool perform_gaussian_blur)
+{
+    auto tensor_xarray = common::get_xtensor_float(tensor);
+    xt::xarray<float> heatmaps = xt::transpose(tensor_xarray, {2, 0, 1});
+    int num_joints = heatmaps.shape()[0];
+    int height = heatmaps.shape()[1];
+    int width = heatmaps.shape()[2];
+    if (perform_gaussian_blur)
+        reference_gaussian_blur(heatmaps, num_joints, width, height);
+
+    std::vector<HailoPoint> points;
+    for (int k = 0; k < num_joints; k++)
+    {
+        xt::xarray<float> heatmap = xt::view(heatmaps, k, xt::all(), xt::all());
+        xt::xarray<float> flat = xt::flatten(heatmap);
+        int index = xt::argmax(flat)();
+        float max_val = std::min(xt::amax(flat)(), 1.0f);
+        float px = (max_val > 0.0) ? index % width : -1;
+        float py = (max_val > 0.0) ? std::floor(index / width) : -1;
+        int ix = (int)px, iy = (int)py;
+        if (ix < width - 1 && ix > 1 && iy < height - 1 && iy > 1)
+        {
+            float diff = heatmap(iy, ix + 1) - heatmap(iy, ix - 1);
+            px += (diff > 0) ? 0.75 : 0.25;
+            diff = heatmap(iy + 1, ix) - heatmap(iy - 1, ix);
+            px += (diff > 0) ? 0.75 : 0.25;
+        }
+        points.emplace_back(HailoPoint(px / width, py / height, max_val / 255 + 0.5));
+    }
+    return points;
+}
+
+//******************************************************************
+// TEST DATA
+//******************************************************************
+// Every channel holds a gaussian blob at a random position over low noise, as a trained network outputs
+inline HailoTensorPtr make_heatmaps(std::mt19937 &generator, int width, int height, int channels, float qp_zp, float qp_scale)
+{
+    HailoTensorPtr heatmaps = make_quantized_tensor(make_vstream_info("heatmaps", height, width, channels, qp_zp, qp_scale));
+    uint8_t *data = heatmaps->data();
+
+    std::uniform_real_distribution<float> position(0.0f, 1.0f);
+    std::uniform_real_distribution<float> amplitude(60.0f, 235.0f);
+    std::uniform_int_distribution<int> noise(0, 6);
+    for (int c = 0; c < channels; c++)
+    {
+        float cx = position(generator) * (width - 1), cy = position(generator) * (height - 1);
+        float peak = amplitude(generator), sigma = 1.5f + position(generator) * 2.0f;
+        for (int y = 0; y < height; y++)
+        {
+            for (int x = 0; x < width; x++)
+            {
+                float d2 = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+                float value = peak * std::exp(-d2 / (2 * sigma * sigma)) + noise(generator);
+                data[(y * width + x) * channels + c] = (uint8_t)std::min(value, 255.0f);
+            }
+        }
+    }
+    return heatmaps;
+}
+
+inline HailoROIPtr make_roi(HailoTensorPtr heatmaps)
+{
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0, 0, 1, 1));
+    roi->add_tensor(heatmaps);
+    return roi;
+}
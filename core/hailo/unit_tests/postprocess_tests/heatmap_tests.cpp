@@ -0,0 +1,122 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "common/heatmap.hpp"
+#include "common/math.hpp"
+#include "heatmap_reference.hpp"
+
+// Defined in pose_estimation/mspn.cpp
+void mspn_postprocess(HailoROIPtr roi, const float score_threshold, bool perform_gaussian_blur);
+
+std::vector<HailoPoint> decoded_points(HailoROIPtr roi)
+{
+    auto landmarks = hailo_common::get_hailo_landmarks(roi);
+    REQUIRE(landmarks.size() == 1);
+    return landmarks[0]->get_points();
+}
+
+//******************************************************************
+// TESTS
+//******************************************************************
+TEST_CASE("MSPN decoding on the quantized tensor matches the float decoding", "[heatmap]")
+{
+    std::mt19937 generator(7);
+    const float qp_zp = 4.0f, qp_scale = 0.004f;
+
+    for (bool blur : {true, false})
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            HailoTensorPtr heatmaps = make_heatmaps(generator, MSPN_WIDTH, MSPN_HEIGHT, MSPN_JOINTS, qp_zp, qp_scale);
+            HailoROIPtr roi = make_roi(heatmaps);
+            std::vector<HailoPoint> expected = reference_mspn(roi->get_tensors()[0], blur);
+            mspn_postprocess(roi, 0.2, blur);
+            std::vector<HailoPoint> points = decoded_points(roi);
+
+            REQUIRE(points.size() == expected.size());
+            for (size_t j = 0; j < points.size(); j++)
+            {
+                CHECK(points[j].x() == Approx(expected[j].x()).margin(1e-6));
+                CHECK(points[j].y() == Approx(expected[j].y()).margin(1e-6));
+                CHECK(points[j].confidence() == Approx(expected[j].confidence()).margin(1e-6));
+            }
+        }
+    }
+}
+
+TEST_CASE("Heatmap top k finds the same peaks as common::top_k", "[heatmap]")
+{
+    std::mt19937 generator(11);
+
+    SECTION("uint8 joint heatmaps, every channel searched in place")
+    {
+        HailoTensorPtr tensor = make_heatmaps(generator, CENTERPOSE_SIZE, CENTERPOSE_SIZE, MSPN_JOINTS, 0.0f, 1.0f);
+        xt::xarray<uint8_t> xscores = common::get_xtensor(tensor);
+        std::vector<common::HeatmapPeak> peaks;
+        for (int joint = 0; joint < MSPN_JOINTS; joint++)
+        {
+            common::heatmap_top_k(tensor->data(), CENTERPOSE_SIZE, CENTERPOSE_SIZE, MSPN_JOINTS, joint, TOP_K, peaks);
+            REQUIRE(peaks.size() == TOP_K);
+
+            xt::xarray<uint8_t> row = xt::expand_dims(xt::flatten(xt::view(xscores, xt::all(), xt::all(), joint)), 0);
+            xt::xarray<int> expected_indices = xt::flatten(common::top_k(row, TOP_K));
+            std::vector<int> expected_values;
+            for (int index : expected_indices)
+                expected_values.push_back(row(0, index));
+            std::sort(expected_values.rbegin(), expected_values.rend());
+
+            for (int i = 0; i < TOP_K; i++)
+            {
+                // Equal values may come in another order, the values and the cells they point to must match
+                CHECK(peaks[i].value == expected_values[i]);
+                CHECK(row(0, peaks[i].index) == peaks[i].value);
+                CHECK(peaks[i].index == peaks[i].y * CENTERPOSE_SIZE + peaks[i].x);
+                if (i > 0)
+                    CHECK(peaks[i - 1].value >= peaks[i].value);
+            }
+        }
+    }
+
+    SECTION("uint16 single channel heatmap")
+    {
+        std::uniform_int_distribution<int> values(0, 65535);
+        std::vector<uint16_t> data(CENTERPOSE_SIZE * CENTERPOSE_SIZE);
+        for (auto &value : data)
+            value = values(generator);
+        std::vector<common::HeatmapPeak> peaks;
+        common::heatmap_top_k(data.data(), CENTERPOSE_SIZE, CENTERPOSE_SIZE, 1, 0, TOP_K, peaks);
+
+        std::vector<uint16_t> sorted(data);
+        std::sort(sorted.rbegin(), sorted.rend());
+        for (int i = 0; i < TOP_K; i++)
+        {
+            CHECK(peaks[i].value == sorted[i]);
+            CHECK(data[peaks[i].index] == peaks[i].value);
+        }
+    }
+
+    SECTION("k larger than the heatmap returns every cell")
+    {
+        std::vector<uint8_t> data = {3, 1, 2, 0};
+        std::vector<common::HeatmapPeak> peaks;
+        common::heatmap_top_k(data.data(), 2, 2, 1, 0, 10, peaks);
+        REQUIRE(peaks.size() == 4);
+        CHECK(peaks[0].index == 0);
+        CHECK(peaks[1].index == 2);
+        CHECK(peaks[2].index == 1);
+        CHECK(peaks[3].index == 3);
+    }
+}
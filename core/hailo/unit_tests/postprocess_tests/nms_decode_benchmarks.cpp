@@ -0,0 +1,42 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <map>
+#include <string>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "detection/hailo_nms_decode.hpp"
+#include "nms_decode_reference.hpp"
+
+// Adding the detections while decoding against decoding them first
+TEST_CASE( "Benchmark the nms decoding.", "[benchmark]" ) {
+    HailoTensorPtr output = make_nms_output<common::hailo_bbox_float32_t>(NUM_CLASSES, MAX_BOXES);
+    std::map<uint8_t, std::string> labels = make_labels(NUM_CLASSES);
+
+    BENCHMARK( "decode and add_detections, 100 classes x 100 boxes" ) {
+        HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+        auto post = HailoNMSDecode(output, labels);
+        hailo_common::add_detections(roi, post.decode<float32_t, common::hailo_bbox_float32_t>());
+        return roi;
+    };
+    BENCHMARK( "decode_to_roi, 100 classes x 100 boxes" ) {
+        HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+        auto post = HailoNMSDecode(output, labels);
+        post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
+        return roi;
+    };
+    BENCHMARK( "decode_to_roi, 100 classes x 100 boxes, half filtered by score" ) {
+        HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+        auto post = HailoNMSDecode(output, labels, 0.5f, MAX_BOXES, true);
+        post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
+        return roi;
+    };
+}
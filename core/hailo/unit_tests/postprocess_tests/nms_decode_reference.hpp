@@ -0,0 +1,54 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Nms outputs, shared by nms_decode_unit_tests and postprocess_benchmarks
+#pragma once
+
+// General cpp includes
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "common/structures.hpp"
+#include "common/quantized_tensor.hpp"
+
+#define NUM_CLASSES (100)
+#define MAX_BOXES (100)
+
+/**
+ * @brief An nms buffer where every class has boxes_per_class boxes, with the scores 0.05, 0.15, ... 0.95 in turn.
+ */
+template <typename BBoxType>
+HailoTensorPtr make_nms_output(uint32_t num_classes, uint32_t boxes_per_class, float qp_scale = 1.0f, float qp_zp = 0.0f)
+{
+    std::vector<uint8_t> buffer(num_classes * (sizeof(float32_t) + boxes_per_class * sizeof(BBoxType)));
+    size_t offset = 0;
+    for (uint32_t class_id = 0; class_id < num_classes; class_id++)
+    {
+        float32_t count = boxes_per_class;
+        memcpy(&buffer[offset], &count, sizeof(count));
+        offset += sizeof(count);
+        for (uint32_t box = 0; box < boxes_per_class; box++)
+        {
+            float values[5] = {0.1f, 0.2f + class_id * 0.001f, 0.5f, 0.6f, (box % 10) / 10.0f + 0.05f};
+            BBoxType bbox;
+            auto *fields = reinterpret_cast<decltype(bbox.y_min) *>(&bbox);
+            for (int field = 0; field < 5; field++)
+                fields[field] = std::is_floating_point<decltype(bbox.y_min)>::value ? values[field] : std::round(values[field] / qp_scale + qp_zp);
+            memcpy(&buffer[offset], &bbox, sizeof(bbox));
+            offset += sizeof(bbox);
+        }
+    }
+
+    hailo_vstream_info_t info = make_vstream_info("nms", 0, 0, 0, qp_zp, qp_scale);
+    info.format.order = HAILO_FORMAT_ORDER_HAILO_NMS;
+    info.nms_shape.number_of_classes = num_classes;
+    info.nms_shape.max_bboxes_per_class = MAX_BOXES;
+    return make_quantized_tensor(std::move(buffer), info);
+}
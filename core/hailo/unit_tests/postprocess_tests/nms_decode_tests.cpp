@@ -0,0 +1,87 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "hailo_common.hpp"
+#include "detection/hailo_nms_decode.hpp"
+#include "nms_decode_reference.hpp"
+
+TEST_CASE( "Decoding the nms buffer to the roi matches the decoded detections.", "[nms_decode]" ) {
+    HailoTensorPtr output = make_nms_output<common::hailo_bbox_float32_t>(5, 10);
+    std::map<uint8_t, std::string> labels = make_labels(5);
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.25f, 0.25f, 0.5f, 0.5f));
+
+    for (bool filter_by_score : {false, true})
+    {
+        auto post = HailoNMSDecode(output, labels, 0.5f, MAX_BOXES, filter_by_score);
+        std::vector<HailoDetection> expected = post.decode<float32_t, common::hailo_bbox_float32_t>();
+        CHECK( expected.size() == (filter_by_score ? 25 : 50) );
+
+        roi->remove_objects_typed(HAILO_DETECTION);
+        post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi);
+        std::vector<HailoDetectionPtr> detections = hailo_common::get_hailo_detections(roi);
+        REQUIRE( detections.size() == expected.size() );
+        for (size_t i = 0; i < detections.size(); i++)
+        {
+            CHECK( detections[i]->get_label() == expected[i].get_label() );
+            CHECK( detections[i]->get_class_id() == expected[i].get_class_id() );
+            CHECK( detections[i]->get_confidence() == expected[i].get_confidence() );
+            CHECK( detections[i]->get_bbox().xmin() == expected[i].get_bbox().xmin() );
+            CHECK( detections[i]->get_bbox().height() == expected[i].get_bbox().height() );
+            CHECK( detections[i]->get_scaling_bbox().xmin() == 0.25f );
+        }
+    }
+
+    std::vector<HailoDetectionPtr> detections = hailo_common::get_hailo_detections(roi);
+    CHECK( detections[0]->get_label() == "label_1" );
+    CHECK( detections[0]->get_class_id() == 1 );
+    CHECK( detections[0]->get_confidence() == Approx(0.55f) );
+    CHECK( detections.back()->get_label() == "label_5" );
+}
+
+TEST_CASE( "Quantized nms boxes are filtered before they are dequantized.", "[nms_decode]" ) {
+    const float qp_scale = 1.0f / 1000.0f;
+    const float qp_zp = 10.0f;
+    HailoTensorPtr output = make_nms_output<common::hailo_bbox_t>(3, 10, qp_scale, qp_zp);
+    std::map<uint8_t, std::string> labels = make_labels(3);
+
+    auto post = HailoNMSDecode(output, labels, 0.55f, MAX_BOXES, true);
+    std::vector<HailoDetection> detections = post.decode<uint8_t, common::hailo_bbox_t>();
+    // 0.65 ... 0.95 pass, 0.55 is not above the threshold
+    REQUIRE( detections.size() == 3 * 4 );
+    CHECK( detections[0].get_confidence() == Approx(0.65f) );
+    CHECK( detections[0].get_bbox().ymin() == Approx(0.1f) );
+    CHECK( detections[0].get_bbox().width() == Approx(0.4f) );
+    CHECK( detections.back().get_label() == "label_3" );
+}
+
+TEST_CASE( "Nms decoding skips classes and checks the number of boxes.", "[nms_decode]" ) {
+    HailoTensorPtr output = make_nms_output<common::hailo_bbox_float32_t>(4, 2);
+    std::map<uint8_t, std::string> labels = {{1, "person"}, {2, "car"}};
+    HailoROIPtr roi = std::make_shared<HailoROI>(HailoBBox(0.0f, 0.0f, 1.0f, 1.0f));
+
+    auto post = HailoNMSDecode(output, labels);
+    post.decode_to_roi<float32_t, common::hailo_bbox_float32_t>(roi, [](uint32_t class_index) { return class_index != 1; });
+    std::vector<HailoDetectionPtr> detections = hailo_common::get_hailo_detections(roi);
+    REQUIRE( detections.size() == 6 );
+    CHECK( detections[0]->get_label() == "car" );
+    // A class without a label gets an empty one
+    CHECK( detections[2]->get_label() == "" );
+    CHECK( labels.size() == 2 );
+
+    float32_t too_many = MAX_BOXES + 1;
+    memcpy(output->data(), &too_many, sizeof(too_many));
+    CHECK_THROWS_AS( (post.decode<float32_t, common::hailo_bbox_float32_t>()), std::runtime_error );
+}
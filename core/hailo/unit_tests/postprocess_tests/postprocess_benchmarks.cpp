@@ -0,0 +1,10 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// The benchmarks are in the <postprocess>_benchmarks.cpp files, run one with: postprocess_benchmarks "<test case name>"
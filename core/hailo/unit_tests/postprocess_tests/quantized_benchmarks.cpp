@@ -0,0 +1,45 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <vector>
+
+// Tappas includes
+#include "common/quantized.hpp"
+#include "quantized_reference.hpp"
+
+// The quantized reductions against their float and std equivalents
+TEST_CASE( "Benchmark the quantized reductions.", "[benchmark]" ) {
+    std::vector<uint8_t> scores = random_values<uint8_t>(1001, 255, 1);
+    std::vector<int> indices;
+
+    BENCHMARK( "quantized argmax, 1001 classes" ) {
+        return common::quantized_argmax(scores.data(), scores.size());
+    };
+    BENCHMARK( "std::max_element, 1001 classes" ) {
+        return std::max_element(scores.begin(), scores.end()) - scores.begin();
+    };
+    BENCHMARK( "quantized top 5, 1001 classes" ) {
+        common::quantized_top_k(scores.data(), scores.size(), 5, indices);
+        return indices[0];
+    };
+
+    const common::QuantizedSoftmax &softmax = common::QuantizedSoftmax::cached(0.1f, 255);
+    std::vector<float> probabilities(scores.size());
+    BENCHMARK( "LUT softmax, 1001 classes" ) {
+        softmax.softmax(scores.data(), scores.size(), probabilities.data());
+        return probabilities[0];
+    };
+    BENCHMARK( "float softmax, 1001 classes" ) {
+        std::vector<float> dequantized(scores.begin(), scores.end());
+        for (float &value : dequantized)
+            value *= 0.1f;
+        return reference_softmax(dequantized)[0];
+    };
+}
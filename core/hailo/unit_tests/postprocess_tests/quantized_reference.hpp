@@ -0,0 +1,35 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Random scores and the float softmax, shared by quantized_unit_tests and postprocess_benchmarks
+#pragma once
+
+// General cpp includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+template <typename T>
+std::vector<T> random_values(int size, T max_value, uint seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<uint32_t> distribution(0, max_value);
+    std::vector<T> values(size);
+    for (T &value : values)
+        value = distribution(generator);
+    return values;
+}
+
+inline std::vector<float> reference_softmax(const std::vector<float> &values)
+{
+    float max = *std::max_element(values.begin(), values.end());
+    std::vector<float> probabilities(values.size());
+    double sum = 0.0;
+    for (size_t i = 0; i < values.size(); i++)
+        sum += probabilities[i] = std::exp(values[i] - max);
+    for (float &probability : probabilities)
+        probability /= sum;
+    return probabilities;
+}
@@ -0,0 +1,132 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "common/quantized.hpp"
+#include "common/quantized_tensor.hpp"
+#include "quantized_reference.hpp"
+
+TEMPLATE_TEST_CASE( "The quantized argmax is the first of the highest values.", "[quantized]", uint8_t, uint16_t ) {
+    for (int size : {1, 7, 16, 33, 1000})
+    {
+        // Few distinct values, so the max shows up several times
+        std::vector<TestType> values = random_values<TestType>(size, 20, size);
+        int expected = std::max_element(values.begin(), values.end()) - values.begin();
+        CHECK( common::quantized_argmax(values.data(), size) == expected );
+        CHECK( common::quantized_max(values.data(), size) == values[expected] );
+    }
+
+    std::vector<TestType> values = random_values<TestType>(40, 3, 7);
+    std::vector<int> indices;
+    common::quantized_argmax_rows(values.data(), 20, 2, indices);
+    REQUIRE( indices.size() == 20 );
+    for (int row = 0; row < 20; row++)
+        CHECK( indices[row] == (values[row * 2 + 1] > values[row * 2] ? 1 : 0) );
+}
+
+TEMPLATE_TEST_CASE( "The quantized top k matches a stable sort.", "[quantized]", uint8_t, uint16_t ) {
+    std::vector<TestType> values = random_values<TestType>(1000, 50, 3);
+    std::vector<int> expected(values.size());
+    std::iota(expected.begin(), expected.end(), 0);
+    std::stable_sort(expected.begin(), expected.end(), [&](int a, int b) { return values[a] > values[b]; });
+
+    std::vector<int> indices;
+    for (int k : {1, 5, 100})
+    {
+        common::quantized_top_k(values.data(), values.size(), k, indices);
+        CHECK( indices == std::vector<int>(expected.begin(), expected.begin() + k) );
+    }
+    common::quantized_top_k(values.data(), 3, 10, indices);
+    CHECK( indices.size() == 3 );
+}
+
+TEST_CASE( "The quantized threshold matches the dequantized compare.", "[quantized]" ) {
+    for (float qp_scale : {0.01f, 0.0723f, 0.5f})
+    {
+        for (float qp_zp : {0.0f, 83.0f, 128.0f})
+        {
+            for (float value : {-1.5f, 0.0f, 0.8473f, 3.0f})
+            {
+                int64_t threshold = common::quantized_threshold(value, qp_scale, qp_zp);
+                for (int q = 0; q < 256; q++)
+                    CHECK( ((q - qp_zp) * qp_scale > value) == (q >= threshold) );
+            }
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE( "The LUT softmax matches the dequantized softmax.", "[quantized]", uint8_t, uint16_t ) {
+    const float qp_scale = std::is_same<TestType, uint8_t>::value ? 0.08f : 0.0004f;
+    const float qp_zp = 97.0f;
+    const TestType max_value = std::numeric_limits<TestType>::max();
+    std::vector<TestType> values = random_values<TestType>(37, max_value, 11);
+
+    std::vector<float> dequantized;
+    for (TestType value : values)
+        dequantized.push_back((value - qp_zp) * qp_scale);
+    std::vector<float> expected = reference_softmax(dequantized);
+
+    const common::QuantizedSoftmax &softmax = common::QuantizedSoftmax::cached(qp_scale, max_value);
+    CHECK( &softmax == &common::QuantizedSoftmax::cached(qp_scale, max_value) );
+    std::vector<float> probabilities(values.size());
+    softmax.softmax(values.data(), values.size(), probabilities.data());
+    for (size_t i = 0; i < values.size(); i++)
+        CHECK( probabilities[i] == Approx(expected[i]).margin(1e-6) );
+
+    int index;
+    float max_probability = softmax.max_probability(values.data(), values.size(), index);
+    CHECK( index == std::max_element(expected.begin(), expected.end()) - expected.begin() );
+    CHECK( max_probability == Approx(expected[index]).margin(1e-6) );
+}
+
+TEST_CASE( "The LUT softmax of sums is the softmax of the means.", "[quantized]" ) {
+    const float qp_scale = 0.05f;
+    const int count = 4;
+    std::vector<uint8_t> values = random_values<uint8_t>(11 * count, 255, 5);
+    std::vector<uint32_t> sums(11, 0);
+    std::vector<float> means(11, 0.0f);
+    for (int i = 0; i < 11 * count; i++)
+    {
+        sums[i % 11] += values[i];
+        means[i % 11] += values[i] * qp_scale / count;
+    }
+    std::vector<float> expected = reference_softmax(means);
+
+    common::QuantizedSoftmax softmax(qp_scale / count, 255 * count);
+    int index;
+    float max_probability = softmax.max_probability(sums.data(), sums.size(), index);
+    CHECK( index == std::max_element(expected.begin(), expected.end()) - expected.begin() );
+    CHECK( max_probability == Approx(expected[index]).margin(1e-6) );
+}
+
+TEST_CASE( "The tensor argmax reads uint8 and uint16 tensors in place.", "[quantized]" ) {
+    HailoTensorPtr tensor = make_quantized_tensor({3, 9, 1, 9, 0, 4}, make_vstream_info("scores", 1, 1, 6, 2.0f, 0.5f));
+    common::QuantizedArgmax top = common::tensor_argmax(tensor);
+    CHECK( top.index == 1 );
+    CHECK( tensor->fix_scale(top.value) == 3.5f );
+
+    HailoTensorPtr wide_tensor = make_quantized_tensor(make_vstream_info("scores", 1, 1, 6, 2.0f, 0.5f, HAILO_FORMAT_TYPE_UINT16));
+    std::vector<uint16_t> wide_values = {3, 900, 1, 1000, 0, 4};
+    memcpy(wide_tensor->data(), wide_values.data(), wide_values.size() * sizeof(uint16_t));
+    top = common::tensor_argmax(wide_tensor);
+    CHECK( top.index == 3 );
+    CHECK( top.value == 1000 );
+
+    std::vector<int> indices;
+    common::tensor_argmax_rows(wide_tensor, 2, indices);
+    CHECK( indices == std::vector<int>{1, 1, 1} );
+}
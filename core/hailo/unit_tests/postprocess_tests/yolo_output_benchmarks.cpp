@@ -0,0 +1,97 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <map>
+#include <string>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "detection/yolo_output.hpp"
+#include "yolo_output_reference.hpp"
+
+/**
+ * @brief The three output scales of a 640x640 network with 80 classes.
+ */
+struct YoloOutputs
+{
+    std::vector<HailoTensorPtr> tensors;
+    std::vector<YoloOutputLayer> layers;
+};
+
+static YoloOutputs make_fused_outputs(float qp_scale, float qp_zp)
+{
+    YoloOutputs outputs;
+    std::vector<std::vector<int>> anchors = COCO_ANCHORS;
+    for (uint i = 0; i < 3; i++)
+    {
+        outputs.tensors.push_back(make_tensor<uint8_t>(20 << i, 255, qp_scale, qp_zp, i, 4, 85));
+        outputs.layers.emplace_back(outputs.tensors.back(), anchors[i]);
+    }
+    return outputs;
+}
+
+static YoloOutputs make_yolox_outputs()
+{
+    YoloOutputs outputs;
+    for (uint i = 0; i < 3; i++)
+    {
+        outputs.tensors.push_back(make_tensor<uint8_t>(20 << i, 4, 0.02f, 128.0f, i));
+        outputs.tensors.push_back(make_tensor<uint8_t>(20 << i, 1, 1.0f / 255.0f, 0.0f, i, 0, 1));
+        outputs.tensors.push_back(make_tensor<uint8_t>(20 << i, 80, 1.0f / 255.0f, 0.0f, i));
+        auto &tensors = outputs.tensors;
+        outputs.layers.emplace_back(tensors[3 * i], tensors[3 * i + 1], tensors[3 * i + 2]);
+    }
+    return outputs;
+}
+
+static size_t decode(YoloOutputs &outputs, yolo_layout_t layout, bool sigmoid, const YoloExtractParams &params)
+{
+    std::vector<HailoDetection> detections;
+    const YoloDecoder &decoder = YoloDecoder::select(layout, sigmoid);
+    for (auto &layer : outputs.layers)
+        decoder.extract_boxes(layer, params, detections);
+    return detections.size();
+}
+
+static size_t reference_decode(YoloOutputs &outputs, yolo_layout_t layout, bool sigmoid, const YoloExtractParams &params)
+{
+    size_t count = 0;
+    for (auto &layer : outputs.layers)
+        count += reference_extract(layout, sigmoid, layer, params, false).size();
+    return count;
+}
+
+// The template layouts against the per element decoding
+TEST_CASE( "Benchmark the yolo output decoding.", "[benchmark]" ) {
+    std::map<uint8_t, std::string> labels = make_labels(80);
+    YoloExtractParams params = {0.3f, 1, 640, 640, &labels};
+    YoloOutputs v5 = make_fused_outputs(1.0f / 255.0f, 0.0f);
+    YoloOutputs v3 = make_fused_outputs(0.05f, 128.0f);
+    YoloOutputs yolox = make_yolox_outputs();
+
+    BENCHMARK( "yolov5 per element layers, 640x640" ) {
+        return reference_decode(v5, YOLO_LAYOUT_V5, false, params);
+    };
+    BENCHMARK( "yolov5 template layout, 640x640" ) {
+        return decode(v5, YOLO_LAYOUT_V5, false, params);
+    };
+    BENCHMARK( "yolov3 (sigmoid) per element layers, 640x640" ) {
+        return reference_decode(v3, YOLO_LAYOUT_V3, true, params);
+    };
+    BENCHMARK( "yolov3 (sigmoid) template layout, 640x640" ) {
+        return decode(v3, YOLO_LAYOUT_V3, true, params);
+    };
+    BENCHMARK( "yolox per element layers, 640x640" ) {
+        return reference_decode(yolox, YOLO_LAYOUT_X, false, params);
+    };
+    BENCHMARK( "yolox template layout, 640x640" ) {
+        return decode(yolox, YOLO_LAYOUT_X, false, params);
+    };
+}
@@ -0,0 +1,132 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Yolo outputs and the per element decoding, shared by yolo_output_unit_tests and postprocess_benchmarks
+#pragma once
+
+// General cpp includes
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "detection/yolo_output.hpp"
+#include "common/quantized_tensor.hpp"
+
+#define COCO_ANCHORS {{116, 90, 156, 198, 373, 326}, {30, 61, 62, 45, 59, 119}, {10, 13, 16, 30, 33, 23}}
+
+/**
+ * @brief A random output, where an objectness channel (every stride channels from obj_offset) is mostly low.
+ */
+template <typename T>
+HailoTensorPtr make_tensor(uint size, uint features, float qp_scale, float qp_zp, uint seed,
+                           uint obj_offset = 0, uint obj_stride = 0)
+{
+    hailo_vstream_info_t info = make_vstream_info("yolo", size, size, features,
+                                                  qp_zp * (sizeof(T) == 2 ? 256.0f : 1.0f),
+                                                  qp_scale / (sizeof(T) == 2 ? 256.0f : 1.0f),
+                                                  std::is_same<T, uint16_t>::value ? HAILO_FORMAT_TYPE_UINT16 : HAILO_FORMAT_TYPE_UINT8);
+    HailoTensorPtr output = make_quantized_tensor(info);
+
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<uint32_t> values(0, std::numeric_limits<T>::max());
+    std::uniform_int_distribution<uint32_t> low_values(0, std::numeric_limits<T>::max() / 4);
+    T *data = reinterpret_cast<T *>(output->data());
+    for (uint i = 0; i < size * size * features; i++)
+    {
+        bool is_obj = obj_stride != 0 && (i % features) % obj_stride == obj_offset;
+        // One in twenty objectness values is high
+        data[i] = (is_obj && generator() % 20 != 0) ? low_values(generator) : values(generator);
+    }
+    return output;
+}
+
+inline float sigmoid(float x)
+{
+    return 1.0f / (1.0f + expf(-x));
+}
+
+/**
+ * @brief The decoding of the virtual output layers: every element is read and dequantized through the tensor,
+ *        at channels computed from features() / NUM_ANCHORS.
+ */
+inline std::vector<HailoDetection> reference_extract(yolo_layout_t layout, bool perform_sigmoid, YoloOutputLayer &layer,
+                                                     const YoloExtractParams &params, bool is_uint16)
+{
+    const uint num_anchors = (layout == YOLO_LAYOUT_X) ? 1 : 3;
+    const bool fused = (layout != YOLO_LAYOUT_X && layout != YOLO_LAYOUT_V4);
+    if (layout == YOLO_LAYOUT_V5 || layout == YOLO_LAYOUT_X)
+        perform_sigmoid = false;
+    auto activation = [perform_sigmoid](float x) { return perform_sigmoid ? sigmoid(x) : x; };
+    auto get = [is_uint16](HailoTensorPtr &tensor, uint row, uint col, uint channel) -> uint {
+        return is_uint16 ? tensor->get_uint16(row, col, channel) : tensor->get(row, col, channel);
+    };
+    const uint num_classes = fused ? layer.cls->features() / num_anchors - 5 : layer.cls->features() / num_anchors;
+    const uint width = layer.width(), height = layer.height();
+    std::vector<HailoDetection> objects;
+    for (uint row = 0; row < height; ++row)
+    {
+        for (uint col = 0; col < width; ++col)
+        {
+            for (uint anchor = 0; anchor < num_anchors; ++anchor)
+            {
+                uint obj_channel = fused ? layer.obj->features() / num_anchors * anchor + 4 : anchor;
+                float confidence = activation(layer.obj->get_full_percision(row, col, obj_channel, is_uint16));
+                if (confidence < params.detection_threshold)
+                    continue;
+                uint prob_max = 0, class_id = 1;
+                for (uint c = params.label_offset; c <= num_classes; c++)
+                {
+                    uint channel = layer.cls->features() / num_anchors * anchor + (fused ? 5 : 0) + c - 1;
+                    uint prob = get(layer.cls, row, col, channel);
+                    if (prob > prob_max)
+                    {
+                        class_id = c;
+                        prob_max = prob;
+                    }
+                }
+                confidence *= activation(layer.cls->fix_scale(prob_max));
+                if (confidence <= params.detection_threshold)
+                    continue;
+
+                uint center_channel = layer.center->features() / num_anchors * anchor;
+                uint shape_channel = layer.shape->features() / num_anchors * anchor + ((layout == YOLO_LAYOUT_V4) ? 0 : 2);
+                float cx = layer.center->get_full_percision(row, col, center_channel, is_uint16);
+                float cy = layer.center->get_full_percision(row, col, center_channel + 1, is_uint16);
+                float sw = layer.shape->get_full_percision(row, col, shape_channel, is_uint16);
+                float sh = layer.shape->get_full_percision(row, col, shape_channel + 1, is_uint16);
+                float x, y, w, h;
+                switch (layout)
+                {
+                case YOLO_LAYOUT_V5:
+                    x = (cx * 2.0f - 0.5f + col) / width;
+                    y = (cy * 2.0f - 0.5f + row) / height;
+                    w = pow(2.0f * sw, 2.0f) * layer.anchors[anchor * 2] / params.image_width;
+                    h = pow(2.0f * sh, 2.0f) * layer.anchors[anchor * 2 + 1] / params.image_height;
+                    break;
+                case YOLO_LAYOUT_X:
+                    x = (cx + col) / width;
+                    y = (cy + row) / height;
+                    w = expf(sw) / width;
+                    h = expf(sh) / height;
+                    break;
+                default:
+                    x = (sigmoid(cx) + col) / width;
+                    y = (sigmoid(cy) + row) / height;
+                    w = expf(sw) * layer.anchors[anchor * 2] / params.image_width;
+                    h = expf(sh) * layer.anchors[anchor * 2 + 1] / params.image_height;
+                    break;
+                }
+                objects.push_back(HailoDetection(HailoBBox(x - (w / 2.0f), y - (h / 2.0f), w, h), class_id,
+                                                 params.labels->at(class_id), confidence));
+            }
+        }
+    }
+    return objects;
+}
@@ -0,0 +1,116 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Tappas includes
+#include "hailo_objects.hpp"
+#include "detection/yolo_output.hpp"
+#include "yolo_output_reference.hpp"
+
+void check_detections(std::vector<HailoDetection> detections, std::vector<HailoDetection> expected)
+{
+    REQUIRE( detections.size() == expected.size() );
+    for (size_t i = 0; i < detections.size(); i++)
+    {
+        CHECK( detections[i].get_class_id() == expected[i].get_class_id() );
+        CHECK( detections[i].get_label() == expected[i].get_label() );
+        CHECK( detections[i].get_confidence() == Approx(expected[i].get_confidence()).margin(1e-6) );
+        CHECK( detections[i].get_bbox().xmin() == Approx(expected[i].get_bbox().xmin()).margin(1e-6) );
+        CHECK( detections[i].get_bbox().ymin() == Approx(expected[i].get_bbox().ymin()).margin(1e-6) );
+        CHECK( detections[i].get_bbox().width() == Approx(expected[i].get_bbox().width()).margin(1e-6) );
+        CHECK( detections[i].get_bbox().height() == Approx(expected[i].get_bbox().height()).margin(1e-6) );
+    }
+}
+
+TEMPLATE_TEST_CASE( "Fused yolo layouts decode as the per element layers.", "[yolo_output]", uint8_t, uint16_t ) {
+    const bool is_uint16 = std::is_same<TestType, uint16_t>::value;
+    std::vector<std::vector<int>> anchors = COCO_ANCHORS;
+    for (uint num_classes : {80, 3})
+    {
+        std::map<uint8_t, std::string> labels = make_labels(num_classes);
+        const uint features = 3 * (5 + num_classes);
+        for (int label_offset : {1, 2})
+        {
+            YoloExtractParams params = {0.3f, label_offset, 320, 320, &labels};
+            // yolov5 outputs are sigmoid activated, yolov3 outputs are logits
+            HailoTensorPtr v5 = make_tensor<TestType>(10, features, 1.0f / 255.0f, 0.0f, num_classes, 4, 5 + num_classes);
+            YoloOutputLayer v5_layer(v5, anchors[0]);
+            std::vector<HailoDetection> v5_detections;
+            YoloDecoder::select(YOLO_LAYOUT_V5, false).extract_boxes(v5_layer, params, v5_detections);
+            CHECK( v5_detections.size() > 0 );
+            check_detections(v5_detections, reference_extract(YOLO_LAYOUT_V5, false, v5_layer, params, is_uint16));
+
+            // Logits with the sigmoid activation, activated outputs without
+            HailoTensorPtr v3 = make_tensor<TestType>(10, features, 0.05f, 128.0f, num_classes, 4, 5 + num_classes);
+            for (bool sigmoid : {false, true})
+            {
+                YoloOutputLayer v3_layer(sigmoid ? v3 : v5, anchors[1]);
+                for (yolo_layout_t layout : {YOLO_LAYOUT_V3, YOLO_LAYOUT_TINY_V4})
+                {
+                    std::vector<HailoDetection> v3_detections;
+                    YoloDecoder::select(layout, sigmoid).extract_boxes(v3_layer, params, v3_detections);
+                    CHECK( v3_detections.size() > 0 );
+                    if (layout == YOLO_LAYOUT_V3)
+                        check_detections(v3_detections, reference_extract(YOLO_LAYOUT_V3, sigmoid, v3_layer, params, is_uint16));
+                }
+            }
+        }
+    }
+}
+
+TEMPLATE_TEST_CASE( "Split yolo layouts decode as the per element layers.", "[yolo_output]", uint8_t, uint16_t ) {
+    const bool is_uint16 = std::is_same<TestType, uint16_t>::value;
+    std::map<uint8_t, std::string> labels = make_labels(80);
+    YoloExtractParams params = {0.3f, 1, 640, 640, &labels};
+
+    HailoTensorPtr bbox = make_tensor<TestType>(20, 4, 0.02f, 128.0f, 1);
+    HailoTensorPtr obj = make_tensor<TestType>(20, 1, 1.0f / 255.0f, 0.0f, 2, 0, 1);
+    HailoTensorPtr cls = make_tensor<TestType>(20, 80, 1.0f / 255.0f, 0.0f, 3);
+    YoloOutputLayer layer(bbox, obj, cls);
+    const YoloDecoder &decoder = YoloDecoder::select(YOLO_LAYOUT_X, false);
+    CHECK( decoder.num_classes(layer) == 80 );
+    std::vector<HailoDetection> detections;
+    decoder.extract_boxes(layer, params, detections);
+    CHECK( detections.size() > 0 );
+    check_detections(detections, reference_extract(YOLO_LAYOUT_X, false, layer, params, is_uint16));
+}
+
+TEST_CASE( "The yolo decoder is selected by layout and activation.", "[yolo_output]" ) {
+    const YoloDecoder &v3 = YoloDecoder::select(YOLO_LAYOUT_V3, true);
+    CHECK( v3.layout == YOLO_LAYOUT_V3 );
+    CHECK( v3.sigmoid );
+    CHECK( &v3 == &YoloDecoder::select(YOLO_LAYOUT_V3, true) );
+    CHECK( &v3 != &YoloDecoder::select(YOLO_LAYOUT_V3, false) );
+    CHECK( YoloDecoder::select(YOLO_LAYOUT_V4, true).num_anchors == 3 );
+    CHECK( YoloDecoder::select(YOLO_LAYOUT_X, false).num_anchors == 1 );
+    // The yolov5 outputs are already activated
+    CHECK( &YoloDecoder::select(YOLO_LAYOUT_V5, true) == &YoloDecoder::select(YOLO_LAYOUT_V5, false) );
+    CHECK_FALSE( YoloDecoder::select(YOLO_LAYOUT_V5, true).sigmoid );
+}
+
+TEST_CASE( "The quantized objectness threshold matches the activated compare.", "[yolo_output]" ) {
+    HailoTensorPtr output = make_tensor<uint8_t>(1, 1, 0.0723f, 97.0f, 0);
+    YoloField<uint8_t> field(output, 1, 0);
+    for (float threshold : {0.0f, 0.3f, 0.5f, 0.99f})
+    {
+        uint32_t linear = yolo_quantized_threshold<uint8_t, false>(field, threshold);
+        uint32_t activated = yolo_quantized_threshold<uint8_t, true>(field, threshold);
+        for (uint32_t q = 0; q < 256; q++)
+        {
+            CHECK( (field.dequantize(q) >= threshold) == (q >= linear) );
+            CHECK( (sigmoid(field.dequantize(q)) >= threshold) == (q >= activated) );
+        }
+    }
+    // Nothing reaches the threshold
+    CHECK( yolo_quantized_threshold<uint8_t, true>(field, 1.5f) == 256 );
+}
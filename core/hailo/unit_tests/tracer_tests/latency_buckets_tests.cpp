@@ -0,0 +1,139 @@
+/**
+* Copyright (c) 2021-2022 Hailo Technologies Ltd. All rights reserved.
+* Distributed under the LGPL license (https://www.gnu.org/licenses/old-licenses/lgpl-2.1.txt)
+**/
+// Catch2 includes
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include "catch.hpp"       // This includes the catch2 header-only library, no further includes needed for catch2
+
+// General cpp includes
+#include <stdint.h>
+#include <vector>
+
+// Tappas includes
+#include "latency_buckets.hpp"
+
+static void record(std::vector<uint64_t> &counts, uint64_t value, uint64_t times = 1)
+{
+    counts[latency_bucket_index(value)] += times;
+}
+
+TEST_CASE( "Small values get a bucket of their own.", "[latency_buckets]" ) {
+    for (uint64_t value = 0; value < LATENCY_HISTOGRAM_SUB_BUCKETS; ++value) {
+        CHECK( latency_bucket_index(value) == value );
+        CHECK( latency_bucket_value(latency_bucket_index(value)) == value );
+    }
+}
+
+TEST_CASE( "Bucket indices are monotonic and within range.", "[latency_buckets]" ) {
+    unsigned int previous = 0;
+    for (uint64_t value = 1; value < (UINT64_C(1) << 32); value = value * 5 / 4 + 1) {
+        unsigned int index = latency_bucket_index(value);
+        CHECK( index >= previous );
+        CHECK( index < LATENCY_HISTOGRAM_BUCKETS );
+        previous = index;
+    }
+}
+
+TEST_CASE( "Bucket values keep the relative precision.", "[latency_buckets]" ) {
+    // Each bucket spans 1/32 of its power of two, its midpoint is off by at most half of that
+    for (uint64_t value = LATENCY_HISTOGRAM_SUB_BUCKETS; value < (UINT64_C(1) << 36); value = value * 3 / 2 + 7) {
+        double midpoint = latency_bucket_value(latency_bucket_index(value));
+        CHECK( midpoint == Approx(value).epsilon(1.0 / LATENCY_HISTOGRAM_SUB_BUCKETS) );
+    }
+}
+
+TEST_CASE( "Bucket boundaries split every power of two evenly.", "[latency_buckets]" ) {
+    // 64..127 are covered by 32 buckets of width 2
+    CHECK( latency_bucket_index(64) == latency_bucket_index(65) );
+    CHECK( latency_bucket_index(65) + 1 == latency_bucket_index(66) );
+    CHECK( latency_bucket_index(127) + 1 == latency_bucket_index(128) );
+    // 128..255 are covered by buckets of width 4
+    CHECK( latency_bucket_index(128) == latency_bucket_index(131) );
+    CHECK( latency_bucket_index(131) + 1 == latency_bucket_index(132) );
+    CHECK( latency_bucket_value(latency_bucket_index(128)) == 130 );
+}
+
+TEST_CASE( "Values above the maximum are clamped to the last bucket.", "[latency_buckets]" ) {
+    CHECK( latency_bucket_index(LATENCY_HISTOGRAM_MAX_VALUE) == LATENCY_HISTOGRAM_BUCKETS - 1 );
+    CHECK( latency_bucket_index(LATENCY_HISTOGRAM_MAX_VALUE + 1) == LATENCY_HISTOGRAM_BUCKETS - 1 );
+    CHECK( latency_bucket_index(UINT64_MAX) == LATENCY_HISTOGRAM_BUCKETS - 1 );
+}
+
+TEST_CASE( "An empty histogram has zero percentiles.", "[latency_buckets]" ) {
+    std::vector<uint64_t> counts(LATENCY_HISTOGRAM_BUCKETS, 0);
+    uint64_t p50 = 1, p90 = 1, p99 = 1;
+
+    latency_bucket_percentiles(counts.data(), 0, 0, &p50, &p90, &p99);
+
+    CHECK( p50 == 0 );
+    CHECK( p90 == 0 );
+    CHECK( p99 == 0 );
+}
+
+TEST_CASE( "Percentiles use the nearest rank.", "[latency_buckets]" ) {
+    std::vector<uint64_t> counts(LATENCY_HISTOGRAM_BUCKETS, 0);
+    uint64_t p50, p90, p99;
+
+    // 1..100, each value once
+    for (uint64_t value = 1; value <= 100; ++value)
+        record(counts, value * 10);
+
+    latency_bucket_percentiles(counts.data(), 100, 1000, &p50, &p90, &p99);
+
+    CHECK( p50 == latency_bucket_value(latency_bucket_index(500)) );
+    CHECK( p90 == latency_bucket_value(latency_bucket_index(900)) );
+    CHECK( p99 == latency_bucket_value(latency_bucket_index(990)) );
+}
+
+TEST_CASE( "A single sample is every percentile.", "[latency_buckets]" ) {
+    std::vector<uint64_t> counts(LATENCY_HISTOGRAM_BUCKETS, 0);
+    uint64_t p50, p90, p99;
+
+    record(counts, 42);
+    latency_bucket_percentiles(counts.data(), 1, 42, &p50, &p90, &p99);
+
+    CHECK( p50 == 42 );
+    CHECK( p90 == 42 );
+    CHECK( p99 == 42 );
+}
+
+TEST_CASE( "Zero latencies are reported as zero percentiles.", "[latency_buckets]" ) {
+    std::vector<uint64_t> counts(LATENCY_HISTOGRAM_BUCKETS, 0);
+    uint64_t p50, p90, p99;
+
+    record(counts, 0, 95);
+    record(counts, 5000, 5);
+    latency_bucket_percentiles(counts.data(), 100, 5000, &p50, &p90, &p99);
+
+    CHECK( p50 == 0 );
+    CHECK( p90 == 0 );
+    CHECK( p99 == 5000 );
+}
+
+TEST_CASE( "Percentiles never exceed the recorded maximum.", "[latency_buckets]" ) {
+    std::vector<uint64_t> counts(LATENCY_HISTOGRAM_BUCKETS, 0);
+    uint64_t p50, p90, p99;
+
+    // 992 is the start of the bucket [992, 1007], whose midpoint is above it
+    record(counts, 992, 10);
+    REQUIRE( latency_bucket_value(latency_bucket_index(992)) > 992 );
+    latency_bucket_percentiles(counts.data(), 10, 992, &p50, &p90, &p99);
+
+    CHECK( p50 == 992 );
+    CHECK( p90 == 992 );
+    CHECK( p99 == 992 );
+}
+
+TEST_CASE( "A slow tail only shows in the high percentiles.", "[latency_buckets]" ) {
+    std::vector<uint64_t> counts(LATENCY_HISTOGRAM_BUCKETS, 0);
+    uint64_t p50, p90, p99;
+
+    record(counts, 1000000, 980);
+    record(counts, 50000000, 20);
+    latency_bucket_percentiles(counts.data(), 1000, 50000000, &p50, &p90, &p99);
+
+    CHECK( p50 == Approx(1000000).epsilon(0.02) );
+    CHECK( p90 == Approx(1000000).epsilon(0.02) );
+    CHECK( p99 == Approx(50000000).epsilon(0.02) );
+}
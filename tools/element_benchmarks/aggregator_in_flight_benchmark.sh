@@ -0,0 +1,116 @@
+#!/bin/bash
+set -e
+
+# Measures the throughput and latency of a synthetic cropper -> inference -> aggregator cascade
+# as a function of the hailoaggregator max-in-flight property.
+# hailotilecropper splits every frame to tiles, and identity elements with a sleep time stand in for
+# the processing of the main frame branch and for the inference of every crop.
+
+function init_variables() {
+    num_buffers=300
+    tiles=2
+    main_time_us=10000
+    crop_time_us=3000
+    in_flight_values="1 2 4 8"
+    print_help_if_needed $@
+}
+
+function print_usage() {
+    echo "Benchmark hailoaggregator multi frame aggregation:"
+    echo ""
+    echo "Options:"
+    echo "  --help                  Show this help"
+    echo "  --num-buffers NUM       Number of frames to push in every run (default $num_buffers)"
+    echo "  --tiles NUM             Tiles along each axis, every frame has NUM*NUM crops (default $tiles)"
+    echo "  --main-time US          Simulated processing time of a main frame in micro seconds (default $main_time_us)"
+    echo "  --crop-time US          Simulated inference time of a crop in micro seconds (default $crop_time_us)"
+    echo "  --in-flight \"N1 N2 ...\" Values of max-in-flight to measure (default \"$in_flight_values\")"
+    exit 0
+}
+
+function print_help_if_needed() {
+    while test $# -gt 0; do
+        if [ "$1" = "--help" ] || [ "$1" == "-h" ]; then
+            print_usage
+        fi
+
+        shift
+    done
+}
+
+function parse_args() {
+    while test $# -gt 0; do
+        if [ "$1" = "--num-buffers" ]; then
+            num_buffers="$2"
+            shift
+        elif [ "$1" = "--tiles" ]; then
+            tiles="$2"
+            shift
+        elif [ "$1" = "--main-time" ]; then
+            main_time_us="$2"
+            shift
+        elif [ "$1" = "--crop-time" ]; then
+            crop_time_us="$2"
+            shift
+        elif [ "$1" = "--in-flight" ]; then
+            in_flight_values="$2"
+            shift
+        else
+            echo "Received invalid argument: $1. See expected arguments below:"
+            print_usage
+            exit 1
+        fi
+
+        shift
+    done
+}
+
+function build_pipeline() {
+    local in_flight=$1
+
+    pipeline="videotestsrc num-buffers=$num_buffers pattern=black ! \
+              video/x-raw,format=RGB,width=1280,height=720 ! \
+              hailotilecropper name=cropper internal-offset=true tiling-mode=0 \
+                  tiles-along-x-axis=$tiles tiles-along-y-axis=$tiles \
+              hailoaggregator name=agg max-in-flight=$in_flight \
+              cropper. ! queue leaky=no max-size-buffers=10 max-size-bytes=0 max-size-time=0 ! \
+                  identity sleep-time=$main_time_us silent=true ! agg. \
+              cropper. ! queue leaky=no max-size-buffers=40 max-size-bytes=0 max-size-time=0 ! \
+                  identity sleep-time=$crop_time_us silent=true ! agg. \
+              agg. ! queue leaky=no max-size-buffers=3 max-size-bytes=0 max-size-time=0 ! \
+              fakesink name=sink sync=false async=false"
+}
+
+# Runs the pipeline and prints its run time in micro seconds and the mean source to sink latency in micro seconds
+function run_pipeline() {
+    local start end latency
+    local trace_file=$(mktemp)
+
+    start=$(date +%s%N)
+    GST_DEBUG="GST_TRACER:7" GST_DEBUG_FILE=$trace_file GST_TRACERS="interlatency" \
+        gst-launch-1.0 -q $pipeline > /dev/null
+    end=$(date +%s%N)
+
+    # Latency records look like: interlatency, from_pad=(string)..., to_pad=(string)sink_sink, time=(string)0:00:00.012345678;
+    latency=$(grep "to_pad=(string)sink_sink" $trace_file |
+        sed -n 's/.*time=(string)\([0-9]*\):\([0-9]*\):\([0-9.]*\).*/\1 \2 \3/p' |
+        awk '{ sum += ($1 * 3600 + $2 * 60 + $3) * 1000000; count++ } END { if (count > 0) printf "%d", sum / count; else printf "-" }')
+    rm -f $trace_file
+
+    echo "$(((end - start) / 1000)) $latency"
+}
+
+function main() {
+    init_variables $@
+    parse_args $@
+
+    printf "%-15s %-15s %-10s %-20s\n" "max-in-flight" "total [us]" "fps" "mean latency [us]"
+    for in_flight in $in_flight_values; do
+        build_pipeline $in_flight
+        read total latency <<< $(run_pipeline)
+        fps=$((num_buffers * 1000000 / total))
+        printf "%-15s %-15s %-10s %-20s\n" "$in_flight" "$total" "$fps" "$latency"
+    done
+}
+
+main $@
@@ -0,0 +1,125 @@
+#!/bin/bash
+set -e
+
+# Measures the calls per second of hailopython as a function of the number of parallel streams and of
+# the batch-size property. Every stream runs its own hailopython element with a trivial python function,
+# so the measurement is dominated by the GIL and by wrapping the buffers in python objects.
+
+function init_variables() {
+    num_buffers=1000
+    width=640
+    height=480
+    streams_values="1 4 16"
+    batch_sizes="1 4 16"
+    print_help_if_needed $@
+}
+
+function print_usage() {
+    echo "Benchmark hailopython batched calls:"
+    echo ""
+    echo "Options:"
+    echo "  --help                    Show this help"
+    echo "  --num-buffers NUM         Number of buffers to push on every stream in every run (default $num_buffers)"
+    echo "  --width WIDTH             Frame width (default $width)"
+    echo "  --height HEIGHT           Frame height (default $height)"
+    echo "  --streams \"N1 N2 ...\"     Numbers of parallel streams to measure (default \"$streams_values\")"
+    echo "  --batch-sizes \"B1 B2 ...\" Values of batch-size to measure (default \"$batch_sizes\")"
+    exit 0
+}
+
+function print_help_if_needed() {
+    while test $# -gt 0; do
+        if [ "$1" = "--help" ] || [ "$1" == "-h" ]; then
+            print_usage
+        fi
+
+        shift
+    done
+}
+
+function parse_args() {
+    while test $# -gt 0; do
+        if [ "$1" = "--num-buffers" ]; then
+            num_buffers="$2"
+            shift
+        elif [ "$1" = "--width" ]; then
+            width="$2"
+            shift
+        elif [ "$1" = "--height" ]; then
+            height="$2"
+            shift
+        elif [ "$1" = "--streams" ]; then
+            streams_values="$2"
+            shift
+        elif [ "$1" = "--batch-sizes" ]; then
+            batch_sizes="$2"
+            shift
+        else
+            echo "Received invalid argument: $1. See expected arguments below:"
+            print_usage
+            exit 1
+        fi
+
+        shift
+    done
+}
+
+# The python function touches the ROI of every frame, as a minimal postprocess would
+function create_module() {
+    module=$(mktemp --suffix=.py)
+    cat > $module << EOF
+import hailo
+from gi.repository import Gst
+
+
+def run(video_frames):
+    if not isinstance(video_frames, list):
+        video_frames = [video_frames]
+    for video_frame in video_frames:
+        video_frame.roi.get_objects_typed(hailo.HAILO_DETECTION)
+    return Gst.FlowReturn.OK
+EOF
+}
+
+function build_pipeline() {
+    local streams=$1
+    local batch_size=$2
+
+    pipeline=""
+    for ((i = 0; i < streams; i++)); do
+        pipeline+="videotestsrc num-buffers=$num_buffers pattern=black ! \
+                   video/x-raw,format=RGB,width=$width,height=$height ! \
+                   hailopython qos=false module=$module function=run batch-size=$batch_size ! \
+                   queue leaky=no max-size-buffers=$((batch_size + 2)) max-size-bytes=0 max-size-time=0 ! \
+                   fakesink sync=false async=false "
+    done
+}
+
+# Prints the run time of the pipeline in micro seconds
+function run_pipeline() {
+    local start end
+    start=$(date +%s%N)
+    gst-launch-1.0 -q $pipeline > /dev/null
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000))
+}
+
+function main() {
+    init_variables $@
+    parse_args $@
+    create_module
+
+    printf "%-10s %-12s %-15s %-15s\n" "streams" "batch-size" "total [us]" "buffers/s"
+    for streams in $streams_values; do
+        for batch_size in $batch_sizes; do
+            build_pipeline $streams $batch_size
+            total=$(run_pipeline)
+            buffers_per_sec=$((streams * num_buffers * 1000000 / total))
+            printf "%-10s %-12s %-15s %-15s\n" "$streams" "$batch_size" "$total" "$buffers_per_sec"
+        done
+    done
+
+    rm -f $module
+}
+
+main $@
@@ -0,0 +1,120 @@
+#!/bin/bash
+set -e
+
+# Measures the throughput of hailostreamrouter when a single input stream is routed to several
+# src pads, once per fan out mode. A hailofilter adds synthetic detections (each with a classification
+# and a tracking id) to every frame, and every branch adds a classification to each detection,
+# as an attribute network would, so the metadata fan out is part of the measurement.
+
+readonly POSTPROCESS_DIR="$TAPPAS_WORKSPACE/apps/h8/gstreamer/libs/post_processes"
+readonly SYNTHETIC_DETECTIONS_SO="$POSTPROCESS_DIR/libsynthetic_detections.so"
+
+function init_variables() {
+    num_buffers=500
+    width=3840
+    height=2160
+    fan_outs="1 4 8"
+    fan_out_modes="copy shared"
+    num_detections=32
+    print_help_if_needed $@
+}
+
+function print_usage() {
+    echo "Benchmark hailostreamrouter fan out throughput:"
+    echo ""
+    echo "Options:"
+    echo "  --help                  Show this help"
+    echo "  --num-buffers NUM       Number of buffers to push in every run (default $num_buffers)"
+    echo "  --width WIDTH           Frame width (default $width)"
+    echo "  --height HEIGHT         Frame height (default $height)"
+    echo "  --fan-outs \"N1 N2 ...\"  Number of router src pads to measure (default \"$fan_outs\")"
+    echo "  --modes \"M1 M2 ...\"     Fan out modes to measure (default \"$fan_out_modes\")"
+    echo "  --detections NUM        Synthetic detections added to every frame (default $num_detections)"
+    exit 0
+}
+
+function print_help_if_needed() {
+    while test $# -gt 0; do
+        if [ "$1" = "--help" ] || [ "$1" == "-h" ]; then
+            print_usage
+        fi
+
+        shift
+    done
+}
+
+function parse_args() {
+    while test $# -gt 0; do
+        if [ "$1" = "--num-buffers" ]; then
+            num_buffers="$2"
+            shift
+        elif [ "$1" = "--width" ]; then
+            width="$2"
+            shift
+        elif [ "$1" = "--height" ]; then
+            height="$2"
+            shift
+        elif [ "$1" = "--fan-outs" ]; then
+            fan_outs="$2"
+            shift
+        elif [ "$1" = "--modes" ]; then
+            fan_out_modes="$2"
+            shift
+        elif [ "$1" = "--detections" ]; then
+            num_detections="$2"
+            shift
+        else
+            echo "Received invalid argument: $1. See expected arguments below:"
+            print_usage
+            exit 1
+        fi
+
+        shift
+    done
+}
+
+function build_pipeline() {
+    local fan_out=$1
+    local mode=$2
+    local router_pads=""
+    local branches=""
+    for ((i = 0; i < fan_out; i++)); do
+        router_pads+="src_$i::input-streams=\"<sink_0>\" "
+        branches+="router.src_$i ! queue leaky=no max-size-buffers=5 max-size-bytes=0 max-size-time=0 ! \
+                   hailofilter so-path=$SYNTHETIC_DETECTIONS_SO function-name=classify_detections qos=false ! \
+                   fakesink sync=false async=false "
+    done
+
+    pipeline="videotestsrc num-buffers=$num_buffers pattern=black ! \
+              video/x-raw,format=NV12,width=$width,height=$height ! \
+              roundrobin.sink_0 hailoroundrobin name=roundrobin mode=funnel-mode ! \
+              hailofilter so-path=$SYNTHETIC_DETECTIONS_SO config-path=$num_detections qos=false ! \
+              hailostreamrouter name=router fan-out-mode=$mode $router_pads \
+              $branches"
+}
+
+# Prints the run time of the pipeline in micro seconds
+function run_pipeline() {
+    local start end
+    start=$(date +%s%N)
+    eval gst-launch-1.0 -q $pipeline > /dev/null
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000))
+}
+
+function main() {
+    init_variables $@
+    parse_args $@
+
+    printf "%-10s %-10s %-12s %-15s %-10s\n" "fan-out" "mode" "detections" "total [us]" "fps"
+    for fan_out in $fan_outs; do
+        for mode in $fan_out_modes; do
+            build_pipeline $fan_out $mode
+            total=$(run_pipeline)
+            fps=$((num_buffers * 1000000 / total))
+            printf "%-10s %-10s %-12s %-15s %-10s\n" "$fan_out" "$mode" "$num_detections" "$total" "$fps"
+        done
+    done
+}
+
+main $@
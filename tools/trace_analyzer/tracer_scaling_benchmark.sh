@@ -0,0 +1,98 @@
+#!/bin/bash
+set -e
+
+# Measures the per buffer cost of the tracers as a function of the pipeline size.
+# Each run pushes buffers through a chain of identity elements, once without tracers
+# and once per requested tracer, and reports the added time per buffer per element.
+
+function init_variables() {
+    num_buffers=5000
+    pipeline_sizes="10 25 50 100 200"
+    tracers_list="proctime;interlatency;proctime(mode=aggregate);interlatency(mode=aggregate)"
+    print_help_if_needed $@
+}
+
+function print_usage() {
+    echo "Benchmark tracers cost versus pipeline size:"
+    echo ""
+    echo "Options:"
+    echo "  --help                  Show this help"
+    echo "  --num-buffers NUM       Number of buffers to push in every run (default $num_buffers)"
+    echo "  --sizes \"N1 N2 ...\"     Number of elements in the measured pipelines (default \"$pipeline_sizes\")"
+    echo "  --tracers \"T1;T2;...\"   Tracers to measure, each one is measured separately"
+    exit 0
+}
+
+function print_help_if_needed() {
+    while test $# -gt 0; do
+        if [ "$1" = "--help" ] || [ "$1" == "-h" ]; then
+            print_usage
+        fi
+
+        shift
+    done
+}
+
+function parse_args() {
+    while test $# -gt 0; do
+        if [ "$1" = "--num-buffers" ]; then
+            num_buffers="$2"
+            shift
+        elif [ "$1" = "--sizes" ]; then
+            pipeline_sizes="$2"
+            shift
+        elif [ "$1" = "--tracers" ]; then
+            tracers_list="$2"
+            shift
+        else
+            echo "Received invalid argument: $1. See expected arguments below:"
+            print_usage
+            exit 1
+        fi
+
+        shift
+    done
+}
+
+function build_pipeline() {
+    local size=$1
+    pipeline="fakesrc num-buffers=$num_buffers sizetype=fixed sizemax=64 ! "
+    for ((i = 0; i < size; i++)); do
+        pipeline+="identity name=identity_$i silent=true ! "
+    done
+    pipeline+="fakesink sync=false async=false"
+}
+
+# Prints the run time of the pipeline in micro seconds
+function run_pipeline() {
+    local start end
+    start=$(date +%s%N)
+    gst-launch-1.0 -q $pipeline > /dev/null
+    end=$(date +%s%N)
+    echo $(((end - start) / 1000))
+}
+
+function main() {
+    init_variables $@
+    parse_args $@
+
+    # Trace records are generated but not written, so only the tracer cost is measured
+    export GST_DEBUG="GST_TRACER:7"
+    export GST_DEBUG_FILE=/dev/null
+    IFS=';' read -ra tracers <<< "$tracers_list"
+
+    printf "%-10s %-35s %-15s %-20s\n" "elements" "tracer" "total [us]" "overhead [ns/buf/elem]"
+    for size in $pipeline_sizes; do
+        build_pipeline $size
+        baseline=$(GST_TRACERS="" run_pipeline)
+        printf "%-10s %-35s %-15s %-20s\n" "$size" "none" "$baseline" "-"
+
+        for tracer in "${tracers[@]}"; do
+            total=$(GST_TRACERS="$tracer" run_pipeline)
+            overhead=$(((total - baseline) * 1000 / (num_buffers * size)))
+            printf "%-10s %-35s %-15s %-20s\n" "$size" "$tracer" "$total" "$overhead"
+        done
+    done
+}
+
+main $@